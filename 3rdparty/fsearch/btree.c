@@ -24,40 +24,266 @@
 #include "btree.h"
 #include "string_utils.h"
 
+#define BTREE_ARENA_CHUNK_SIZE (1 << BTREE_ARENA_CHUNK_SHIFT)
+// name offsets hold the chunk index above the offset in the chunk
+#define BTREE_ARENA_MAX_CHUNKS (1u << (32 - BTREE_ARENA_CHUNK_SHIFT))
+#define BTREE_ARENA_COLUMN_SHIFT 16
+#define BTREE_ARENA_COLUMN_SIZE (1 << BTREE_ARENA_COLUMN_SHIFT)
+#define BTREE_NODE_MAX_ID ((1u << 30) - 1)
+
+struct _BTreeArena {
+    // chunks in allocation order, node ids grow along with them
+    char **chunks;
+    // id of the first node of every chunk
+    uint32_t *chunk_ids;
+    uint32_t num_chunks;
+    uint32_t max_chunks;
+    // bytes used of the last chunk
+    size_t chunk_used;
+    size_t used;
+
+    // size and mtime of node id are at [id >> COLUMN_SHIFT][id % COLUMN_SIZE],
+    // the columns grow by whole blocks so they never move
+    int64_t **sizes;
+    int64_t **mtimes;
+    uint32_t num_blocks;
+    uint32_t num_nodes;
+};
+
+static inline size_t
+btree_node_record_size (size_t name_len)
+{
+    // keep the following node aligned
+    const size_t align = sizeof (void *);
+    return (sizeof (BTreeNode) + name_len + 1 + align - 1) & ~(align - 1);
+}
+
+static void
+btree_node_init (BTreeNode *node,
+                 const char *name,
+                 size_t name_len,
+                 uint32_t pos,
+                 bool is_dir)
+{
+    node->parent = NULL;
+    node->children = NULL;
+    node->next = NULL;
+
+    // data
+    memcpy (node->name, name, name_len + 1);
+    node->pos = pos;
+    node->id = 0;
+    node->is_dir = is_dir;
+}
+
 BTreeNode *
 btree_node_new (const char *name,
-                time_t mtime,
-                off_t size,
                 uint32_t pos,
                 bool is_dir)
 {
-    BTreeNode *temNew = calloc (1, sizeof (BTreeNode));
+    const size_t name_len = strlen (name);
+    BTreeNode *temNew = malloc (sizeof (BTreeNode) + name_len + 1);
     assert (temNew);
 
-    temNew->parent = NULL;
-    temNew->children = NULL;
-    temNew->next = NULL;
+    btree_node_init (temNew, name, name_len, pos, is_dir);
+    temNew->in_arena = false;
+    return temNew;
+}
 
-    // data
-    temNew->name = strdup (name);
-    temNew->mtime = mtime;
-    temNew->size = size;
-    temNew->pos = pos;
-    temNew->is_dir = is_dir;
+BTreeArena *
+btree_arena_new (void)
+{
+    BTreeArena *arena = calloc (1, sizeof (BTreeArena));
+    assert (arena);
+    return arena;
+}
+
+void
+btree_arena_free (BTreeArena *arena)
+{
+    if (!arena) {
+        return;
+    }
+    for (uint32_t i = 0; i < arena->num_chunks; i++) {
+        free (arena->chunks[i]);
+    }
+    free (arena->chunks);
+    free (arena->chunk_ids);
+    for (uint32_t i = 0; i < arena->num_blocks; i++) {
+        free (arena->sizes[i]);
+        free (arena->mtimes[i]);
+    }
+    free (arena->sizes);
+    free (arena->mtimes);
+    free (arena);
+}
+
+size_t
+btree_arena_get_used (BTreeArena *arena)
+{
+    assert (arena);
+    return arena->used + (size_t)arena->num_blocks * BTREE_ARENA_COLUMN_SIZE * 2 * sizeof (int64_t);
+}
+
+static void *
+btree_arena_alloc (BTreeArena *arena, size_t size)
+{
+    assert (size <= BTREE_ARENA_CHUNK_SIZE);
+    if (!arena->num_chunks || BTREE_ARENA_CHUNK_SIZE - arena->chunk_used < size) {
+        if (arena->num_chunks == arena->max_chunks) {
+            arena->max_chunks = arena->max_chunks ? arena->max_chunks * 2 : 16;
+            arena->chunks = realloc (arena->chunks, arena->max_chunks * sizeof (char *));
+            arena->chunk_ids = realloc (arena->chunk_ids, arena->max_chunks * sizeof (uint32_t));
+            assert (arena->chunks && arena->chunk_ids);
+        }
+        char *chunk = malloc (BTREE_ARENA_CHUNK_SIZE);
+        assert (chunk);
+        arena->chunks[arena->num_chunks] = chunk;
+        arena->chunk_ids[arena->num_chunks] = arena->num_nodes;
+        arena->num_chunks++;
+        arena->chunk_used = 0;
+    }
+    void *ptr = arena->chunks[arena->num_chunks - 1] + arena->chunk_used;
+    arena->chunk_used += size;
+    arena->used += size;
+    return ptr;
+}
 
+static void
+btree_arena_set_stat (BTreeArena *arena, uint32_t id, time_t mtime, off_t size)
+{
+    const uint32_t block = id >> BTREE_ARENA_COLUMN_SHIFT;
+    if (block == arena->num_blocks) {
+        arena->sizes = realloc (arena->sizes, (block + 1) * sizeof (int64_t *));
+        arena->mtimes = realloc (arena->mtimes, (block + 1) * sizeof (int64_t *));
+        assert (arena->sizes && arena->mtimes);
+        arena->sizes[block] = malloc (BTREE_ARENA_COLUMN_SIZE * sizeof (int64_t));
+        arena->mtimes[block] = malloc (BTREE_ARENA_COLUMN_SIZE * sizeof (int64_t));
+        assert (arena->sizes[block] && arena->mtimes[block]);
+        arena->num_blocks++;
+    }
+    arena->sizes[block][id % BTREE_ARENA_COLUMN_SIZE] = size;
+    arena->mtimes[block][id % BTREE_ARENA_COLUMN_SIZE] = mtime;
+}
+
+BTreeNode *
+btree_node_new_in (BTreeArena *arena,
+                   const char *name,
+                   time_t mtime,
+                   off_t size,
+                   uint32_t pos,
+                   bool is_dir)
+{
+    if (!arena) {
+        return btree_node_new (name, pos, is_dir);
+    }
+    assert (arena->num_nodes <= BTREE_NODE_MAX_ID);
+    const size_t name_len = strlen (name);
+    BTreeNode *temNew = btree_arena_alloc (arena, btree_node_record_size (name_len));
+
+    btree_node_init (temNew, name, name_len, pos, is_dir);
+    temNew->id = arena->num_nodes++;
+    temNew->in_arena = true;
+    btree_arena_set_stat (arena, temNew->id, mtime, size);
     return temNew;
 }
 
+uint32_t
+btree_arena_get_name_offset (const BTreeArena *arena, const BTreeNode *node)
+{
+    assert (arena);
+    assert (node);
+    if (!node->in_arena || node->id >= arena->num_nodes || arena->num_chunks > BTREE_ARENA_MAX_CHUNKS) {
+        return BTREE_ARENA_NO_OFFSET;
+    }
+
+    // the last chunk whose first node isn't newer than node
+    uint32_t first = 0;
+    uint32_t last = arena->num_chunks - 1;
+    while (first < last) {
+        const uint32_t mid = first + (last - first + 1) / 2;
+        if (arena->chunk_ids[mid] <= node->id) {
+            first = mid;
+        }
+        else {
+            last = mid - 1;
+        }
+    }
+    const uintptr_t chunk = (uintptr_t)arena->chunks[first];
+    const uintptr_t name = (uintptr_t)node->name;
+    if (name < chunk || name - chunk >= BTREE_ARENA_CHUNK_SIZE) {
+        // node belongs to another arena
+        return BTREE_ARENA_NO_OFFSET;
+    }
+    return (first << BTREE_ARENA_CHUNK_SHIFT) | (uint32_t)(name - chunk);
+}
+
+const char *
+btree_arena_get_name (const BTreeArena *arena, uint32_t offset)
+{
+    return arena->chunks[offset >> BTREE_ARENA_CHUNK_SHIFT] + (offset & (BTREE_ARENA_CHUNK_SIZE - 1));
+}
+
+off_t
+btree_node_get_size (const BTreeArena *arena, const BTreeNode *node)
+{
+    assert (node);
+    if (!arena || !node->in_arena || node->id >= arena->num_nodes) {
+        return 0;
+    }
+    return arena->sizes[node->id >> BTREE_ARENA_COLUMN_SHIFT][node->id % BTREE_ARENA_COLUMN_SIZE];
+}
+
+time_t
+btree_node_get_mtime (const BTreeArena *arena, const BTreeNode *node)
+{
+    assert (node);
+    if (!arena || !node->in_arena || node->id >= arena->num_nodes) {
+        return 0;
+    }
+    return arena->mtimes[node->id >> BTREE_ARENA_COLUMN_SHIFT][node->id % BTREE_ARENA_COLUMN_SIZE];
+}
+
+BTreeNode *
+btree_node_copy (BTreeArena *arena, const BTreeArena *from, BTreeNode *node)
+{
+    assert (node);
+    return btree_node_new_in (arena,
+                              node->name,
+                              btree_node_get_mtime (from, node),
+                              btree_node_get_size (from, node),
+                              node->pos,
+                              node->is_dir);
+}
+
+BTreeNode *
+btree_node_clone (BTreeArena *arena, const BTreeArena *from, BTreeNode *node)
+{
+    assert (node);
+    BTreeNode *copy = btree_node_copy (arena, from, node);
+
+    // keep the order of the children
+    BTreeNode *tail = NULL;
+    for (BTreeNode *child = node->children; child; child = child->next) {
+        BTreeNode *child_copy = btree_node_clone (arena, from, child);
+        child_copy->parent = copy;
+        if (tail) {
+            tail->next = child_copy;
+        }
+        else {
+            copy->children = child_copy;
+        }
+        tail = child_copy;
+    }
+    return copy;
+}
+
 static void
 btree_node_data_free (BTreeNode *node)
 {
-    if (!node) {
+    if (!node || node->in_arena) {
         return;
     }
-    if (node->name) {
-        free (node->name);
-        node->name = NULL;
-    }
     free (node);
     node = NULL;
 }
@@ -23,6 +23,12 @@
 #include <stdint.h>
 
 typedef struct _BTreeNode BTreeNode;
+typedef struct _BTreeArena BTreeArena;
+
+#define BTREE_ARENA_NO_OFFSET UINT32_MAX
+// name offsets hold the index of the arena chunk above this bit, the
+// names of one chunk are contiguous in memory
+#define BTREE_ARENA_CHUNK_SHIFT 20
 
 struct _BTreeNode {
     BTreeNode *next;
@@ -30,21 +36,69 @@ struct _BTreeNode {
     BTreeNode *children;
 
     // data
-    char *name;
-
-    time_t mtime;
-    off_t size;
     uint32_t pos;
-    bool is_dir;
+    // index of the size and mtime in the columns of the arena
+    uint32_t id : 30;
+    uint32_t is_dir : 1;
+    // the node belongs to a BTreeArena and is released with it
+    uint32_t in_arena : 1;
+    // stored right behind the node, the only copy of the name
+    char name[];
 };
 
+// node without size and mtime, which are only kept by arenas
 BTreeNode *
 btree_node_new(const char *name,
-               time_t mtime,
-               off_t size,
                uint32_t pos,
                bool is_dir);
 
+// Bump allocator for the nodes of one tree: nodes are packed into large
+// chunks and freeing a node only unlinks it, the memory is released when
+// the arena is freed. Size and mtime of the nodes are kept in columns
+// indexed by node id instead of in the nodes.
+BTreeArena *
+btree_arena_new(void);
+
+void
+btree_arena_free(BTreeArena *arena);
+
+// bytes taken from the arena, including those of nodes freed since and
+// the size and mtime columns
+size_t
+btree_arena_get_used(BTreeArena *arena);
+
+BTreeNode *
+btree_node_new_in(BTreeArena *arena,
+                  const char *name,
+                  time_t mtime,
+                  off_t size,
+                  uint32_t pos,
+                  bool is_dir);
+
+// 32-bit offset of the name of node in arena, BTREE_ARENA_NO_OFFSET if
+// node doesn't belong to arena or the arena outgrew the offsets
+uint32_t
+btree_arena_get_name_offset(const BTreeArena *arena, const BTreeNode *node);
+
+// name at an offset returned by btree_arena_get_name_offset
+const char *
+btree_arena_get_name(const BTreeArena *arena, uint32_t offset);
+
+// 0 for nodes which don't belong to arena
+off_t
+btree_node_get_size(const BTreeArena *arena, const BTreeNode *node);
+
+time_t
+btree_node_get_mtime(const BTreeArena *arena, const BTreeNode *node);
+
+// copy of node, which belongs to from, in arena without the links
+BTreeNode *
+btree_node_copy(BTreeArena *arena, const BTreeArena *from, BTreeNode *node);
+
+// deep copy of node and all its children, which belong to from, into arena
+BTreeNode *
+btree_node_clone(BTreeArena *arena, const BTreeArena *from, BTreeNode *node);
+
 void
 btree_node_free(BTreeNode *node);
 
@@ -35,6 +35,7 @@
 #include <regex.h>
 
 #include "database.h"
+#include "entry_table.h"
 #include "fsearch_config.h"
 #include "fsearch.h"
 //#include "debug.h"
@@ -48,6 +49,9 @@ struct _Database
     GList *searches;
     DynamicArray *entries;
     uint32_t num_entries;
+    // built with the entries list and patched along with it when changes
+    // are applied, built on demand after any other change
+    FsearchEntryTable *entry_table;
 
     time_t timestamp;
 
@@ -59,6 +63,10 @@ struct _DatabaseLocation
     // B+ tree of entry nodes
     BTreeNode *entries;
     uint32_t num_items;
+    // all nodes of the tree are allocated from here
+    BTreeArena *arena;
+    // nodes removed from the tree whose memory is still held by the arena
+    uint32_t num_removed;
 };
 
 enum {
@@ -72,11 +80,17 @@ enum {
 static void
 db_entries_clear (Database *db);
 
+static void
+db_entry_table_clear (Database *db);
+
+static bool
+db_location_relayout (Database *db, DatabaseLocation *location);
+
 static DatabaseLocation *
 db_location_get_for_path (Database *db, const char *path);
 
 static DatabaseLocation *
-db_location_build_tree (const char *dname, FsearchConfig *cfg, bool *state, void (*callback)(const char *));
+db_location_build_tree (const char *dname, FsearchConfig *cfg, gint *state, void (*callback)(const char *));
 
 static DatabaseLocation *
 db_location_new (void);
@@ -84,6 +98,9 @@ db_location_new (void);
 static void
 db_list_add_location (Database *db, DatabaseLocation *location);
 
+static int
+sort_by_name (const void *a, const void *b);
+
 // Implemenation
 
 static void
@@ -103,6 +120,7 @@ db_location_load_from_file (const char *fname)
         return NULL;
     }
 
+    DatabaseLocation *location = db_location_new ();
     BTreeNode *root = NULL;
 
     char magic[4];
@@ -199,11 +217,12 @@ db_location_load_from_file (const char *fname)
         }
 
         int is_root = !strcmp (name, "/");
-        BTreeNode *new = btree_node_new (is_root ? "" : name,
-                                         mtime,
-                                         size,
-                                         pos,
-                                         is_dir);
+        BTreeNode *new = btree_node_new_in (location->arena,
+                                            is_root ? "" : name,
+                                            mtime,
+                                            size,
+                                            pos,
+                                            is_dir);
         if (!prev) {
             prev = new;
             root = new;
@@ -214,7 +233,6 @@ db_location_load_from_file (const char *fname)
     }
 //    trace ("read database: %d/%d\n", num_items_read, num_items);
 
-    DatabaseLocation *location = db_location_new ();
     location->num_items = num_items_read;
     location->entries = root;
 
@@ -227,9 +245,8 @@ load_fail:
     if (fp) {
         fclose (fp);
     }
-    if (root) {
-        btree_node_free (root);
-    }
+    location->entries = root;
+    db_location_free (location);
     return NULL;
 }
 
@@ -298,13 +315,13 @@ db_location_write_to_file (DatabaseLocation *location, const char *path)
             }
 
             // write node name
-            uint64_t size = node->size;
+            uint64_t size = btree_node_get_size (location->arena, node);
             if (fwrite (&size, 1, 8, fp) != 8) {
                 goto save_fail;
             }
 
             // write node name
-            uint64_t mtime = node->mtime;
+            uint64_t mtime = btree_node_get_mtime (location->arena, node);
             if (fwrite (&mtime, 1, 8, fp) != 8) {
                 goto save_fail;
             }
@@ -398,10 +415,10 @@ db_location_walk_tree_recursive (DatabaseLocation *location,
                                  void (*callback)(const char *),
                                  BTreeNode *parent,
                                  int spec,
-                                 bool *state,
+                                 gint *state,
                                  bool is_data_prefix)
 {
-    if (!(*state))
+    if (!g_atomic_int_get (state))
         return WALK_OK;
 
     if (!db_support(dname, is_data_prefix)) {
@@ -437,7 +454,7 @@ db_location_walk_tree_recursive (DatabaseLocation *location,
     }
 
     struct dirent *dent = NULL;
-    while ((*state) && (dent = readdir (dir))) {
+    while (g_atomic_int_get (state) && (dent = readdir (dir))) {
         if (!strcmp (dent->d_name, ".") || !strcmp (dent->d_name, "..") || dent->d_name[0] == '.') {
             continue;
         }
@@ -460,11 +477,12 @@ db_location_walk_tree_recursive (DatabaseLocation *location,
         }
 
         const bool is_dir = S_ISDIR (st.st_mode);
-        BTreeNode *node = btree_node_new (dent->d_name,
-                                          st.st_mtime,
-                                          st.st_size,
-                                          0,
-                                          is_dir);
+        BTreeNode *node = btree_node_new_in (location->arena,
+                                             dent->d_name,
+                                             st.st_mtime,
+                                             st.st_size,
+                                             0,
+                                             is_dir);
         btree_node_prepend (parent, node);
         location->num_items++;
         if (is_dir) {
@@ -489,7 +507,7 @@ db_location_walk_tree_recursive (DatabaseLocation *location,
 }
 
 static DatabaseLocation *
-db_location_build_tree (const char *dname, FsearchConfig *cfg, bool *state, void (*callback)(const char *))
+db_location_build_tree (const char *dname, FsearchConfig *cfg, gint *state, void (*callback)(const char *))
 {
     const char *root_name = NULL;
     if (!strcmp (dname, "/")) {
@@ -498,8 +516,8 @@ db_location_build_tree (const char *dname, FsearchConfig *cfg, bool *state, void
     else {
         root_name = dname;
     }
-    BTreeNode *root = btree_node_new (root_name, 0, 0, 0, true);
     DatabaseLocation *location = db_location_new ();
+    BTreeNode *root = btree_node_new_in (location->arena, root_name, 0, 0, 0, true);
     location->entries = root;
     FsearchConfig *config = cfg;
 
@@ -535,6 +553,7 @@ static DatabaseLocation *
 db_location_new (void)
 {
     DatabaseLocation *location = g_new0 (DatabaseLocation, 1);
+    location->arena = btree_arena_new ();
     return location;
 }
 
@@ -553,13 +572,13 @@ db_traverse_tree_insert (BTreeNode *node, void *data)
     btree_node_traverse (node, db_list_insert_node, data);
 }
 
-static uint32_t temp_index = 0;
-
 bool
 db_list_add_node (BTreeNode *node, void *data)
 {
     Database *db = data;
-    darray_set_item (db->entries, node, temp_index++);
+    // num_entries doubles as the insert position, several databases may be
+    // rebuilt concurrently so no shared counter is used here
+    darray_set_item (db->entries, node, db->num_entries);
     db->num_entries++;
     return true;
 }
@@ -614,10 +633,10 @@ db_location_free (DatabaseLocation *location)
 {
     assert (location != NULL);
 
-    if (location->entries) {
-        btree_node_free (location->entries);
-        location->entries = NULL;
-    }
+    // the arena holds every node of the tree, no need to walk it
+    location->entries = NULL;
+    btree_arena_free (location->arena);
+    location->arena = NULL;
     g_free (location);
     location = NULL;
 }
@@ -762,7 +781,7 @@ bool
 db_location_add (Database *db,
                  const char *location_name,
                  FsearchConfig *config,
-                 bool *state,
+                 gint *state,
                  void (*callback)(const char *))
 {
     assert (db != NULL);
@@ -814,25 +833,35 @@ db_locations_get_num_entries (Database *db)
     return num_entries;
 }
 
-void
-db_build_initial_entries_list (Database *db)
+static void
+db_build_entries_list_unlocked (Database *db)
 {
-    assert (db != NULL);
-    assert (db->num_entries >= 0);
-
-    db_lock (db);
     db_entries_clear (db);
     uint32_t num_entries = db_locations_get_num_entries (db);
 //    trace ("update list: %d\n", num_entries);
     db->entries = darray_new (num_entries);
 
     GList *locations = db->locations;
-    temp_index = 0;
     for (GList *l = locations; l != NULL; l = l->next) {
         db_list_add_location (db, l->data);
     }
     db_sort (db);
     db_update_sort_index (db);
+}
+
+void
+db_build_initial_entries_list (Database *db)
+{
+    assert (db != NULL);
+    assert (db->num_entries >= 0);
+
+    db_lock (db);
+    db_build_entries_list_unlocked (db);
+    if (db->locations && !db->locations->next) {
+        db_location_relayout (db, db->locations->data);
+    }
+    // built here, usually off the search path, and kept up to date from now on
+    db_get_entry_table (db);
     db_unlock (db);
 }
 
@@ -862,6 +891,527 @@ db_location_get_entries (DatabaseLocation *location)
     return location->entries;
 }
 
+static DatabaseLocation *
+db_location_get_for_sub_path (Database *db, const char *path, const char **relative)
+{
+    for (GList *l = db->locations; l != NULL; l = l->next) {
+        DatabaseLocation *location = l->data;
+        const char *root_path = location->entries->name;
+        const size_t len = strlen (root_path);
+        if (strncmp (path, root_path, len)) {
+            continue;
+        }
+        if (path[len] != '\0' && path[len] != '/') {
+            continue;
+        }
+        *relative = path + len;
+        return location;
+    }
+    return NULL;
+}
+
+static BTreeNode *
+db_node_find_child (BTreeNode *parent, const char *name, size_t name_len)
+{
+    for (BTreeNode *child = parent->children; child; child = child->next) {
+        if (!strncmp (child->name, name, name_len) && child->name[name_len] == '\0') {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+static BTreeNode *
+db_location_lookup (DatabaseLocation *location, const char *relative)
+{
+    BTreeNode *node = location->entries;
+    const char *ptr = relative;
+    while (node) {
+        while (*ptr == '/') {
+            ptr++;
+        }
+        if (*ptr == '\0') {
+            break;
+        }
+        const char *end = strchrnul (ptr, '/');
+        node = db_node_find_child (node, ptr, end - ptr);
+        ptr = end;
+    }
+    return node;
+}
+
+BTreeNode *
+db_location_find_node (Database *db, const char *path)
+{
+    assert (db != NULL);
+    assert (path != NULL);
+
+    const char *relative = NULL;
+    DatabaseLocation *location = db_location_get_for_sub_path (db, path, &relative);
+    if (!location) {
+        return NULL;
+    }
+    return db_location_lookup (location, relative);
+}
+
+#define DB_ENTRY_NOT_FOUND UINT32_MAX
+
+// Nodes touched by one db_location_apply_changes call, the sorted entries
+// list is patched with them instead of being rebuilt and sorted again.
+typedef struct {
+    Database *db;
+    // one bit per entries index, set for entries removed from the trees
+    guint8 *removed;
+    uint32_t num_removed;
+    // top nodes of the inserted subtrees
+    GPtrArray *inserted;
+} DatabaseChanges;
+
+// index of node in the entries list, node->pos is only a hint
+static uint32_t
+db_entries_find_node (Database *db, BTreeNode *node)
+{
+    if (node->pos < db->num_entries && darray_get_item (db->entries, node->pos) == node) {
+        return node->pos;
+    }
+
+    // the list is sorted by name, look through the entries with the same name
+    uint32_t first = 0;
+    uint32_t last = db->num_entries;
+    while (first < last) {
+        const uint32_t mid = first + (last - first) / 2;
+        BTreeNode *item = darray_get_item (db->entries, mid);
+        if (sort_by_name (&item, &node) < 0) {
+            first = mid + 1;
+        }
+        else {
+            last = mid;
+        }
+    }
+    for (; first < db->num_entries; first++) {
+        BTreeNode *item = darray_get_item (db->entries, first);
+        if (item == node) {
+            return first;
+        }
+        if (sort_by_name (&item, &node)) {
+            break;
+        }
+    }
+    return DB_ENTRY_NOT_FOUND;
+}
+
+static bool
+db_changes_remove_node (BTreeNode *node, void *data)
+{
+    DatabaseChanges *changes = data;
+    Database *db = changes->db;
+    const uint32_t idx = db_entries_find_node (db, node);
+    if (idx == DB_ENTRY_NOT_FOUND) {
+        // inserted by this batch, not part of the list yet
+        return true;
+    }
+    if (!changes->removed) {
+        changes->removed = g_new0 (guint8, db->num_entries / 8 + 1);
+    }
+    if (!(changes->removed[idx / 8] & (1 << (idx % 8)))) {
+        changes->removed[idx / 8] |= 1 << (idx % 8);
+        changes->num_removed++;
+    }
+    return true;
+}
+
+// must be called before node is freed
+static void
+db_changes_remove (DatabaseChanges *changes, BTreeNode *node)
+{
+    if (changes->db->entries) {
+        btree_node_traverse (node, db_changes_remove_node, changes);
+    }
+}
+
+static bool
+db_changes_is_removed (DatabaseChanges *changes, uint32_t idx)
+{
+    return changes->removed && (changes->removed[idx / 8] & (1 << (idx % 8)));
+}
+
+static bool
+db_is_location_root (Database *db, BTreeNode *node)
+{
+    for (GList *l = db->locations; l != NULL; l = l->next) {
+        DatabaseLocation *location = l->data;
+        if (location->entries == node) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool
+db_changes_add_node (BTreeNode *node, void *data)
+{
+    g_ptr_array_add (data, node);
+    return true;
+}
+
+// All nodes of the inserted subtrees which are still part of a tree. A
+// subtree may have been replaced later in the same batch, or it may lie in a
+// subtree inserted after it, only subtrees directly below old entries count.
+static GPtrArray *
+db_changes_get_added_nodes (DatabaseChanges *changes)
+{
+    Database *db = changes->db;
+    GPtrArray *added = g_ptr_array_new ();
+    for (guint i = 0; i < changes->inserted->len; i++) {
+        BTreeNode *top = g_ptr_array_index (changes->inserted, i);
+        BTreeNode *parent = top->parent;
+        while (parent && parent->parent) {
+            if (db_entries_find_node (db, parent) == DB_ENTRY_NOT_FOUND) {
+                break;
+            }
+            parent = parent->parent;
+        }
+        if (parent && !parent->parent && db_is_location_root (db, parent)) {
+            btree_node_traverse (top, db_changes_add_node, added);
+        }
+    }
+    g_ptr_array_sort (added, sort_by_name);
+    return added;
+}
+
+// Merges the sorted inserted nodes into the sorted entries list and drops the
+// removed ones in one pass, node->pos and the entry table are kept in sync
+// with the new list.
+static void
+db_entries_apply_changes (Database *db, DatabaseChanges *changes)
+{
+    GPtrArray *added = db_changes_get_added_nodes (changes);
+    if (!changes->num_removed && !added->len) {
+        g_ptr_array_free (added, TRUE);
+        return;
+    }
+
+    const uint32_t num_entries = db->num_entries - changes->num_removed + added->len;
+    DynamicArray *entries = darray_new (num_entries);
+    // old index of every new entry, only needed to carry the table over
+    FsearchEntryTable *table = db->entry_table;
+    uint32_t *sources = table ? g_new (uint32_t, num_entries) : NULL;
+    uint32_t j = 0;
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < db->num_entries; i++) {
+        if (db_changes_is_removed (changes, i)) {
+            continue;
+        }
+        BTreeNode *node = darray_get_item (db->entries, i);
+        while (j < added->len && sort_by_name (&added->pdata[j], &node) < 0) {
+            BTreeNode *new_node = g_ptr_array_index (added, j++);
+            new_node->pos = k;
+            if (sources) {
+                sources[k] = FS_ENTRY_NO_PARENT;
+            }
+            darray_set_item (entries, new_node, k++);
+        }
+        if (i != k) {
+            node->pos = k;
+        }
+        if (sources) {
+            sources[k] = i;
+        }
+        darray_set_item (entries, node, k++);
+    }
+    while (j < added->len) {
+        BTreeNode *new_node = g_ptr_array_index (added, j++);
+        new_node->pos = k;
+        if (sources) {
+            sources[k] = FS_ENTRY_NO_PARENT;
+        }
+        darray_set_item (entries, new_node, k++);
+    }
+    g_ptr_array_free (added, TRUE);
+
+    // the old table still describes the old list, keep it from being freed
+    db->entry_table = NULL;
+    db_entries_clear (db);
+    db->entries = entries;
+    db->num_entries = num_entries;
+    if (table) {
+        db->entry_table = fs_entry_table_update (table, entries, num_entries, sources);
+        fs_entry_table_free (table);
+        g_free (sources);
+    }
+}
+
+static void
+db_location_remove_path (Database *db, DatabaseChanges *changes, const char *path)
+{
+    const char *relative = NULL;
+    DatabaseLocation *location = db_location_get_for_sub_path (db, path, &relative);
+    if (!location) {
+        return;
+    }
+    BTreeNode *node = db_location_lookup (location, relative);
+    if (!node || node == location->entries) {
+        return;
+    }
+    const uint32_t num_nodes = btree_node_n_nodes (node);
+    location->num_items -= num_nodes;
+    location->num_removed += num_nodes;
+    db_changes_remove (changes, node);
+    btree_node_free (node);
+}
+
+static void
+db_location_insert_path (Database *db,
+                         DatabaseChanges *changes,
+                         const char *path,
+                         FsearchConfig *config,
+                         GTimer *timer)
+{
+    const char *relative = NULL;
+    DatabaseLocation *location = db_location_get_for_sub_path (db, path, &relative);
+    if (!location) {
+        return;
+    }
+
+    const char *name = strrchr (path, '/');
+    if (!name || name[1] == '\0' || name[1] == '.') {
+        // hidden items are never part of the database, see the walker
+        return;
+    }
+    name++;
+    if (file_is_excluded (name, config->exclude_files)
+            || directory_is_excluded (path, config->exclude_locations)) {
+        return;
+    }
+
+    const size_t parent_len = name - 1 - path;
+    char parent_path[PATH_MAX] = "";
+    if (parent_len >= sizeof (parent_path)) {
+        return;
+    }
+    strncpy (parent_path, path, parent_len);
+    parent_path[parent_len] = '\0';
+
+    const char *parent_relative = parent_path + (relative - path);
+    if ((size_t)(relative - path) > parent_len) {
+        // the location root itself
+        return;
+    }
+    BTreeNode *parent = db_location_lookup (location, parent_relative);
+    if (!parent || !parent->is_dir) {
+        return;
+    }
+
+    // replace a stale entry instead of adding a duplicate
+    BTreeNode *old = db_node_find_child (parent, name, strlen (name));
+    if (old) {
+        const uint32_t num_nodes = btree_node_n_nodes (old);
+        location->num_items -= num_nodes;
+        location->num_removed += num_nodes;
+        db_changes_remove (changes, old);
+        btree_node_free (old);
+    }
+
+    struct stat st;
+    if (lstat (path, &st) == -1) {
+        return;
+    }
+
+    const bool is_dir = S_ISDIR (st.st_mode);
+    BTreeNode *node = btree_node_new_in (location->arena, name, st.st_mtime, st.st_size, 0, is_dir);
+    btree_node_prepend (parent, node);
+    location->num_items++;
+    g_ptr_array_add (changes->inserted, node);
+    if (is_dir) {
+        gint state = 1;
+        db_location_walk_tree_recursive (location,
+                                         config->exclude_locations,
+                                         config->exclude_files,
+                                         path,
+                                         timer,
+                                         NULL,
+                                         node,
+                                         0,
+                                         &state,
+                                         !strncmp ("/data", path, strlen ("/data")));
+    }
+}
+
+static bool
+db_list_replace_node (BTreeNode *node, void *data)
+{
+    DynamicArray *entries = data;
+    // same slot, the number of items must not change
+    darray_remove_item (entries, node->pos);
+    darray_set_item (entries, node, node->pos);
+    return true;
+}
+
+static void
+db_traverse_tree_replace (BTreeNode *node, void *data)
+{
+    btree_node_traverse (node, db_list_replace_node, data);
+}
+
+// copy of node made by db_location_relayout, false if node isn't part of
+// the entries list
+static bool
+db_relayout_get_copy (Database *db,
+                      BTreeNode *root,
+                      BTreeNode **copies,
+                      BTreeNode *node,
+                      BTreeNode **copy)
+{
+    if (!node) {
+        *copy = NULL;
+        return true;
+    }
+    if (node == root) {
+        *copy = copies[db->num_entries];
+        return true;
+    }
+    if (node->pos < db->num_entries && darray_get_item (db->entries, node->pos) == node) {
+        *copy = copies[node->pos];
+        return true;
+    }
+    return false;
+}
+
+// Copies the tree of location into a fresh arena in the order of the entries
+// list, so the names of neighbouring entries are neighbours in memory and
+// the search can scan them in one go. Only done if the entries list holds
+// exactly the nodes of location, false if the tree was left alone.
+static bool
+db_location_relayout (Database *db, DatabaseLocation *location)
+{
+    assert (db != NULL);
+    assert (location != NULL);
+
+    if (!location->entries || !db->entries || db->num_entries != location->num_items) {
+        return false;
+    }
+    const uint32_t num_entries = db->num_entries;
+    for (uint32_t i = 0; i < num_entries; i++) {
+        BTreeNode *node = darray_get_item (db->entries, i);
+        if (!node || node->pos != i) {
+            return false;
+        }
+    }
+
+    BTreeArena *arena = btree_arena_new ();
+    // the copy of the root goes last
+    BTreeNode **copies = g_new (BTreeNode *, num_entries + 1);
+    BTreeNode *root = location->entries;
+    copies[num_entries] = btree_node_copy (arena, location->arena, root);
+    for (uint32_t i = 0; i < num_entries; i++) {
+        copies[i] = btree_node_copy (arena, location->arena, darray_get_item (db->entries, i));
+    }
+    for (uint32_t i = 0; i <= num_entries; i++) {
+        BTreeNode *node = i < num_entries ? darray_get_item (db->entries, i) : root;
+        BTreeNode *copy = copies[i];
+        if (!db_relayout_get_copy (db, root, copies, node->parent, &copy->parent)
+            || !db_relayout_get_copy (db, root, copies, node->next, &copy->next)
+            || !db_relayout_get_copy (db, root, copies, node->children, &copy->children)) {
+            // a node of the tree is missing from the entries list
+            g_free (copies);
+            btree_arena_free (arena);
+            return false;
+        }
+    }
+
+    // the offsets of the entry table point into the old arena
+    db_entry_table_clear (db);
+    for (uint32_t i = 0; i < num_entries; i++) {
+        // same slot, the number of items must not change
+        darray_remove_item (db->entries, i);
+        darray_set_item (db->entries, copies[i], i);
+    }
+    location->entries = copies[num_entries];
+    g_free (copies);
+    btree_arena_free (location->arena);
+    location->arena = arena;
+    location->num_removed = 0;
+    return true;
+}
+
+// Removed nodes keep their memory in the arena, once they outnumber the
+// live nodes the tree is copied into a fresh arena. The copies keep pos, so
+// they take the places of the old nodes in the entries list.
+static void
+db_location_compact (Database *db, DatabaseLocation *location)
+{
+    assert (db != NULL);
+    assert (location != NULL);
+
+    if (!location->entries || location->num_removed <= location->num_items) {
+        return;
+    }
+    if (db->locations && !db->locations->next && db_location_relayout (db, location)) {
+        db_get_entry_table (db);
+        return;
+    }
+    BTreeArena *arena = btree_arena_new ();
+    location->entries = btree_node_clone (arena, location->arena, location->entries);
+    if (db->entries) {
+        btree_node_children_foreach (location->entries, db_traverse_tree_replace, db->entries);
+    }
+    // the offsets of the entry table point into the old arena
+    db_entry_table_clear (db);
+    btree_arena_free (location->arena);
+    location->arena = arena;
+    location->num_removed = 0;
+    db_get_entry_table (db);
+}
+
+bool
+db_location_apply_changes (Database *db,
+                           char **removed_paths,
+                           char **added_paths,
+                           FsearchConfig *config)
+{
+    assert (db != NULL);
+    assert (config != NULL);
+
+    db_lock (db);
+    if (!db->locations) {
+        db_unlock (db);
+        return false;
+    }
+
+    DatabaseChanges changes = { db, NULL, 0, g_ptr_array_new () };
+    if (removed_paths) {
+        for (int i = 0; removed_paths[i]; ++i) {
+            db_location_remove_path (db, &changes, removed_paths[i]);
+        }
+    }
+    if (added_paths) {
+        GTimer *timer = g_timer_new ();
+        g_timer_start (timer);
+        for (int i = 0; added_paths[i]; ++i) {
+            db_location_insert_path (db, &changes, added_paths[i], config, timer);
+        }
+        g_timer_destroy (timer);
+    }
+
+    // the entries list holds pointers into the trees, it must be patched
+    // before the arenas are compacted and the lock is released
+    if (db->entries) {
+        db_entries_apply_changes (db, &changes);
+    }
+    else {
+        db_build_entries_list_unlocked (db);
+    }
+    g_free (changes.removed);
+    g_ptr_array_free (changes.inserted, TRUE);
+
+    for (GList *l = db->locations; l != NULL; l = l->next) {
+        db_location_compact (db, l->data);
+    }
+    db_update_timestamp (db);
+    db_unlock (db);
+    return true;
+}
+
 Database *
 db_new ()
 {
@@ -876,6 +1426,7 @@ db_entries_clear (Database *db)
     // free entries
     assert (db != NULL);
 
+    db_entry_table_clear (db);
     if (db->entries) {
         darray_free (db->entries);
         db->entries = NULL;
@@ -883,6 +1434,17 @@ db_entries_clear (Database *db)
     db->num_entries = 0;
 }
 
+static void
+db_entry_table_clear (Database *db)
+{
+    assert (db != NULL);
+
+    if (db->entry_table) {
+        fs_entry_table_free (db->entry_table);
+        db->entry_table = NULL;
+    }
+}
+
 void
 db_free (Database *db)
 {
@@ -937,6 +1499,21 @@ db_get_entries (Database *db)
     return db->entries;
 }
 
+const FsearchEntryTable *
+db_get_entry_table (Database *db)
+{
+    assert (db != NULL);
+    if (!db->entries) {
+        return NULL;
+    }
+    // the table refers to the names in the arena of a single location
+    if (!db->entry_table && db->locations && !db->locations->next) {
+        DatabaseLocation *location = db->locations->data;
+        db->entry_table = fs_entry_table_new (db->entries, db->num_entries, location->arena);
+    }
+    return db->entry_table;
+}
+
 static int
 sort_by_name (const void *a, const void *b)
 {
@@ -965,6 +1542,7 @@ db_sort (Database *db)
     assert (db != NULL);
     assert (db->entries != NULL);
 
+    db_entry_table_clear (db);
 //    trace ("start sorting\n");
     darray_sort (db->entries, sort_by_name);
 //    trace ("finished sorting\n");
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include "array.h"
 #include "btree.h"
+#include "entry_table.h"
 
 typedef struct _Database Database;
 
@@ -40,7 +41,7 @@ bool
 db_location_add(Database *db,
                 const char *location_name,
                 FsearchConfig *config,
-                bool *state,
+                gint *state,
                 void (*callback)(const char *));
 
 bool
@@ -52,6 +53,15 @@ db_location_write_to_file(DatabaseLocation *location, const char *fname);
 BTreeNode *
 db_location_get_entries(DatabaseLocation *location);
 
+BTreeNode *
+db_location_find_node(Database *db, const char *path);
+
+bool
+db_location_apply_changes(Database *db,
+                          char **removed_paths,
+                          char **added_paths,
+                          FsearchConfig *config);
+
 void
 db_free(Database *db);
 
@@ -92,6 +102,11 @@ db_try_lock(Database *db);
 DynamicArray *
 db_get_entries(Database *db);
 
+// flat view of the entries list for searching, NULL unless the database has
+// a single location, the database must be locked
+const FsearchEntryTable *
+db_get_entry_table(Database *db);
+
 void
 db_sort(Database *db);
 
@@ -26,20 +26,35 @@
 #include <ctype.h>
 #include <pcre.h>
 #include <fnmatch.h>
+#include <limits.h>
 
 #include "database_search.h"
 #include "string_utils.h"
+#include "string_match.h"
+#include "entry_table.h"
 #include "query.h"
 //#include "debug.h"
 #include "utf8.h"
 
 #define OVECCOUNT 3
-
-
+// bytes of names scanned at once
+#define SEARCH_SCAN_WINDOW (1 << 16)
+// names further apart don't belong to neighbouring node records
+#define SEARCH_SCAN_MAX_GAP (sizeof (BTreeNode) + NAME_MAX + 1 + sizeof (void *))
+
+// how a query is matched when the entry table is available
+enum {
+    SEARCH_MATCH_FUNC = 0,      // search_func on the original string
+    SEARCH_MATCH_SUBSTR,        // fs_memmem on the original string
+    SEARCH_MATCH_SUBSTR_ICASE,  // fs_memmem on the folded string
+};
 
 typedef struct search_query_s {
     char *query;
+    // ASCII lower-cased copy of query
+    char *folded_query;
     uint32_t (*search_func)(const char *, const char *);
+    uint32_t match_mode;
     size_t query_len;
     uint32_t has_uppercase;
     uint32_t has_separator;
@@ -155,6 +170,278 @@ filter_node (BTreeNode *node, FsearchFilter filter)
     return false;
 }
 
+static inline bool
+node_in_scope (BTreeNode *node, BTreeNode *scope)
+{
+    if (!scope) {
+        return true;
+    }
+    // the scope node itself is not part of the results
+    for (BTreeNode *parent = node->parent; parent; parent = parent->parent) {
+        if (parent == scope) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool
+search_query_in_path (const search_query_t *query,
+                      bool search_in_path,
+                      bool auto_search_in_path)
+{
+    return search_in_path || (auto_search_in_path && query->has_separator);
+}
+
+static inline bool
+search_query_match (const search_query_t *query,
+                    const char *haystack,
+                    const char *folded_haystack,
+                    size_t haystack_len)
+{
+    if (folded_haystack) {
+        switch (query->match_mode) {
+        case SEARCH_MATCH_SUBSTR:
+            return fs_memmem (haystack, haystack_len, query->query, query->query_len) != NULL;
+        case SEARCH_MATCH_SUBSTR_ICASE:
+            return fs_memmem (folded_haystack, haystack_len, query->folded_query, query->query_len) != NULL;
+        default:
+            break;
+        }
+    }
+    return query->search_func (haystack, query->query) ? true : false;
+}
+
+// the match modes are only used along with the entry table,
+// full_path, folded_path and folded_name must hold PATH_MAX bytes
+static bool
+search_node_match (search_thread_context_t *ctx,
+                   BTreeNode *node,
+                   bool use_match_mode,
+                   char *full_path,
+                   char *folded_path,
+                   char *folded_name)
+{
+    const bool search_in_path = ctx->search->search_in_path;
+    const bool auto_search_in_path = ctx->search->auto_search_in_path;
+    const char *haystack_path = NULL;
+    const char *folded_haystack_path = NULL;
+    size_t path_len = 0;
+    const char *folded_haystack_name = NULL;
+    size_t name_len = 0;
+
+    for (uint32_t i = 0; i < ctx->num_queries; i++) {
+        const search_query_t *query = ctx->queries[i];
+        if (!query) {
+            return false;
+        }
+        if (search_query_in_path (query, search_in_path, auto_search_in_path)) {
+            if (!haystack_path) {
+                btree_node_get_path_full (node, full_path, PATH_MAX);
+                haystack_path = full_path;
+                if (use_match_mode) {
+                    path_len = strlen (full_path);
+                    fs_str_fold_ascii (folded_path, full_path, path_len + 1);
+                    folded_haystack_path = folded_path;
+                }
+            }
+            if (!search_query_match (query, haystack_path, folded_haystack_path, path_len)) {
+                return false;
+            }
+        }
+        else {
+            if (use_match_mode && !folded_haystack_name) {
+                name_len = strlen (node->name);
+                if (name_len < PATH_MAX) {
+                    fs_str_fold_ascii (folded_name, node->name, name_len + 1);
+                    folded_haystack_name = folded_name;
+                }
+            }
+            if (!search_query_match (query, node->name, folded_haystack_name, name_len)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The longest substring query which is matched against the name, every
+// result must contain it so it can drive a scan over the names.
+static const search_query_t *
+search_get_scan_query (search_thread_context_t *ctx)
+{
+    const search_query_t *scan_query = NULL;
+    for (uint32_t i = 0; i < ctx->num_queries; i++) {
+        const search_query_t *query = ctx->queries[i];
+        if (!query) {
+            break;
+        }
+        if (query->match_mode == SEARCH_MATCH_FUNC
+            || query->query_len == 0
+            || search_query_in_path (query, ctx->search->search_in_path, ctx->search->auto_search_in_path)) {
+            continue;
+        }
+        if (!scan_query || query->query_len > scan_query->query_len) {
+            scan_query = query;
+        }
+    }
+    return scan_query;
+}
+
+static inline bool
+filter_entry (const FsearchEntryTable *table, uint32_t idx, FsearchFilter filter)
+{
+    const uint8_t flags = table->flags[idx];
+    if (flags & FS_ENTRY_FLAG_EMPTY) {
+        return false;
+    }
+    if (filter == FSEARCH_FILTER_FILES) {
+        return !(flags & FS_ENTRY_FLAG_DIR);
+    }
+    if (filter == FSEARCH_FILTER_FOLDERS) {
+        return flags & FS_ENTRY_FLAG_DIR;
+    }
+    return true;
+}
+
+// scope_idx is FS_ENTRY_NO_PARENT if scope is the root of a location
+static inline bool
+entry_in_scope (const FsearchEntryTable *table,
+                DynamicArray *entries,
+                uint32_t idx,
+                BTreeNode *scope,
+                uint32_t scope_idx)
+{
+    if (!scope) {
+        return true;
+    }
+    uint32_t top = idx;
+    for (uint32_t parent = table->parents[idx]; parent != FS_ENTRY_NO_PARENT; parent = table->parents[parent]) {
+        if (parent == scope_idx) {
+            return true;
+        }
+        top = parent;
+    }
+    if (scope_idx != FS_ENTRY_NO_PARENT) {
+        return false;
+    }
+    BTreeNode *top_node = darray_get_item (entries, top);
+    return top_node && top_node->parent == scope;
+}
+
+// The names of neighbouring entries are stored one after the other in the
+// arena, between the nodes they belong to. A scan runs fs_memmem over a
+// window of these bytes, folded first for case insensitive queries, and
+// skips straight to the next name containing the query.
+typedef struct search_scan_s {
+    const FsearchEntryTable *table;
+    const char *needle;
+    size_t needle_len;
+    // holds the folded window, NULL for case sensitive queries
+    char *buffer;
+    // the window starts with the name of first and ends with the one of last
+    const char *data;
+    size_t data_len;
+    uint32_t first;
+    uint32_t last;
+} search_scan_t;
+
+// maps the window onto the names of the entries from i on, as long as their
+// node records follow each other in the arena; false if the name of i
+// doesn't fit
+static bool
+search_scan_fill (search_scan_t *scan, uint32_t i, uint32_t end)
+{
+    const FsearchEntryTable *table = scan->table;
+    const uint32_t base = table->names[i];
+    uint32_t last = i;
+    for (uint32_t k = i + 1; k <= end; k++) {
+        const uint32_t offset = table->names[k];
+        if ((table->flags[k] & FS_ENTRY_FLAG_EMPTY)
+            || offset <= table->names[k - 1]
+            || offset - table->names[k - 1] > SEARCH_SCAN_MAX_GAP
+            || (offset >> BTREE_ARENA_CHUNK_SHIFT) != (base >> BTREE_ARENA_CHUNK_SHIFT)
+            || offset - base >= SEARCH_SCAN_WINDOW - NAME_MAX - 1) {
+            break;
+        }
+        last = k;
+    }
+
+    const char *data = btree_arena_get_name (table->arena, base);
+    size_t data_len = 0;
+    while (true) {
+        const uint32_t from = table->names[last] - base;
+        data_len = from + strlen (data + from) + 1;
+        if (data_len <= SEARCH_SCAN_WINDOW) {
+            break;
+        }
+        if (last == i) {
+            return false;
+        }
+        last--;
+    }
+
+    if (scan->buffer) {
+        fs_str_fold_ascii (scan->buffer, data, data_len);
+        data = scan->buffer;
+    }
+    scan->data = data;
+    scan->data_len = data_len;
+    scan->first = i;
+    scan->last = last;
+    return true;
+}
+
+// index of the next entry in [i, end] whose name contains the needle,
+// end + 1 if there is none
+static uint32_t
+search_scan_next (search_scan_t *scan, uint32_t i, uint32_t end)
+{
+    const FsearchEntryTable *table = scan->table;
+    while (i <= end) {
+        if (table->flags[i] & FS_ENTRY_FLAG_EMPTY) {
+            i++;
+            continue;
+        }
+        if (!scan->data || i < scan->first || i > scan->last) {
+            if (!search_scan_fill (scan, i, end)) {
+                // left to the full match
+                scan->data = NULL;
+                return i;
+            }
+        }
+
+        const uint32_t base = table->names[scan->first];
+        const size_t from = table->names[i] - base;
+        const char *hit = fs_memmem (scan->data + from, scan->data_len - from, scan->needle, scan->needle_len);
+        if (!hit) {
+            i = scan->last + 1;
+            continue;
+        }
+
+        // the last entry of the window whose name starts before the hit
+        const uint32_t offset = base + (uint32_t)(hit - scan->data);
+        uint32_t first = i;
+        uint32_t last = scan->last;
+        while (first < last) {
+            const uint32_t mid = first + (last - first + 1) / 2;
+            if (table->names[mid] <= offset) {
+                first = mid;
+            }
+            else {
+                last = mid - 1;
+            }
+        }
+        // hits in the nodes between the names don't count, the needle holds
+        // no NUL so a hit starting in a name also ends in it
+        if (offset - table->names[first] < strlen (scan->data + (table->names[first] - base))) {
+            return first;
+        }
+        i = first + 1;
+    }
+    return end + 1;
+}
+
 static void *
 search_thread (void * user_data)
 {
@@ -172,66 +459,81 @@ search_thread (void * user_data)
     const uint32_t start = ctx->start_pos;
     const uint32_t end = ctx->end_pos;
     const uint32_t max_results = ctx->search->max_results;
-    const uint32_t num_queries = ctx->num_queries;
     const FsearchFilter filter = ctx->search->filter;
-    search_query_t **queries = ctx->queries;
-    const uint32_t search_in_path = ctx->search->search_in_path;
-    const uint32_t auto_search_in_path = ctx->search->auto_search_in_path;
+    BTreeNode *scope = ctx->search->scope;
     DynamicArray *entries = ctx->search->entries;
     BTreeNode **results = ctx->results;
 
+    const FsearchEntryTable *table = ctx->search->entry_table;
+    if (table && table->num_entries != ctx->search->num_entries) {
+        table = NULL;
+    }
+    uint32_t scope_idx = FS_ENTRY_NO_PARENT;
+    if (table && scope && scope->parent) {
+        if (scope->pos < table->num_entries && darray_get_item (entries, scope->pos) == scope) {
+            scope_idx = scope->pos;
+        }
+        else {
+            // the scope doesn't belong to these entries
+            table = NULL;
+        }
+    }
+    const search_query_t *scan_query = table ? search_get_scan_query (ctx) : NULL;
+    search_scan_t scan = { 0 };
+    if (scan_query) {
+        scan.table = table;
+        scan.needle_len = scan_query->query_len;
+        if (scan_query->match_mode == SEARCH_MATCH_SUBSTR_ICASE) {
+            scan.needle = scan_query->folded_query;
+            scan.buffer = malloc (SEARCH_SCAN_WINDOW);
+            assert (scan.buffer != NULL);
+        }
+        else {
+            scan.needle = scan_query->query;
+        }
+    }
+
     uint32_t num_results = 0;
     char full_path[PATH_MAX] = "";
+    char folded_path[PATH_MAX] = "";
+    char folded_name[PATH_MAX] = "";
     for (uint32_t i = start; i <= end; i++) {
         if (max_results && num_results == max_results) {
             break;
         }
+        if (table) {
+            if (scan_query) {
+                i = search_scan_next (&scan, i, end);
+                if (i > end) {
+                    break;
+                }
+            }
+            if (!filter_entry (table, i, filter)) {
+                continue;
+            }
+            if (!entry_in_scope (table, entries, i, scope, scope_idx)) {
+                continue;
+            }
+        }
         BTreeNode *node = darray_get_item (entries, i);
         if (!node) {
             continue;
         }
-        if (!filter_node (node, filter)) {
-            continue;
-        }
-
-        const char *haystack_path = NULL;
-        const char *haystack_name = node->name;
-        if (search_in_path) {
-            btree_node_get_path_full (node, full_path, sizeof (full_path));
-            haystack_path = full_path;
-        }
-
-        uint32_t num_found = 0;
-        while (true) {
-            if (num_found == num_queries) {
-                results[num_results] = node;
-                num_results++;
-                break;
-            }
-            search_query_t *query = queries[num_found++];
-            if (!query) {
-                break;
-            }
-            char *ptr = query->query;
-            uint32_t (*search_func)(const char *, const char *) = query->search_func;
-
-            const char *haystack = NULL;
-            if (search_in_path || (auto_search_in_path && query->has_separator)) {
-                if (!haystack_path) {
-                    btree_node_get_path_full (node, full_path, sizeof (full_path));
-                    haystack_path = full_path;
-                }
-                haystack = haystack_path;
+        if (!table) {
+            if (!filter_node (node, filter)) {
+                continue;
             }
-            else {
-                haystack = haystack_name;
-            }
-            if (!search_func (haystack, ptr)) {
-                break;
+            if (!node_in_scope (node, scope)) {
+                continue;
             }
         }
 
+        if (search_node_match (ctx, node, table != NULL, full_path, folded_path, folded_name)) {
+            results[num_results] = node;
+            num_results++;
+        }
     }
+    free (scan.buffer);
     ctx->num_results = num_results;
     return NULL;
 }
@@ -327,6 +629,10 @@ search_query_free (void * data)
         g_free (query->query);
         query->query = NULL;
     }
+    if (query->folded_query != NULL) {
+        g_free (query->folded_query);
+        query->folded_query = NULL;
+    }
     g_free (query);
     query = NULL;
 }
@@ -339,6 +645,8 @@ search_query_new (const char *query, bool match_case)
 
     temNew->query = g_strdup (query);
     temNew->query_len = strlen (query);
+    temNew->folded_query = g_strdup (query);
+    fs_str_fold_ascii (temNew->folded_query, query, temNew->query_len);
     temNew->has_uppercase = fs_str_has_upper (query);
     temNew->has_separator = strchr (query, '/') ? 1 : 0;
     // TODO: this might not work at all times?
@@ -359,13 +667,16 @@ search_query_new (const char *query, bool match_case)
     else {
         if (match_case) {
             temNew->search_func = search_normal;
+            temNew->match_mode = SEARCH_MATCH_SUBSTR;
         }
         else {
             if (temNew->is_utf8) {
+                // non-ASCII letters need full case folding
                 temNew->search_func = search_normal_icase_u8;
             }
             else {
                 temNew->search_func = search_normal_icase;
+                temNew->match_mode = SEARCH_MATCH_SUBSTR_ICASE;
             }
         }
     }
@@ -583,6 +894,14 @@ db_search_results_clear (DatabaseSearch *search)
     return;
 }
 
+void
+db_search_set_scope (DatabaseSearch *search, BTreeNode *scope)
+{
+    assert (search != NULL);
+
+    search->scope = scope;
+}
+
 void
 db_search_free (DatabaseSearch *search)
 {
@@ -662,6 +981,14 @@ db_search_new (FsearchThreadPool *pool)
     return db_search;
 }
 
+void
+db_search_set_entry_table (DatabaseSearch *search, const FsearchEntryTable *entry_table)
+{
+    assert (search != NULL);
+
+    search->entry_table = entry_table;
+}
+
 void
 db_search_set_search_in_path (DatabaseSearch *search, bool search_in_path)
 {
@@ -21,6 +21,7 @@
 #include "array.h"
 #include "btree.h"
 #include "query.h"
+#include "entry_table.h"
 #include "fsearch_thread_pool.h"
 
 typedef struct _DatabaseSearch DatabaseSearch;
@@ -54,6 +55,10 @@ struct _DatabaseSearch {
 
     DynamicArray *entries;
     uint32_t num_entries;
+    // flat copy of entries, NULL falls back to visiting the nodes one by one
+    const FsearchEntryTable *entry_table;
+    // only nodes below this one are matched, NULL matches everything
+    BTreeNode *scope;
 
     GThread *search_thread;
     bool search_thread_terminate;
@@ -108,6 +113,12 @@ db_search_update(DatabaseSearch *search,
 void
 db_search_results_clear(DatabaseSearch *search);
 
+void
+db_search_set_scope(DatabaseSearch *search, BTreeNode *scope);
+
+void
+db_search_set_entry_table(DatabaseSearch *search, const FsearchEntryTable *entry_table);
+
 void
 db_search_set_search_in_path(DatabaseSearch *search, bool search_in_path);
 
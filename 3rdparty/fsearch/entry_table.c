@@ -0,0 +1,159 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <assert.h>
+#include <string.h>
+#include <glib.h>
+
+#include "entry_table.h"
+
+static bool
+entry_table_node_parent (DynamicArray *entries, uint32_t num_entries, BTreeNode *node, uint32_t *parent_idx)
+{
+    BTreeNode *parent = node->parent;
+    if (!parent || !parent->parent) {
+        // location roots are not part of the entries list
+        *parent_idx = FS_ENTRY_NO_PARENT;
+        return true;
+    }
+    if (parent->pos < num_entries && darray_get_item (entries, parent->pos) == parent) {
+        *parent_idx = parent->pos;
+        return true;
+    }
+    return false;
+}
+
+// fills in entry idx from node, false if node can't be part of the table
+static bool
+entry_table_set_node (FsearchEntryTable *table,
+                      DynamicArray *entries,
+                      uint32_t num_entries,
+                      uint32_t idx,
+                      BTreeNode *node)
+{
+    if (!node) {
+        table->names[idx] = BTREE_ARENA_NO_OFFSET;
+        table->parents[idx] = FS_ENTRY_NO_PARENT;
+        table->flags[idx] = FS_ENTRY_FLAG_EMPTY;
+        return true;
+    }
+    table->names[idx] = btree_arena_get_name_offset (table->arena, node);
+    if (table->names[idx] == BTREE_ARENA_NO_OFFSET) {
+        return false;
+    }
+    table->flags[idx] = node->is_dir ? FS_ENTRY_FLAG_DIR : 0;
+    return entry_table_node_parent (entries, num_entries, node, &table->parents[idx]);
+}
+
+static FsearchEntryTable *
+entry_table_new (const BTreeArena *arena, uint32_t num_entries)
+{
+    FsearchEntryTable *table = g_new0 (FsearchEntryTable, 1);
+    table->arena = arena;
+    table->num_entries = num_entries;
+    table->names = g_new (uint32_t, num_entries);
+    table->parents = g_new (uint32_t, num_entries);
+    table->flags = g_new (uint8_t, num_entries);
+    return table;
+}
+
+FsearchEntryTable *
+fs_entry_table_new (DynamicArray *entries, uint32_t num_entries, const BTreeArena *arena)
+{
+    assert (entries != NULL);
+    assert (arena != NULL);
+
+    FsearchEntryTable *table = entry_table_new (arena, num_entries);
+    for (uint32_t i = 0; i < num_entries; i++) {
+        if (!entry_table_set_node (table, entries, num_entries, i, darray_get_item (entries, i))) {
+            fs_entry_table_free (table);
+            return NULL;
+        }
+    }
+    return table;
+}
+
+FsearchEntryTable *
+fs_entry_table_update (const FsearchEntryTable *table,
+                       DynamicArray *entries,
+                       uint32_t num_entries,
+                       const uint32_t *sources)
+{
+    assert (table != NULL);
+    assert (entries != NULL);
+    assert (sources != NULL);
+
+    // new index of every entry of the old table, for the parent columns
+    uint32_t *targets = g_new (uint32_t, table->num_entries);
+    memset (targets, 0xff, table->num_entries * sizeof (uint32_t));
+    for (uint32_t i = 0; i < num_entries; i++) {
+        if (sources[i] != FS_ENTRY_NO_PARENT) {
+            targets[sources[i]] = i;
+        }
+    }
+
+    FsearchEntryTable *new_table = entry_table_new (table->arena, num_entries);
+    uint32_t i = 0;
+    while (i < num_entries) {
+        const uint32_t src = sources[i];
+        if (src == FS_ENTRY_NO_PARENT) {
+            if (!entry_table_set_node (new_table, entries, num_entries, i, darray_get_item (entries, i))) {
+                g_free (targets);
+                fs_entry_table_free (new_table);
+                return NULL;
+            }
+            i++;
+            continue;
+        }
+
+        // kept entries which were neighbours in the old table are copied at once,
+        // the nodes didn't move so their name offsets are still valid
+        uint32_t end = i + 1;
+        while (end < num_entries && sources[end] == sources[end - 1] + 1) {
+            end++;
+        }
+        memcpy (new_table->names + i, table->names + src, (end - i) * sizeof (uint32_t));
+        memcpy (new_table->flags + i, table->flags + src, end - i);
+        for (uint32_t j = i; j < end; j++) {
+            const uint32_t parent = table->parents[sources[j]];
+            if (parent == FS_ENTRY_NO_PARENT) {
+                new_table->parents[j] = FS_ENTRY_NO_PARENT;
+            }
+            else if (targets[parent] != FS_ENTRY_NO_PARENT) {
+                new_table->parents[j] = targets[parent];
+            }
+            else {
+                // the parent was dropped but its child was kept
+                g_free (targets);
+                fs_entry_table_free (new_table);
+                return NULL;
+            }
+        }
+        i = end;
+    }
+    g_free (targets);
+    return new_table;
+}
+
+void
+fs_entry_table_free (FsearchEntryTable *table)
+{
+    if (!table) {
+        return;
+    }
+    g_free (table->names);
+    g_free (table->parents);
+    g_free (table->flags);
+    g_free (table);
+}
+
+size_t
+fs_entry_table_get_size (const FsearchEntryTable *table)
+{
+    if (!table) {
+        return 0;
+    }
+    return sizeof (FsearchEntryTable)
+            + (size_t)table->num_entries * (2 * sizeof (uint32_t) + sizeof (uint8_t));
+}
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <stdint.h>
+#include "array.h"
+#include "btree.h"
+
+#define FS_ENTRY_NO_PARENT UINT32_MAX
+
+enum {
+    FS_ENTRY_FLAG_EMPTY = 1 << 0,
+    FS_ENTRY_FLAG_DIR = 1 << 1,
+};
+
+// Flat struct-of-arrays view of an entries list. Search threads scan
+// these columns linearly and only touch a BTreeNode once an entry passed
+// the filter, the scope and the name match. The names aren't copied, the
+// table refers to the names in the arena of the nodes.
+typedef struct {
+    // arena all nodes of the entries belong to
+    const BTreeArena *arena;
+    // offsets of the names in arena, see btree_arena_get_name
+    uint32_t *names;
+    // entries index of the parent, FS_ENTRY_NO_PARENT below a location root
+    uint32_t *parents;
+    // FS_ENTRY_FLAG_*
+    uint8_t *flags;
+    uint32_t num_entries;
+} FsearchEntryTable;
+
+// returns NULL if node->pos of a parent doesn't match its entries index or
+// a node doesn't belong to arena
+FsearchEntryTable *
+fs_entry_table_new(DynamicArray *entries, uint32_t num_entries, const BTreeArena *arena);
+
+// Table for entries, the result of merging new nodes into the entries list
+// of table and dropping some of its entries. sources[i] is the index of
+// entry i in table, FS_ENTRY_NO_PARENT for a new node. Kept entries are
+// copied from table, only new nodes are read, they must belong to the arena
+// of table. node->pos must match the entries index, returns NULL otherwise.
+FsearchEntryTable *
+fs_entry_table_update(const FsearchEntryTable *table,
+                      DynamicArray *entries,
+                      uint32_t num_entries,
+                      const uint32_t *sources);
+
+void
+fs_entry_table_free(FsearchEntryTable *table);
+
+// bytes held by the columns of table
+size_t
+fs_entry_table_get_size(const FsearchEntryTable *table);
@@ -45,7 +45,7 @@ enum {
 //static guint signals [LAST_SIGNAL];
 
 gpointer
-load_database (FsearchApplication*app, const char *path, bool *state);
+load_database (FsearchApplication*app, const char *path, gint *state);
 
 Database *
 fsearch_application_get_db (FsearchApplication *fsearch)
@@ -143,7 +143,7 @@ static inline void timer_stop()
 }
 
  gpointer
-load_database (FsearchApplication*app, const char *path, bool *state)
+load_database (FsearchApplication*app, const char *path, gint *state)
 {
     timer_start ();
     app->db = db_new ();
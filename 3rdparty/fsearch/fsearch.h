@@ -58,7 +58,7 @@ void
 fsearch_application_startup(FsearchApplication *app);
 
 gpointer
-load_database(FsearchApplication *app, const char *path, bool *state);
+load_database(FsearchApplication *app, const char *path, gint *state);
 
 void
 fsearch_application_init(FsearchApplication *app);
@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_match.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define FS_STRING_MATCH_X86 1
+#include <immintrin.h>
+#endif
+
+typedef const char *(*fs_memmem_func)(const char *, size_t, const char *, size_t);
+typedef void (*fs_fold_func)(char *, const char *, size_t);
+
+static inline char
+fold_ascii_char (char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static void
+fold_ascii_scalar (char *dst, const char *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = fold_ascii_char (src[i]);
+    }
+}
+
+static const char *
+memmem_scalar (const char *haystack,
+               size_t haystack_len,
+               const char *needle,
+               size_t needle_len)
+{
+    return memmem (haystack, haystack_len, needle, needle_len);
+}
+
+#ifdef FS_STRING_MATCH_X86
+
+static void
+fold_ascii_sse2 (char *dst, const char *src, size_t len)
+{
+    const __m128i before_a = _mm_set1_epi8 ('A' - 1);
+    const __m128i after_z = _mm_set1_epi8 ('Z' + 1);
+    const __m128i diff = _mm_set1_epi8 ('a' - 'A');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128 ((const __m128i *)(src + i));
+        // bytes >= 0x80 are negative in the signed compare and stay untouched
+        const __m128i upper = _mm_and_si128 (_mm_cmpgt_epi8 (v, before_a),
+                                             _mm_cmplt_epi8 (v, after_z));
+        _mm_storeu_si128 ((__m128i *)(dst + i), _mm_add_epi8 (v, _mm_and_si128 (upper, diff)));
+    }
+    fold_ascii_scalar (dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx2"))) static void
+fold_ascii_avx2 (char *dst, const char *src, size_t len)
+{
+    const __m256i before_a = _mm256_set1_epi8 ('A' - 1);
+    const __m256i after_z = _mm256_set1_epi8 ('Z' + 1);
+    const __m256i diff = _mm256_set1_epi8 ('a' - 'A');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256 ((const __m256i *)(src + i));
+        const __m256i upper = _mm256_and_si256 (_mm256_cmpgt_epi8 (v, before_a),
+                                                _mm256_cmpgt_epi8 (after_z, v));
+        _mm256_storeu_si256 ((__m256i *)(dst + i), _mm256_add_epi8 (v, _mm256_and_si256 (upper, diff)));
+    }
+    fold_ascii_sse2 (dst + i, src + i, len - i);
+}
+
+// Compares the first and the last byte of the needle against 16 candidate
+// positions at once, only positions where both match are verified with memcmp.
+// Needles shorter than 2 bytes are handled by fs_memmem.
+static const char *
+memmem_sse2 (const char *haystack,
+             size_t haystack_len,
+             const char *needle,
+             size_t needle_len)
+{
+    const __m128i first = _mm_set1_epi8 (needle[0]);
+    const __m128i last = _mm_set1_epi8 (needle[needle_len - 1]);
+    size_t i = 0;
+    for (; i + needle_len + 15 <= haystack_len; i += 16) {
+        const __m128i block_first = _mm_loadu_si128 ((const __m128i *)(haystack + i));
+        const __m128i block_last = _mm_loadu_si128 ((const __m128i *)(haystack + i + needle_len - 1));
+        uint32_t mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (first, block_first),
+                                                          _mm_cmpeq_epi8 (last, block_last)));
+        while (mask) {
+            const uint32_t pos = __builtin_ctz (mask);
+            if (!memcmp (haystack + i + pos + 1, needle + 1, needle_len - 2)) {
+                return haystack + i + pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return memmem_scalar (haystack + i, haystack_len - i, needle, needle_len);
+}
+
+__attribute__((target("avx2"))) static const char *
+memmem_avx2 (const char *haystack,
+             size_t haystack_len,
+             const char *needle,
+             size_t needle_len)
+{
+    const __m256i first = _mm256_set1_epi8 (needle[0]);
+    const __m256i last = _mm256_set1_epi8 (needle[needle_len - 1]);
+    size_t i = 0;
+    for (; i + needle_len + 31 <= haystack_len; i += 32) {
+        const __m256i block_first = _mm256_loadu_si256 ((const __m256i *)(haystack + i));
+        const __m256i block_last = _mm256_loadu_si256 ((const __m256i *)(haystack + i + needle_len - 1));
+        uint32_t mask = _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (first, block_first),
+                                                                _mm256_cmpeq_epi8 (last, block_last)));
+        while (mask) {
+            const uint32_t pos = __builtin_ctz (mask);
+            if (!memcmp (haystack + i + pos + 1, needle + 1, needle_len - 2)) {
+                return haystack + i + pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return memmem_sse2 (haystack + i, haystack_len - i, needle, needle_len);
+}
+
+#endif
+
+#ifdef FS_STRING_MATCH_X86
+static fs_memmem_func memmem_impl = memmem_sse2;
+static fs_fold_func fold_impl = fold_ascii_sse2;
+static const char *memmem_impl_name = "sse2";
+
+__attribute__((constructor)) static void
+fs_string_match_init (void)
+{
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+        memmem_impl = memmem_avx2;
+        fold_impl = fold_ascii_avx2;
+        memmem_impl_name = "avx2";
+    }
+}
+#else
+static fs_memmem_func memmem_impl = memmem_scalar;
+static fs_fold_func fold_impl = fold_ascii_scalar;
+static const char *memmem_impl_name = "scalar";
+#endif
+
+const char *
+fs_memmem (const char *haystack,
+           size_t haystack_len,
+           const char *needle,
+           size_t needle_len)
+{
+    if (needle_len == 0) {
+        return haystack;
+    }
+    if (needle_len > haystack_len) {
+        return NULL;
+    }
+    if (needle_len == 1) {
+        return memchr (haystack, needle[0], haystack_len);
+    }
+    return memmem_impl (haystack, haystack_len, needle, needle_len);
+}
+
+const char *
+fs_memmem_get_impl_name (void)
+{
+    return memmem_impl_name;
+}
+
+void
+fs_str_fold_ascii (char *dst, const char *src, size_t len)
+{
+    fold_impl (dst, src, len);
+}
@@ -0,0 +1,25 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// lower-cases the ASCII letters of src into dst, other bytes are copied
+// unchanged so UTF-8 sequences stay intact; dst may be src
+void
+fs_str_fold_ascii(char *dst, const char *src, size_t len);
+
+// memmem(3) with an AVX2 or SSE2 first/last byte filter, selected at
+// runtime, and a scalar fallback on other architectures
+const char *
+fs_memmem(const char *haystack,
+          size_t haystack_len,
+          const char *needle,
+          size_t needle_len);
+
+// name of the implementation fs_memmem dispatches to
+const char *
+fs_memmem_get_impl_name(void);
@@ -57,6 +57,7 @@ BuildRequires:  htmlcxx-devel
 BuildRequires:  libgsf-devel
 BuildRequires:  mimetic-devel
 BuildRequires:  boost-devel
+BuildRequires:  liburing-devel
 %ifarch %{ix86} x86_64
 BuildRequires:	deepin-anything-devel deepin-anything-server
 %endif
@@ -101,6 +102,7 @@ Requires:       libzen
 Requires:       udisks2-qt5
 Requires:       taglib
 Requires:       libgio-qt
+Requires:       liburing
 %ifarch %{ix86} x86_64 
 Requires:		deepin-anything-libs
 %endif
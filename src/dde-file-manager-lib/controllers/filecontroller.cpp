@@ -43,8 +43,6 @@
 #include "models/sharefileinfo.h"
 #include "usershare/usersharemanager.h"
 
-#include "fileoperations/sort.h"
-
 #include "deviceinfo/udisklistener.h"
 #include "deviceinfo/udiskdeviceinfo.h"
 #include "controllers/vaultcontroller.h"
@@ -57,9 +55,14 @@
 #include <QGuiApplication>
 #include <QUrlQuery>
 #include <QRegularExpression>
+#include <QtConcurrent>
 
 #include <thread>
+#include <algorithm>
 #include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/syscall.h>
 #include <gio/gio.h>
 
 #include <QQueue>
@@ -133,67 +136,96 @@ private:
     bool isgvfs = false;
 };
 
-class DFMSortInodeDirIterator : public DDirIterator
+// 用 getdents64 批量读取本地目录，按 inode 顺序返回文件。
+// 过滤条件尽量使用 d_type 判断，不需要 stat 每个文件；文件名读取完之后在后台按 inode 顺序
+// 批量 stat，提前把 inode 读入内核缓存，创建文件信息时不再阻塞在磁盘上
+class DFMLocalDirIterator : public DDirIterator
 {
 public:
-    explicit DFMSortInodeDirIterator(const QString &path)
+    DFMLocalDirIterator(const QString &path,
+                        const QStringList &nameFilters,
+                        QDir::Filters filters,
+                        const bool isGvfs,
+                        const bool createDesktopFileInfo)
         : dir(path)
+        , filters(filters)
+        , createDesktopFileInfo(createDesktopFileInfo)
+        , isGvfs(isGvfs)
     {
+        const Qt::CaseSensitivity cs = filters.testFlag(QDir::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+        for (const QString &filter : nameFilters)
+            nameFilterList << QRegExp(filter, cs, QRegExp::Wildcard);
+    }
 
+    ~DFMLocalDirIterator() override
+    {
+        close();
     }
 
-    ~DFMSortInodeDirIterator() override
+    // 按权限过滤时需要 access()，这种情况交给 QDirIterator 处理
+    static bool isSupported(QDir::Filters filters, QDirIterator::IteratorFlags flags)
     {
-        if (sortFiles) {
-            free(sortFiles);
-        } else if (sortFilesIndex) {
-            delete sortFilesIndex;
-        }
+        return !(filters & QDir::PermissionMask) && !flags.testFlag(QDirIterator::Subdirectories)
+                && !flags.testFlag(QDirIterator::FollowSymlinks);
     }
 
     DUrl next() override
     {
-        const QByteArray name(sortFilesIndex);
-
-        currentFileInfo.setFile(dir.absoluteFilePath(QFile::decodeName(name)));
-        sortFilesIndex += name.length() + 1;
+        ++current;
+        currentFileName = QFile::decodeName(entries.at(current).name);
 
-        return DUrl::fromLocalFile(currentFileInfo.absoluteFilePath());
+        return fileUrl();
     }
 
     bool hasNext() const override
     {
-        if (!sortFilesIndex) {
-            sortFiles = savedir(QFile::encodeName(dir.absolutePath()).constData());
+        if (!entriesRead)
+            const_cast<DFMLocalDirIterator *>(this)->readEntries();
 
-            if (sortFiles) {
-                sortFilesIndex = sortFiles;
-            } else {
-                sortFilesIndex = new char(0);
-            }
-        }
+        return current + 1 < entries.count();
+    }
+
+    void close() override
+    {
+        statCanceled = true;
+        statFuture.waitForFinished();
 
-        return *sortFilesIndex;
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
     }
 
     QString fileName() const override
     {
-        return currentFileInfo.fileName();
+        return currentFileName;
     }
 
     DUrl fileUrl() const override
     {
-        return DUrl::fromLocalFile(currentFileInfo.filePath());
+        return DUrl::fromLocalFile(dir.absoluteFilePath(currentFileName));
     }
 
     const DAbstractFileInfoPointer fileInfo() const override
     {
-        //判断是否是gvfs文件，是就创建DGvfsFileInfo
-        bool currentisgvfs = FileUtils::isGvfsMountFile(currentFileInfo.path(), true);
-        if (currentisgvfs) {
-            return DAbstractFileInfoPointer(new DGvfsFileInfo(currentFileInfo, false));
+        if (current < 0 || current >= entries.count())
+            return DAbstractFileInfoPointer();
+
+        const QFileInfo info(dir.absoluteFilePath(currentFileName));
+
+        //父目录是gvfs目录，那么子目录和子文件必须是gvfs文件
+        if (isGvfs)
+            return DAbstractFileInfoPointer(new DGvfsFileInfo(info, false));
+
+        // 只有后缀是 desktop 的文件才需要检查 mimetype
+        const uchar type = entries.at(current).type;
+        if (createDesktopFileInfo && currentFileName.endsWith(".desktop", Qt::CaseInsensitive)
+                && type != DT_LNK && (type != DT_UNKNOWN || !info.isSymLink())
+                && FileUtils::isDesktopFile(info)) {
+            return DAbstractFileInfoPointer(new DesktopFileInfo(info));
         }
-        return DAbstractFileInfoPointer(new DFileInfo(currentFileInfo));
+
+        return DAbstractFileInfoPointer(new DFileInfo(info));
     }
 
     DUrl url() const override
@@ -202,10 +234,152 @@ public:
     }
 
 private:
+    struct Entry {
+        QByteArray name;
+        quint64 inode;
+        uchar type;
+    };
+
+    // 与 getdents64 返回的结构相同，d_name 的长度由 d_reclen 决定
+    struct LinuxDirent64 {
+        quint64 d_ino;
+        qint64 d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    void readEntries()
+    {
+        entriesRead = true;
+        fd = ::open(QFile::encodeName(dir.absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (fd < 0)
+            return;
+
+        QByteArray buffer(128 * 1024, Qt::Uninitialized);
+
+        forever {
+            const long size = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+
+            if (size <= 0)
+                break;
+
+            for (long offset = 0; offset < size;) {
+                const LinuxDirent64 *dirent = reinterpret_cast<const LinuxDirent64 *>(buffer.constData() + offset);
+                offset += dirent->d_reclen;
+
+                Entry entry;
+                entry.name = QByteArray(dirent->d_name);
+                entry.inode = dirent->d_ino;
+                entry.type = dirent->d_type;
+
+                if (matchesFilters(entry))
+                    entries << entry;
+            }
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &e1, const Entry &e2) {
+            return e1.inode < e2.inode;
+        });
+
+        // gvfs 目录的 stat 开销很大，不提前获取
+        if (!isGvfs && !entries.isEmpty())
+            statFuture = QtConcurrent::run(this, &DFMLocalDirIterator::prefetchStat);
+    }
+
+    // 与 QDirIterator 的过滤规则一致，d_type 不能确定文件类型时才调用 stat
+    bool matchesFilters(Entry &entry) const
+    {
+        const bool isDot = entry.name == ".";
+        const bool isDotDot = entry.name == "..";
+
+        if ((isDot && filters.testFlag(QDir::NoDot)) || (isDotDot && filters.testFlag(QDir::NoDotDot)))
+            return false;
+
+        bool isSymLink = entry.type == DT_LNK;
+        bool exists = true;
+        uchar type = entry.type;
+        const bool skipSymLinks = filters.testFlag(QDir::NoSymLinks);
+        const bool includeSystem = filters.testFlag(QDir::System);
+        const bool skipDirs = !(filters & (QDir::Dirs | QDir::AllDirs));
+        const bool skipFiles = !filters.testFlag(QDir::Files);
+
+        if (type == DT_UNKNOWN || (isSymLink && (skipSymLinks || !includeSystem || skipDirs || skipFiles || !nameFilterList.isEmpty()))) {
+            struct stat buffer;
+            if (type == DT_UNKNOWN && fstatat(fd, entry.name.constData(), &buffer, AT_SYMLINK_NOFOLLOW) == 0) {
+                isSymLink = S_ISLNK(buffer.st_mode);
+                type = isSymLink ? DT_LNK : IFTODT(buffer.st_mode);
+                entry.type = type;
+            }
+
+            // 链接文件的类型以目标文件为准
+            if (isSymLink) {
+                exists = fstatat(fd, entry.name.constData(), &buffer, 0) == 0;
+                type = exists ? IFTODT(buffer.st_mode) : DT_UNKNOWN;
+            }
+        }
+
+        const bool isDir = type == DT_DIR;
+        const bool isFile = type == DT_REG;
+
+        if (!nameFilterList.isEmpty() && !(filters.testFlag(QDir::AllDirs) && isDir)) {
+            const QString &name = QFile::decodeName(entry.name);
+            bool matched = false;
+
+            for (const QRegExp &filter : nameFilterList) {
+                if (filter.exactMatch(name)) {
+                    matched = true;
+                    break;
+                }
+            }
+
+            if (!matched)
+                return false;
+        }
+
+        if (skipSymLinks && isSymLink && (!includeSystem || exists))
+            return false;
+
+        if (!filters.testFlag(QDir::Hidden) && !isDot && !isDotDot && entry.name.startsWith('.'))
+            return false;
+
+        if (!includeSystem && (!(isFile || isDir || isSymLink) || (isSymLink && !exists)))
+            return false;
+
+        if (skipDirs && isDir)
+            return false;
+
+        if (skipFiles && isFile)
+            return false;
+
+        return true;
+    }
+
+    void prefetchStat()
+    {
+        struct stat buffer;
+
+        for (const Entry &entry : entries) {
+            if (statCanceled)
+                break;
+
+            fstatat(fd, entry.name.constData(), &buffer, AT_SYMLINK_NOFOLLOW);
+        }
+    }
+
     QDir dir;
-    mutable char *sortFiles = nullptr;
-    mutable char *sortFilesIndex = nullptr;
-    QFileInfo currentFileInfo;
+    QDir::Filters filters;
+    QList<QRegExp> nameFilterList;
+    bool createDesktopFileInfo = true;
+    bool isGvfs = false;
+    bool entriesRead = false;
+    int fd = -1;
+    QVector<Entry> entries;
+    int current = -1;
+    QString currentFileName;
+    QFuture<void> statFuture;
+    QAtomicInteger<bool> statCanceled{false};
 };
 
 class FileDirIterator : public DDirIterator
@@ -1537,7 +1711,7 @@ bool FileController::fileAdded(const DUrl &url) const
     return true;
 }
 
-DUrl FileController::handleTagFileUrl(const DUrl &url) const
+DUrl FileController::handleTagFileUrl(const DUrl &url)
 {
     DUrl newUrl(url);
     if (newUrl.path().startsWith("/data/home/"))
@@ -1580,8 +1754,12 @@ FileDirIterator::FileDirIterator(const QString &path, const QStringList &nameFil
 {
     bool sort_inode = flags.testFlag(static_cast<QDirIterator::IteratorFlag>(DDirIterator::SortINode));
 
-    if (sort_inode) {
-        iterator = new DFMSortInodeDirIterator(path);
+    // 本地目录使用 getdents64 批量读取，gvfs 目录仍然使用 QDirIterator，除非需要按 inode 排序
+    const bool local = sort_inode || (!gvfs && DFMLocalDirIterator::isSupported(filter, flags));
+    const bool isGvfs = local && FileUtils::isGvfsMountFile(path, true);
+
+    if (sort_inode || (local && !isGvfs)) {
+        iterator = new DFMLocalDirIterator(path, nameFilters, filter, isGvfs, !sort_inode);
     } else {
         iterator = new DFMQDirIterator(path, nameFilters, filter, flags, gvfs);
     }
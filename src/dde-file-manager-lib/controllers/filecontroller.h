@@ -62,6 +62,7 @@ public:
     bool setFileTags(const QSharedPointer<DFMSetFileTagsEvent> &event) const override;
     bool removeTagsOfFile(const QSharedPointer<DFMRemoveTagsOfFileEvent> &event) const override;
     QList<QString> getTagsThroughFiles(const QSharedPointer<DFMGetTagsThroughFilesEvent> &event) const override;
+    static DUrl handleTagFileUrl(const DUrl &url);
 
     bool renameFileByGio(const DUrl &oldUrl, const DUrl &newUrl) const;
 private:
@@ -74,8 +75,6 @@ private:
     bool isExtDeviceJobCase(void *curJob, const DUrl &url) const;
     bool isDiscburnJobCase(void *curJob, const DUrl &url) const;
     bool fileAdded(const DUrl &url) const;
-
-    DUrl handleTagFileUrl(const DUrl &url) const;
 };
 
 #endif // FILECONTROLLER_H
@@ -549,12 +549,63 @@ DUrlList RecentController::realUrlList(const DUrlList &recentUrls)
     return list;
 }
 
-void RecentController::handleFileChanged()
+QHash<QString, QString> RecentController::readXbelBookmarks(QIODevice *device)
 {
-    // read xbel file.
-    QFile file(m_xbelPath);
-    QList<DUrl> urlList;
+    QHash<QString, QString> bookmarks;
+    QXmlStreamReader reader(device);
+
+    while (!reader.atEnd()) {
+        if (!reader.readNextStartElement() ||
+                reader.name() != "bookmark") {
+            continue;
+        }
+
+        const QXmlStreamAttributes &attributes = reader.attributes();
+        const QStringRef &location = attributes.value("href");
+
+        if (!location.isEmpty())
+            bookmarks.insert(location.toString(), attributes.value("modified").toString());
+    }
 
+    return bookmarks;
+}
+
+RecentController::XbelEntry RecentController::createXbelEntry(const QString &href, const QString &modified)
+{
+    XbelEntry entry;
+    entry.modified = modified;
+
+    const QString &path = FileUtils::bindPathTransform(href);
+    DUrl url = DUrl(path);
+
+    // 保险箱内文件不显示到最近使用页面
+    if (VaultController::isVaultFile(href))
+        return entry;
+
+    if (path != href)
+        entry.bindPath = url.toLocalFile();
+
+    entry.fileUrl = url;
+
+    return entry;
+}
+
+void RecentController::checkXbelEntry(XbelEntry &entry)
+{
+    entry.recentUrl = DUrl();
+    if (!entry.fileUrl.isValid())
+        return;
+
+    QFileInfo info(entry.fileUrl.toLocalFile());
+    if (!info.exists() || !info.isFile())
+        return;
+
+    entry.recentUrl = entry.fileUrl;
+    entry.recentUrl.setScheme(RECENT_SCHEME);
+}
+
+void RecentController::handleFileChanged()
+{
     // try interrupting any other running parsers, then acquire the lock
     m_condition.wakeAll();
     if (!m_xbelFileLock.tryLock(100)) {
@@ -571,90 +622,118 @@ void RecentController::handleFileChanged()
         return;
     }
 
-    if (file.open(QIODevice::ReadOnly)) {
-        QXmlStreamReader reader(&file);
-        m_bindPathMaps.clear();
+    // 一次写入会触发多次文件变化的信号，文件没有变化时不需要重新解析
+    const QFileInfo xbelInfo(m_xbelPath);
+    if (xbelInfo.lastModified() == m_xbelLastModified && xbelInfo.size() == m_xbelSize) {
+        m_xbelFileLock.unlock();
+        return;
+    }
 
-        while (!reader.atEnd()) {
+    m_xbelLastModified = xbelInfo.lastModified();
+    m_xbelSize = xbelInfo.size();
 
-            if (!reader.readNextStartElement() ||
-                    reader.name() != "bookmark") {
-                continue;
-            }
+    // read xbel file.
+    QFile file(m_xbelPath);
+    QHash<QString, QString> bookmarks;
 
-            const QStringRef &location = reader.attributes().value("href");
-            const QStringRef &readTime = reader.attributes().value("modified");
-
-            if (!location.isEmpty()) {
-                QString path = location.toString();
-                path = FileUtils::bindPathTransform(path);
-                DUrl url = DUrl(path);
-                QFileInfo info(url.toLocalFile());
-                DUrl recentUrl = url;
-                recentUrl.setScheme(RECENT_SCHEME);
-
-                if (info.exists() && info.isFile()) {
-                    urlList << recentUrl;
-                    if (path != location.toString())
-                        m_bindPathMaps.insert(info.filePath(), location.toString());
-
-                    DThreadUtil::runInMainThread([ = ]() {
-                        if (dp.isNull())
-                            return;
-                        // 保险箱内文件不显示到最近使用页面
-                        if(!VaultController::isVaultFile(location.toString())) {
-                            if (!recentNodes.contains(recentUrl)) {
-                                recentNodes[recentUrl] = new RecentFileInfo(recentUrl);
-                                DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
-                                                                  &DAbstractFileWatcher::subfileCreated,
-                                                                  recentUrl);
-                            }
-                            //如果readtime变更了，需要通知filesystemmodel重新排序
-                            else if (recentNodes[recentUrl]->readDateTime().toSecsSinceEpoch() != QDateTime::fromString(readTime.toString(), Qt::ISODate).toSecsSinceEpoch()) {
-                                //先更新info数据
-                                recentNodes[recentUrl]->updateInfo();
-                                DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
-                                                                  &DAbstractFileWatcher::fileModified,
-                                                                  recentUrl);
-                            }
-                        }
-                    });
-                }
-            }
+    if (file.open(QIODevice::ReadOnly))
+        bookmarks = readXbelBookmarks(&file);
+
+    // 只为新增和 modified 变化了的条目转换路径，其它条目沿用上次的结果，
+    // 但文件可能在两次解析之间被删除或者重新创建，所有条目都要重新检查文件是否存在
+    QHash<QString, XbelEntry> entries;
+    entries.reserve(bookmarks.size());
+    QSet<DUrl> modifiedUrls;
+
+    for (auto it = bookmarks.constBegin(); it != bookmarks.constEnd(); ++it) {
+        auto lastEntry = m_xbelEntries.constFind(it.key());
+
+        if (lastEntry != m_xbelEntries.constEnd() && lastEntry->modified == it.value()) {
+            XbelEntry entry = lastEntry.value();
+            checkXbelEntry(entry);
+            entries.insert(it.key(), entry);
+            continue;
         }
+
+        XbelEntry entry = createXbelEntry(it.key(), it.value());
+        checkXbelEntry(entry);
+        entries.insert(it.key(), entry);
+
+        //如果readtime变更了，需要通知filesystemmodel重新排序
+        if (lastEntry != m_xbelEntries.constEnd() && entry.recentUrl.isValid())
+            modifiedUrls << entry.recentUrl;
     }
 
-    if (dp.isNull())
-        return;
-    // delete does not exist url.
-    for (auto iter = recentNodes.begin(); iter != recentNodes.end();) {
-        if (dp.isNull())
-            return;
-        const DUrl &url = iter.key();
-        if (!urlList.contains(url)) {
-            DThreadUtil::runInMainThread([this, &iter, url]() {
-                iter = recentNodes.erase(iter);
-
-                DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
-                                                  &DAbstractFileWatcher::fileDeleted,
-                                                  url);
-            });
-        } else {
-            auto info = iter.value();
-            if (info) {
-                iter.value()->updateInfo();
-                ++iter;
-            } else {
-                iter = recentNodes.erase(iter);
-            }
-        }
-        if (dp.isNull())
-            return;
+    QSet<DUrl> lastUrls;
+    for (const XbelEntry &entry : m_xbelEntries) {
+        if (entry.recentUrl.isValid())
+            lastUrls << entry.recentUrl;
     }
 
+    QSet<DUrl> urls;
+    QMap<QString, QString> bindPathMaps;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (!it->recentUrl.isValid())
+            continue;
+
+        urls << it->recentUrl;
+        if (!it->bindPath.isEmpty())
+            bindPathMaps.insert(it->bindPath, it.key());
+    }
+
+    DUrlList added, modified, removed;
+    for (const DUrl &url : urls) {
+        if (!lastUrls.contains(url))
+            added << url;
+        else if (modifiedUrls.contains(url))
+            modified << url;
+    }
+
+    for (const DUrl &url : lastUrls) {
+        if (!urls.contains(url))
+            removed << url;
+    }
+
+    m_xbelEntries = entries;
+
+    // 所有变化一次性交给主线程处理
+    DThreadUtil::runInMainThread([dp, added, modified, removed, bindPathMaps]() {
+        if (!dp.isNull())
+            dp->applyRecentChanges(added, modified, removed, bindPathMaps);
+    });
+
     m_xbelFileLock.unlock();
 }
 
+void RecentController::applyRecentChanges(const DUrlList &added, const DUrlList &modified, const DUrlList &removed,
+                                          const QMap<QString, QString> &bindPathMaps)
+{
+    m_bindPathMaps = bindPathMaps;
+
+    for (const DUrl &url : removed) {
+        recentNodes.remove(url);
+        DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT), &DAbstractFileWatcher::fileDeleted, url);
+    }
+
+    for (const DUrl &url : added) {
+        if (recentNodes.contains(url))
+            continue;
+
+        recentNodes[url] = new RecentFileInfo(url);
+        DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT), &DAbstractFileWatcher::subfileCreated, url);
+    }
+
+    for (const DUrl &url : modified) {
+        const RecentPointer &info = recentNodes.value(url);
+        if (!info)
+            continue;
+
+        //先更新info数据
+        info->updateInfo();
+        DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT), &DAbstractFileWatcher::fileModified, url);
+    }
+}
+
 void RecentController::asyncHandleFileChanged()
 {
     /* remark 190410:
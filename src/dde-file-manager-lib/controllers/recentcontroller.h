@@ -9,7 +9,9 @@
 #include "models/recentfileinfo.h"
 
 #include <QWaitCondition>
+#include <QDateTime>
 #include <QMutex>
+#include <QHash>
 
 class QFileSystemWatcher;
 class DAbstractFileInfo;
@@ -50,9 +52,22 @@ public:
     mutable QMap<DUrl, RecentPointer> recentNodes;
 
 private:
+    // recently-used.xbel 中一条 bookmark 上次的解析结果
+    struct XbelEntry {
+        QString modified;
+        QString bindPath;   // href 经过 bindPathTransform 转换后的本地路径，未转换时为空
+        DUrl fileUrl;   // 保险箱文件为空
+        DUrl recentUrl;   // 文件不存在、不是普通文件或者是保险箱文件时为空
+    };
+
     static DUrlList realUrlList(const DUrlList &recentUrls);
+    static QHash<QString, QString> readXbelBookmarks(QIODevice *device);
+    static XbelEntry createXbelEntry(const QString &href, const QString &modified);
+    static void checkXbelEntry(XbelEntry &entry);
     void handleFileChanged();
     void asyncHandleFileChanged();
+    void applyRecentChanges(const DUrlList &added, const DUrlList &modified, const DUrlList &removed,
+                            const QMap<QString, QString> &bindPathMaps);
 
 private:
     QString m_xbelPath;
@@ -60,6 +75,11 @@ private:
     DFileWatcher *m_watcher;
     QWaitCondition m_condition;
     QMutex m_xbelFileLock;
+
+    // 以下只在持有 m_xbelFileLock 的解析线程中访问
+    QHash<QString, XbelEntry> m_xbelEntries;
+    QDateTime m_xbelLastModified;
+    qint64 m_xbelSize = -1;
 };
 
 #endif // RECENTCONTROLLER_H
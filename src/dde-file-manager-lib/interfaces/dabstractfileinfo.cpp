@@ -54,6 +54,7 @@
 
 #include <dglibutils.h>
 #include <memory> // std::unique_ptr
+#include <algorithm>
 
 DCORE_USE_NAMESPACE
 
@@ -76,9 +77,23 @@ public:
     }
 };
 
-bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder order)
+static DCollator &threadCollator()
 {
     thread_local static DCollator sortCollator;
+    return sortCollator;
+}
+
+/*!
+ * \brief collationSortKey 与 compareByString 使用相同规则的排序键，用于预先计算后批量比较
+ */
+QCollatorSortKey collationSortKey(const QString &str)
+{
+    return threadCollator().sortKey(str);
+}
+
+bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder order)
+{
+    DCollator &sortCollator = threadCollator();
     //其他符号要排在最后，需要在中文前先做判断
     if (DFMGlobal::startWithSymbol(str1)) {
         if (!DFMGlobal::startWithSymbol(str2))
@@ -97,7 +112,33 @@ bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder ord
     return ((order == Qt::DescendingOrder) ^ (sortCollator.compare(str1, str2) < 0)) == 0x01;
 }
 
-COMPARE_FUN_DEFINE(fileDisplayName, DisplayName, DAbstractFileInfo)
+bool compareByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order)
+{
+    const int result = info1->fileDisplayNameSortKey().compare(info2->fileDisplayNameSortKey());
+    if (result == 0)
+        return false;
+
+    return ((order == Qt::DescendingOrder) ^ (result < 0)) == 0x01;
+}
+
+bool compareFileListByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort)
+{
+    if (!info1.data() || !info2.data())
+        return false;
+
+    if (!isMixedSort) {
+        if (info1->isDir()) {
+            if (!info2->isDir())
+                return true;
+        } else {
+            if (info2->isDir())
+                return false;
+        }
+    }
+
+    return compareByDisplayName(info1, info2, order);
+}
+
 COMPARE_FUN_DEFINE(fileSize, Size, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(lastModified, Modified, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(fileTypeDisplayName, Mime, DAbstractFileInfo)
@@ -105,38 +146,59 @@ COMPARE_FUN_DEFINE(created, Created, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(lastRead, LastRead, DAbstractFileInfo)
 } /// end namespace FileSortFunction
 
+DFileNameSortKey::DFileNameSortKey(const QString &name)
+    : rank((DFMGlobal::startWithSymbol(name) ? 2 : 0) + (DFMGlobal::startWithHanzi(name) ? 1 : 0))
+    , hasHanzi(std::any_of(name.cbegin(), name.cend(), [](const QChar &ch) { return ch.script() == QChar::Script_Han; }))
+    , pinyinKey(FileSortFunction::collationSortKey(hasHanzi ? DFMGlobal::toPinyin(name) : QString()))
+    , nameKey(FileSortFunction::collationSortKey(name))
+{
+
+}
+
+int DFileNameSortKey::compare(const DFileNameSortKey &other) const
+{
+    // 先符号后汉字，与 compareByString 的判断顺序相同
+    if (rank != other.rank)
+        return rank - other.rank;
+
+    if (hasHanzi || other.hasHanzi) {
+        // 不含汉字的一方以原文参与拼音比较
+        const int result = (hasHanzi ? pinyinKey : nameKey).compare(other.hasHanzi ? other.pinyinKey : other.nameKey);
+        if (result != 0)
+            return result;
+    }
+
+    return nameKey.compare(other.nameKey);
+}
+
 #define CALL_PROXY(Fun)\
     Q_D(const DAbstractFileInfo);\
     if (d->proxy) return d->proxy->Fun;
 
 QMap<DUrl, DAbstractFileInfo *> DAbstractFileInfoPrivate::urlToFileInfoMap;
 QReadWriteLock *DAbstractFileInfoPrivate::urlToFileInfoMapLock = new QReadWriteLock();
+std::atomic<quint64> DAbstractFileInfoPrivate::cacheHits(0);
+std::atomic<quint64> DAbstractFileInfoPrivate::cacheMisses(0);
 DMimeDatabase DAbstractFileInfoPrivate::mimeDatabase;
 
+static bool isInMainThread()
+{
+    return QThread::currentThread() && qApp && qApp->thread() && QThread::currentThread() == qApp->thread();
+}
+
 DAbstractFileInfoPrivate::DAbstractFileInfoPrivate(const DUrl &url, DAbstractFileInfo *qq, bool hasCache)
     : q_ptr(qq)
     , fileUrl(url)
 {
     //###(zccrs): 只在主线程中开启缓存，防止不同线程中持有同一对象时的竞争问题
-    if (hasCache && (url.isValid() && (QThread::currentThread()) &&  qApp && qApp->thread() && QThread::currentThread() == qApp->thread())) {
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-
-        urlToFileInfoMap[url] = qq;
+    if (hasCache && url.isValid() && isInMainThread()) {
+        insertToCache(url, qq);
     }
 }
 
 DAbstractFileInfoPrivate::~DAbstractFileInfoPrivate()
 {
-    QReadLocker read_locker(urlToFileInfoMapLock);
-    if (urlToFileInfoMap.value(fileUrl) == q_ptr) {
-        read_locker.unlock();
-        QWriteLocker write_locker(urlToFileInfoMapLock);
-        Q_UNUSED(write_locker)
-        urlToFileInfoMap.remove(fileUrl);
-    } else {
-        read_locker.unlock();
-    }
+    removeFromCache(fileUrl, q_ptr);
 }
 
 void DAbstractFileInfoPrivate::setUrl(const DUrl &url, bool hasCache)
@@ -145,31 +207,78 @@ void DAbstractFileInfoPrivate::setUrl(const DUrl &url, bool hasCache)
         return;
     }
 
-    if (urlToFileInfoMap.value(fileUrl) == q_ptr) {
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-        urlToFileInfoMap.remove(fileUrl);
-    }
+    removeFromCache(fileUrl, q_ptr);
 
     if (hasCache) {
-        QWriteLocker locker(urlToFileInfoMapLock);
-        Q_UNUSED(locker)
-        urlToFileInfoMap[url] = q_ptr;
+        insertToCache(url, q_ptr);
     }
     fileUrl = url;
 }
 
-DAbstractFileInfo *DAbstractFileInfoPrivate::getFileInfo(const DUrl &fileUrl)
+DAbstractFileInfoPointer DAbstractFileInfoPrivate::getFileInfo(const DUrl &fileUrl)
 {
-    //###(zccrs): 只在主线程中开启缓存，防止不同线程中持有同一对象时的竞争问题,优化都可以
-    if (!QThread::currentThread() || !qApp  || !qApp->thread() || QThread::currentThread() != qApp->thread()) {
-        return nullptr;
+    //###(zccrs): 只在主线程中开启缓存，防止不同线程中持有同一对象时的竞争问题
+    // 主线程随时会 refresh() 缓存中的对象，其它线程需要自己创建对象
+    if (!isInMainThread()) {
+        return DAbstractFileInfoPointer();
     }
 
     if (!fileUrl.isValid()) {
-        return nullptr;
+        return DAbstractFileInfoPointer();
     }
-    return urlToFileInfoMap.value(fileUrl);
+
+    QReadLocker locker(urlToFileInfoMapLock);
+    DAbstractFileInfo *info = urlToFileInfoMap.value(fileUrl);
+
+    if (!info) {
+        ++cacheMisses;
+        return DAbstractFileInfoPointer();
+    }
+
+    // 对象可能在其它线程中释放，引用计数为 0 的对象正在析构或者还没有被任何指针持有，不能再使用
+    int ref = info->ref.load();
+    do {
+        if (ref <= 0) {
+            ++cacheMisses;
+            return DAbstractFileInfoPointer();
+        }
+    } while (!info->ref.testAndSetOrdered(ref, ref + 1, ref));
+
+    DAbstractFileInfoPointer pointer(info);
+    info->ref.deref();
+    ++cacheHits;
+
+    return pointer;
+}
+
+DAbstractFileInfo::CacheStatistics DAbstractFileInfoPrivate::cacheStatistics()
+{
+    DAbstractFileInfo::CacheStatistics statistics;
+    statistics.hits = cacheHits.load();
+    statistics.misses = cacheMisses.load();
+
+    QReadLocker locker(urlToFileInfoMapLock);
+    statistics.count = urlToFileInfoMap.count();
+
+    return statistics;
+}
+
+void DAbstractFileInfoPrivate::insertToCache(const DUrl &fileUrl, DAbstractFileInfo *info)
+{
+    QWriteLocker locker(urlToFileInfoMapLock);
+    Q_UNUSED(locker)
+
+    urlToFileInfoMap[fileUrl] = info;
+}
+
+void DAbstractFileInfoPrivate::removeFromCache(const DUrl &fileUrl, DAbstractFileInfo *info)
+{
+    QWriteLocker locker(urlToFileInfoMapLock);
+    Q_UNUSED(locker)
+    auto it = urlToFileInfoMap.find(fileUrl);
+
+    if (it != urlToFileInfoMap.end() && it.value() == info)
+        urlToFileInfoMap.erase(it);
 }
 
 DAbstractFileInfo::DAbstractFileInfo(const DUrl &url, bool hasCache)
@@ -191,7 +300,12 @@ DAbstractFileInfo::~DAbstractFileInfo()
 
 const DAbstractFileInfoPointer DAbstractFileInfo::getFileInfo(const DUrl &fileUrl)
 {
-    return DAbstractFileInfoPointer(DAbstractFileInfoPrivate::getFileInfo(fileUrl));
+    return DAbstractFileInfoPrivate::getFileInfo(fileUrl);
+}
+
+DAbstractFileInfo::CacheStatistics DAbstractFileInfo::fileInfoCacheStatistics()
+{
+    return DAbstractFileInfoPrivate::cacheStatistics();
 }
 
 bool DAbstractFileInfo::exists() const
@@ -324,6 +438,24 @@ QString DAbstractFileInfo::fileDisplayPinyinName() const
     return d->pinyinName;
 }
 
+/*!
+ * \brief DAbstractFileInfo::fileDisplayNameSortKey 显示名称的排序键，首次使用时计算并缓存，显示名称变化后重新计算
+ */
+DFileNameSortKey DAbstractFileInfo::fileDisplayNameSortKey() const
+{
+    Q_D(const DAbstractFileInfo);
+
+    const QString &displayName = this->fileDisplayName();
+
+    QMutexLocker locker(&d->sortKeyMutex);
+    if (!d->nameSortKey || d->sortKeyName != displayName) {
+        d->nameSortKey.reset(new DFileNameSortKey(displayName));
+        d->sortKeyName = displayName;
+    }
+
+    return *d->nameSortKey;
+}
+
 bool DAbstractFileInfo::canRename() const
 {
     CALL_PROXY(canRename());
@@ -14,6 +14,7 @@
 #include <QMimeType>
 #include <QMimeDatabase>
 #include <QDir>
+#include <QCollator>
 
 #include "durl.h"
 #include "dfmglobal.h"
@@ -48,12 +49,12 @@
             }\
             \
             if ((isDir1 && isDir2 && (value1 == value2)) || (isFile1 && isFile2 && (value1 == value2))) {\
-                return compareByString(info1->fileDisplayName(), info2->fileDisplayName());\
+                return compareByDisplayName(info1, info2);\
             }\
             \
         } else {\
             if (value1 == value2)\
-                return compareByString(info1->fileDisplayName(), info2->fileDisplayName());\
+                return compareByDisplayName(info1, info2);\
         }\
         bool isStrType = typeid(value1) == typeid(QString);\
         if (isStrType)\
@@ -64,6 +65,7 @@
 
 namespace FileSortFunction {
 bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder order = Qt::AscendingOrder);
+QCollatorSortKey collationSortKey(const QString &str);
 template<typename T>
 bool compareByString(T, T, Qt::SortOrder order = Qt::AscendingOrder)
 {
@@ -80,6 +82,36 @@ typedef std::function<const DAbstractFileInfoPointer(int)> getFileInfoFun;
 typedef DFMGlobal::MenuAction MenuAction;
 class DAbstractFileInfoPrivate;
 
+/*!
+ * \brief The DFileNameSortKey class 文件名的排序键
+ * 由首字符类别（字母数字、汉字、符号）、拼音展开后的排序键和原文的排序键组成，
+ * 比较时只需比较预先计算好的字节序列，顺序与 FileSortFunction::compareByString 的规则一致，
+ * 汉字按拼音排序
+ */
+class DFileNameSortKey
+{
+public:
+    explicit DFileNameSortKey(const QString &name);
+
+    int compare(const DFileNameSortKey &other) const;
+
+private:
+    int rank;
+    bool hasHanzi;
+    QCollatorSortKey pinyinKey;
+    QCollatorSortKey nameKey;
+};
+
+namespace FileSortFunction {
+bool compareByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order = Qt::AscendingOrder);
+bool compareFileListByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort);
+bool compareFileListBySize(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort);
+bool compareFileListByModified(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort);
+bool compareFileListByMime(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort);
+bool compareFileListByCreated(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort);
+bool compareFileListByLastRead(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort);
+}
+
 
 #ifdef SW_LABEL
 
@@ -132,6 +164,13 @@ public:
         CustomType = 0x100
     };
 
+    // 文件信息缓存的命中统计，用于性能分析
+    struct CacheStatistics {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        int count = 0;
+    };
+
     inline static QString dateTimeFormat()
     {
         return "yyyy/MM/dd HH:mm:ss";
@@ -142,6 +181,7 @@ public:
     virtual ~DAbstractFileInfo();
 
     static const DAbstractFileInfoPointer getFileInfo(const DUrl &fileUrl);
+    static CacheStatistics fileInfoCacheStatistics();
 
     virtual bool exists() const;
     virtual bool isPrivate() const;
@@ -157,6 +197,7 @@ public:
     virtual QString fileDisplayName() const;
     virtual QString fileSharedName() const;
     QString fileDisplayPinyinName() const;
+    DFileNameSortKey fileDisplayNameSortKey() const;
 
     virtual bool canRename() const;
     virtual bool canShare() const;
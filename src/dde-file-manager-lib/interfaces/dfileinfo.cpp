@@ -43,11 +43,15 @@
 #include <ddiskmanager.h>
 
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 DFM_USE_NAMESPACE
 
 #define REQUEST_THUMBNAIL_DEALY 500
+// 合并查询扩展属性的时间窗口（毫秒）与每次查询的最大文件数
+#define REQUEST_EP_BATCH_INTERVAL 20
+#define REQUEST_EP_BATCH_SIZE 1000
 
 class RequestEP : public QThread
 {
@@ -117,37 +121,78 @@ RequestEP::~RequestEP()
 void RequestEP::run()
 {
     forever {
-        requestEPFilesLock.lockForRead();
+        // 等待一小段时间，把这段时间内请求的文件合并为一次查询
+        QThread::msleep(REQUEST_EP_BATCH_INTERVAL);
+
+        requestEPFilesLock.lockForWrite();
         if (requestEPFiles.isEmpty()) {
             requestEPFilesLock.unlock();
             return;
         }
+
+        QList<QPair<DUrl, DFileInfoPrivate *>> file_infos;
+        while (!requestEPFiles.isEmpty() && file_infos.count() < REQUEST_EP_BATCH_SIZE) {
+            file_infos << requestEPFiles.dequeue();
+        }
         requestEPFilesLock.unlock();
-        requestEPFilesLock.lockForWrite();
-        auto file_info = requestEPFiles.dequeue();
-        requestEPFilesLock.unlock();
 
-        const DUrl &url = file_info.first;
-        const QStringList &tag_list = DFileService::instance()->getTagsThroughFiles(nullptr, {url});
+        // 本地文件一次查询各自的标记，其它文件仍通过文件服务逐个查询
+        QList<DUrl> local_urls;
+        for (const auto &file_info : file_infos) {
+            if (file_info.first.isLocalFile()) {
+                local_urls << FileController::handleTagFileUrl(file_info.first);
+            }
+        }
+
+        const QHash<DUrl, QList<QString>> &local_tags = TagManager::instance()->getTagsOfFiles(local_urls);
+        QList<QStringList> tag_lists;
+        QSet<QString> all_tags;
 
-        QVariantHash ep;
+        for (const auto &file_info : file_infos) {
+            const DUrl &url = file_info.first;
+            const QStringList &tag_list = url.isLocalFile() ? local_tags.value(FileController::handleTagFileUrl(url))
+                                          : DFileService::instance()->getTagsThroughFiles(nullptr, {url});
 
-        if (!tag_list.isEmpty()) {
-            ep["tag_name_list"] = tag_list;
+            tag_lists << tag_list;
+            for (const QString &tag : tag_list) {
+                all_tags << tag;
+            }
         }
 
-        QList<QColor> colors;
+        const QMap<QString, QColor> &tag_colors = TagManager::instance()->getTagColor(all_tags.toList());
 
-        for (const QColor &color : TagManager::instance()->getTagColor(tag_list)) {
-            colors << color;
-        }
+        for (int i = 0; i < file_infos.count(); ++i) {
+            const DUrl &url = file_infos.at(i).first;
+            const QStringList &tag_list = tag_lists.at(i);
 
-        if (!colors.isEmpty()) {
-            ep["colored"] = QVariant::fromValue(colors);
-        }
+            QVariantHash ep;
+
+            if (!tag_list.isEmpty()) {
+                ep["tag_name_list"] = tag_list;
+            }
+
+            // 与逐个查询时相同，按标记名称排序
+            QMap<QString, QColor> colors_of_file;
+
+            for (const QString &tag : tag_list) {
+                if (tag_colors.contains(tag)) {
+                    colors_of_file[tag] = tag_colors.value(tag);
+                }
+            }
 
-        QMetaObject::invokeMethod(this, "processEPChanged", Qt::QueuedConnection,
-                                  Q_ARG(DUrl, url), Q_ARG(DFileInfoPrivate *, file_info.second), Q_ARG(QVariantHash, ep));
+            QList<QColor> colors;
+
+            for (const QColor &color : colors_of_file) {
+                colors << color;
+            }
+
+            if (!colors.isEmpty()) {
+                ep["colored"] = QVariant::fromValue(colors);
+            }
+
+            QMetaObject::invokeMethod(this, "processEPChanged", Qt::QueuedConnection,
+                                      Q_ARG(DUrl, url), Q_ARG(DFileInfoPrivate *, file_infos.at(i).second), Q_ARG(QVariantHash, ep));
+        }
     }
 }
 
@@ -283,6 +328,81 @@ bool DFileInfoPrivate::isLowSpeedFile() const
     return lowSpeedFile;
 }
 
+#ifdef STATX_BASIC_STATS
+static qint64 toMSecs(const struct statx_timestamp &time)
+{
+    return static_cast<qint64>(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+static bool fillFileStat(const QByteArray &path, bool follow, DFileInfoPrivate::FileStat &fileStat)
+{
+    struct statx buffer;
+    if (statx(AT_FDCWD, path.constData(), follow ? 0 : AT_SYMLINK_NOFOLLOW,
+              STATX_BASIC_STATS | STATX_BTIME, &buffer) != 0)
+        return false;
+
+    fileStat.mode = buffer.stx_mode;
+    fileStat.inode = buffer.stx_ino;
+    fileStat.size = static_cast<qint64>(buffer.stx_size);
+    fileStat.ownerId = buffer.stx_uid;
+    fileStat.groupId = buffer.stx_gid;
+    fileStat.birthTime = (buffer.stx_mask & STATX_BTIME) ? toMSecs(buffer.stx_btime) : -1;
+    fileStat.changeTime = toMSecs(buffer.stx_ctime);
+    fileStat.lastModified = toMSecs(buffer.stx_mtime);
+    fileStat.lastRead = toMSecs(buffer.stx_atime);
+
+    return true;
+}
+#else
+// 不支持 statx 的系统上退回到 stat/lstat，没有创建时间
+static bool fillFileStat(const QByteArray &path, bool follow, DFileInfoPrivate::FileStat &fileStat)
+{
+    QT_STATBUF buffer;
+    if ((follow ? QT_STAT(path.constData(), &buffer) : QT_LSTAT(path.constData(), &buffer)) != 0)
+        return false;
+
+    fileStat.mode = buffer.st_mode;
+    fileStat.inode = buffer.st_ino;
+    fileStat.size = static_cast<qint64>(buffer.st_size);
+    fileStat.ownerId = buffer.st_uid;
+    fileStat.groupId = buffer.st_gid;
+    fileStat.birthTime = -1;
+    fileStat.changeTime = static_cast<qint64>(buffer.st_ctime) * 1000;
+    fileStat.lastModified = static_cast<qint64>(buffer.st_mtime) * 1000;
+    fileStat.lastRead = static_cast<qint64>(buffer.st_atime) * 1000;
+
+    return true;
+}
+#endif
+
+DFileInfoPrivate::FileStat DFileInfoPrivate::fileStat() const
+{
+    QMutexLocker locker(&statMutex);
+
+    if (statValid)
+        return statSnapshot;
+
+    statSnapshot = FileStat();
+    statValid = true;
+
+    const QByteArray &path = QFile::encodeName(fileInfo.absoluteFilePath());
+    if (!fillFileStat(path, false, statSnapshot))
+        return statSnapshot;
+
+    statSnapshot.exists = true;
+    statSnapshot.isSymLink = S_ISLNK(statSnapshot.mode);
+    // 链接文件的类型、大小和时间以目标文件为准，目标不存在时保留链接本身的属性
+    statSnapshot.targetExists = !statSnapshot.isSymLink || fillFileStat(path, true, statSnapshot);
+
+    return statSnapshot;
+}
+
+void DFileInfoPrivate::invalidateFileStat() const
+{
+    QMutexLocker locker(&statMutex);
+    statValid = false;
+}
+
 DFileInfo::DFileInfo(const QString &filePath, bool hasCache)
     : DFileInfo(DUrl::fromLocalFile(filePath), hasCache)
 {
@@ -322,7 +442,7 @@ bool DFileInfo::exists() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.exists() || d->fileInfo.isSymLink();
+    return d->fileStat().exists;
 }
 
 bool DFileInfo::isPrivate() const
@@ -391,7 +511,7 @@ QList<QIcon> DFileInfo::additionalIcon() const
     // 当为快捷方式时，有源文件文件不存在的情况，所以增加特殊判断
     // 注意：此处将exits()替换成QFileInfo::exists()原因在于重命名时，原始文件的QFileinfo对象没有及时刷新，
     // exits()判断的结果仍然是true（错误结果），反而静态函数QFileInfo::exits()判断的结果为false（正确结果）,
-    // 所以此处使用QFileInfo::exits()判断文件信息
+    // 所以此处使用QFileInfo::exits()判断文件信息，不能使用 stat 快照
     if (!isSymLink() && !QFileInfo::exists(filePath())) {
         return icons;
     }
@@ -635,33 +755,30 @@ DAbstractFileInfo::FileType DFileInfo::fileType() const
 
     // fix bug#52950 【专业版1030】【文管5.2.0.72】回收站删除指向块设备的链接文件时，删除失败
     // QT_STATBUF判断链接文件属性时，判断的是指向文件的属性，使用QFileInfo判断
-    QString absoluteFilePath = d->fileInfo.absoluteFilePath();
-    if (absoluteFilePath.startsWith(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath))
-            && d->fileInfo.isSymLink()) {
+    const DFileInfoPrivate::FileStat &fileStat = d->fileStat();
+    if (fileStat.isSymLink
+            && d->fileInfo.absoluteFilePath().startsWith(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath))) {
         return RegularFile;
     }
 
-    // Cannot access statBuf.st_mode from the filesystem engine, so we have to stat again.
-    // In addition we want to follow symlinks.
-    const QByteArray &nativeFilePath = QFile::encodeName(absoluteFilePath);
-    QT_STATBUF statBuffer;
-    if (QT_STAT(nativeFilePath.constData(), &statBuffer) == 0) {
-        if (S_ISDIR(statBuffer.st_mode))
+    // 链接文件使用目标文件的类型
+    if (fileStat.targetExists) {
+        if (S_ISDIR(fileStat.mode))
             return Directory;
 
-        if (S_ISCHR(statBuffer.st_mode))
+        if (S_ISCHR(fileStat.mode))
             return CharDevice;
 
-        if (S_ISBLK(statBuffer.st_mode))
+        if (S_ISBLK(fileStat.mode))
             return BlockDevice;
 
-        if (S_ISFIFO(statBuffer.st_mode))
+        if (S_ISFIFO(fileStat.mode))
             return FIFOFile;
 
-        if (S_ISSOCK(statBuffer.st_mode))
+        if (S_ISSOCK(fileStat.mode))
             return SocketFile;
 
-        if (S_ISREG(statBuffer.st_mode))
+        if (S_ISREG(fileStat.mode))
             return RegularFile;
     }
 
@@ -672,21 +789,25 @@ bool DFileInfo::isFile() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.isFile();
+    const DFileInfoPrivate::FileStat &fileStat = d->fileStat();
+
+    return fileStat.targetExists && S_ISREG(fileStat.mode);
 }
 
 bool DFileInfo::isDir() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.isDir();
+    const DFileInfoPrivate::FileStat &fileStat = d->fileStat();
+
+    return fileStat.targetExists && S_ISDIR(fileStat.mode);
 }
 
 bool DFileInfo::isSymLink() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.isSymLink();
+    return d->fileStat().isSymLink;
 }
 
 bool DFileInfo::canDragCompress() const
@@ -702,7 +823,7 @@ QString DFileInfo::symlinkTargetPath() const
 {
     Q_D(const DFileInfo);
 
-    if (d->fileInfo.isSymLink()) {
+    if (d->fileStat().isSymLink) {
         char s[PATH_MAX + 1];
         int len = static_cast<int>(readlink(d->fileInfo.absoluteFilePath().toLocal8Bit().constData(), s, PATH_MAX));
 
@@ -716,7 +837,7 @@ DUrl DFileInfo::symLinkTarget() const
 {
     Q_D(const DFileInfo);
 
-    if (d->fileInfo.isSymLink())
+    if (d->fileStat().isSymLink)
         return DUrl::fromLocalFile(d->fileInfo.symLinkTarget());
 
     return DAbstractFileInfo::symLinkTarget();
@@ -733,7 +854,7 @@ uint DFileInfo::ownerId() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.ownerId();
+    return d->fileStat().ownerId;
 }
 
 QString DFileInfo::group() const
@@ -747,7 +868,7 @@ uint DFileInfo::groupId() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.groupId();
+    return d->fileStat().groupId;
 }
 
 bool DFileInfo::permission(QFileDevice::Permissions permissions) const
@@ -774,7 +895,7 @@ qint64 DFileInfo::size() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.size();
+    return d->fileStat().size;
 }
 
 int DFileInfo::filesCount() const
@@ -799,35 +920,25 @@ QDateTime DFileInfo::created() const
 {
     Q_D(const DFileInfo);
 
-    return d->fileInfo.created();
+    const DFileInfoPrivate::FileStat &fileStat = d->fileStat();
+
+    // 与 QFileInfo::created() 一致，不支持创建时间时使用状态改变时间
+    return QDateTime::fromMSecsSinceEpoch(fileStat.birthTime >= 0 ? fileStat.birthTime : fileStat.changeTime);
 }
 
 QDateTime DFileInfo::lastModified() const
 {
     Q_D(const DFileInfo);
 
-    if (isSymLink() && !d->fileInfo.exists()) {
-        struct stat attrib;
-
-        if (lstat(d->fileInfo.filePath().toLocal8Bit().constData(), &attrib) >= 0)
-            return QDateTime::fromTime_t(static_cast<uint>(attrib.st_mtime));
-    }
-
-    return d->fileInfo.lastModified();
+    // 目标不存在的链接文件使用链接本身的时间
+    return QDateTime::fromMSecsSinceEpoch(d->fileStat().lastModified);
 }
 
 QDateTime DFileInfo::lastRead() const
 {
     Q_D(const DFileInfo);
 
-    if (isSymLink() && !d->fileInfo.exists()) {
-        struct stat attrib;
-
-        if (lstat(d->fileInfo.filePath().toLocal8Bit().constData(), &attrib) >= 0)
-            return QDateTime::fromTime_t(static_cast<uint>(attrib.st_mtime));
-    }
-
-    return d->fileInfo.lastRead();
+    return QDateTime::fromMSecsSinceEpoch(d->fileStat().lastRead);
 }
 
 QMimeType DFileInfo::mimeType(QMimeDatabase::MatchMode mode) const
@@ -908,11 +1019,11 @@ void DFileInfo::refresh(const bool isForce)
     Q_UNUSED(isForce)
 
     d->fileInfo.refresh();
+    d->invalidateFileStat();
     d->icon = QIcon();
     d->epInitialized = false;
     d->hasThumbnail = -1;
     d->mimeType = QMimeType();
-    d->inode = 0;
 }
 
 DUrl DFileInfo::goToUrlWhenDeleted() const
@@ -931,8 +1042,10 @@ void DFileInfo::makeToActive()
 {
     Q_D(DFileInfo);
 
-    if (!d->isLowSpeedFile())
+    if (!d->isLowSpeedFile()) {
         d->fileInfo.refresh();
+        d->invalidateFileStat();
+    }
 
     DAbstractFileInfo::makeToActive();
 }
@@ -989,14 +1102,10 @@ QIcon DFileInfo::fileIcon() const
     if (d->needThumbnail || d->hasThumbnail > 0) {
         d->needThumbnail = true;
 
-        const QIcon icon(DThumbnailProvider::instance()->thumbnailFilePath(d->fileInfo, DThumbnailProvider::Large));
-
-        if (!icon.isNull()) {
-            QPixmap pixmap = icon.pixmap(DThumbnailProvider::Large, DThumbnailProvider::Large);
-            QPainter pa(&pixmap);
+        // 缩略图缓存在内存中，文件重新进入可见区域时不再读取磁盘
+        const QPixmap &pixmap = DThumbnailProvider::instance()->thumbnailPixmap(d->fileInfo, DThumbnailProvider::Large, inode());
 
-            pa.setPen(Qt::gray);
-            pa.drawPixmap(0, 0, pixmap);
+        if (!pixmap.isNull()) {
             d->icon.addPixmap(pixmap);
             d->iconFromTheme = false;
             d->needThumbnail = false;
@@ -1125,18 +1234,8 @@ QVariantHash DFileInfo::extraProperties() const
 quint64 DFileInfo::inode() const
 {
     Q_D(const DFileInfo);
-    if (d->inode != 0) {
-        return d->inode;
-    }
-
-    struct stat statinfo;
-    QByteArray pathArry = d->fileInfo.absoluteFilePath().toUtf8();
-    std::string pathStd = pathArry.toStdString();
-    if (stat(pathStd.c_str(), &statinfo) != 0)
-        return 0;
-    d->inode = statinfo.st_ino;
 
-    return d->inode;
+    return d->fileStat().inode;
 }
 
 DFileInfo::DFileInfo(DFileInfoPrivate &dd)
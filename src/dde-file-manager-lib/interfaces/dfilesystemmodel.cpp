@@ -22,6 +22,7 @@
 //处理自动整理的路径问题
 #include "controllers/mergeddesktopcontroller.h"
 #include "shutil/dfmfilelistfile.h"
+#include "shutil/dfmfilesorter.h"
 #include "dfilesystemmodel_p.h"
 #include "dfmsettings.h"
 
@@ -40,12 +41,12 @@
 
 static int FindInsertPosInOrderList(const FileSystemNodePointer &needNode,
         const QList<FileSystemNodePointer> &list, const DAbstractFileInfo::CompareFunction &sortFun,
-        const Qt::SortOrder &order, const bool *isCancel){
+        const Qt::SortOrder &order, const bool *isCancel, int begin = 0){
     if (!sortFun)
         return list.count();
-    int begin = 0;
     int end = list.count();
     int row = (begin + end)/2;
+    const bool isMixedSort = DFMApplication::appAttribute(DFMApplication::AA_FileAndDirMixedSort).toBool();
     // 先找到文件还是目录
     forever {
 
@@ -56,7 +57,7 @@ static int FindInsertPosInOrderList(const FileSystemNodePointer &needNode,
             break;
 
         const FileSystemNodePointer &node = list.at(row);
-        if (!sortFun(needNode->fileInfo, node->fileInfo, order, DFMApplication::appAttribute(DFMApplication::AA_FileAndDirMixedSort).toBool())) {
+        if (!sortFun(needNode->fileInfo, node->fileInfo, order, isMixedSort)) {
             begin = row;
             row = (end + begin + 1) / 2;
             if (row >= end)
@@ -170,22 +171,11 @@ void FileSystemNode::applyFileFilter(std::shared_ptr<FileFilter> filter)
 void FileSystemNode::sortAllChildren(const DAbstractFileInfo::CompareFunction &sortFun, const Qt::SortOrder &order, const bool *cancel) {
     if (!sortFun)
         return;
-    QList<FileSystemNodePointer> sortList;
-    int row = 0;
     rwLock->lockForWrite();
-    for (const auto & needNode : visibleChildren) {
-        if (*cancel) {
-            rwLock->unlock();
-            return;
-        }
-        row = FindInsertPosInOrderList(needNode, sortList, sortFun, order, cancel);
-        if (*cancel) {
-            rwLock->unlock();
-            return;
-        }
-        sortList.insert(row, needNode);
-    }
-    visibleChildren = sortList;
+    QList<FileSystemNodePointer> sortList = visibleChildren;
+    // 被取消时保持原有顺序
+    if (DFMFileSorter(sortFun, order, cancel).sort(sortList, [](const FileSystemNodePointer &node) { return node->fileInfo; }))
+        visibleChildren = sortList;
     rwLock->unlock();
 }
 
@@ -536,6 +526,8 @@ void FileNodeManagerThread::addFile(const DAbstractFileInfoPointer &info, bool a
     if (isEnd)
         jobFinisded = true;
 
+    fileQueueCondition.wakeAll();
+
     if (!isRunning() && canStart && !fileQueue.isEmpty())
         start();
 }
@@ -545,7 +537,10 @@ void FileNodeManagerThread::removeFile(const DAbstractFileInfoPointer &info)
     if (!enable)
         return;
 
+    mutex.lock();
     fileQueue.enqueue(qMakePair(RmFile, info));
+    fileQueueCondition.wakeAll();
+    mutex.unlock();
 
     if (!isRunning()) {
         if (!waitTimer->isActive()) {
@@ -567,12 +562,23 @@ void FileNodeManagerThread::setEnable(bool enable)
     this->enable = enable;
 }
 
+void FileNodeManagerThread::setJobFinisded(const bool isFinisded)
+{
+    QMutexLocker lk(&mutex);
+    jobFinisded = isFinisded;
+    fileQueueCondition.wakeAll();
+}
+
 void FileNodeManagerThread::stop()
 {
+    mutex.lock();
     enable = false;
     jobFinisded = false;
     canStart = false;
     isInsertCache = false;
+    // 唤醒等待文件队列的工作线程
+    fileQueueCondition.wakeAll();
+    mutex.unlock();
     // 确保在timer的所在线程停止它
     waitTimer->metaObject()->invokeMethod(waitTimer, "stop");
     // 取消工作线程的等待，防止产生死锁
@@ -620,6 +626,60 @@ QPair<FileNodeManagerThread::EventType, DAbstractFileInfoPointer> FileNodeManage
     return fileQueue.dequeue();
 }
 
+void FileNodeManagerThread::waitForFileQueue()
+{
+    QMutexLocker lk(&mutex);
+    if (enable && !jobFinisded && fileQueue.isEmpty())
+        fileQueueCondition.wait(&mutex);
+}
+
+bool FileNodeManagerThread::insertSortedNodes(const QList<FileSystemNodePointer> &nodes, const DAbstractFileInfo::CompareFunction &compareFun)
+{
+    if (nodes.isEmpty())
+        return true;
+
+    // 在模型线程中合并到已排序的列表，插入到同一位置的节点只需要通知一次
+    DThreadUtil::runInThread(&semaphore, model()->thread(), [&] {
+        const QList<FileSystemNodePointer> &visibleChildren = rootNode->getChildrenList();
+        const Qt::SortOrder order = model()->sortOrder();
+        bool cancel = false;
+        QList<FileSystemNodePointer> insertNodes;
+        QVector<int> rows;
+        int row = 0;
+
+        insertNodes.reserve(nodes.count());
+        rows.reserve(nodes.count());
+
+        // 节点已按相同的规则排好序，下一个节点的位置只需要从上一个位置往后查找
+        for (const FileSystemNodePointer &node : nodes) {
+            if (rootNode->childContains(node->fileInfo->fileUrl()))
+                continue;
+
+            row = FindInsertPosInOrderList(node, visibleChildren, compareFun, order, &cancel, row);
+            insertNodes << node;
+            rows << row;
+        }
+
+        int offset = 0;
+        for (int first = 0; first < insertNodes.count() && enable;) {
+            int last = first;
+            while (last + 1 < insertNodes.count() && rows.at(last + 1) == rows.at(first))
+                ++last;
+
+            const int index = rows.at(first) + offset;
+            model()->beginInsertRows(model()->createIndex(rootNode, 0), index, index + last - first);
+            for (int i = first; i <= last; ++i)
+                rootNode->insertChildren(index + i - first, insertNodes.at(i)->fileInfo->fileUrl(), insertNodes.at(i), &isInsertCache);
+            model()->endInsertRows();
+
+            offset += last - first + 1;
+            first = last + 1;
+        }
+    });
+
+    return enable.load();
+}
+
 void FileNodeManagerThread::run()
 {
     // 缓存需要批量插入的文件信息列表
@@ -627,6 +687,11 @@ void FileNodeManagerThread::run()
     QList<DAbstractFileInfoPointer> backlogDirInfoList;
     // 使用计时器避免文件在批量插入列表中等待太久
     QTime timerOfFileList, timerOfDirList;
+    // 缓存需要按顺序插入的节点，攒够一批或者队列暂时为空时再一起插入
+    QList<FileSystemNodePointer> pendingSortedNodes;
+    QSet<DUrl> pendingSortedUrls;
+    // 每批最多插入的节点数量，避免一次占用模型线程太久
+    const int sortedBatchSize = 1000;
 
     auto insertInfoList = [&](int index, const QList<DAbstractFileInfoPointer> &list) {
         DThreadUtil::runInThread(&semaphore, model()->thread(), model(), &DFileSystemModel::beginInsertRows,
@@ -716,6 +781,21 @@ void FileNodeManagerThread::run()
 
         return false;
     };
+
+    auto disposePendingSortedNodes = [&](const DAbstractFileInfo::CompareFunction &compareFun) {
+        if (pendingSortedNodes.isEmpty())
+            return true;
+
+        model()->sortByMySelf(pendingSortedNodes, compareFun);
+
+        if (!insertSortedNodes(pendingSortedNodes, compareFun))
+            return false;
+
+        pendingSortedNodes.clear();
+        pendingSortedUrls.clear();
+
+        return true;
+    };
 begin:
     QList<FileSystemNodePointer> visibleChildren;
     QHash<DUrl, FileSystemNodePointer> children;
@@ -729,16 +809,24 @@ begin:
         tempjobFinisded = jobFinisded;
 
         if (isFileQueueEmpty()) {
+            // 暂时没有新文件时先把攒下的节点插入
+            if (!disposePendingSortedNodes(compareFun))
+                return;
+
             if (tempjobFinisded) {
                 break;
             }
-            QThread::msleep(1);
+
+            waitForFileQueue();
             continue;
         }
 
         const QPair<EventType, DAbstractFileInfoPointer> &v = dequeueFileQueue();
         const DAbstractFileInfoPointer &fileInfo = v.second;
         if (tempjobFinisded && visibleChildren.isEmpty() && !isFileQueueEmpty()) {
+            if (!disposePendingSortedNodes(compareFun))
+                return;
+
             isInsertCache = true;
             visibleChildren = rootNode->getChildrenList();
             children = rootNode->getChildrenMap();
@@ -749,7 +837,7 @@ begin:
         const DUrl &fileUrl = fileInfo->fileUrl();
 
         if (v.first == AddFile || v.first == AppendFile) {
-            if (rootNode->childContains(fileUrl))
+            if (rootNode->childContains(fileUrl) || pendingSortedUrls.contains(fileUrl))
                 continue;
 
             int row = -1;
@@ -772,8 +860,19 @@ begin:
                         } else {
                             continue;
                         }
+                    } else if (rootNode->fileInfo->fileUrl().isSearchFile() || !tempjobFinisded) {
+                        pendingSortedNodes << node;
+                        pendingSortedUrls << fileUrl;
+
+                        if (pendingSortedNodes.count() >= sortedBatchSize && !disposePendingSortedNodes(compareFun))
+                            return;
+
+                        continue;
                     } else {
-                       row = rootNode->insertChildren(fileInfo->fileUrl(), node, compareFun, model()->sortOrder());
+                        if (!disposePendingSortedNodes(compareFun))
+                            return;
+
+                        row = rootNode->insertChildren(fileInfo->fileUrl(), node, compareFun, model()->sortOrder());
                     }
                 } else {
                     rootNode->appendUnVisibaleChildren(fileInfo->fileUrl(), node);
@@ -828,6 +927,9 @@ begin:
             }
         } else {
             // 先尝试从待插入列表中删除
+            if (pendingSortedUrls.contains(fileUrl) && !disposePendingSortedNodes(compareFun))
+                return;
+
             if (fileInfo->isFile()) {
                 if (removeInList(backlogFileInfoList, fileUrl)) {
                     continue;
@@ -857,6 +959,9 @@ begin:
     }
 
     // 退出前确保所有文件都被处理
+    if (!disposePendingSortedNodes(compareFun))
+        return;
+
     disposeBacklogFileList();
     disposeBacklogDirList();
 
@@ -3154,17 +3259,7 @@ bool DFileSystemModel::beginRemoveRows(const QModelIndex &parent, int first, int
 void DFileSystemModel::sortByMySelf(QList<FileSystemNodePointer> &list, const DAbstractFileInfo::CompareFunction &sortFun)
 {
     Q_D(DFileSystemModel);
-    QList<FileSystemNodePointer> sortList;
-    int row = 0;
-    for (const auto & needNode : list) {
-        if (isNeedToBreakBusyCase)
-            return;
-        row = FindInsertPosInOrderList(needNode, sortList, sortFun, d->srotOrder, &isNeedToBreakBusyCase);
-        if (isNeedToBreakBusyCase)
-            return;
-        sortList.insert(row, needNode);
-    }
-    list = sortList;
+    DFMFileSorter(sortFun, d->srotOrder, &isNeedToBreakBusyCase).sort(list, [](const FileSystemNodePointer &node) { return node->fileInfo; });
 }
 
 void DFileSystemModel::endRemoveRows()
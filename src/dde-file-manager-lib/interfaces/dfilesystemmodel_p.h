@@ -13,6 +13,7 @@
 #include "shutil/dfmfilelistfile.h"
 
 #include <QReadWriteLock>
+#include <QWaitCondition>
 #include <QQueue>
 
 class FileSystemNode : public QSharedData
@@ -196,9 +197,7 @@ public:
     void setRootNode(const FileSystemNodePointer &node);
     void setEnable(bool enable);
     void stop();
-    void setJobFinisded(const bool isFinisded) {
-        jobFinisded = isFinisded;
-    }
+    void setJobFinisded(const bool isFinisded);
     void setStart();
     bool hasUpdateChildren() const;
     bool *isInsertCaches();
@@ -206,6 +205,8 @@ public:
     QPair<EventType, DAbstractFileInfoPointer> dequeueFileQueue();
 private:
     void run() override;
+    void waitForFileQueue();
+    bool insertSortedNodes(const QList<FileSystemNodePointer> &nodes, const DAbstractFileInfo::CompareFunction &compareFun);
 
 private:
     QTimer *waitTimer;
@@ -215,6 +216,8 @@ private:
     QAtomicInteger<bool> canStart{false};
     QAtomicInteger<bool> jobFinisded{false};
     QMutex mutex;
+    // 队列为空时工作线程在此等待，入队、结束和停止时唤醒
+    QWaitCondition fileQueueCondition;
     bool isInsertCache{false};
     QSemaphore semaphore;
 };
@@ -63,6 +63,8 @@ public:
         GA_ShowDeleteConfirmDialog, // 显示删除确认对话框
         GA_HideLoopPartitions, // 隐藏 loop 分区
         GA_RenameHideFileOperate, // 重命名隐藏文件时，记住的操作，1隐藏，2取消 0未设置
+        GA_ThumbnailCacheSize, // 内存中缓存的缩略图大小上限，单位 MB
+        GA_IndexWatchCount, // 搜索索引最多监视的目录数量，超出的目录由定时的全量校正更新
     };
 
     Q_ENUM(GenericAttribute)
@@ -437,14 +437,9 @@ QIcon DGvfsFileInfo::fileIcon() const
     if (d->needThumbnail || d->hasThumbnail > 0) {
         d->needThumbnail = true;
 
-        const QIcon icon(DThumbnailProvider::instance()->thumbnailFilePath(d->fileInfo, DThumbnailProvider::Large));
+        const QPixmap &pixmap = DThumbnailProvider::instance()->thumbnailPixmap(d->fileInfo, DThumbnailProvider::Large);
 
-        if (!icon.isNull()) {
-            QPixmap pixmap = icon.pixmap(DThumbnailProvider::Large, DThumbnailProvider::Large);
-            QPainter pa(&pixmap);
-
-            pa.setPen(Qt::gray);
-            pa.drawPixmap(0, 0, pixmap);
+        if (!pixmap.isNull()) {
             d->icon.addPixmap(pixmap);
             d->iconFromTheme = false;
             d->needThumbnail = false;
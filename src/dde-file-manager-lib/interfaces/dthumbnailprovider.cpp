@@ -9,6 +9,7 @@
 #include "app/define.h"
 #include "singleton.h"
 #include "shutil/mimetypedisplaymanager.h"
+#include "shutil/dfmthumbnailimagereader.h"
 #include "fileoperations/filejob.h"
 #include "dfmapplication.h"
 
@@ -17,10 +18,14 @@
 #include <QDir>
 #include <QDateTime>
 #include <QImageReader>
-#include <QQueue>
 #include <QMimeType>
 #include <QReadWriteLock>
-#include <QWaitCondition>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QCache>
+#include <QPixmap>
 #include <QPainter>
 #include <QDirIterator>
 #include <QJsonDocument>
@@ -36,18 +41,42 @@
 #include <poppler-page.h>
 #include <poppler-page-renderer.h>
 #include <sys/stat.h>
+#include <climits>
 
 #include <DThumbnailProvider>
 
 DFM_BEGIN_NAMESPACE
 
 #define FORMAT ".png"
+// 不在视图可见区域中的文件的优先级，按加入队列的顺序生成
+#define BACKGROUND_PRIORITY INT_MAX
+// 内存中缩略图的默认上限，单位 MB
+#define DEFAULT_PIXMAP_CACHE_SIZE 64
 //#define CREATE_VEDIO_THUMB "CreateVedioThumbnail"
 inline QByteArray dataToMd5Hex(const QByteArray &data)
 {
     return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
 }
 
+// 内存中缩略图的索引，文件修改后修改时间或大小变化，旧的缩略图不会再被命中
+struct ThumbnailPixmapKey {
+    quint64 inode;
+    qint64 lastModified;
+    qint64 fileSize;
+    int size;
+
+    bool operator==(const ThumbnailPixmapKey &other) const
+    {
+        return inode == other.inode && lastModified == other.lastModified
+               && fileSize == other.fileSize && size == other.size;
+    }
+};
+
+inline uint qHash(const ThumbnailPixmapKey &key, uint seed = 0)
+{
+    return qHash(key.inode, seed) ^ (qHash(key.lastModified, seed) << 1) ^ (qHash(key.fileSize, seed) << 2) ^ uint(key.size);
+}
+
 class DThumbnailProviderPrivate
 {
 public:
@@ -56,37 +85,75 @@ public:
     void init();
 
     QString sizeToFilePath(DThumbnailProvider::Size size) const;
+    QString thumbnailFilePath(const QFileInfo &info, DThumbnailProvider::Size size, QImage *image) const;
 
     DThumbnailProvider *q_ptr;
-    QString errorString;
+    // 多个线程同时生成缩略图，错误信息按线程分开保存
+    QThreadStorage<QString> errorString;
     // 5MB
     qint64 defaultSizeLimit = 1024 * 1024 * 20;
     QHash<QMimeType, qint64> sizeLimitHash;
     DMimeDatabase mimeDatabase;
 
     static QSet<QString> hasThumbnailMimeHash;
+    static QReadWriteLock hasThumbnailMimeLock;
+
+    // 解码开销大的类型限制同时生成的数量
+    enum DecoderType {
+        OtherDecoder,
+        VideoDecoder,
+        DocumentDecoder,
+        DecoderTypeCount
+    };
+
+    typedef QPair<QString, DThumbnailProvider::Size> ProduceKey;
+    typedef QPair<int, quint64> ProduceOrder;   // 与视图中心的距离、加入队列的序号
 
     struct ProduceInfo {
         QFileInfo fileInfo;
         DThumbnailProvider::Size size;
-        DThumbnailProvider::CallBack callback;
+        QList<DThumbnailProvider::CallBack> callbacks;
+        DecoderType decoder = OtherDecoder;
+        ProduceOrder order;
     };
 
-    QQueue<ProduceInfo> produceQueue;
-    QQueue<QString> m_produceAbsoluteFilePathQueue;
-    QSet<QPair<QString, DThumbnailProvider::Size>> discardedProduceInfos;
-
+    DecoderType decoderTypeOf(const QFileInfo &info) const;
+    void setPriority(const QString &filePath, int priority);
+    bool takeProduceInfo(ProduceKey &key, ProduceInfo &info);
+    void startWorker();
+    void produce();
+
+    // 等待生成的缩略图，produceOrder 按优先级排序，二者一一对应
+    QHash<ProduceKey, ProduceInfo> produceInfos;
+    QMap<ProduceOrder, ProduceKey> produceOrder;
+    // 正在生成的缩略图，重复的请求只追加回调
+    QHash<ProduceKey, QList<DThumbnailProvider::CallBack>> producingCallbacks;
+    QHash<QString, int> viewportDistances;
+    quint64 produceSequence = 0;
+    int runningDecoders[DecoderTypeCount] = {0};
+    int decoderLimits[DecoderTypeCount] = {0};
+    int workerCount = 0;
     bool running = true;
+    QMutex produceMutex;
+    QThreadPool workerPool;
 
-    QWaitCondition waitCondition;
-    QReadWriteLock dataReadWriteLock;
-
+    QMutex thumbnailToolMutex;
     QHash<QString, QString> keyToThumbnailTool;
+    // dtk 的缩略图接口不能在多个线程中同时调用
+    mutable QMutex dtkProviderMutex;
+    // 视频缩略图库的导出函数，在构造时解析一次，可以在多个线程中同时调用
+    typedef void(*GetMovieCover)(const QUrl &url, const QString &savePath, QImage *imageRet);
+    GetMovieCover getMovieCover = nullptr;
+
+    // 已读取的缩略图，maxCost 为缓存的字节数上限，按最近使用的顺序淘汰
+    mutable QCache<ThumbnailPixmapKey, QPixmap> pixmapCache;
+    mutable QMutex pixmapCacheMutex;
 
     Q_DECLARE_PUBLIC(DThumbnailProvider)
 };
 
 QSet<QString> DThumbnailProviderPrivate::hasThumbnailMimeHash;
+QReadWriteLock DThumbnailProviderPrivate::hasThumbnailMimeLock;
 
 DThumbnailProviderPrivate::DThumbnailProviderPrivate(DThumbnailProvider *qq)
     : q_ptr(qq)
@@ -116,6 +183,117 @@ void DThumbnailProviderPrivate::init()
 
     // High file limit size only for FLAC files.
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("audio/flac"), INT64_MAX);
+
+    workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    decoderLimits[OtherDecoder] = workerPool.maxThreadCount();
+    decoderLimits[VideoDecoder] = qMax(1, workerPool.maxThreadCount() / 4);
+    // poppler 的全局状态不是线程安全的，文档逐个生成
+    decoderLimits[DocumentDecoder] = 1;
+}
+
+/*!
+ * \brief DThumbnailProviderPrivate::decoderTypeOf 只根据文件名判断类型，在加入队列时调用，不读取文件内容
+ */
+DThumbnailProviderPrivate::DecoderType DThumbnailProviderPrivate::decoderTypeOf(const QFileInfo &info) const
+{
+    const QMimeType &mime = mimeDatabase.QMimeDatabase::mimeTypeForFile(info.fileName(), QMimeDatabase::MatchExtension);
+    const QString &name = mime.name();
+
+    if (name.startsWith("video/") || name == "application/vnd.rn-realmedia"
+            || name == "application/vnd.ms-asf" || name == "application/mxf")
+        return VideoDecoder;
+
+    if (name == "application/pdf" || mime.inherits("application/pdf") || name.startsWith("image/vnd.djvu"))
+        return DocumentDecoder;
+
+    return OtherDecoder;
+}
+
+/*!
+ * \brief DThumbnailProviderPrivate::setPriority 调整文件等待中的缩略图的优先级，需要持有 produceMutex
+ */
+void DThumbnailProviderPrivate::setPriority(const QString &filePath, int priority)
+{
+    for (DThumbnailProvider::Size size : {DThumbnailProvider::Small, DThumbnailProvider::Normal, DThumbnailProvider::Large}) {
+        const ProduceKey key(filePath, size);
+        auto it = produceInfos.find(key);
+        if (it == produceInfos.end() || it->order.first == priority)
+            continue;
+
+        produceOrder.remove(it->order);
+        it->order.first = priority;
+        produceOrder.insert(it->order, key);
+    }
+}
+
+/*!
+ * \brief DThumbnailProviderPrivate::takeProduceInfo 取出优先级最高且其类型未达到并发上限的任务，需要持有 produceMutex
+ */
+bool DThumbnailProviderPrivate::takeProduceInfo(ProduceKey &key, ProduceInfo &info)
+{
+    for (auto it = produceOrder.begin(); it != produceOrder.end(); ++it) {
+        auto infoIt = produceInfos.find(it.value());
+        if (runningDecoders[infoIt->decoder] >= decoderLimits[infoIt->decoder])
+            continue;
+
+        key = it.value();
+        info = infoIt.value();
+        produceOrder.erase(it);
+        produceInfos.erase(infoIt);
+
+        ++runningDecoders[info.decoder];
+        producingCallbacks.insert(key, info.callbacks);
+
+        return true;
+    }
+
+    return false;
+}
+
+/*!
+ * \brief DThumbnailProviderPrivate::startWorker 线程数未达到上限时启动一个生成线程，需要持有 produceMutex
+ */
+void DThumbnailProviderPrivate::startWorker()
+{
+    // 只受线程池上限的限制，没有任务可取的线程会立即退出
+    if (workerCount >= workerPool.maxThreadCount())
+        return;
+
+    ++workerCount;
+    QtConcurrent::run(&workerPool, this, &DThumbnailProviderPrivate::produce);
+}
+
+void DThumbnailProviderPrivate::produce()
+{
+    Q_Q(DThumbnailProvider);
+
+    forever {
+        ProduceKey key;
+        ProduceInfo task;
+
+        {
+            QMutexLocker locker(&produceMutex);
+            // 没有可以生成的任务时退出，受并发上限限制的任务由正在生成同类缩略图的线程完成后继续生成
+            if (!running || !takeProduceInfo(key, task)) {
+                --workerCount;
+                return;
+            }
+        }
+
+        const QString &thumbnail = q->createThumbnail(task.fileInfo, task.size);
+
+        QList<DThumbnailProvider::CallBack> callbacks;
+        {
+            QMutexLocker locker(&produceMutex);
+            --runningDecoders[task.decoder];
+            callbacks = producingCallbacks.take(key);
+        }
+
+        for (const DThumbnailProvider::CallBack &callback : callbacks) {
+            if (callback)
+                callback(thumbnail);
+        }
+    }
 }
 
 QString DThumbnailProviderPrivate::sizeToFilePath(DThumbnailProvider::Size size) const
@@ -131,6 +309,61 @@ QString DThumbnailProviderPrivate::sizeToFilePath(DThumbnailProvider::Size size)
     return ""; //默认返回空字符 warning项
 }
 
+/*!
+ * \brief DThumbnailProviderPrivate::thumbnailFilePath 检查缩略图是否有效，image 不为空时返回读取到的缩略图
+ */
+QString DThumbnailProviderPrivate::thumbnailFilePath(const QFileInfo &info, DThumbnailProvider::Size size, QImage *image) const
+{
+    Q_Q(const DThumbnailProvider);
+
+    const QString &absolutePath = info.absolutePath();
+    const QString &absoluteFilePath = info.absoluteFilePath();
+
+    if (absolutePath == sizeToFilePath(DThumbnailProvider::Small)
+            || absolutePath == sizeToFilePath(DThumbnailProvider::Normal)
+            || absolutePath == sizeToFilePath(DThumbnailProvider::Large)
+            || absolutePath == DFMStandardPaths::location(DFMStandardPaths::ThumbnailFailPath)) {
+        return absoluteFilePath;
+    }
+    struct stat st;
+    ulong inode = 0;
+    QByteArray pathArry = absoluteFilePath.toUtf8();
+    std::string pathStd = pathArry.toStdString();
+    if (stat(pathStd.c_str(), &st) == 0)
+        inode = st.st_ino;
+
+    const QString thumbnailName = dataToMd5Hex((QUrl::fromLocalFile(absoluteFilePath).
+                                                toString(QUrl::FullyEncoded) + QString::number(inode)).toLocal8Bit()) + FORMAT;
+    QString thumbnail = sizeToFilePath(size) + QDir::separator() + thumbnailName;
+
+    if (!QFile::exists(thumbnail)) {
+        return QString();
+    }
+
+    QImageReader ir(thumbnail, QByteArray(FORMAT).mid(1));
+    if (!ir.canRead()) {
+        QFile::remove(thumbnail);
+        emit q->thumbnailChanged(absoluteFilePath, QString());
+        return QString();
+    }
+    ir.setAutoDetectImageFormat(false);
+
+    const QImage thumbnailImage = ir.read();
+
+    if (!thumbnailImage.isNull() && thumbnailImage.text(QT_STRINGIFY(Thumb::MTime)).toInt() != (int)info.lastModified().toTime_t()) {
+        QFile::remove(thumbnail);
+
+        emit q->thumbnailChanged(absoluteFilePath, QString());
+
+        return QString();
+    }
+
+    if (image)
+        *image = thumbnailImage;
+
+    return thumbnail;
+}
+
 class DFileThumbnailProviderPrivate : public DThumbnailProvider {};
 Q_GLOBAL_STATIC(DFileThumbnailProviderPrivate, ftpGlobal)
 
@@ -192,10 +425,14 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
         return false;
     }
 
-    if (DThumbnailProviderPrivate::hasThumbnailMimeHash.contains(mime))
-        return true;
+    {
+        QReadLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeLock);
+        if (DThumbnailProviderPrivate::hasThumbnailMimeHash.contains(mime))
+            return true;
+    }
 
     if (Q_LIKELY(mime.startsWith("image") || mime.startsWith("audio/") || mime.startsWith("video/"))) {
+        QWriteLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeLock);
         DThumbnailProviderPrivate::hasThumbnailMimeHash.insert(mime);
         return true;
     }
@@ -205,11 +442,13 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
                  || mime == "application/vnd.rn-realmedia"
                  || mime == "application/vnd.ms-asf"
                  || mime == "application/mxf")) {
+        QWriteLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeLock);
         DThumbnailProviderPrivate::hasThumbnailMimeHash.insert(mime);
 
         return true;
     }
 
+    QMutexLocker locker(&d_func()->dtkProviderMutex);
     if (DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->hasThumbnail(mimeType))
         return true;
 
@@ -220,49 +459,71 @@ QString DThumbnailProvider::thumbnailFilePath(const QFileInfo &info, Size size)
 {
     Q_D(const DThumbnailProvider);
 
-    const QString &absolutePath = info.absolutePath();
-    const QString &absoluteFilePath = info.absoluteFilePath();
+    return d->thumbnailFilePath(info, size, nullptr);
+}
 
-    if (absolutePath == d->sizeToFilePath(Small)
-            || absolutePath == d->sizeToFilePath(Normal)
-            || absolutePath == d->sizeToFilePath(Large)
-            || absolutePath == DFMStandardPaths::location(DFMStandardPaths::ThumbnailFailPath)) {
-        return absoluteFilePath;
-    }
-    struct stat st;
-    ulong inode = 0;
-    QByteArray pathArry = absoluteFilePath.toUtf8();
-    std::string pathStd = pathArry.toStdString();
-    if (stat(pathStd.c_str(), &st) == 0)
-        inode = st.st_ino;
+/*!
+ * \brief DThumbnailProvider::thumbnailPixmap 获取已生成的缩略图，命中内存缓存时不读取磁盘
+ * \param inode 文件的 inode，为 0 时重新获取
+ * \return 缩略图不存在或已失效时返回空的 QPixmap
+ */
+QPixmap DThumbnailProvider::thumbnailPixmap(const QFileInfo &info, Size size, quint64 inode) const
+{
+    Q_D(const DThumbnailProvider);
 
-    const QString thumbnailName = dataToMd5Hex((QUrl::fromLocalFile(absoluteFilePath).
-                                                toString(QUrl::FullyEncoded) + QString::number(inode)).toLocal8Bit()) + FORMAT;
-    QString thumbnail = d->sizeToFilePath(size) + QDir::separator() + thumbnailName;
+    if (inode == 0) {
+        struct stat st;
+        if (stat(info.absoluteFilePath().toUtf8().constData(), &st) == 0)
+            inode = st.st_ino;
+    }
 
-    if (!QFile::exists(thumbnail)) {
-        return QString();
+    const ThumbnailPixmapKey key {inode, info.lastModified().toMSecsSinceEpoch(), info.size(), size};
+    if (inode != 0) {
+        QMutexLocker locker(&d->pixmapCacheMutex);
+        if (QPixmap *pixmap = d->pixmapCache.object(key))
+            return *pixmap;
     }
 
-    QImageReader ir(thumbnail, QByteArray(FORMAT).mid(1));
-    if (!ir.canRead()) {
-        QFile::remove(thumbnail);
-        emit thumbnailChanged(absoluteFilePath, QString());
-        return QString();
+    QImage image;
+    const QString &thumbnail = d->thumbnailFilePath(info, size, &image);
+    if (thumbnail.isEmpty() || (image.isNull() && !image.load(thumbnail)))
+        return QPixmap();
+
+    // 保持缩略图的原始像素尺寸，由绘制时按屏幕的缩放比例缩放
+    const QPixmap &pixmap = QPixmap::fromImage(image);
+    if (inode != 0) {
+        QMutexLocker locker(&d->pixmapCacheMutex);
+        d->pixmapCache.insert(key, new QPixmap(pixmap), pixmap.width() * pixmap.height() * pixmap.depth() / 8);
     }
-    ir.setAutoDetectImageFormat(false);
 
-    const QImage image = ir.read();
+    return pixmap;
+}
 
-    if (!image.isNull() && image.text(QT_STRINGIFY(Thumb::MTime)).toInt() != (int)info.lastModified().toTime_t()) {
-        QFile::remove(thumbnail);
+qint64 DThumbnailProvider::pixmapCacheLimit() const
+{
+    Q_D(const DThumbnailProvider);
 
-        emit thumbnailChanged(absoluteFilePath, QString());
+    QMutexLocker locker(&d->pixmapCacheMutex);
+    return d->pixmapCache.maxCost();
+}
 
-        return QString();
-    }
+/*!
+ * \brief DThumbnailProvider::setPixmapCacheLimit 设置内存中缩略图的总字节数上限，超出时淘汰最久未使用的缩略图
+ */
+void DThumbnailProvider::setPixmapCacheLimit(qint64 bytes)
+{
+    Q_D(DThumbnailProvider);
 
-    return thumbnail;
+    QMutexLocker locker(&d->pixmapCacheMutex);
+    d->pixmapCache.setMaxCost(static_cast<int>(qBound<qint64>(0, bytes, INT_MAX)));
+}
+
+void DThumbnailProvider::clearPixmapCache()
+{
+    Q_D(DThumbnailProvider);
+
+    QMutexLocker locker(&d->pixmapCacheMutex);
+    d->pixmapCache.clear();
 }
 
 static QString generalKey(const QString &key)
@@ -279,7 +540,8 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 {
     Q_D(DThumbnailProvider);
 
-    d->errorString.clear();
+    QString &errorString = d->errorString.localData();
+    errorString.clear();
 
     const QString &absolutePath = info.absolutePath();
     const QString &absoluteFilePath = info.absoluteFilePath();
@@ -292,7 +554,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
     }
 
     if (!hasThumbnail(info)) {
-        d->errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
+        errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
 
         //!Warnning: Do not store thumbnails to the fail path
         return QString();
@@ -328,10 +590,13 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
     //! 新增djvu格式文件缩略图预览
     if (mime.name().contains("image/vnd.djvu")) {
-        thumbnail = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_GUI_NAMESPACE::DThumbnailProvider::Size)size);
-        d->errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        {
+            QMutexLocker locker(&d->dtkProviderMutex);
+            thumbnail = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_GUI_NAMESPACE::DThumbnailProvider::Size)size);
+            errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        }
 
-        if (d->errorString.isEmpty()) {
+        if (errorString.isEmpty()) {
             emit createThumbnailFinished(absoluteFilePath, thumbnail);
             emit thumbnailChanged(absoluteFilePath, thumbnail);
 
@@ -349,7 +614,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             process.start(readerBinary, arguments);
 
             if (!process.waitForFinished()) {
-                d->errorString = process.errorString();
+                errorString = process.errorString();
 
                 goto _return;
             }
@@ -358,9 +623,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QString &error = process.readAllStandardError();
 
                 if (error.isEmpty()) {
-                    d->errorString = QString("get thumbnail failed from the \"%1\" application").arg(readerBinary);
+                    errorString = QString("get thumbnail failed from the \"%1\" application").arg(readerBinary);
                 } else {
-                    d->errorString = error;
+                    errorString = error;
                 }
 
                 goto _return;
@@ -373,7 +638,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 Q_ASSERT(!output.isEmpty());
 
                 if (image->loadFromData(output, "png")) {
-                    d->errorString.clear();
+                    errorString.clear();
                 }
                 file.close();
             }
@@ -389,41 +654,18 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QString mimeType = d->mimeDatabase.mimeTypeForFile(info, QMimeDatabase::MatchContent).name();
         QString suffix = mimeType.replace("image/", "");
 
-        QImageReader reader(absoluteFilePath, suffix.toLatin1());
-        if (!reader.canRead()) {
-            d->errorString = reader.errorString();
-            goto _return;
-        }
-
-        const QSize &imageSize = reader.size();
-
-        //fix 读取损坏icns文件（可能任意损坏的image类文件也有此情况）在arm平台上会导致递归循环的问题
-        //这里先对损坏文件（imagesize无效）做处理，不再尝试读取其image数据
-        if (!imageSize.isValid()) {
-            d->errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
-            goto _return;
-        }
-
-        if (imageSize.width() > size || imageSize.height() > size || mime.name() == "image/svg+xml") {
-            reader.setScaledSize(reader.size().scaled(size, size, Qt::KeepAspectRatio));
-        }
-
-        reader.setAutoTransform(true);
-
-        if (!reader.read(image.data())) {
-            d->errorString = reader.errorString();
+        // 优先使用内嵌的预览图，否则按缩略图尺寸解码，不解码完整的原图
+        DFMThumbnailImageReader reader(absoluteFilePath, suffix.toLatin1());
+        if (!reader.read(size, *image)) {
+            errorString = reader.errorString();
             goto _return;
         }
-
-        if (image->width() > size || image->height() > size) {
-            image->operator =(image->scaled(size, size, Qt::KeepAspectRatio));
-        }
     } else if (mime.name() == "text/plain") {
         //FIXME(zccrs): This should be done using the image plugin?
         QFile file(absoluteFilePath);
 
         if (!file.open(QIODevice::ReadOnly)) {
-            d->errorString = file.errorString();
+            errorString = file.errorString();
             goto _return;
         }
 
@@ -452,19 +694,19 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QScopedPointer<poppler::document> doc(poppler::document::load_from_file(absoluteFilePath.toStdString()));
 
         if (!doc || doc->is_locked()) {
-            d->errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
+            errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
             goto _return;
         }
 
         if (doc->pages() < 1) {
-            d->errorString = QStringLiteral("This stream is invalid");
+            errorString = QStringLiteral("This stream is invalid");
             goto _return;
         }
 
         QScopedPointer<const poppler::page> page(doc->create_page(0));
 
         if (!page) {
-            d->errorString = QStringLiteral("Cannot get this page at index 0");
+            errorString = QStringLiteral("Cannot get this page at index 0");
             goto _return;
         }
 
@@ -475,7 +717,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         poppler::image imageData = pr.render_page(page.data(), 72, 72, -1, -1, -1, size);
 
         if (!imageData.is_valid()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
@@ -484,7 +726,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
         switch (format) {
         case poppler::image::format_invalid:
-            d->errorString = QStringLiteral("Image format is invalid");
+            errorString = QStringLiteral("Image format is invalid");
             goto _return;
         case poppler::image::format_mono:
             img = QImage((uchar *)imageData.data(), imageData.width(), imageData.height(), QImage::Format_Mono);
@@ -500,7 +742,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         }
 
         if (img.isNull()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
@@ -518,45 +760,44 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                      QIODevice::ReadOnly);
 
         if (!ffmpeg.waitForFinished()) {
-            d->errorString = ffmpeg.errorString();
+            errorString = ffmpeg.errorString();
             goto _return;
         }
 
         const QByteArray output = ffmpeg.readAllStandardOutput();
 
         if (image->loadFromData(output)) {
-            d->errorString.clear();
+            errorString.clear();
         } else {
-            d->errorString = QString("load image failed from the ffmpeg application");
+            errorString = QString("load image failed from the ffmpeg application");
         }
     } else {
         //显式调用库函数getMovieCover获取视频缩略图，以兼容文管旧版本
         bool thumnailCreatedByMovieLib = false;
-        //获取缩略图生成库函数getMovieCover的指针
-        if(m_libMovieViewer && m_libMovieViewer->isLoaded()){
-            typedef void(*getMovieCover)(const QUrl &url, const QString &savePath, QImage *imageRet);
-            getMovieCover func= reinterpret_cast<void(*)(const QUrl &, const QString &, QImage *)>(m_libMovieViewer->resolve("getMovieCover"));
-            if(func){//存在导出函数getMovieCover
-                auto url = QUrl::fromLocalFile(absoluteFilePath);
-                QImage img;
-                func(url,absolutePath,&img);//调用getMovieCover生成缩略图
-                if(!img.isNull()){
-                    *image = img;
-                    thumnailCreatedByMovieLib = true;
-                }
+        // 视频解码不加锁，同时生成的数量由 decoderLimits 限制
+        if(d->getMovieCover){//存在导出函数getMovieCover
+            auto url = QUrl::fromLocalFile(absoluteFilePath);
+            QImage img;
+            d->getMovieCover(url,absolutePath,&img);//调用getMovieCover生成缩略图
+            if(!img.isNull()){
+                *image = img;
+                thumnailCreatedByMovieLib = true;
             }
         }
         if(thumnailCreatedByMovieLib){//调用库函数getMovieCover提取缩略图成功
-            d->errorString.clear();
+            errorString.clear();
         }else{//若调用库函数getMovieCover提取缩略图失败，下面走旧逻辑
+            QMutexLocker dtkLocker(&d->dtkProviderMutex);
             thumbnail = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_GUI_NAMESPACE::DThumbnailProvider::Size)size);
-            d->errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
-        if (d->errorString.isEmpty()) {
+            errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+            dtkLocker.unlock();
+        if (errorString.isEmpty()) {
             emit createThumbnailFinished(absoluteFilePath, thumbnail);
             emit thumbnailChanged(absoluteFilePath, thumbnail);
 
             return thumbnail;
         } else { // fallback to thumbnail tool
+            QMutexLocker toolLocker(&d->thumbnailToolMutex);
             if (d->keyToThumbnailTool.isEmpty()) {
                 d->keyToThumbnailTool["Initialized"] = QString();
 
@@ -602,6 +843,8 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 tool = d->keyToThumbnailTool.value(mime_name);
             }
 
+            toolLocker.unlock();
+
             if (tool.isEmpty()) {
                 return thumbnail;
             }
@@ -610,7 +853,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             process.start(tool, {QString::number(size), absoluteFilePath}, QIODevice::ReadOnly);
 
             if (!process.waitForFinished()) {
-                d->errorString = process.errorString();
+                errorString = process.errorString();
 
                 goto _return;
             }
@@ -619,9 +862,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QString &error = process.readAllStandardError();
 
                 if (error.isEmpty()) {
-                    d->errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
+                    errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
                 } else {
-                    d->errorString = error;
+                    errorString = error;
                 }
 
                 goto _return;
@@ -632,7 +875,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             Q_ASSERT(!png_data.isEmpty());
 
             if (image->loadFromData(png_data, "png")) {
-                d->errorString.clear();
+                errorString.clear();
             } else {
                 //过滤video tool的其他输出信息
                 QString processResult(output);
@@ -640,9 +883,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QByteArray pngData = QByteArray::fromBase64(processResult.toUtf8());
                 Q_ASSERT(!pngData.isEmpty());
                 if (image->loadFromData(pngData, "png")) {
-                    d->errorString.clear();
+                    errorString.clear();
                 } else {
-                    d->errorString = QString("load png image failed from the \"%1\" application").arg(tool);
+                    errorString = QString("load png image failed from the \"%1\" application").arg(tool);
                 }
             }
         }
@@ -651,7 +894,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
 _return:
     // successful
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         thumbnail = d->sizeToFilePath(size) + QDir::separator() + thumbnailName;
     } else {
         //fail
@@ -665,10 +908,10 @@ _return:
     QFileInfo(thumbnail).absoluteDir().mkpath(".");
 
     if (!image->save(thumbnail, Q_NULLPTR, 80)) {
-        d->errorString = QStringLiteral("Can not save image to ") + thumbnail;
+        errorString = QStringLiteral("Can not save image to ") + thumbnail;
     }
 
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         emit createThumbnailFinished(absoluteFilePath, thumbnail);
         emit thumbnailChanged(absoluteFilePath, thumbnail);
 
@@ -683,52 +926,83 @@ _return:
 
 void DThumbnailProvider::appendToProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, DThumbnailProvider::CallBack callback)
 {
+    Q_D(DThumbnailProvider);
+
+    const DThumbnailProviderPrivate::ProduceKey key(info.absoluteFilePath(), size);
+
+    QMutexLocker locker(&d->produceMutex);
+
+    if (!d->running)
+        return;
+
+    // fix bug 62540 这里在没生成缩略图的情况下，（触发刷新，文件大小改变）同一个文件会多次生成缩略图的情况,
+    // 队列中或正在生成的文件不再重复生成，只追加回调
+    auto producing = d->producingCallbacks.find(key);
+    if (producing != d->producingCallbacks.end()) {
+        producing->append(callback);
+        return;
+    }
+
+    auto it = d->produceInfos.find(key);
+    if (it != d->produceInfos.end()) {
+        it->callbacks.append(callback);
+        return;
+    }
+
     DThumbnailProviderPrivate::ProduceInfo produceInfo;
 
     produceInfo.fileInfo = info;
     produceInfo.size = size;
-    produceInfo.callback = callback;
+    produceInfo.callbacks.append(callback);
+    produceInfo.decoder = d->decoderTypeOf(info);
+    produceInfo.order = qMakePair(d->viewportDistances.value(key.first, BACKGROUND_PRIORITY), ++d->produceSequence);
+
+    d->produceOrder.insert(produceInfo.order, key);
+    d->produceInfos.insert(key, produceInfo);
+    d->startWorker();
+}
 
+void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
+{
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        // fix bug 62540 这里在没生成缩略图的情况下，（触发刷新，文件大小改变）同一个文件会多次生成缩略图的情况,
-        // 缓存当前队列中生成的缩略图文件的路劲没有就加入队里生成
-        if (!d->m_produceAbsoluteFilePathQueue.contains(info.absoluteFilePath())) {
-            d->produceQueue.append(std::move(produceInfo));
-            d->m_produceAbsoluteFilePathQueue << info.absoluteFilePath();
-        }
-        locker.unlock();
-        d->waitCondition.wakeAll();
-    } else {
-        // fix bug 62540 这里在没生成缩略图的情况下，（触发刷新，文件大小改变）同一个文件会多次生成缩略图的情况,
-        // 缓存当前队列中生成的缩略图文件的路劲没有就加入队里生成
-        if (!d->m_produceAbsoluteFilePathQueue.contains(info.absoluteFilePath())) {
-            d->produceQueue.append(std::move(produceInfo));
-            d->m_produceAbsoluteFilePathQueue << info.absoluteFilePath();
-        }
-        start();
-    }
+    QMutexLocker locker(&d->produceMutex);
+
+    // 正在生成的缩略图不能中断，生成完成后依然会调用回调
+    auto it = d->produceInfos.find(qMakePair(info.absoluteFilePath(), size));
+    if (it == d->produceInfos.end())
+        return;
+
+    d->produceOrder.remove(it->order);
+    d->produceInfos.erase(it);
 }
 
-void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
+/*!
+ * \brief DThumbnailProvider::updateViewport 视图滚动后更新可见区域中的文件，调整等待中的缩略图的生成顺序
+ * \param viewportDistances 可见区域中的文件路径及其与可见区域中心的距离，距离越小越先生成
+ */
+void DThumbnailProvider::updateViewport(const QHash<QString, int> &viewportDistances)
 {
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        Q_UNUSED(locker)
+    QMutexLocker locker(&d->produceMutex);
+
+    for (auto it = d->viewportDistances.cbegin(); it != d->viewportDistances.cend(); ++it) {
+        if (!viewportDistances.contains(it.key()))
+            d->setPriority(it.key(), BACKGROUND_PRIORITY);
     }
 
-    d->discardedProduceInfos.insert(qMakePair(info.absoluteFilePath(), size));
+    for (auto it = viewportDistances.cbegin(); it != viewportDistances.cend(); ++it)
+        d->setPriority(it.key(), qMax(0, it.value()));
+
+    d->viewportDistances = viewportDistances;
 }
 
 QString DThumbnailProvider::errorString() const
 {
     Q_D(const DThumbnailProvider);
 
-    return d->errorString;
+    return d->errorString.localData();
 }
 
 qint64 DThumbnailProvider::defaultSizeLimit() const
@@ -763,18 +1037,43 @@ DThumbnailProvider::DThumbnailProvider(QObject *parent)
     : QThread(parent)
     , d_ptr(new DThumbnailProviderPrivate(this))
 {
-    d_func()->init();
+    Q_D(DThumbnailProvider);
+
+    d->init();
+
+    // 缩略图缓存大小可在配置文件中设置，单位为 MB
+    auto updatePixmapCacheLimit = [this](const QVariant &value) {
+        bool ok = false;
+        qint64 cacheSize = value.toLongLong(&ok);
+        if (!ok || cacheSize < 0)
+            cacheSize = DEFAULT_PIXMAP_CACHE_SIZE;
+
+        setPixmapCacheLimit(cacheSize * 1024 * 1024);
+    };
+    updatePixmapCacheLimit(DFMApplication::genericAttribute(DFMApplication::GA_ThumbnailCacheSize));
+    connect(DFMApplication::instance(), &DFMApplication::genericAttributeChanged, this,
+    [updatePixmapCacheLimit](DFMApplication::GenericAttribute ga, const QVariant &value) {
+        if (ga == DFMApplication::GA_ThumbnailCacheSize)
+            updatePixmapCacheLimit(value);
+    });
+
     m_libMovieViewer = new QLibrary("libimageviewer.so");
-    m_libMovieViewer->load();
+    if (m_libMovieViewer->load())
+        d->getMovieCover = reinterpret_cast<DThumbnailProviderPrivate::GetMovieCover>(m_libMovieViewer->resolve("getMovieCover"));
 }
 
 DThumbnailProvider::~DThumbnailProvider()
 {
     Q_D(DThumbnailProvider);
 
-    d->running = false;
-    d->waitCondition.wakeAll();
-    wait();
+    {
+        QMutexLocker locker(&d->produceMutex);
+        d->running = false;
+        d->produceInfos.clear();
+        d->produceOrder.clear();
+    }
+    d->workerPool.waitForDone();
+    d->getMovieCover = nullptr;
 
     if(m_libMovieViewer && m_libMovieViewer->isLoaded()){
         m_libMovieViewer->unload();
@@ -783,43 +1082,12 @@ DThumbnailProvider::~DThumbnailProvider()
     }
 }
 
+/*!
+ * \brief DThumbnailProvider::run 缩略图已改由线程池生成，不再启动此线程；
+ * 保留基类 QThread 和此函数是为了不改变公开头文件的二进制接口
+ */
 void DThumbnailProvider::run()
 {
-    Q_D(DThumbnailProvider);
-
-    forever {
-        QWriteLocker locker(&d->dataReadWriteLock);
-
-        if (d->produceQueue.isEmpty()) {
-            d->waitCondition.wait(&d->dataReadWriteLock);
-        }
-
-        if (!d->running)
-            return;
-
-        const DThumbnailProviderPrivate::ProduceInfo &task = d->produceQueue.dequeue();
-        const QPair<QString, DThumbnailProvider::Size> &tmpKey = qMakePair(task.fileInfo.absoluteFilePath(), task.size);
-
-        if (d->discardedProduceInfos.contains(tmpKey)) {
-            d->discardedProduceInfos.remove(tmpKey);
-            //fix 62540 去除缓存
-            d->m_produceAbsoluteFilePathQueue.removeOne(task.fileInfo.absoluteFilePath());
-            locker.unlock();
-            continue;
-        }
-
-        locker.unlock();
-
-        const QString &thumbnail = createThumbnail(task.fileInfo, task.size);
-
-        locker.relock();
-        //fix 62540 生成结束了去除缓存
-        d->m_produceAbsoluteFilePathQueue.removeOne(task.fileInfo.absoluteFilePath());
-        locker.unlock();
-
-        if (task.callback)
-            task.callback(thumbnail);
-    }
 }
 
 DFM_END_NAMESPACE
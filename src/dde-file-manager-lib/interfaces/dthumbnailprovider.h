@@ -7,6 +7,7 @@
 
 #include <QThread>
 #include <QFileInfo>
+#include <QHash>
 
 #include "dfmglobal.h"
 
@@ -15,11 +16,17 @@
 QT_BEGIN_NAMESPACE
 class QMimeType;
 class QLibrary;
+class QPixmap;
 QT_END_NAMESPACE
 
 DFM_BEGIN_NAMESPACE
 
 class DThumbnailProviderPrivate;
+/*!
+ * \brief The DThumbnailProvider class 生成文件的缩略图
+ * 队列中的缩略图由线程池并行生成，越靠近视图可见区域中心的文件越先生成，视频和文档等解码
+ * 开销大的文件限制同时生成的数量。读取过的缩略图缓存在内存中，视图中反复滚动时不再读取磁盘。
+ */
 class DThumbnailProvider : public QThread
 {
     Q_OBJECT
@@ -37,11 +44,17 @@ public:
     bool hasThumbnail(const QMimeType &mimeType) const;
 
     QString thumbnailFilePath(const QFileInfo &info, Size size) const;
+    QPixmap thumbnailPixmap(const QFileInfo &info, Size size, quint64 inode = 0) const;
+
+    qint64 pixmapCacheLimit() const;
+    void setPixmapCacheLimit(qint64 bytes);
+    void clearPixmapCache();
 
     typedef std::function<void(const QString &)> CallBack;
     QString createThumbnail(const QFileInfo &info, Size size);
     void appendToProduceQueue(const QFileInfo &info, Size size, CallBack callback = 0);
     void removeInProduceQueue(const QFileInfo &info, Size size);
+    void updateViewport(const QHash<QString, int> &viewportDistances);
 
     QString errorString() const;
 
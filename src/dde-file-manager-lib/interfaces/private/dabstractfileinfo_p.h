@@ -9,6 +9,9 @@
 #include "dmimedatabase.h"
 
 #include <QPointer>
+#include <QMutex>
+
+#include <atomic>
 
 QT_BEGIN_NAMESPACE
 class QReadWriteLock;
@@ -23,11 +26,15 @@ public:
     virtual ~DAbstractFileInfoPrivate();
 
     void setUrl(const DUrl &url, bool hasCache);
-    static DAbstractFileInfo *getFileInfo(const DUrl &fileUrl);
+    static DAbstractFileInfoPointer getFileInfo(const DUrl &fileUrl);
+    static DAbstractFileInfo::CacheStatistics cacheStatistics();
 
     DAbstractFileInfo *q_ptr = Q_NULLPTR;
 
     mutable QString pinyinName;
+    mutable QMutex sortKeyMutex;
+    mutable QString sortKeyName;
+    mutable QScopedPointer<DFileNameSortKey> nameSortKey;
     bool active = false;
     qint8 gvfsMountFile = -1;
 
@@ -39,9 +46,14 @@ public:
     Q_DECLARE_PUBLIC(DAbstractFileInfo)
 
 private:
+    static void insertToCache(const DUrl &fileUrl, DAbstractFileInfo *info);
+    static void removeFromCache(const DUrl &fileUrl, DAbstractFileInfo *info);
+
     DUrl fileUrl;
     static QReadWriteLock *urlToFileInfoMapLock;
     static QMap<DUrl, DAbstractFileInfo*> urlToFileInfoMap;
+    static std::atomic<quint64> cacheHits;
+    static std::atomic<quint64> cacheMisses;
 };
 
 #endif // DABSTRACTFILEINFO_P_H
@@ -23,6 +23,27 @@ public:
 
     bool isLowSpeedFile() const;
 
+    // 一次 statx 得到的文件属性，链接文件会再获取一次目标文件的属性
+    struct FileStat {
+        bool exists = false;
+        bool isSymLink = false;
+        bool targetExists = false;
+        quint32 mode = 0;
+        quint64 inode = 0;
+        qint64 size = 0;
+        uint ownerId = 0;
+        uint groupId = 0;
+        // 单位为毫秒，文件系统不支持创建时间时 birthTime 为 -1
+        qint64 birthTime = -1;
+        qint64 changeTime = 0;
+        qint64 lastModified = 0;
+        qint64 lastRead = 0;
+    };
+
+    // 第一次访问时获取，refresh() 后重新获取；返回副本，快照可能被其它线程丢弃
+    FileStat fileStat() const;
+    void invalidateFileStat() const;
+
     QFileInfo fileInfo;
     mutable QMimeType mimeType;
     mutable QMimeDatabase::MatchMode mimeTypeMode;
@@ -34,7 +55,9 @@ public:
     // 小于0时表示此值未初始化，0表示不支持，1表示支持
     mutable qint8 hasThumbnail = -1;
     mutable qint8 lowSpeedFile = -1;
-    mutable quint64 inode = 0;
+    mutable QMutex statMutex;
+    mutable FileStat statSnapshot;
+    mutable bool statValid = false;
 
     mutable QVariantHash extraProperties;
     mutable bool epInitialized = false;
@@ -30,6 +30,7 @@ public:
     mutable long cacheReadTime = -1;// bug 27247 远程连接FTP,使用大小排序反应很慢
     mutable qint32 cacheFileCount = -1;// bug 27247 远程连接FTP,使用大小排序反应很慢
     mutable qint64 cacheFileSize = -1; // bug 27247 远程连接FTP,使用大小排序反应很慢
+    mutable quint64 inode = 0;
 
 
     mutable int ownerid = -1;//当前文件的所以
@@ -0,0 +1,230 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dfilecopyjournal.h"
+#include "interfaces/dfmstandardpaths.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDebug>
+
+namespace {
+static const quint32 kJournalMagic = 0x44464d4a;   // "DFMJ"
+static const quint16 kJournalVersion = 1;
+static const int kJournalExpireDays = 7;   // 超过期限未恢复的日志视为放弃，打开新日志时清理
+
+QString journalDirectory()
+{
+    return DFMStandardPaths::location(DFMStandardPaths::CachePath) + "/copyjournal";
+}
+
+bool readHeader(QDataStream &stream, DFM_NAMESPACE::DFileCopyJournal::JobInfo &info)
+{
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint32 mode = 0;
+    stream >> magic >> version;
+    if (magic != kJournalMagic || version != kJournalVersion)
+        return false;
+
+    stream >> mode >> info.sourceUrls >> info.targetUrl;
+    info.mode = mode;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void removeExpiredJournals(const QString &except)
+{
+    const QDateTime &expire = QDateTime::currentDateTime().addDays(-kJournalExpireDays);
+    for (const QFileInfo &info : QDir(journalDirectory()).entryInfoList({"*.journal"}, QDir::Files)) {
+        if (info.absoluteFilePath() != except && info.lastModified() < expire)
+            QFile::remove(info.absoluteFilePath());
+    }
+}
+}
+
+DFM_BEGIN_NAMESPACE
+
+DFileCopyJournal::DFileCopyJournal(const QString &filePath)
+    : file(filePath)
+{
+
+}
+
+DFileCopyJournal::~DFileCopyJournal()
+{
+    file.close();
+}
+
+/*!
+ * \brief DFileCopyJournal::journalPath 任务对应的日志文件路径，相同的任务得到相同的路径
+ */
+QString DFileCopyJournal::journalPath(int mode, const DUrlList &sourceUrls, const DUrl &targetUrl)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(mode));
+    for (const DUrl &url : sourceUrls) {
+        hash.addData(url.toEncoded());
+        hash.addData("\n", 1);
+    }
+    hash.addData(targetUrl.toEncoded());
+
+    return journalDirectory() + "/" + hash.result().toHex() + ".journal";
+}
+
+/*!
+ * \brief DFileCopyJournal::unfinishedJobs 未正常结束的任务，可用于提示用户继续这些任务
+ */
+QList<DFileCopyJournal::JobInfo> DFileCopyJournal::unfinishedJobs()
+{
+    QList<JobInfo> jobs;
+    for (const QFileInfo &info : QDir(journalDirectory()).entryInfoList({"*.journal"}, QDir::Files, QDir::Time)) {
+        QFile journal(info.absoluteFilePath());
+        if (!journal.open(QIODevice::ReadOnly))
+            continue;
+
+        QDataStream stream(&journal);
+        JobInfo job;
+        if (readHeader(stream, job))
+            jobs << job;
+    }
+
+    return jobs;
+}
+
+/*!
+ * \brief DFileCopyJournal::open 打开日志，日志已存在且属于同一任务时加载其中的记录
+ * \return 日志无法写入时返回 false，此时任务仍可正常执行，只是不能断点续传
+ */
+bool DFileCopyJournal::open(int mode, const DUrlList &sourceUrls, const DUrl &targetUrl)
+{
+    entries.clear();
+    file.close();
+
+    if (!QDir().mkpath(QFileInfo(file.fileName()).absolutePath()))
+        return false;
+
+    removeExpiredJournals(file.fileName());
+
+    JobInfo info;
+    info.mode = mode;
+    info.sourceUrls = sourceUrls;
+    info.targetUrl = targetUrl;
+
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "failed to open copy journal:" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    if (load(info))
+        return true;
+
+    // 新建日志或日志已损坏，重写文件头
+    entries.clear();
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << kJournalMagic << kJournalVersion << static_cast<qint32>(mode) << sourceUrls << targetUrl;
+
+    if (!file.resize(0) || !file.seek(0) || file.write(header) != header.size() || !file.flush()) {
+        qWarning() << "failed to write copy journal:" << file.fileName() << file.errorString();
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool DFileCopyJournal::isOpen() const
+{
+    return file.isOpen();
+}
+
+int DFileCopyJournal::count() const
+{
+    return entries.count();
+}
+
+/*!
+ * \brief DFileCopyJournal::append 追加一条记录，每条记录都立即写入文件，程序崩溃时不会丢失
+ * \param lastModified 源文件的修改时间，单位秒
+ */
+bool DFileCopyJournal::append(EntryType type, const DUrl &from, const DUrl &target, qint64 size, qint64 lastModified)
+{
+    if (!file.isOpen())
+        return false;
+
+    Entry &entry = entries[from];
+    entry.type = type;
+    entry.target = target;
+    entry.size = size;
+    entry.lastModified = lastModified;
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream << static_cast<quint8>(type) << from << target << size << lastModified;
+
+    if (file.write(record) != record.size() || !file.flush()) {
+        qWarning() << "failed to append copy journal:" << file.fileName() << file.errorString();
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool DFileCopyJournal::find(const DUrl &from, Entry &entry) const
+{
+    auto it = entries.constFind(from);
+    if (it == entries.cend())
+        return false;
+
+    entry = it.value();
+    return true;
+}
+
+/*!
+ * \brief DFileCopyJournal::remove 任务结束后删除日志
+ */
+void DFileCopyJournal::remove()
+{
+    entries.clear();
+    file.close();
+    file.remove();
+}
+
+bool DFileCopyJournal::load(const JobInfo &info)
+{
+    if (file.size() <= 0)
+        return false;
+
+    QDataStream stream(&file);
+    JobInfo journalInfo;
+    if (!readHeader(stream, journalInfo) || journalInfo.mode != info.mode
+            || journalInfo.sourceUrls != info.sourceUrls || journalInfo.targetUrl != info.targetUrl)
+        return false;
+
+    qint64 validPos = file.pos();
+    while (!stream.atEnd()) {
+        quint8 type = 0;
+        DUrl from;
+        Entry entry;
+        stream >> type >> from >> entry.target >> entry.size >> entry.lastModified;
+        if (stream.status() != QDataStream::Ok || type < FileEntry || type > DirectoryEntry)
+            break;
+
+        entry.type = static_cast<EntryType>(type);
+        entries[from] = entry;
+        validPos = file.pos();
+    }
+
+    // 丢弃崩溃时写了一半的记录，后续的记录接在最后一条完整记录之后
+    if (validPos != file.size() && !file.resize(validPos))
+        return false;
+
+    return file.seek(validPos);
+}
+
+DFM_END_NAMESPACE
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DFILECOPYJOURNAL_H
+#define DFILECOPYJOURNAL_H
+
+#include <dfmglobal.h>
+#include "durl.h"
+
+#include <QFile>
+#include <QHash>
+
+DFM_BEGIN_NAMESPACE
+
+/*!
+ * \brief The DFileCopyJournal class 复制/移动任务的断点记录
+ * 任务中每完成一个文件或目录就以二进制追加一条记录到缓存目录下的日志文件中，日志以任务的模式、
+ * 源文件列表和目标目录命名。程序崩溃或会话结束后重新执行相同的任务时加载日志，已经完成且
+ * 大小和修改时间仍与记录一致的文件不再重复拷贝。日志末尾不完整的记录在加载时丢弃，任务正常
+ * 结束后删除日志。只在任务线程中访问。
+ */
+class DFileCopyJournal
+{
+public:
+    enum EntryType : quint8 {
+        FileEntry = 1,   // 文件已完成
+        DirectoryCreatedEntry,   // 目录已创建，其中的文件可能未完成
+        DirectoryEntry   // 目录及其中的文件都已完成
+    };
+
+    struct Entry {
+        EntryType type = FileEntry;
+        DUrl target;
+        qint64 size = 0;   // 完成时源文件的大小
+        qint64 lastModified = 0;   // 完成时源文件的修改时间，单位秒
+    };
+
+    struct JobInfo {
+        int mode = 0;
+        DUrlList sourceUrls;
+        DUrl targetUrl;
+    };
+
+    explicit DFileCopyJournal(const QString &filePath);
+    ~DFileCopyJournal();
+
+    static QString journalPath(int mode, const DUrlList &sourceUrls, const DUrl &targetUrl);
+    static QList<JobInfo> unfinishedJobs();
+
+    bool open(int mode, const DUrlList &sourceUrls, const DUrl &targetUrl);
+    bool isOpen() const;
+    int count() const;
+
+    bool append(EntryType type, const DUrl &from, const DUrl &target, qint64 size, qint64 lastModified);
+    bool find(const DUrl &from, Entry &entry) const;
+    void remove();
+
+private:
+    Q_DISABLE_COPY(DFileCopyJournal)
+
+    bool load(const JobInfo &info);
+
+    QFile file;
+    QHash<DUrl, Entry> entries;
+};
+
+DFM_END_NAMESPACE
+
+#endif // DFILECOPYJOURNAL_H
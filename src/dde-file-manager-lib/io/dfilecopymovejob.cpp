@@ -12,6 +12,8 @@
 #include "ddiriterator.h"
 #include "dfilestatisticsjob.h"
 #include "dlocalfiledevice.h"
+#include "duringfilecopier.h"
+#include "dfilecopyjournal.h"
 #include "models/trashfileinfo.h"
 #include "controllers/vaultcontroller.h"
 #include "controllers/masteredmediacontroller.h"
@@ -68,6 +70,13 @@ Q_LOGGING_CATEGORY(fileJob, "file.job", QtInfoMsg)
 #define BIG_FILE_SIZE 500 * 1024 * 1024
 #define THREAD_SLEEP_TIME 200
 #define COPY_FILE_STORE_NUM 2000
+#define URING_BATCH_SIZE 256
+#define URING_FILES_IN_FLIGHT 128
+#define WRITE_RING_CAPACITY 32
+#define WRITE_RING_WAIT_TIME 10
+#define DIRECT_COPY_MIN_SIZE (64 * 1024 * 1024)
+#define DIRECT_COPY_BLOCK_SIZE (4 * 1024 * 1024)
+#define DIRECT_IO_ALIGNMENT 4096
 QQueue<DFileCopyMoveJob*> DFileCopyMoveJobPrivate::CopyLargeFileOnDiskQueue;
 QMutex DFileCopyMoveJobPrivate::CopyLargeFileOnDiskMutex;
 DUrlList DFileCopyMoveJobPrivate::copyingFiles;
@@ -113,6 +122,25 @@ static QByteArray fileReadAll(const QString &file_path)
     return QByteArray();
 }
 
+// 从 offset 处读满 size 字节，只在到达文件末尾时返回的数据较少，出错返回 -errno（可能在其它线程调用）
+static qint64 readFileFully(int fd, char *buffer, qint64 size, qint64 offset)
+{
+    qint64 total = 0;
+    while (total < size) {
+        ssize_t ret = pread(fd, buffer + total, static_cast<size_t>(size - total), offset + total);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        if (ret == 0)
+            break;
+        total += ret;
+    }
+
+    return total;
+}
+
 class ElapsedTimer
 {
 public:
@@ -169,6 +197,7 @@ DFileCopyMoveJobPrivate::DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq)
     , updateSpeedElapsedTimer(new ElapsedTimer())
 {
     m_pool.setMaxThreadCount(FileUtils::getCpuProcessCount());
+    m_isUringSupported = DUringFileCopier::isSupported();
 }
 
 DFileCopyMoveJobPrivate::~DFileCopyMoveJobPrivate()
@@ -188,6 +217,9 @@ DFileCopyMoveJobPrivate::~DFileCopyMoveJobPrivate()
         updateSpeedTimer = nullptr;
     }
     stopAllDeviceOperation();
+    // 写线程使用的队列随私有数据一起释放，需要先等它退出
+    if (m_isWriteThreadStart.load())
+        m_writeResult.waitForFinished();
 }
 
 QString DFileCopyMoveJobPrivate::errorToString(DFileCopyMoveJob::Error error)
@@ -699,6 +731,9 @@ bool DFileCopyMoveJobPrivate::doProcess(const DUrl &from, const DAbstractFileInf
     }
 
     if (!source_info->exists()) {
+        if (skipJournalCompleted(from, source_info, target_info))
+            return true;
+
         DFileCopyMoveJob::Error errortype = (source_info->path().startsWith("/root/") && !target_info->path().startsWith("/root/")) ?
                                             DFileCopyMoveJob::PermissionError : DFileCopyMoveJob::NonexistenceError;
         errortype = source_info->path().startsWith(MOBILE_ROOT_PATH) ? DFileCopyMoveJob::NotSupportedError : errortype;
@@ -841,6 +876,9 @@ bool DFileCopyMoveJobPrivate::doProcess(const DUrl &from, const DAbstractFileInf
         return ok;
     }
 
+    if (skipJournalCompleted(from, source_info, target_info))
+        return true;
+
     QString file_name;
     //! 是否退回到回收站
     if (m_fileNameList.isEmpty()) {
@@ -871,7 +909,8 @@ create_new_file_info:
         return false;
     }
 
-    if (new_file_info->exists()) {
+    // 继续上次中断的任务时，合并已经创建的目录
+    if (new_file_info->exists() && !isJournalCreatedDirectory(from, new_file_info)) {
         //忽略DStorageInfo::isSameFile判断链接文件的结果
         if ((mode == DFileCopyMoveJob::MoveMode || mode == DFileCopyMoveJob::CutMode) &&
                 (new_file_info->fileUrl() == from || (DStorageInfo::isSameFile(from.path(), new_file_info->fileUrl().path()) && !new_file_info->isSymLink()))) {
@@ -1050,6 +1089,7 @@ process_file:
     if (source_info->isFile()) {
         bool ok = false;
         qint64 size = source_info->size();
+        const qint64 lastModified = source_info->lastModified().toMSecsSinceEpoch() / 1000;
 
         while (!checkFreeSpace(size)) {
             isErrorOccur = true;
@@ -1137,7 +1177,7 @@ process_file:
         }
 
         if (ok) {
-            joinToCompletedFileList(from, new_file_info->fileUrl(), size);
+            joinToCompletedFileList(from, new_file_info->fileUrl(), size, lastModified);
         }
 
         return ok;
@@ -1189,7 +1229,7 @@ process_file:
 
         if (ok) {
             handler->setFileTime(new_file_info->fileUrl(), si_last_read, si_last_modified);
-            joinToCompletedDirectoryList(from, new_file_info->fileUrl(), size);
+            joinToCompletedDirectoryList(from, new_file_info->fileUrl(), size, si_last_modified.toMSecsSinceEpoch() / 1000);
         }
 
         return ok;
@@ -1245,6 +1285,9 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(const QSharedPointer<DFileHandler>
                 skipFileSize += m_currentDirSize <= 0 ? FileUtils::getMemoryPageSize() : m_currentDirSize;
             return action == DFileCopyMoveJob::SkipAction;
         }
+
+        if (m_journal)
+            m_journal->append(DFileCopyJournal::DirectoryCreatedEntry, fromInfo->fileUrl(), toInfo->fileUrl(), 0, 0);
     }
 
     if (toInfo && fromInfo->filesCount() <= 0 && mode == DFileCopyMoveJob::CopyMode) {
@@ -1325,13 +1368,15 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(const QSharedPointer<DFileHandler>
         // 权限为0000时，源文件已经被删除，无需修改新建的文件的权限为0000
         if (permissions != 0000) {
             if (m_refineStat == DFileCopyMoveJob::RefineBlock) {
-                FileCopyInfoPointer copyinfo(new FileCopyInfo());
-                copyinfo->isdir = true;
-                copyinfo->permission = permissions;
-                copyinfo->handler = handler;
-                copyinfo->toinfo = toInfo;
-                copyinfo->frominfo = fromInfo;
-                writeQueueEnqueue(copyinfo);
+                FileCopyInfo *copyinfo = writeQueueReserve();
+                if (copyinfo) {
+                    copyinfo->isdir = true;
+                    copyinfo->permission = permissions;
+                    copyinfo->handler = handler;
+                    copyinfo->toinfo = toInfo;
+                    copyinfo->frominfo = fromInfo;
+                    writeQueueCommit();
+                }
             } else if (m_refineStat == DFileCopyMoveJob::RefineLocal) {
                 QSharedPointer<DirSetPermissonInfo> dirinfo(new DirSetPermissonInfo);
                 dirinfo->handler = handler;
@@ -1543,6 +1588,12 @@ open_file: {
         saveCurrentDevice(toInfo->fileUrl(),toDevice);
     }
 
+    // 本地文件之间优先在内核中拷贝，未能拷贝的部分继续读写拷贝
+    if (!copyFileByKernel(fromInfo, fromDevice, toDevice)) {
+        cleanDoCopyFileSource(nullptr, fromInfo, toInfo, fromDevice, toDevice);
+        return false;
+    }
+
     qint64 block_Size = fromInfo->size() > MAX_BUFFER_LEN ? MAX_BUFFER_LEN : fromInfo->size();
 
     char *data = new char[block_Size + 1];
@@ -1760,19 +1811,7 @@ open_file: {
     countrefinesize(fromInfo->size() <= 0 ? FileUtils::getMemoryPageSize() : 0);
 
     //对文件加权
-    handler->setFileTime(toInfo->fileUrl(), fromInfo->lastRead(), fromInfo->lastModified());
-
-    QFileDevice::Permissions permissions = fromInfo->permissions();
-    //! use stat function to read vault file permission.
-    QString path = fromInfo->fileUrl().path();
-    if (VaultController::isVaultFile(path)) {
-        permissions = VaultController::getPermissions(path);
-    } else if (deviceListener->isFileFromDisc(fromInfo->path())) { // fix bug 52610: 从光盘中复制出来的文件权限为只读，与 ubuntu 策略保持一致，拷贝出来权限为 rw-rw-r--
-        permissions |= MasteredMediaController::getPermissionsCopyToLocal();
-    }
-    //权限为0000时，源文件已经被删除，无需修改新建的文件的权限为0000
-    if (permissions != 0000)
-        handler->setPermissions(toInfo->fileUrl(), permissions);
+    setTargetFileAttributes(fromInfo, toInfo, handler);
 
 
     if (Q_UNLIKELY(!stateCheck())) {
@@ -2056,6 +2095,12 @@ open_file:{
         saveCurrentDevice(toInfo->fileUrl(),toDevice);
     }
 
+    // 本地文件之间优先在内核中拷贝，未能拷贝的部分继续读写拷贝
+    if (!copyFileByKernel(fromInfo, fromDevice, toDevice)) {
+        cleanCopySources(nullptr, fromDevice, toDevice, isErrorOccur);
+        return false;
+    }
+
     qint64 block_Size = fromInfo->size() > MAX_BUFFER_LEN ? MAX_BUFFER_LEN : fromInfo->size();
     uLong source_checksum = adler32(0L, nullptr, 0);
     char *data = new char[block_Size + 1];
@@ -2215,19 +2260,7 @@ open_file:{
     countrefinesize(fromInfo->size() <= 0 ? FileUtils::getMemoryPageSize() : 0);
 
     //对文件加权
-    handler->setFileTime(toInfo->fileUrl(), fromInfo->lastRead(), fromInfo->lastModified());
-
-    QFileDevice::Permissions permissions = fromInfo->permissions();
-    //! use stat function to read vault file permission.
-    QString path = fromInfo->fileUrl().path();
-    if (VaultController::isVaultFile(path)) {
-        permissions = VaultController::getPermissions(path);
-    } else if (deviceListener->isFileFromDisc(fromInfo->path())) { // fix bug 52610: 从光盘中复制出来的文件权限为只读，与 ubuntu 策略保持一致，拷贝出来权限为 rw-rw-r--
-        permissions |= MasteredMediaController::getPermissionsCopyToLocal();
-    }
-    //权限为0000时，源文件已经被删除，无需修改新建的文件的权限为0000
-    if (permissions != 0000)
-        handler->setPermissions(toInfo->fileUrl(), permissions);
+    setTargetFileAttributes(fromInfo, toInfo, handler);
 
     if (Q_UNLIKELY(!stateCheck())) {
         return false;
@@ -2355,6 +2388,166 @@ open_file:{
     return true;
 }
 
+/*!
+ * \brief DFileCopyMoveJobPrivate::copyFileByKernel 源文件和目标文件都是本地文件时，在内核中拷贝文件数据
+ * 依次尝试 reflink、copy_file_range、sendfile（见 DLocalFileDevice::copyFrom），数据不经过用户空间。
+ * 需要校验完整性时数据必须经过用户空间，不使用此方式。内核拷贝失败时，
+ * 两个文件的位置停留在已拷贝的数据之后，由调用者继续读写拷贝并处理错误
+ * \return 任务被停止时返回 false
+ */
+bool DFileCopyMoveJobPrivate::copyFileByKernel(const DAbstractFileInfoPointer &fromInfo, const QSharedPointer<DFileDevice> &fromDevice,
+                                               const QSharedPointer<DFileDevice> &toDevice)
+{
+    // 每次在内核中拷贝的数据量，太大会使进度更新和暂停不及时
+    static const qint64 kernelCopyChunkSize = 8 * 1024 * 1024;
+
+    DLocalFileDevice *fromLocal = qobject_cast<DLocalFileDevice *>(fromDevice.data());
+    DLocalFileDevice *toLocal = qobject_cast<DLocalFileDevice *>(toDevice.data());
+    if (!fromLocal || !toLocal || fromInfo->size() <= 0
+            || !fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
+        return true;
+    }
+
+    qint64 copied = 0;
+    Q_FOREVER {
+        if (Q_UNLIKELY(!stateCheck()))
+            return false;
+
+        const qint64 size = toLocal->copyFrom(fromLocal, kernelCopyChunkSize);
+        if (size <= 0)
+            break;
+
+        //fix 修复vfat格式u盘卡死问题，写入数据后立刻同步
+        if (m_isEveryReadAndWritesSnc)
+            toDevice->syncToDisk(m_isVfat);
+
+        copied += size;
+        countrefinesize(size);
+        currentJobDataSizeInfo.second += size;
+        completedDataSize += size;
+        completedDataSizeOnBlockDevice += size;
+    }
+
+    qCDebug(fileJob()) << "copied by kernel:" << fromInfo->fileUrl() << copied << "bytes, method:" << toLocal->copyMethod();
+
+    // 内核拷贝改变了文件描述符的位置，同步到设备上
+    if (copied > 0) {
+        fromDevice->seek(copied);
+        toDevice->seek(copied);
+    }
+
+    return true;
+}
+
+void DFileCopyMoveJobPrivate::enqueueThreadPoolCopyFile(const QSharedPointer<ThreadCopyInfo> &threadInfo)
+{
+    if (!threadInfo->toDevice)
+        threadInfo->toDevice.reset(DFileService::instance()->createFileDevice(nullptr, threadInfo->toInfo->fileUrl()));
+    if (!threadInfo->fromDevice)
+        threadInfo->fromDevice.reset(DFileService::instance()->createFileDevice(nullptr, threadInfo->fromInfo->fileUrl()));
+    {
+        QMutexLocker lk(&m_threadMutex);
+        m_threadInfos << threadInfo;
+    }
+    QtConcurrent::run(&m_pool, this, static_cast<bool(DFileCopyMoveJobPrivate::*)()>
+                      (&DFileCopyMoveJobPrivate::doThreadPoolCopyFile));
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::canCopyByUring 文件能否批量交给 io_uring 拷贝
+ * 完整性校验需要逐块计算校验和，网络文件需要断点续传，都只能走原有的拷贝流程
+ */
+bool DFileCopyMoveJobPrivate::canCopyByUring(const DAbstractFileInfoPointer &fromInfo) const
+{
+    if (!m_isUringSupported || m_isTagGvfsFile)
+        return false;
+
+    if (!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking))
+        return false;
+
+    return fromInfo->isFile() && !fromInfo->isSymLink() && fromInfo->size() <= DUringFileCopier::maxFileSize();
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::flushUringBatch 把已积攒的小文件交给线程池拷贝
+ * 只在任务线程中调用
+ */
+void DFileCopyMoveJobPrivate::flushUringBatch()
+{
+    if (m_uringBatch.isEmpty())
+        return;
+
+    const QList<QSharedPointer<ThreadCopyInfo>> batch = m_uringBatch;
+    m_uringBatch.clear();
+    QtConcurrent::run(&m_pool, this, &DFileCopyMoveJobPrivate::doUringCopyFiles, batch);
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::doUringCopyFiles 在线程池中用一个 io_uring 拷贝一批小文件
+ * 拷贝失败的文件重新加入线程池，按原有流程拷贝并处理错误
+ */
+void DFileCopyMoveJobPrivate::doUringCopyFiles(const QList<QSharedPointer<ThreadCopyInfo>> &batch)
+{
+    if (!stateCheck())
+        return;
+
+    QVector<DUringFileCopier::Task> tasks;
+    tasks.reserve(batch.size());
+    for (const auto &info : batch) {
+        DUringFileCopier::Task task;
+        task.source = info->fromInfo->fileUrl().toLocalFile().toLocal8Bit();
+        task.target = info->toInfo->fileUrl().toLocalFile().toLocal8Bit();
+        task.size = info->fromInfo->size();
+        tasks << task;
+        saveCopyFileUrl(info->toInfo->fileUrl());
+    }
+
+    DUringFileCopier copier(qMin(batch.size(), URING_FILES_IN_FLIGHT));
+    copier.setSyncToDisk(m_isEveryReadAndWritesSnc);
+    copier.copy(tasks, [this] { return stateCheck(); }, [&](int index) {
+        const DUringFileCopier::Task &task = tasks.at(index);
+        if (task.error != 0)
+            return;
+
+        const QSharedPointer<ThreadCopyInfo> &info = batch.at(index);
+        sendCopyInfo(info->fromInfo, info->toInfo);
+        currentJobDataSizeInfo.second += task.copiedSize;
+        completedDataSize += task.copiedSize;
+        completedDataSizeOnBlockDevice += task.copiedSize;
+        countrefinesize(task.copiedSize <= 0 ? FileUtils::getMemoryPageSize() : task.copiedSize);
+        setTargetFileAttributes(info->fromInfo, info->toInfo, info->handler);
+    });
+
+    const bool isRunning = stateCheck();
+    for (int i = 0; i < batch.size(); ++i) {
+        const QSharedPointer<ThreadCopyInfo> &info = batch.at(i);
+        removeCopyFileUrl(info->toInfo->fileUrl());
+        if (tasks.at(i).error == 0 || !isRunning)
+            continue;
+
+        qCDebug(fileJob()) << "io_uring copy failed:" << info->fromInfo->fileUrl() << strerror(tasks.at(i).error);
+        enqueueThreadPoolCopyFile(info);
+    }
+}
+
+void DFileCopyMoveJobPrivate::setTargetFileAttributes(const DAbstractFileInfoPointer &fromInfo, const DAbstractFileInfoPointer &toInfo,
+                                                      const QSharedPointer<DFileHandler> &handler)
+{
+    handler->setFileTime(toInfo->fileUrl(), fromInfo->lastRead(), fromInfo->lastModified());
+
+    QFileDevice::Permissions permissions = fromInfo->permissions();
+    //! use stat function to read vault file permission.
+    QString path = fromInfo->fileUrl().path();
+    if (VaultController::isVaultFile(path)) {
+        permissions = VaultController::getPermissions(path);
+    } else if (deviceListener->isFileFromDisc(fromInfo->path())) { // fix bug 52610: 从光盘中复制出来的文件权限为只读，与 ubuntu 策略保持一致，拷贝出来权限为 rw-rw-r--
+        permissions |= MasteredMediaController::getPermissionsCopyToLocal();
+    }
+    //权限为0000时，源文件已经被删除，无需修改新建的文件的权限为0000
+    if (permissions != 0000)
+        handler->setPermissions(toInfo->fileUrl(), permissions);
+}
+
 bool DFileCopyMoveJobPrivate::doThreadPoolCopyFile()
 {
     setLastErrorAction(DFileCopyMoveJob::NoAction);
@@ -2391,6 +2584,154 @@ bool DFileCopyMoveJobPrivate::doThreadPoolCopyFile()
     return ok;
 }
 
+/*!
+ * \brief DFileCopyMoveJobPrivate::doCopyFileDirect 以 O_DIRECT 拷贝大文件到块设备
+ * 数据不经过页缓存，写入返回时已经到达设备，进度与实际写入一致，拷贝结束后也不会长时间同步，
+ * 读取过的源文件数据也从页缓存中丢弃。两块对齐的缓冲区交替使用，写入当前块的同时在另一个线程预读下一块。
+ * 打开文件失败（包括目标文件系统不支持 O_DIRECT）时交给 doCopyFileOnBlock 处理。
+ */
+bool DFileCopyMoveJobPrivate::doCopyFileDirect(const DAbstractFileInfoPointer fromInfo, const DAbstractFileInfoPointer toInfo, const QSharedPointer<DFileHandler> &handler, int blockSize)
+{
+    const QByteArray &fromPath = fromInfo->fileUrl().toLocalFile().toLocal8Bit();
+    const QByteArray &toPath = toInfo->fileUrl().toLocalFile().toLocal8Bit();
+
+    int fromfd = open(fromPath.constData(), O_RDONLY | O_CLOEXEC);
+    if (fromfd < 0)
+        return doCopyFileOnBlock(fromInfo, toInfo, handler, blockSize);
+
+    int tofd = open(toPath.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0777);
+    if (tofd < 0) {
+        qCDebug(fileJob()) << "open with O_DIRECT failed:" << toInfo->fileUrl() << strerror(errno);
+        close(fromfd);
+        return doCopyFileOnBlock(fromInfo, toInfo, handler, blockSize);
+    }
+
+    void *memory = nullptr;
+    if (posix_memalign(&memory, DIRECT_IO_ALIGNMENT, static_cast<size_t>(DIRECT_COPY_BLOCK_SIZE) * 2) != 0) {
+        close(fromfd);
+        close(tofd);
+        return doCopyFileOnBlock(fromInfo, toInfo, handler, blockSize);
+    }
+    char *buffers[2] = {static_cast<char *>(memory), static_cast<char *>(memory) + DIRECT_COPY_BLOCK_SIZE};
+
+    posix_fadvise(fromfd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    saveCopyFileUrl(toInfo->fileUrl());
+    sendCopyInfo(fromInfo, toInfo);
+
+    QFuture<qint64> reading;
+    auto cleanup = [&] {
+        reading.waitForFinished();
+        free(memory);
+        close(fromfd);
+        close(tofd);
+        removeCopyFileUrl(toInfo->fileUrl());
+    };
+    auto skipRemaining = [&](qint64 pos) {
+        completedProgressDataSize += fromInfo->size() - pos;
+        countrefinesize(fromInfo->size() - pos);
+    };
+
+    qint64 current_pos = 0;
+    int current = 0;
+    reading = QtConcurrent::run(readFileFully, fromfd, buffers[current], qint64(DIRECT_COPY_BLOCK_SIZE), current_pos);
+    while (true) {
+        qint64 size_read = reading.result();
+        while (Q_UNLIKELY(size_read < 0)) {
+            const QString &errorstr = qApp->translate("DFileCopyMoveJob", "Failed to read the file, cause: ") + strerror(static_cast<int>(-size_read));
+            switch (setAndhandleError(DFileCopyMoveJob::ReadError, fromInfo, toInfo, errorstr)) {
+            case DFileCopyMoveJob::RetryAction:
+                QThread::msleep(THREAD_SLEEP_TIME);
+                size_read = readFileFully(fromfd, buffers[current], DIRECT_COPY_BLOCK_SIZE, current_pos);
+                break;
+            case DFileCopyMoveJob::SkipAction:
+                skipRemaining(current_pos);
+                cleanup();
+                return true;
+            default:
+                cleanup();
+                q_ptr->stop();
+                return false;
+            }
+        }
+
+        if (Q_UNLIKELY(!stateCheck())) {
+            cleanup();
+            return false;
+        }
+
+        if (size_read == 0)
+            break;
+
+        // 写入当前块的同时预读下一块
+        const bool isLastBlock = size_read < DIRECT_COPY_BLOCK_SIZE;
+        if (!isLastBlock)
+            reading = QtConcurrent::run(readFileFully, fromfd, buffers[1 - current], qint64(DIRECT_COPY_BLOCK_SIZE), current_pos + size_read);
+
+        // O_DIRECT 要求写入大小对齐，文件末尾不足的部分补零写入，最后再截断
+        const qint64 size_aligned = (size_read + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        if (size_aligned > size_read)
+            memset(buffers[current] + size_read, 0, static_cast<size_t>(size_aligned - size_read));
+
+        qint64 size_written = 0;
+        while (size_written < size_aligned) {
+            ssize_t ret = pwrite(tofd, buffers[current] + size_written, static_cast<size_t>(size_aligned - size_written), current_pos + size_written);
+            if (Q_LIKELY(ret > 0)) {
+                size_written += ret;
+                continue;
+            }
+            if (ret < 0 && errno == EINTR)
+                continue;
+
+            DFileCopyMoveJob::Error errortype = DFileCopyMoveJob::NotEnoughSpaceError;
+            QString errorstr;
+            if (ret == 0 || errno != ENOSPC) {
+                errortype = DFileCopyMoveJob::WriteError;
+                errorstr = qApp->translate("DFileCopyMoveJob", "Failed to write the file, cause: %1").arg(strerror(errno));
+            }
+            switch (setAndhandleError(errortype, fromInfo, toInfo, errorstr)) {
+            case DFileCopyMoveJob::RetryAction:
+                QThread::msleep(THREAD_SLEEP_TIME);
+                break;
+            case DFileCopyMoveJob::SkipAction:
+                skipRemaining(current_pos);
+                cleanup();
+                return true;
+            default:
+                cleanup();
+                q_ptr->stop();
+                return false;
+            }
+        }
+
+        //fix 修复vfat格式u盘卡死问题，写入数据后立刻同步
+        // O_DIRECT 不经过页缓存，但文件的元数据和设备的写缓存仍需同步
+        if (m_isEveryReadAndWritesSnc && fdatasync(tofd) != 0)
+            qCWarning(fileJob()) << "failed to sync" << toInfo->fileUrl() << strerror(errno);
+
+        // 源文件已读过的数据不再需要，避免挤占页缓存
+        posix_fadvise(fromfd, current_pos, size_read, POSIX_FADV_DONTNEED);
+
+        currentJobDataSizeInfo.second += size_read;
+        completedDataSize += size_read;
+        completedDataSizeOnBlockDevice += size_read;
+        countrefinesize(size_read);
+        current_pos += size_read;
+        current = 1 - current;
+
+        if (isLastBlock)
+            break;
+    }
+
+    if (current_pos % DIRECT_IO_ALIGNMENT != 0 && ftruncate(tofd, current_pos) != 0)
+        qCWarning(fileJob()) << "failed to truncate" << toInfo->fileUrl() << strerror(errno);
+
+    cleanup();
+
+    setTargetFileAttributes(fromInfo, toInfo, handler);
+
+    return true;
+}
+
 bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer fromInfo, const DAbstractFileInfoPointer toInfo, const QSharedPointer<DFileHandler> &handler, int blockSize)
 {
     DFileCopyMoveJob::Action action = DFileCopyMoveJob::NoAction;
@@ -2444,20 +2785,11 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
     }
 
 #endif
-    qint64 size_block = fromInfo->size() > MAX_BUFFER_LEN ? MAX_BUFFER_LEN : fromInfo->size();
-    size_block = blockSize;
-    FileCopyInfoPointer copyinfo(new FileCopyInfo());
-    copyinfo->handler = handler;
-    copyinfo->frominfo = fromInfo;
-    copyinfo->toinfo = toInfo;
+    // 数据直接读入写队列中预先分配的缓冲区，不再为每一块单独分配内存
+    const qint64 size_block = qMin<qint64>(blockSize, MAX_BUFFER_LEN);
     lseek(fromfd, 0, SEEK_SET);
     qint64 current_pos = 0;
     while (true) {
-        while(checkWritQueueCount()) {
-            QThread::msleep(1);
-        }
-        copyinfo->currentpos = current_pos;
-
         if (Q_UNLIKELY(!stateCheck())) {
             close(fromfd);
             return false;
@@ -2472,34 +2804,49 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
             close(fromfd);
             return true;
         }
-        char *buffer = new char[size_block + 1];
-        qint64 size_read = read(fromfd, buffer, static_cast<size_t>(size_block));
+
+        // 写线程跟不上时在这里等待
+        FileCopyInfo *copyinfo = writeQueueReserve();
+        if (Q_UNLIKELY(!copyinfo)) {
+            close(fromfd);
+            return false;
+        }
+        qint64 size_read = read(fromfd, copyinfo->buffer, static_cast<size_t>(size_block));
 
         if (Q_UNLIKELY(!stateCheck())) {
-            delete[]  buffer;
             close(fromfd);
             return false;
         }
 
         if (Q_UNLIKELY(size_read <= 0)) {
             if (size_read == 0 && current_pos == fromInfo->size()) {
-                copyinfo->buffer = buffer;
-                copyinfo->size = size_read;
+                if (fromInfo->size() <= 0) {
+                    completedProgressDataSize += FileUtils::getMemoryPageSize();
+                    countrefinesize(FileUtils::getMemoryPageSize());
+                }
+
+                // 最后一项不含数据，写线程收到后关闭文件并加权
+                copyinfo->handler = handler;
+                copyinfo->frominfo = fromInfo;
+                copyinfo->toinfo = toInfo;
+                copyinfo->currentpos = current_pos;
+                copyinfo->size = 0;
+                writeQueueCommit();
+                startWriteRefineThread();
                 break;
             }
 
-            const_cast<DAbstractFileInfo *>(copyinfo->frominfo.data())->refresh();
+            const_cast<DAbstractFileInfo *>(fromInfo.data())->refresh();
             DFileCopyMoveJob::Error errortype = DFileCopyMoveJob::NonexistenceError;
             QString errorstr;
-            if (copyinfo->frominfo->exists()) {
+            if (fromInfo->exists()) {
                 errortype = DFileCopyMoveJob::ReadError;
                 errorstr = qApp->translate("DFileCopyMoveJob", "Failed to read the file, cause: ")/*.arg(fromDevice->errorString())*/;
             }
-            switch (setAndhandleError(errortype, copyinfo->frominfo, copyinfo->toinfo, errorstr)) {
+            switch (setAndhandleError(errortype, fromInfo, toInfo, errorstr)) {
             case DFileCopyMoveJob::RetryAction: {
                 if (!lseek(fromfd, current_pos, SEEK_SET)) {
                     setError(DFileCopyMoveJob::UnknowError, "");
-                    delete[]  buffer;
                     close(fromfd);
                     q_ptr->stop();
                     return false;
@@ -2514,47 +2861,25 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
                         ? FileUtils::getMemoryPageSize() : fromInfo->size() - current_pos;
                 countrefinesize(fromInfo->size() <= 0
                                 ? FileUtils::getMemoryPageSize() : fromInfo->size() - current_pos);
-                delete[]  buffer;
+                close(fromfd);
                 return true;
             default:
                 close(fromfd);
                 q_ptr->stop();
-                delete[]  buffer;
                 return false;
             }
         } else {
-            FileCopyInfoPointer tmpinfo(new FileCopyInfo);
-            tmpinfo->closeflag = false;
-            tmpinfo->frominfo = copyinfo->frominfo;
-            tmpinfo->toinfo = copyinfo->toinfo;
-            tmpinfo->currentpos = current_pos;
-            tmpinfo->buffer = buffer;
-            tmpinfo->size = size_read;
+            copyinfo->closeflag = false;
+            copyinfo->frominfo = fromInfo;
+            copyinfo->toinfo = toInfo;
+            copyinfo->currentpos = current_pos;
+            copyinfo->size = size_read;
             current_pos += size_read;
-
-            writeQueueEnqueue(tmpinfo);
-            if (!m_isWriteThreadStart.load()) {
-                m_isWriteThreadStart.store(true);
-                m_writeResult = QtConcurrent::run([this]() {
-                    writeRefineThread();
-                });
-            }
+            writeQueueCommit();
+            startWriteRefineThread();
         }
     }
 
-    if (fromInfo->size() <= 0) {
-        completedProgressDataSize += FileUtils::getMemoryPageSize();
-        countrefinesize(FileUtils::getMemoryPageSize());
-    }
-
-    writeQueueEnqueue(copyinfo);
-    if (!m_isWriteThreadStart.load()) {
-        m_isWriteThreadStart.store(true);
-        m_writeResult = QtConcurrent::run([this]() {
-            writeRefineThread();
-        });
-    }
-
     close(fromfd);
 
     return true;
@@ -2767,6 +3092,7 @@ bool DFileCopyMoveJobPrivate::copyFile(const DAbstractFileInfoPointer fromInfo,
     //判读目标目录和本地目录是不是同盘，并且是大文件
     if (m_refineStat == DFileCopyMoveJob::RefineLocal) {
         if (fromInfo->size() > bigFileSize) {
+            flushUringBatch();
             while (m_pool.activeThreadCount() > 0) {
                 QThread::msleep(10);
             }
@@ -2782,20 +3108,23 @@ bool DFileCopyMoveJobPrivate::copyFile(const DAbstractFileInfoPointer fromInfo,
             QSharedPointer<ThreadCopyInfo> threadInfo(new ThreadCopyInfo);
             threadInfo->fromInfo = fromInfo;
             threadInfo->toInfo = toInfo;
-            threadInfo->toDevice.reset(DFileService::instance()->createFileDevice(nullptr, toInfo->fileUrl()));
-            threadInfo->fromDevice.reset(DFileService::instance()->createFileDevice(nullptr, fromInfo->fileUrl()));
             threadInfo->handler = handler;
-            {
-                QMutexLocker lk(&m_threadMutex);
-                m_threadInfos << threadInfo;
+            if (canCopyByUring(fromInfo)) {
+                //小文件攒够一批后在线程池中用 io_uring 拷贝
+                m_uringBatch << threadInfo;
+                if (m_uringBatch.size() >= URING_BATCH_SIZE)
+                    flushUringBatch();
+            } else {
+                enqueueThreadPoolCopyFile(threadInfo);
             }
-            QtConcurrent::run(&m_pool, this, static_cast<bool(DFileCopyMoveJobPrivate::*)()>
-                              (&DFileCopyMoveJobPrivate::doThreadPoolCopyFile));
             endJob();
             qCDebug(fileJob(), "Time spent of copy the file: %lld", updateSpeedElapsedTimer->elapsed() - elapsed);
             return ok;
         }
     }
+    else if (fromInfo->size() >= DIRECT_COPY_MIN_SIZE) {
+        ok = doCopyFileDirect(fromInfo, toInfo, handler, blockSize);
+    }
     else {
         ok = doCopyFileOnBlock(fromInfo, toInfo, handler, blockSize);
     }
@@ -2886,7 +3215,7 @@ void DFileCopyMoveJobPrivate::leaveDirectory()
     directoryStack.pop();
 }
 
-void DFileCopyMoveJobPrivate::joinToCompletedFileList(const DUrl from, const DUrl target, qint64 dataSize)
+void DFileCopyMoveJobPrivate::joinToCompletedFileList(const DUrl from, const DUrl target, qint64 dataSize, qint64 lastModified)
 {
 //    qCDebug(fileJob(), "file. from: %s, target: %s, data size: %lld", qPrintable(from.toString()), qPrintable(target.toString()), dataSize);
 
@@ -2905,11 +3234,13 @@ void DFileCopyMoveJobPrivate::joinToCompletedFileList(const DUrl from, const DUr
     }
 
     completedFileList << qMakePair(from, target);
+
+    if (m_journal && target.isValid())
+        m_journal->append(DFileCopyJournal::FileEntry, from, target, dataSize, lastModified);
 }
 
-void DFileCopyMoveJobPrivate::joinToCompletedDirectoryList(const DUrl from, const DUrl target, qint64 dataSize)
+void DFileCopyMoveJobPrivate::joinToCompletedDirectoryList(const DUrl from, const DUrl target, qint64 dataSize, qint64 lastModified)
 {
-    Q_UNUSED(dataSize)
 //    qCDebug(fileJob(), "directory. from: %s, target: %s, data size: %lld", qPrintable(from.toString()), qPrintable(target.toString()), dataSize);
 
     // warning: isFromLocalUrls 对于外部挂载存储设备返回true，如果要修改 isFromLocalUrls 的含义
@@ -2927,6 +3258,112 @@ void DFileCopyMoveJobPrivate::joinToCompletedDirectoryList(const DUrl from, cons
     }
 
     completedDirectoryList << qMakePair(from, target);
+
+    if (m_journal && target.isValid())
+        m_journal->append(DFileCopyJournal::DirectoryEntry, from, target, dataSize, lastModified);
+}
+
+void DFileCopyMoveJobPrivate::openJournal()
+{
+    if (!targetUrl.isValid() || mode == DFileCopyMoveJob::RemoteMode)
+        return;
+
+    m_journal.reset(new DFileCopyJournal(DFileCopyJournal::journalPath(mode, sourceUrlList, targetUrl)));
+    if (!m_journal->open(mode, sourceUrlList, targetUrl)) {
+        m_journal.reset();
+        return;
+    }
+
+    if (m_journal->count() > 0)
+        qInfo() << "resume job from journal, completed entries:" << m_journal->count();
+}
+
+void DFileCopyMoveJobPrivate::closeJournal()
+{
+    if (!m_journal)
+        return;
+
+    // 出错中断的任务保留日志，再次执行时可以继续
+    if (error == DFileCopyMoveJob::NoError || error == DFileCopyMoveJob::CancelError)
+        m_journal->remove();
+
+    m_journal.reset();
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::skipJournalCompleted 继续上次中断的任务时跳过已经完成的文件或目录
+ * 复制任务中，日志中有记录，且源文件和目标文件的大小、修改时间都与记录一致时才认为文件已完成。
+ * 目录中的文件可能仍在线程池中异步写入时目录就已记录完成，因此复制任务不跳过整个目录，而是合并
+ * 目录后逐个检查其中的文件。移动任务中已完成的源文件不再存在，只要目标文件存在即可
+ * \return 跳过时返回 true
+ */
+bool DFileCopyMoveJobPrivate::skipJournalCompleted(const DUrl &from, const DAbstractFileInfoPointer &sourceInfo, const DAbstractFileInfoPointer &targetInfo)
+{
+    if (!m_journal || m_journal->count() <= 0 || !targetInfo)
+        return false;
+
+    DFileCopyJournal::Entry entry;
+    if (!m_journal->find(from, entry) || entry.type == DFileCopyJournal::DirectoryCreatedEntry
+            || entry.target.parentUrl() != targetInfo->fileUrl())
+        return false;
+
+    const DAbstractFileInfoPointer &toInfo = DFileService::instance()->createFileInfo(nullptr, entry.target, false);
+    if (!toInfo || !toInfo->exists())
+        return false;
+
+    const bool isDir = entry.type == DFileCopyJournal::DirectoryEntry;
+    if (toInfo->isDir() != isDir)
+        return false;
+
+    qint64 skipSize = FileUtils::getMemoryPageSize();
+    if (sourceInfo && sourceInfo->exists()) {
+        // 移动任务中源文件仍然存在时不能确定是否已经完成，复制任务不跳过整个目录
+        if (mode != DFileCopyMoveJob::CopyMode || isDir)
+            return false;
+        if (sourceInfo->isDir() || sourceInfo->isSymLink() != toInfo->isSymLink())
+            return false;
+
+        // 修改时间以秒为单位设置到目标文件上，见 DLocalFileHandler::setFileTime
+        if (!sourceInfo->isSymLink()) {
+            if (sourceInfo->size() != entry.size || toInfo->size() != entry.size
+                    || sourceInfo->lastModified().toMSecsSinceEpoch() / 1000 != entry.lastModified
+                    || toInfo->lastModified().toMSecsSinceEpoch() / 1000 != entry.lastModified)
+                return false;
+        }
+
+        if (entry.size > 0)
+            skipSize = entry.size;
+    } else if (mode == DFileCopyMoveJob::CopyMode) {
+        return false;
+    }
+
+    //! 与 doProcess 中一样，每个源文件对应回收站中的一个原始路径
+    if (!m_fileNameList.isEmpty())
+        m_fileNameList.dequeue();
+
+    skipFileSize += skipSize;
+    ++completedFilesCount;
+    Q_EMIT q_ptr->completedFilesCountChanged(completedFilesCount);
+
+    if (isDir)
+        completedDirectoryList << qMakePair(from, entry.target);
+    else
+        completedFileList << qMakePair(from, entry.target);
+
+    return true;
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::isJournalCreatedDirectory 目标目录是否由上次中断的同一任务创建，
+ * 继续任务时直接合并这样的目录，不再询问用户
+ */
+bool DFileCopyMoveJobPrivate::isJournalCreatedDirectory(const DUrl &from, const DAbstractFileInfoPointer &toInfo) const
+{
+    if (!m_journal || m_journal->count() <= 0 || !toInfo->isDir() || toInfo->isSymLink())
+        return false;
+
+    DFileCopyJournal::Entry entry;
+    return m_journal->find(from, entry) && entry.type != DFileCopyJournal::FileEntry && entry.target == toInfo->fileUrl();
 }
 
 void DFileCopyMoveJobPrivate::updateProgress()
@@ -3085,28 +3522,148 @@ void DFileCopyMoveJobPrivate::checkTagetIsFromBlockDevice()
                                  deviceListener->isBlockFile(targetUrl.toLocalFile()));
 }
 
+DFileCopyMoveJobPrivate::FileCopyRing::FileCopyRing(int capacity, qint64 bufferSize)
+    : items(capacity)
+    , m_bufferSize(bufferSize)
+{
+    void *memory = nullptr;
+    const size_t alignment = static_cast<size_t>(FileUtils::getMemoryPageSize());
+    if (posix_memalign(&memory, alignment, static_cast<size_t>(bufferSize * capacity)) == 0)
+        buffers = static_cast<char *>(memory);
+    else
+        qWarning() << "failed to allocate the write ring buffer!";
+}
+
+DFileCopyMoveJobPrivate::FileCopyRing::~FileCopyRing()
+{
+    free(buffers);
+}
+
+qint64 DFileCopyMoveJobPrivate::FileCopyRing::bufferSize() const
+{
+    return buffers ? m_bufferSize : 0;
+}
+
+bool DFileCopyMoveJobPrivate::FileCopyRing::isEmpty() const
+{
+    return head.loadAcquire() == tail.loadAcquire();
+}
+
+DFileCopyMoveJobPrivate::FileCopyInfo *DFileCopyMoveJobPrivate::FileCopyRing::reserve(const std::function<bool()> &isRunning)
+{
+    const quint32 current = tail.load();
+    const quint32 capacity = static_cast<quint32>(items.size());
+    while (current - head.loadAcquire() >= capacity) {
+        if (!isRunning())
+            return nullptr;
+
+        // 置位后再检查一次，避免错过写线程的唤醒；超时用于兜底
+        producerWaiting.storeRelease(1);
+        {
+            QMutexLocker lk(&waitMutex);
+            if (current - head.loadAcquire() >= capacity)
+                notFull.wait(&waitMutex, WRITE_RING_WAIT_TIME);
+        }
+        producerWaiting.storeRelease(0);
+    }
+
+    const int index = static_cast<int>(current % capacity);
+    FileCopyInfo &info = items[index];
+    info.closeflag = true;
+    info.isdir = false;
+    info.handler.reset();
+    info.frominfo.reset();
+    info.toinfo.reset();
+    info.buffer = buffers ? buffers + m_bufferSize * index : nullptr;
+    info.size = 0;
+    info.currentpos = 0;
+    info.permission = QFileDevice::ReadOwner;
+    return &info;
+}
+
+void DFileCopyMoveJobPrivate::FileCopyRing::commit()
+{
+    tail.storeRelease(tail.load() + 1);
+    if (consumerWaiting.loadAcquire()) {
+        QMutexLocker lk(&waitMutex);
+        notEmpty.wakeOne();
+    }
+}
+
+DFileCopyMoveJobPrivate::FileCopyInfo *DFileCopyMoveJobPrivate::FileCopyRing::front(unsigned long timeout)
+{
+    const quint32 current = head.load();
+    if (current == tail.loadAcquire()) {
+        if (timeout == 0)
+            return nullptr;
+
+        consumerWaiting.storeRelease(1);
+        {
+            QMutexLocker lk(&waitMutex);
+            if (current == tail.loadAcquire())
+                notEmpty.wait(&waitMutex, timeout);
+        }
+        consumerWaiting.storeRelease(0);
+
+        if (current == tail.loadAcquire())
+            return nullptr;
+    }
+
+    return &items[static_cast<int>(current % static_cast<quint32>(items.size()))];
+}
+
+void DFileCopyMoveJobPrivate::FileCopyRing::pop()
+{
+    head.storeRelease(head.load() + 1);
+    if (producerWaiting.loadAcquire()) {
+        QMutexLocker lk(&waitMutex);
+        notFull.wakeOne();
+    }
+}
+
+void DFileCopyMoveJobPrivate::FileCopyRing::clear()
+{
+    head.storeRelease(tail.loadAcquire());
+    if (producerWaiting.loadAcquire()) {
+        QMutexLocker lk(&waitMutex);
+        notFull.wakeOne();
+    }
+}
+
 bool DFileCopyMoveJobPrivate::checkWritQueueEmpty()
 {
-    QMutexLocker lk(&m_copyInfoQueueMutex);
-    return m_writeFileQueue.isEmpty();
+    return !m_writeRing || m_writeRing->isEmpty();
 }
 
-bool DFileCopyMoveJobPrivate::checkWritQueueCount()
+/*!
+ * \brief DFileCopyMoveJobPrivate::writeQueueReserve 在任务线程中取得写队列的一个空闲位置
+ * 写线程跟不上时在这里等待，内存占用不超过队列容量 * MAX_BUFFER_LEN
+ * \return 任务被停止或缓冲区分配失败时返回空
+ */
+DFileCopyMoveJobPrivate::FileCopyInfo *DFileCopyMoveJobPrivate::writeQueueReserve()
 {
-    QMutexLocker lk(&m_copyInfoQueueMutex);
-    return m_writeFileQueue.count() > 300;
+    if (!m_writeRing)
+        m_writeRing.reset(new FileCopyRing(WRITE_RING_CAPACITY, MAX_BUFFER_LEN));
+
+    if (m_writeRing->bufferSize() <= 0)
+        return nullptr;
+
+    return m_writeRing->reserve([this] { return stateCheck(); });
 }
 
-QSharedPointer<DFileCopyMoveJobPrivate::FileCopyInfo> DFileCopyMoveJobPrivate::writeQueueDequeue()
+void DFileCopyMoveJobPrivate::writeQueueCommit()
 {
-    QMutexLocker lk(&m_copyInfoQueueMutex);
-    return m_writeFileQueue.dequeue();
+    m_writeRing->commit();
 }
 
-void DFileCopyMoveJobPrivate::writeQueueEnqueue(const QSharedPointer<DFileCopyMoveJobPrivate::FileCopyInfo> &copyinfo)
+void DFileCopyMoveJobPrivate::startWriteRefineThread()
 {
-    QMutexLocker lk(&m_copyInfoQueueMutex);
-    m_writeFileQueue.enqueue(copyinfo);
+    if (!m_isWriteThreadStart.load()) {
+        m_isWriteThreadStart.store(true);
+        m_writeResult = QtConcurrent::run([this]() {
+            writeRefineThread();
+        });
+    }
 }
 
 void DFileCopyMoveJobPrivate::errorQueueHandling()
@@ -3149,12 +3706,8 @@ void DFileCopyMoveJobPrivate::errorQueueHandled(const bool &isNotCancel)
         m_errorCondition.wakeAll();
 }
 
-void DFileCopyMoveJobPrivate::releaseCopyInfo(const DFileCopyMoveJobPrivate::FileCopyInfoPointer &info)
+void DFileCopyMoveJobPrivate::releaseCopyInfo()
 {
-    if (info->buffer) {
-        delete [] info->buffer;
-        info->buffer = nullptr;
-    }
     for (auto fd : m_writeOpenFd) {
         close(fd);
         removeCopyFileUrl(m_writeOpenFd.key(fd));
@@ -3164,6 +3717,7 @@ void DFileCopyMoveJobPrivate::releaseCopyInfo(const DFileCopyMoveJobPrivate::Fil
 
 bool DFileCopyMoveJobPrivate::writeRefineThread()
 {
+    m_writeThread.storeRelease(QThread::currentThread());
     bool ok = true;
     while (checkRefineCopyProccessSate(DFileCopyMoveJob::ReadFileProccessOver)) {
         ok = writeToFileByQueue();
@@ -3188,15 +3742,25 @@ bool DFileCopyMoveJobPrivate::writeRefineThread()
 //写线程出错时，1.弹出提示框时，是否要暂停读线程2.点击跳过应该怎么处理，清理掉有相同的文件描述符的写队列、关闭文件读文件是否要暂停3.关闭拷贝时，要怎么处理）
 bool DFileCopyMoveJobPrivate::writeToFileByQueue()
 {
-    while (!checkWritQueueEmpty()) {
-        auto info = writeQueueDequeue();
+    if (!m_writeRing)
+        return true;
+
+    // 队首的缓冲区在本次循环结束（包括出错返回）时才归还给读线程
+    struct PopGuard {
+        FileCopyRing *ring;
+        ~PopGuard() { ring->pop(); }
+    };
+
+    FileCopyInfo *info = nullptr;
+    while ((info = m_writeRing->front(WRITE_RING_WAIT_TIME))) {
+        PopGuard guard{m_writeRing.data()};
         if (Q_UNLIKELY(!stateCheck())) {
-            releaseCopyInfo(info);
+            releaseCopyInfo();
             return false;
         }
         //检查info的有效性
         if (!info->frominfo || !info->toinfo) {
-            releaseCopyInfo(info);
+            releaseCopyInfo();
             return false;
         }
         //对文件夹加权
@@ -3207,7 +3771,7 @@ bool DFileCopyMoveJobPrivate::writeToFileByQueue()
         if (skipReadFileDealWriteThread(info->frominfo->fileUrl())) {
             completedProgressDataSize += info->size;
             countrefinesize(info->size);
-            releaseCopyInfo(info);
+            releaseCopyInfo();
             continue;
         }
         int toFd = -1;
@@ -3254,12 +3818,12 @@ bool DFileCopyMoveJobPrivate::writeToFileByQueue()
             if (action == DFileCopyMoveJob::SkipAction) {
                 countrefinesize(info->size);
                 completedProgressDataSize += info->size;
-                releaseCopyInfo(info);
+                releaseCopyInfo();
                 QMutexLocker lk(&m_skipFileQueueMutex);
                 m_skipFileQueue.enqueue(info->frominfo->fileUrl());
                 continue;
             } else if (action != DFileCopyMoveJob::NoAction) {
-                releaseCopyInfo(info);
+                releaseCopyInfo();
                 return false;
             }
         }
@@ -3269,17 +3833,24 @@ bool DFileCopyMoveJobPrivate::writeToFileByQueue()
 
         bool bSkiped = false;
 
+        // O_DIRECT 要求写入大小对齐，文件末尾不足对齐大小的一块改为普通写入
+        if (Q_UNLIKELY(info->size % DIRECT_IO_ALIGNMENT != 0 && (m_openFlag & O_DIRECT))) {
+            const int flags = fcntl(toFd, F_GETFL);
+            if (flags != -1 && (flags & O_DIRECT))
+                fcntl(toFd, F_SETFL, flags & ~O_DIRECT);
+        }
+
 write_data: {
             qint64 size_write = write(toFd, info->buffer, static_cast<size_t>(info->size));
             QString errorstr = strerror(errno);
             if (Q_UNLIKELY(!stateCheck())) {
-                releaseCopyInfo(info);
+                releaseCopyInfo();
                 return false;
             }
             //如果写失败了，直接推出
             if (size_write < 0) {
                 if (!stateCheck()) {
-                    releaseCopyInfo(info);
+                    releaseCopyInfo();
                     return false;
                 }
 
@@ -3298,7 +3869,7 @@ write_data: {
                             errorQueueHandled(false);
                             isErrorOccur = false;
                         }
-                        releaseCopyInfo(info);
+                        releaseCopyInfo();
                         return false;
                     }
                     goto write_data;
@@ -3309,7 +3880,7 @@ write_data: {
                     //在失去网络，网络文件调用gio 的 g_output_stream_close 关闭 output_stream，会卡很久
                     completedProgressDataSize += info->size;
                     countrefinesize(info->size);
-                    releaseCopyInfo(info);
+                    releaseCopyInfo();
 
                     //当前错误处理完成
                     if (isErrorOccur) {
@@ -3328,7 +3899,7 @@ write_data: {
                         errorQueueHandled(false);
                         isErrorOccur = false;
                     }
-                    releaseCopyInfo(info);
+                    releaseCopyInfo();
 
                     return false;
                 }
@@ -3379,7 +3950,7 @@ write_data: {
                     case DFileCopyMoveJob::RetryAction: {
                         if (!lseek(toFd, info->currentpos, SEEK_SET)) {
                             setError(DFileCopyMoveJob::UnknowError, "");
-                            releaseCopyInfo(info);
+                            releaseCopyInfo();
                             //当前错误处理完成
                             if (isErrorOccur) {
                                 errorQueueHandled(false);
@@ -3392,7 +3963,7 @@ write_data: {
                         goto write_data;
                     }
                     case DFileCopyMoveJob::SkipAction:{
-                        releaseCopyInfo(info);
+                        releaseCopyInfo();
 
                         //当前错误处理完成
                         if (isErrorOccur) {
@@ -3406,7 +3977,7 @@ write_data: {
                     }
                     default:
                         //当前错误处理完成
-                        releaseCopyInfo(info);
+                        releaseCopyInfo();
                         if (isErrorOccur) {
                             errorQueueHandled(false);
                             isErrorOccur = false;
@@ -3424,10 +3995,6 @@ write_data: {
             completedDataSizeOnBlockDevice += size_write;
 
             countrefinesize(size_write);
-            if (info->buffer) {
-                delete [] info->buffer;
-                info->buffer = nullptr;
-            }
         }
         //关闭文件并加权
         if (info->closeflag) {
@@ -3467,17 +4034,14 @@ bool DFileCopyMoveJobPrivate::skipReadFileDealWriteThread(const DUrl &url)
 
 void DFileCopyMoveJobPrivate::cancelReadFileDealWriteThread()
 {
-    QMutexLocker lk(&m_copyInfoQueueMutex);
-    for (auto fd : m_writeOpenFd) {
-        close(fd);
-        removeCopyFileUrl(m_writeOpenFd.key(fd));
-    }
-    m_writeOpenFd.clear();
-    while (!m_writeFileQueue.isEmpty()) {
-        auto info = m_writeFileQueue.dequeue();
-        if (info->buffer)
-            delete[] info->buffer;
-    }
+    // 写线程运行中只能由它自己清理队列和打开的文件，它在退出前会调用这里
+    if (m_isWriteThreadStart.load() && !m_writeResult.isFinished()
+            && m_writeThread.loadAcquire() != QThread::currentThread())
+        return;
+
+    releaseCopyInfo();
+    if (m_writeRing)
+        m_writeRing->clear();
 }
 
 void DFileCopyMoveJobPrivate::setRefineCopyProccessSate(const DFileCopyMoveJob::RefineCopyProccessSate &stat)
@@ -3691,6 +4255,11 @@ void DFileCopyMoveJob::setRefine(const RefineState &refinestat)
 
 void DFileCopyMoveJobPrivate::waitRefineThreadFinish()
 {
+    if (state == DFileCopyMoveJob::StoppedState)
+        m_uringBatch.clear();
+    else
+        flushUringBatch();
+
     qDebug() << "wait thread pool finished!";
     while (m_pool.activeThreadCount() > 0) {
         if (state == DFileCopyMoveJob::StoppedState)
@@ -4407,6 +4976,8 @@ void DFileCopyMoveJob::run()
     }
     //初始化优化状态
     d->initRefineState();
+    //打开断点续传日志，相同的任务之前中断过时跳过已完成的文件
+    d->openJournal();
 
     for (DUrl &source : d->sourceUrlList) {
         if (!d->stateCheck()) {
@@ -4526,6 +5097,7 @@ end:
 
     d->fileStatistics->stop();
     d->setState(StoppedState);
+    d->closeJournal();
 
     if (d->error == NoError) {
         d->updateSpeedTimer->stop();
@@ -0,0 +1,257 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dfilestatisticscache.h"
+
+#include <QFile>
+#include <QDebug>
+
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+namespace {
+static const int kDefaultWatchCount = 8192;   // 无法读取系统限制时最多监视的目录数量
+static const int kMaxWatchCount = 65536;   // 每个监视都占用内核内存，再大的系统限制也只用到这里
+static const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO
+                                   | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+DFM_BEGIN_NAMESPACE
+
+DFileStatisticsCache::DFileStatisticsCache()
+    : inotifyFd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    if (inotifyFd < 0)
+        qWarning() << "can not create inotify instance for the statistics cache";
+}
+
+DFileStatisticsCache::~DFileStatisticsCache()
+{
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+}
+
+DFileStatisticsCache *DFileStatisticsCache::instance()
+{
+    static DFileStatisticsCache *cache = new DFileStatisticsCache();
+    return cache;
+}
+
+/*!
+ * \brief DFileStatisticsCache::maxWatchCount 所有缓存和进行中的统计最多监视的目录数量
+ * 取系统限制的四分之一，其余留给文件管理器的其他监视，超过的目录树不缓存
+ */
+int DFileStatisticsCache::maxWatchCount()
+{
+    static const int count = [] {
+        QFile file("/proc/sys/fs/inotify/max_user_watches");
+        if (!file.open(QIODevice::ReadOnly))
+            return kDefaultWatchCount;
+
+        bool ok = false;
+        const int max = file.readAll().trimmed().toInt(&ok);
+        return ok && max > 0 ? qMin(max / 4, kMaxWatchCount) : kDefaultWatchCount;
+    }();
+
+    return count;
+}
+
+/*!
+ * \brief DFileStatisticsCache::find 查找目录的统计结果
+ * \param path 本地目录路径
+ * \param hints 影响统计结果的参数，与 insert 时一致才能命中
+ * \param statistics 命中时返回目录下的统计结果
+ */
+bool DFileStatisticsCache::find(const QByteArray &path, int hints, Statistics &statistics)
+{
+    struct stat st;
+    if (::stat(path.constData(), &st) != 0 || !S_ISDIR(st.st_mode))
+        return false;
+
+    QMutexLocker lk(&mutex);
+    // 先处理已经发生的变化，不会命中已失效的缓存
+    readEvents();
+
+    auto it = entries.constFind({static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino), hints});
+    if (it == entries.cend())
+        return false;
+
+    statistics = it->statistics;
+    return true;
+}
+
+/*!
+ * \brief DFileStatisticsCache::beginWalk 开始一次统计
+ * \return 当前的变化序号，insert 时用来检查统计期间监视的目录是否发生了变化
+ */
+quint64 DFileStatisticsCache::beginWalk()
+{
+    QMutexLocker lk(&mutex);
+    readEvents();
+    return serial;
+}
+
+/*!
+ * \brief DFileStatisticsCache::watchDirectory 统计时在读取目录前监视它
+ * \return 监视描述符，失败或超过监视数量上限时返回 -1，这次统计的结果不能缓存
+ * 返回的监视由调用方持有，需要交给 insert 或 releaseWatches
+ */
+int DFileStatisticsCache::watchDirectory(const QByteArray &path)
+{
+    if (inotifyFd < 0)
+        return -1;
+
+    QMutexLocker lk(&mutex);
+    const int wd = ::inotify_add_watch(inotifyFd, path.constData(), kWatchMask);
+    if (wd < 0)
+        return -1;
+
+    if (!watches.contains(wd)) {
+        // 监视数量达到上限时淘汰最早加入的缓存
+        while (watches.size() >= maxWatchCount() && !insertOrder.isEmpty())
+            removeEntry(insertOrder.first());
+
+        if (watches.size() >= maxWatchCount()) {
+            ::inotify_rm_watch(inotifyFd, wd);
+            return -1;
+        }
+    }
+
+    ++watches[wd].refCount;
+    return wd;
+}
+
+void DFileStatisticsCache::releaseWatches(const QVector<int> &watchList)
+{
+    QMutexLocker lk(&mutex);
+    for (int wd : watchList)
+        releaseWatch(wd);
+}
+
+/*!
+ * \brief DFileStatisticsCache::insert 记录一次完整统计的结果
+ * \param watchList 统计时 watchDirectory 返回的所有监视（包括 path 自身），由缓存接管
+ * \param walkSerial 统计开始时 beginWalk 返回的序号，之后任一目录发生变化时结果不缓存
+ */
+void DFileStatisticsCache::insert(const QByteArray &path, int hints, const Statistics &statistics,
+                                  const QVector<int> &watchList, quint64 walkSerial)
+{
+    struct stat st;
+    const bool isDir = ::stat(path.constData(), &st) == 0 && S_ISDIR(st.st_mode);
+
+    QMutexLocker lk(&mutex);
+    readEvents();
+
+    bool unchanged = isDir && !watchList.isEmpty();
+    for (int i = 0; unchanged && i < watchList.size(); ++i) {
+        auto it = watches.constFind(watchList.at(i));
+        unchanged = it != watches.cend() && !it->removed && it->changeSerial <= walkSerial;
+    }
+
+    if (!unchanged) {
+        for (int wd : watchList)
+            releaseWatch(wd);
+        return;
+    }
+
+    const Key key {static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino), hints};
+    removeEntry(key);
+
+    Entry entry {QFile::decodeName(path), statistics, watchList};
+    std::sort(entry.watchList.begin(), entry.watchList.end());
+    entries.insert(key, entry);
+    insertOrder << key;
+}
+
+void DFileStatisticsCache::clear()
+{
+    QMutexLocker lk(&mutex);
+    while (!insertOrder.isEmpty())
+        removeEntry(insertOrder.first());
+}
+
+/*!
+ * \brief DFileStatisticsCache::readEvents 读取所有已经发生的变化，使相关的缓存失效
+ */
+void DFileStatisticsCache::readEvents()
+{
+    if (inotifyFd < 0)
+        return;
+
+    alignas(struct inotify_event) char buffer[4096];
+    forever {
+        const ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            return;
+
+        for (ssize_t i = 0; i < length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + i);
+            i += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+            // 事件队列溢出，所有缓存和进行中的统计都不再可信
+            if (event->mask & IN_Q_OVERFLOW) {
+                ++serial;
+                for (auto it = watches.begin(); it != watches.end(); ++it)
+                    it->changeSerial = serial;
+                while (!insertOrder.isEmpty())
+                    removeEntry(insertOrder.first());
+                continue;
+            }
+
+            auto it = watches.find(event->wd);
+            if (it == watches.end())
+                continue;
+
+            it->changeSerial = ++serial;
+            if (event->mask & IN_IGNORED)
+                it->removed = true;
+            invalidate(event->wd);
+        }
+    }
+}
+
+/*!
+ * \brief DFileStatisticsCache::invalidate 监视的目录发生了变化，移除所有包含它的目录树的缓存
+ */
+void DFileStatisticsCache::invalidate(int wd)
+{
+    QList<Key> invalidKeys;
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        if (std::binary_search(it->watchList.cbegin(), it->watchList.cend(), wd))
+            invalidKeys << it.key();
+    }
+
+    for (const Key &key : invalidKeys)
+        removeEntry(key);
+}
+
+void DFileStatisticsCache::removeEntry(const Key &key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return;
+
+    for (int wd : it->watchList)
+        releaseWatch(wd);
+
+    entries.erase(it);
+    insertOrder.removeOne(key);
+}
+
+void DFileStatisticsCache::releaseWatch(int wd)
+{
+    auto it = watches.find(wd);
+    if (it == watches.end() || --it->refCount > 0)
+        return;
+
+    // 目录被删除或卸载时内核已经移除了监视
+    if (!it->removed)
+        ::inotify_rm_watch(inotifyFd, wd);
+    watches.erase(it);
+}
+
+DFM_END_NAMESPACE
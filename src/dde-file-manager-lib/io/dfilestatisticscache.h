@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DFILESTATISTICSCACHE_H
+#define DFILESTATISTICSCACHE_H
+
+#include <dfmglobal.h>
+
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+DFM_BEGIN_NAMESPACE
+
+/*!
+ * \brief The DFileStatisticsCache class 本地目录的统计结果缓存
+ * 以目录的设备号、inode 和统计参数为键，记录目录下（不含目录自身）的总大小和文件数量。
+ * 统计时每个目录在读取前先加入 inotify 监视，缓存的目录树中任何变化都会使包含它的缓存失效，
+ * 在监视加入后、结果加入缓存前发生的变化也会使这次统计结果不被缓存。
+ * 监视事件在每次调用时同步读取，不依赖事件循环，可在任意线程调用。
+ */
+class DFileStatisticsCache
+{
+public:
+    struct Statistics {
+        qint64 totalSize = 0;
+        qint64 totalProgressSize = 0;
+        int filesCount = 0;
+        int directoryCount = 0;
+    };
+
+    static DFileStatisticsCache *instance();
+    static int maxWatchCount();
+
+    bool find(const QByteArray &path, int hints, Statistics &statistics);
+
+    quint64 beginWalk();
+    int watchDirectory(const QByteArray &path);
+    void releaseWatches(const QVector<int> &watchList);
+    void insert(const QByteArray &path, int hints, const Statistics &statistics, const QVector<int> &watchList, quint64 walkSerial);
+    void clear();
+
+private:
+    DFileStatisticsCache();
+    ~DFileStatisticsCache();
+
+    struct Key {
+        quint64 device;
+        quint64 inode;
+        int hints;
+
+        bool operator==(const Key &other) const
+        {
+            return device == other.device && inode == other.inode && hints == other.hints;
+        }
+    };
+    friend uint qHash(const Key &key, uint seed)
+    {
+        return ::qHash(key.device, seed) ^ ::qHash(key.inode, seed) ^ static_cast<uint>(key.hints);
+    }
+
+    struct Entry {
+        QString path;
+        Statistics statistics;
+        QVector<int> watchList;   // 有序，便于按监视描述符查找
+    };
+
+    struct Watch {
+        int refCount = 0;
+        quint64 changeSerial = 0;   // 最后一次变化的序号
+        bool removed = false;   // 目录已被删除或卸载，内核已移除监视
+    };
+
+    void readEvents();
+    void invalidate(int wd);
+    void removeEntry(const Key &key);
+    void releaseWatch(int wd);
+
+private:
+    int inotifyFd = -1;
+
+    QMutex mutex;
+    QHash<Key, Entry> entries;
+    QList<Key> insertOrder;   // 用于淘汰最早加入的缓存
+    QHash<int, Watch> watches;   // 目录被多个缓存或统计引用时只监视一次
+    quint64 serial = 0;
+};
+
+DFM_END_NAMESPACE
+
+#endif // DFILESTATISTICSCACHE_H
@@ -6,6 +6,7 @@
 #include "dfileservices.h"
 #include "dabstractfileinfo.h"
 #include "dstorageinfo.h"
+#include "dfilestatisticscache.h"
 #include "shutil/fileutils.h"
 #include <models/trashfileinfo.h>
 
@@ -13,7 +14,42 @@
 #include <QQueue>
 #include <QTimer>
 #include <QWaitCondition>
+#include <QMetaMethod>
+#include <QSet>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+namespace {
+static const int kMaxWalkerThreadCount = 8;   // 本地目录遍历的最大线程数，过多的线程只会加剧磁盘寻道
+static const int kDirentBufferSize = 64 * 1024;   // 每次 getdents64 读取的缓冲区大小
+static const unsigned long kWalkerIdleWait = 10;   // 空闲线程等待新目录的超时时间（ms）
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// /proc/kcore 与 /dev/core（通常是指向前者的链接）不能按大小统计
+bool isKernelCoreFile(const struct stat &st)
+{
+    static struct stat kcore;
+    static const bool hasKcore = ::stat("/proc/kcore", &kcore) == 0;
 
+    return hasKcore && st.st_dev == kcore.st_dev && st.st_ino == kcore.st_ino;
+}
+}
 
 DFM_BEGIN_NAMESPACE
 
@@ -29,6 +65,10 @@ public:
     bool stateCheck();
 
     void processFile(const DUrl &url, QQueue<DUrl> &directoryQueue);
+    void walkLocalDirectories(const QList<QByteArray> &directories);
+    void countLocalDirectory(const QByteArray &directory);
+
+    class LocalWalker;
 
     DFileStatisticsJob *q_ptr;
     QTimer *notifyDataTimer;
@@ -37,6 +77,8 @@ public:
     DFileStatisticsJob::FileHints fileHints;
 
     DUrlList sourceUrlList;
+    // 暂停的线程在 stateMutex 上等待，修改状态后要加锁再唤醒，否则唤醒可能丢失
+    QMutex stateMutex;
     QWaitCondition waitCondition;
 
     QAtomicInteger<qint64> totalSize = 0;
@@ -44,8 +86,306 @@ public:
     QAtomicInteger<qint64> totalProgressSize = 0;
     QAtomicInt filesCount = 0;
     QAtomicInt directoryCount = 0;
+
+    // 没有连接时不必为每个文件构造 DUrl 并发送信号
+    bool notifyFileFound = false;
+    bool notifyDirectoryFound = false;
+    bool notifySizeChanged = false;
+
+    // 统计单个目录时监视遍历到的目录，供缓存使用
+    bool collectDirectories = false;
+    QMutex directoriesMutex;
+    QVector<int> walkedWatches;
+    bool walkCacheable = false;
 };
 
+/*!
+ * \brief The DFileStatisticsJobPrivate::LocalWalker class 多线程遍历本地目录
+ * 每个线程持有一个目录队列，优先处理自己队列末尾的目录（深度优先，局部性好），
+ * 自己的队列为空时从其它线程队列的头部窃取层级较浅的目录。
+ * 目录通过 open/getdents64/fstatat 读取，不创建文件信息对象；只在子目录的 st_dev 与父目录不同，
+ * 即跨越挂载点时才查询挂载信息。统计结果按目录汇总后再累加到任务的计数中。
+ */
+class DFileStatisticsJobPrivate::LocalWalker
+{
+public:
+    LocalWalker(DFileStatisticsJobPrivate *dd, int threadCount);
+
+    void push(int worker, const QByteArray &path);
+    void run(int worker);
+
+private:
+    struct WorkQueue {
+        QMutex mutex;
+        std::deque<QByteArray> directories;
+    };
+
+    struct Counter {
+        qint64 size = 0;
+        qint64 progressSize = 0;
+        int files = 0;
+        int directories = 0;
+    };
+
+    bool pop(int worker, QByteArray &path);
+    void processDirectory(int worker, const QByteArray &path, std::vector<char> &buffer);
+    void processEntry(int worker, int dirFd, dev_t dirDevice, const char *name,
+                      const QByteArray &filePath, Counter &counter);
+    void countFile(const struct stat &st, bool isSymLink, Counter &counter);
+    bool isSkippedMountPoint(const QByteArray &path) const;
+    bool markVisited(const struct stat &st);
+
+    DFileStatisticsJobPrivate *d;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    QAtomicInt pending = 0;   // 已入队但尚未处理完的目录数
+    QAtomicInt stopped = 0;
+    QMutex idleMutex;
+    QWaitCondition idleCondition;
+    QMutex visitedMutex;
+    QSet<QPair<quint64, quint64>> visited;   // 跟随符号链接进入的目录，避免链接成环时重复遍历
+};
+
+DFileStatisticsJobPrivate::LocalWalker::LocalWalker(DFileStatisticsJobPrivate *dd, int threadCount)
+    : d(dd)
+{
+    for (int i = 0; i < threadCount; ++i)
+        queues.emplace_back(new WorkQueue);
+}
+
+void DFileStatisticsJobPrivate::LocalWalker::push(int worker, const QByteArray &path)
+{
+    pending.ref();
+
+    WorkQueue *queue = queues[static_cast<size_t>(worker)].get();
+    {
+        QMutexLocker lk(&queue->mutex);
+        queue->directories.push_back(path);
+    }
+
+    idleCondition.wakeOne();
+}
+
+bool DFileStatisticsJobPrivate::LocalWalker::pop(int worker, QByteArray &path)
+{
+    WorkQueue *own = queues[static_cast<size_t>(worker)].get();
+    {
+        QMutexLocker lk(&own->mutex);
+        if (!own->directories.empty()) {
+            path = own->directories.back();
+            own->directories.pop_back();
+            return true;
+        }
+    }
+
+    const size_t count = queues.size();
+    for (size_t i = 1; i < count; ++i) {
+        WorkQueue *victim = queues[(static_cast<size_t>(worker) + i) % count].get();
+        QMutexLocker lk(&victim->mutex);
+        if (!victim->directories.empty()) {
+            path = victim->directories.front();
+            victim->directories.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DFileStatisticsJobPrivate::LocalWalker::run(int worker)
+{
+    std::vector<char> buffer(kDirentBufferSize);
+
+    forever {
+        QByteArray path;
+        if (pop(worker, path)) {
+            if (!stopped.loadAcquire()) {
+                if (d->stateCheck())
+                    processDirectory(worker, path, buffer);
+                else
+                    stopped.storeRelease(1);
+            }
+
+            // 最后一个目录处理完后唤醒所有空闲的线程退出
+            if (!pending.deref())
+                idleCondition.wakeAll();
+            continue;
+        }
+
+        QMutexLocker lk(&idleMutex);
+        if (pending.loadAcquire() == 0)
+            return;
+
+        idleCondition.wait(&idleMutex, kWalkerIdleWait);
+    }
+}
+
+void DFileStatisticsJobPrivate::LocalWalker::processDirectory(int worker, const QByteArray &path, std::vector<char> &buffer)
+{
+    const int fd = ::open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat dirStat;
+    if (::fstat(fd, &dirStat) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    // 读取目录前加入监视，之后目录中的变化都会使这次统计结果不被缓存
+    if (d->collectDirectories) {
+        QMutexLocker lk(&d->directoriesMutex);
+        if (d->walkCacheable) {
+            const int wd = DFileStatisticsCache::instance()->watchDirectory(path);
+            if (wd < 0)
+                d->walkCacheable = false;
+            else
+                d->walkedWatches << wd;
+        }
+    }
+
+    const QByteArray &prefix = path.endsWith('/') ? path : path + '/';
+    Counter counter;
+
+    forever {
+        const long length = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (length <= 0)
+            break;
+
+        for (long offset = 0; offset < length;) {
+            const linux_dirent64 *entry = reinterpret_cast<const linux_dirent64 *>(buffer.data() + offset);
+            offset += entry->d_reclen;
+
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            processEntry(worker, fd, dirStat.st_dev, name, prefix + name, counter);
+        }
+
+        if (stopped.loadAcquire())
+            break;
+    }
+
+    ::close(fd);
+
+    d->totalSize += counter.size;
+    d->totalProgressSize += counter.progressSize;
+    d->filesCount += counter.files;
+    d->directoryCount += counter.directories;
+
+    if (counter.size > 0 && d->notifySizeChanged)
+        Q_EMIT d->q_ptr->sizeChanged(d->totalSize);
+}
+
+void DFileStatisticsJobPrivate::LocalWalker::processEntry(int worker, int dirFd, dev_t dirDevice, const char *name,
+                                                          const QByteArray &filePath, Counter &counter)
+{
+    struct stat st;
+    if (::fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        return;
+
+    const DFileStatisticsJob::FileHints &fileHints = d->fileHints;
+
+    if (S_ISLNK(st.st_mode)) {
+        struct stat target;
+        const bool valid = ::fstatat(dirFd, name, &target, 0) == 0;
+        // 无效的链接与指向非目录的链接一样按文件统计
+        if (!valid || !S_ISDIR(target.st_mode)) {
+            if (valid && S_ISREG(target.st_mode) && !isKernelCoreFile(target))
+                countFile(target, true, counter);
+            else
+                counter.progressSize += FileUtils::getMemoryPageSize();
+            ++counter.files;
+            if (d->notifyFileFound)
+                Q_EMIT d->q_ptr->fileFound(DUrl::fromLocalFile(QFile::decodeName(filePath)));
+            return;
+        }
+
+        // fix bug 30548 ,以为有些文件大小为0,文件夹为空，size也为零，重新计算显示大小
+        counter.progressSize += FileUtils::getMemoryPageSize();
+        if (!fileHints.testFlag(DFileStatisticsJob::FollowSymlink)) {
+            ++counter.files;
+            if (d->notifyFileFound)
+                Q_EMIT d->q_ptr->fileFound(DUrl::fromLocalFile(QFile::decodeName(filePath)));
+            return;
+        }
+
+        ++counter.directories;
+        if (d->notifyDirectoryFound)
+            Q_EMIT d->q_ptr->directoryFound(DUrl::fromLocalFile(QFile::decodeName(filePath)));
+
+        if (markVisited(target))
+            push(worker, filePath);
+        return;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        // fix bug 30548 ,以为有些文件大小为0,文件夹为空，size也为零，重新计算显示大小
+        counter.progressSize += FileUtils::getMemoryPageSize();
+        ++counter.directories;
+        if (d->notifyDirectoryFound)
+            Q_EMIT d->q_ptr->directoryFound(DUrl::fromLocalFile(QFile::decodeName(filePath)));
+
+        // 设备号变化说明进入了新的挂载点，只有这时才需要判断文件系统类型
+        if (st.st_dev != dirDevice && isSkippedMountPoint(filePath))
+            return;
+
+        if (!fileHints.testFlag(DFileStatisticsJob::SingleDepth))
+            push(worker, filePath);
+        return;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        // ###(zccrs): skip the file,os file
+        if (!isKernelCoreFile(st))
+            countFile(st, false, counter);
+    } else if ((S_ISCHR(st.st_mode) && fileHints.testFlag(DFileStatisticsJob::DontSkipCharDeviceFile))
+               || (S_ISBLK(st.st_mode) && fileHints.testFlag(DFileStatisticsJob::DontSkipBlockDeviceFile))
+               || (S_ISFIFO(st.st_mode) && fileHints.testFlag(DFileStatisticsJob::DontSkipFIFOFile))
+               || (S_ISSOCK(st.st_mode) && fileHints.testFlag(DFileStatisticsJob::DontSkipSocketFile))) {
+        countFile(st, false, counter);
+    }
+
+    ++counter.files;
+    if (d->notifyFileFound)
+        Q_EMIT d->q_ptr->fileFound(DUrl::fromLocalFile(QFile::decodeName(filePath)));
+}
+
+void DFileStatisticsJobPrivate::LocalWalker::countFile(const struct stat &st, bool isSymLink, Counter &counter)
+{
+    const qint64 size = st.st_size;
+    if (size > 0)
+        counter.size += size;
+
+    // fix bug 30548 ,以为有些文件大小为0,文件夹为空，size也为零，重新计算显示大小
+    // fix bug 202007010033【文件管理器】【5.1.2.10-1】【sp2】复制软连接的文件，进度条显示1%
+    counter.progressSize += (size <= 0 || isSymLink) ? FileUtils::getMemoryPageSize() : size;
+}
+
+bool DFileStatisticsJobPrivate::LocalWalker::isSkippedMountPoint(const QByteArray &path) const
+{
+    const DFileStatisticsJob::FileHints &fileHints = d->fileHints;
+    if (fileHints & (DFileStatisticsJob::DontSkipAVFSDStorage | DFileStatisticsJob::DontSkipPROCStorage))
+        return false;
+
+    DStorageInfo si(QFile::decodeName(path));
+    if (si.rootPath() != QFile::decodeName(path))
+        return false;
+
+    return si.device() == "proc" || si.device() == "avfsd";
+}
+
+bool DFileStatisticsJobPrivate::LocalWalker::markVisited(const struct stat &st)
+{
+    QMutexLocker lk(&visitedMutex);
+    const QPair<quint64, quint64> key(static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino));
+    if (visited.contains(key))
+        return false;
+
+    visited.insert(key);
+    return true;
+}
+
 DFileStatisticsJobPrivate::DFileStatisticsJobPrivate(DFileStatisticsJob *qq)
     : q_ptr(qq)
     , notifyDataTimer(nullptr)
@@ -88,11 +428,10 @@ void DFileStatisticsJobPrivate::setState(DFileStatisticsJob::State s)
 
 bool DFileStatisticsJobPrivate::jobWait()
 {
-    QMutex lock;
-
-    lock.lock();
-    waitCondition.wait(&lock);
-    lock.unlock();
+    QMutexLocker lk(&stateMutex);
+    // 虚假唤醒时状态仍是暂停，需要继续等待
+    while (state == DFileStatisticsJob::PausedState)
+        waitCondition.wait(&stateMutex);
 
     return state == DFileStatisticsJob::RunningState;
 }
@@ -224,6 +563,79 @@ void DFileStatisticsJobPrivate::processFile(const DUrl &url, QQueue<DUrl> &direc
 
 }
 
+/*!
+ * \brief DFileStatisticsJobPrivate::walkLocalDirectories 多线程统计本地目录下的所有文件
+ * 当前线程也作为其中一个工作线程，返回时所有目录都已处理完毕或任务已被停止
+ */
+void DFileStatisticsJobPrivate::walkLocalDirectories(const QList<QByteArray> &directories)
+{
+    const int threadCount = qBound(1, QThread::idealThreadCount(), kMaxWalkerThreadCount);
+    LocalWalker walker(this, threadCount);
+    for (int i = 0; i < directories.size(); ++i)
+        walker.push(i % threadCount, directories.at(i));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int i = 1; i < threadCount; ++i)
+        QtConcurrent::run(&pool, [&walker, i] { walker.run(i); });
+
+    walker.run(0);
+    pool.waitForDone();
+}
+
+/*!
+ * \brief DFileStatisticsJobPrivate::countLocalDirectory 统计本地目录下的所有文件，优先使用缓存的结果
+ * 完整统计后的结果会加入缓存，目录树没有变化时再次统计可直接返回
+ */
+void DFileStatisticsJobPrivate::countLocalDirectory(const QByteArray &directory)
+{
+    // 只有这些参数会影响统计结果
+    const int hints = static_cast<int>(fileHints & (DFileStatisticsJob::FollowSymlink
+                                                    | DFileStatisticsJob::DontSkipAVFSDStorage
+                                                    | DFileStatisticsJob::DontSkipPROCStorage
+                                                    | DFileStatisticsJob::DontSkipCharDeviceFile
+                                                    | DFileStatisticsJob::DontSkipBlockDeviceFile
+                                                    | DFileStatisticsJob::DontSkipFIFOFile
+                                                    | DFileStatisticsJob::DontSkipSocketFile));
+    DFileStatisticsCache::Statistics statistics;
+    if (DFileStatisticsCache::instance()->find(directory, hints, statistics)) {
+        totalSize += statistics.totalSize;
+        totalProgressSize += statistics.totalProgressSize;
+        filesCount += statistics.filesCount;
+        directoryCount += statistics.directoryCount;
+
+        if (statistics.totalSize > 0 && notifySizeChanged)
+            Q_EMIT q_ptr->sizeChanged(totalSize);
+        return;
+    }
+
+    const qint64 oldTotalSize = totalSize;
+    const qint64 oldTotalProgressSize = totalProgressSize;
+    const int oldFilesCount = filesCount;
+    const int oldDirectoryCount = directoryCount;
+
+    walkedWatches.clear();
+    walkCacheable = true;
+    const quint64 walkSerial = DFileStatisticsCache::instance()->beginWalk();
+    collectDirectories = true;
+    walkLocalDirectories({directory});
+    collectDirectories = false;
+
+    // 被停止的统计结果不完整，超过监视数量上限的目录树无法保证缓存有效
+    if (state == DFileStatisticsJob::StoppedState || !walkCacheable) {
+        DFileStatisticsCache::instance()->releaseWatches(walkedWatches);
+        walkedWatches.clear();
+        return;
+    }
+
+    statistics.totalSize = totalSize - oldTotalSize;
+    statistics.totalProgressSize = totalProgressSize - oldTotalProgressSize;
+    statistics.filesCount = filesCount - oldFilesCount;
+    statistics.directoryCount = directoryCount - oldDirectoryCount;
+    DFileStatisticsCache::instance()->insert(directory, hints, statistics, walkedWatches, walkSerial);
+    walkedWatches.clear();
+}
+
 DFileStatisticsJob::DFileStatisticsJob(QObject *parent)
     : QThread(parent)
     , d_ptr(new DFileStatisticsJobPrivate(this))
@@ -330,6 +742,8 @@ void DFileStatisticsJob::stop()
     }
 
     d->setState(StoppedState);
+
+    QMutexLocker lk(&d->stateMutex);
     d->waitCondition.wakeAll();
 }
 
@@ -343,6 +757,8 @@ void DFileStatisticsJob::togglePause()
 
     if (d->state == PausedState) {
         d->setState(RunningState);
+
+        QMutexLocker lk(&d->stateMutex);
         d->waitCondition.wakeAll();
     } else {
         d->setState(PausedState);
@@ -365,6 +781,9 @@ void DFileStatisticsJob::run()
     d_ptr->totalSize = 0;
     d_ptr->filesCount = 0;
     d_ptr->directoryCount = 0;
+    d_ptr->notifyFileFound = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::fileFound));
+    d_ptr->notifyDirectoryFound = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::directoryFound));
+    d_ptr->notifySizeChanged = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::sizeChanged));
 
     Q_EMIT dataNotify(0, 0, 0);
 
@@ -429,6 +848,37 @@ void DFileStatisticsJob::run()
         return;
     }
 
+    // 本地目录不经过文件信息对象，直接多线程遍历
+    QList<QByteArray> local_directories;
+    for (auto it = directory_queue.begin(); it != directory_queue.end();) {
+        if (it->isLocalFile()) {
+            local_directories << QFile::encodeName(it->toLocalFile());
+            it = directory_queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!local_directories.isEmpty()) {
+        if (d->notifyFileFound || d->notifyDirectoryFound) {
+            // 需要逐个通知找到的文件时不能使用缓存
+            d->walkLocalDirectories(local_directories);
+        } else {
+            for (const QByteArray &directory : local_directories) {
+                d->countLocalDirectory(directory);
+
+                if (d->state == StoppedState)
+                    break;
+            }
+        }
+
+        if (!d->stateCheck()) {
+            d->setState(StoppedState);
+
+            return;
+        }
+    }
+
     while (!directory_queue.isEmpty()) {
         const DUrl &directory_url = directory_queue.dequeue();
         const DDirIteratorPointer &iterator = DFileService::instance()->createDirIterator(nullptr, directory_url, QStringList(),
@@ -6,6 +6,21 @@
 #include "private/dlocalfiledevice_p.h"
 
 #include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+
+namespace {
+// 以下错误表示当前的复制方式不适用于这对文件，应换用下一种方式
+bool isUnsupportedError(int error)
+{
+    return error == EXDEV || error == ENOSYS || error == EOPNOTSUPP || error == ENOTTY
+            || error == EINVAL || error == EBADF || error == EPERM;
+}
+}
 
 DFM_BEGIN_NAMESPACE
 
@@ -38,6 +53,7 @@ bool DLocalFileDevice::setFileUrl(const DUrl &url)
     QString filename = url.toLocalFile();
 
     d->file->setFileName(filename);
+    d->copyMethod = ReflinkCopy;
 
     return DFileDevice::setFileUrl(url);
 }
@@ -100,4 +116,86 @@ bool DLocalFileDevice::syncToDisk(bool isVfat)
     return true;
 }
 
+/*!
+ * \brief DLocalFileDevice::copyFrom 在内核中把 from 当前位置起最多 maxSize 字节的数据复制到此文件的当前位置
+ * 依次尝试 FICLONE（只在两个文件都位于开头时尝试一次）、copy_file_range、sendfile，
+ * 当前方式不适用于这对文件时自动换用下一种，两个文件的位置都会前移复制的字节数
+ * \return 复制的字节数，0 表示源文件已经读完，-1 表示出错或没有可用的方式，调用者应从当前位置起读写复制
+ */
+qint64 DLocalFileDevice::copyFrom(DLocalFileDevice *from, qint64 maxSize)
+{
+    Q_D(DLocalFileDevice);
+
+    const int fromFd = from ? from->handle() : -1;
+    const int toFd = handle();
+    if (fromFd < 0 || toFd < 0 || maxSize <= 0)
+        return -1;
+
+    // 大小为 0 的文件可能是 proc 等文件系统中的文件，内核复制会直接返回 0
+    struct stat fromStat;
+    if (::fstat(fromFd, &fromStat) != 0 || !S_ISREG(fromStat.st_mode) || fromStat.st_size <= 0) {
+        d->copyMethod = BufferedCopy;
+        return -1;
+    }
+
+    if (d->copyMethod == ReflinkCopy) {
+        d->copyMethod = RangeCopy;
+#ifdef FICLONE
+        if (::lseek(fromFd, 0, SEEK_CUR) == 0 && ::lseek(toFd, 0, SEEK_CUR) == 0
+                && ::ioctl(toFd, FICLONE, fromFd) == 0) {
+            ::lseek(fromFd, fromStat.st_size, SEEK_SET);
+            ::lseek(toFd, fromStat.st_size, SEEK_SET);
+            d->copyMethod = ReflinkCopy;
+            return fromStat.st_size;
+        }
+#endif
+    }
+
+    // 内核每次最多复制 0x7ffff000 字节
+    const size_t size = static_cast<size_t>(qMin<qint64>(maxSize, 0x7ffff000));
+
+#ifdef SYS_copy_file_range
+    if (d->copyMethod == RangeCopy) {
+        const qint64 copied = ::syscall(SYS_copy_file_range, fromFd, nullptr, toFd, nullptr, size, 0);
+        if (copied > 0)
+            return copied;
+
+        if (copied == 0 && ::lseek(fromFd, 0, SEEK_CUR) >= fromStat.st_size)
+            return 0;
+
+        if (copied < 0 && !isUnsupportedError(errno)) {
+            setErrorString(QString::fromLocal8Bit(strerror(errno)));
+            return -1;
+        }
+
+        d->copyMethod = SendFileCopy;
+    }
+#else
+    if (d->copyMethod == RangeCopy)
+        d->copyMethod = SendFileCopy;
+#endif
+
+    if (d->copyMethod == SendFileCopy) {
+        const qint64 copied = ::sendfile(toFd, fromFd, nullptr, size);
+        if (copied >= 0)
+            return copied;
+
+        if (!isUnsupportedError(errno)) {
+            setErrorString(QString::fromLocal8Bit(strerror(errno)));
+            return -1;
+        }
+
+        d->copyMethod = BufferedCopy;
+    }
+
+    return -1;
+}
+
+DLocalFileDevice::CopyMethod DLocalFileDevice::copyMethod() const
+{
+    Q_D(const DLocalFileDevice);
+
+    return d->copyMethod;
+}
+
 DFM_END_NAMESPACE
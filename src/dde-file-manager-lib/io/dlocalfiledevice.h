@@ -15,6 +15,13 @@ class DLocalFileDevice : public DFileIODeviceProxy
     Q_DECLARE_PRIVATE(DLocalFileDevice)
 
 public:
+    enum CopyMethod {
+        ReflinkCopy,    // FICLONE，同一个支持写时复制的文件系统内只共享数据块
+        RangeCopy,      // copy_file_range，数据不经过用户空间
+        SendFileCopy,   // sendfile
+        BufferedCopy    // 以上方式都不可用，由调用者读写复制
+    };
+
     explicit DLocalFileDevice(QObject *parent = nullptr);
 
     bool setFileUrl(const DUrl &url) override;
@@ -25,6 +32,9 @@ public:
     bool flush() override;
     bool syncToDisk(bool isVfat = false) override;
 
+    qint64 copyFrom(DLocalFileDevice *from, qint64 maxSize);
+    CopyMethod copyMethod() const;
+
 private:
     using DFileIODeviceProxy::setDevice;
 };
@@ -0,0 +1,425 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "duringfilecopier.h"
+
+#include <QDebug>
+
+#ifdef DFM_ENABLE_IO_URING
+#include <liburing.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+DFM_BEGIN_NAMESPACE
+
+namespace {
+static const qint64 kMaxFileSize = 256 * 1024;   // 可以批量拷贝的最大文件
+static const int kBufferAlignment = 4096;
+// 缓冲区比最大文件多一页，读满时说明文件在拷贝前变大了，交给调用者按普通方式拷贝
+static const qint64 kBufferSize = kMaxFileSize + kBufferAlignment;
+
+enum Stage {
+    kIdle,
+    kOpenSource,
+    kOpenTarget,
+    kRead,
+    kWrite,
+    kSync,
+    kCloseSource,
+    kCloseTarget
+};
+
+struct Slot {
+    int task = -1;
+    Stage stage = kIdle;
+    int sourceFd = -1;
+    int targetFd = -1;
+    int error = 0;
+    qint64 length = 0;   // 已读入缓冲区的大小
+    qint64 requested = 0;   // 最近一次读请求的大小
+    qint64 written = 0;
+    char *buffer = nullptr;
+};
+}
+
+class DUringFileCopierPrivate
+{
+public:
+    ~DUringFileCopierPrivate();
+
+#ifdef DFM_ENABLE_IO_URING
+    struct io_uring ring;
+
+    bool submit(Slot *slot, const QVector<DUringFileCopier::Task> &tasks);
+    void complete(Slot *slot, int result, bool canceled, const DUringFileCopier::Task &task);
+    void abort(Slot *slot, int error);
+#endif
+
+    bool valid = false;
+    bool syncToDisk = false;
+    QVector<Slot> slotList;
+    char *buffers = nullptr;
+};
+
+DUringFileCopierPrivate::~DUringFileCopierPrivate()
+{
+#ifdef DFM_ENABLE_IO_URING
+    if (valid)
+        io_uring_queue_exit(&ring);
+#endif
+    free(buffers);
+}
+
+#ifdef DFM_ENABLE_IO_URING
+/*!
+ * \brief DUringFileCopierPrivate::submit 为 slot 当前所处的阶段准备一个请求
+ * 每个 slot 同时只有一个请求，队列的大小不小于 slot 的数量，正常情况下不会取不到 sqe
+ */
+bool DUringFileCopierPrivate::submit(Slot *slot, const QVector<DUringFileCopier::Task> &tasks)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+    if (!sqe)
+        return false;
+
+    const DUringFileCopier::Task &task = tasks.at(slot->task);
+    switch (slot->stage) {
+    case kOpenSource:
+        io_uring_prep_openat(sqe, AT_FDCWD, task.source.constData(), O_RDONLY | O_CLOEXEC, 0);
+        break;
+    case kOpenTarget:
+        io_uring_prep_openat(sqe, AT_FDCWD, task.target.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        break;
+    case kRead:
+        slot->requested = kBufferSize - slot->length;
+        io_uring_prep_read(sqe, slot->sourceFd, slot->buffer + slot->length,
+                           static_cast<unsigned>(slot->requested), static_cast<__u64>(slot->length));
+        break;
+    case kWrite:
+        io_uring_prep_write(sqe, slot->targetFd, slot->buffer + slot->written,
+                            static_cast<unsigned>(slot->length - slot->written), static_cast<__u64>(slot->written));
+        break;
+    case kSync:
+        io_uring_prep_fsync(sqe, slot->targetFd, 0);
+        break;
+    case kCloseSource:
+        io_uring_prep_close(sqe, slot->sourceFd);
+        break;
+    case kCloseTarget:
+        io_uring_prep_close(sqe, slot->targetFd);
+        break;
+    case kIdle:
+        return false;
+    }
+
+    io_uring_sqe_set_data(sqe, slot);
+    return true;
+}
+
+/*!
+ * \brief DUringFileCopierPrivate::complete 处理 slot 的一个请求的结果，推进到下一个阶段
+ * 出错或被取消后不再读写，直接关闭已经打开的文件；两个文件都关闭后 slot 回到 kIdle
+ */
+void DUringFileCopierPrivate::complete(Slot *slot, int result, bool canceled, const DUringFileCopier::Task &task)
+{
+    auto closeFiles = [slot] {
+        if (slot->sourceFd >= 0)
+            slot->stage = kCloseSource;
+        else if (slot->targetFd >= 0)
+            slot->stage = kCloseTarget;
+        else
+            slot->stage = kIdle;
+    };
+
+    if (result < 0 && slot->error == 0)
+        slot->error = -result;
+    if (canceled && slot->error == 0)
+        slot->error = ECANCELED;
+
+    switch (slot->stage) {
+    case kOpenSource:
+        if (result >= 0)
+            slot->sourceFd = result;
+        if (slot->error == 0)
+            slot->stage = kOpenTarget;
+        else
+            closeFiles();
+        break;
+    case kOpenTarget:
+        if (result >= 0)
+            slot->targetFd = result;
+        if (slot->error == 0)
+            slot->stage = kRead;
+        else
+            closeFiles();
+        break;
+    case kRead:
+        if (slot->error == 0) {
+            slot->length += result;
+            if (slot->length >= kBufferSize) {
+                slot->error = EFBIG;
+                closeFiles();
+            } else if (result > 0 && (slot->length < task.size || result == slot->requested)) {
+                // 还没读到拷贝前的文件大小，或读满了请求的大小时继续读；否则已到文件末尾，省去一次确认末尾的读请求
+                slot->stage = kRead;
+            } else if (slot->length > 0) {
+                slot->stage = kWrite;
+            } else {
+                slot->stage = syncToDisk ? kSync : kCloseSource;
+            }
+        } else {
+            closeFiles();
+        }
+        break;
+    case kWrite:
+        if (slot->error == 0 && result == 0)
+            slot->error = EIO;
+        if (slot->error == 0) {
+            slot->written += result;
+            if (slot->written < slot->length)
+                slot->stage = kWrite;
+            else
+                slot->stage = syncToDisk ? kSync : kCloseSource;
+        } else {
+            closeFiles();
+        }
+        break;
+    case kSync:
+        closeFiles();
+        break;
+    case kCloseSource:
+        slot->sourceFd = -1;
+        closeFiles();
+        break;
+    case kCloseTarget:
+        slot->targetFd = -1;
+        slot->stage = kIdle;
+        break;
+    case kIdle:
+        break;
+    }
+}
+
+/*!
+ * \brief DUringFileCopierPrivate::abort 请求无法提交时结束 slot，已经打开的文件直接关闭
+ */
+void DUringFileCopierPrivate::abort(Slot *slot, int error)
+{
+    if (slot->error == 0)
+        slot->error = error;
+    if (slot->sourceFd >= 0)
+        ::close(slot->sourceFd);
+    if (slot->targetFd >= 0)
+        ::close(slot->targetFd);
+
+    slot->sourceFd = -1;
+    slot->targetFd = -1;
+    slot->stage = kIdle;
+}
+#endif
+
+/*!
+ * \brief DUringFileCopier::DUringFileCopier
+ * \param maxFilesInFlight 同时处理的最大文件数量，每个文件占用一块 maxFileSize() 大小的缓冲区
+ */
+DUringFileCopier::DUringFileCopier(int maxFilesInFlight)
+    : d_ptr(new DUringFileCopierPrivate())
+{
+#ifdef DFM_ENABLE_IO_URING
+    Q_D(DUringFileCopier);
+
+    const int count = qMax(1, maxFilesInFlight);
+    void *buffers = nullptr;
+    if (posix_memalign(&buffers, kBufferAlignment, static_cast<size_t>(kBufferSize * count)) != 0)
+        return;
+    d->buffers = static_cast<char *>(buffers);
+
+    int ret = io_uring_queue_init(static_cast<unsigned>(count), &d->ring, 0);
+    if (ret < 0) {
+        qWarning() << "io_uring init failed:" << strerror(-ret);
+        return;
+    }
+
+    d->slotList.resize(count);
+    for (int i = 0; i < count; ++i)
+        d->slotList[i].buffer = d->buffers + kBufferSize * i;
+    d->valid = true;
+#else
+    Q_UNUSED(maxFilesInFlight)
+#endif
+}
+
+DUringFileCopier::~DUringFileCopier()
+{
+
+}
+
+/*!
+ * \brief DUringFileCopier::isSupported 当前系统是否可以使用 io_uring 拷贝文件，结果只检测一次
+ */
+bool DUringFileCopier::isSupported()
+{
+#ifdef DFM_ENABLE_IO_URING
+    static const bool supported = []() -> bool {
+        struct io_uring ring;
+        if (io_uring_queue_init(2, &ring, 0) < 0)
+            return false;
+
+        bool ok = false;
+        struct io_uring_probe *probe = io_uring_get_probe_ring(&ring);
+        if (probe) {
+            ok = io_uring_opcode_supported(probe, IORING_OP_OPENAT)
+                    && io_uring_opcode_supported(probe, IORING_OP_READ)
+                    && io_uring_opcode_supported(probe, IORING_OP_WRITE)
+                    && io_uring_opcode_supported(probe, IORING_OP_FSYNC)
+                    && io_uring_opcode_supported(probe, IORING_OP_CLOSE);
+            io_uring_free_probe(probe);
+        }
+        io_uring_queue_exit(&ring);
+
+        qInfo() << "io_uring file copy supported:" << ok;
+        return ok;
+    }();
+
+    return supported;
+#else
+    return false;
+#endif
+}
+
+qint64 DUringFileCopier::maxFileSize()
+{
+    return kMaxFileSize;
+}
+
+bool DUringFileCopier::isValid() const
+{
+    Q_D(const DUringFileCopier);
+
+    return d->valid;
+}
+
+/*!
+ * \brief DUringFileCopier::setSyncToDisk 写入后是否同步到磁盘，默认不同步
+ */
+void DUringFileCopier::setSyncToDisk(bool sync)
+{
+    Q_D(DUringFileCopier);
+
+    d->syncToDisk = sync;
+}
+
+/*!
+ * \brief DUringFileCopier::copy 拷贝 tasks 中的所有文件，阻塞到全部完成或被取消
+ * 目标文件已存在时会被覆盖，文件时间和权限不在这里处理。
+ * \param tasks 待拷贝的文件，size 为拷贝前源文件的大小，完成后 error 和 copiedSize 记录每个文件的结果
+ * \param isRunning 返回 false 时不再开始新的文件，正在拷贝的文件以 ECANCELED 结束
+ * \param finished 每个文件结束（成功或失败）时以其在 tasks 中的下标调用，调用在当前线程
+ * \return ring 不可用时返回 false，此时 error 不为 0 的文件可能未处理，调用者应按原有方式重新拷贝
+ */
+bool DUringFileCopier::copy(QVector<Task> &tasks, const std::function<bool()> &isRunning,
+                            const std::function<void(int)> &finished)
+{
+    Q_D(DUringFileCopier);
+
+    if (!d->valid)
+        return false;
+
+#ifdef DFM_ENABLE_IO_URING
+    int next = 0;
+    int inFlight = 0;
+    bool canceled = false;
+
+    auto finishSlot = [&tasks, &finished](const Slot &slot) {
+        Task &task = tasks[slot.task];
+        task.error = slot.error;
+        task.copiedSize = slot.error == 0 ? slot.written : 0;
+        if (finished)
+            finished(slot.task);
+    };
+
+    // 取不到 sqe 时 slot 不会再有完成事件，文件以 EBUSY 失败，由调用者按原有方式重新拷贝
+    auto submitSlot = [&](Slot &slot) {
+        if (d->submit(&slot, tasks)) {
+            ++inFlight;
+            return;
+        }
+
+        qWarning() << "io_uring submission queue is full";
+        d->abort(&slot, EBUSY);
+        finishSlot(slot);
+    };
+
+    while (inFlight > 0 || (next < tasks.size() && !canceled)) {
+        if (!canceled && isRunning && !isRunning())
+            canceled = true;
+
+        // 空闲的 slot 开始拷贝新的文件
+        for (Slot &slot : d->slotList) {
+            if (canceled || next >= tasks.size())
+                break;
+            if (slot.stage != kIdle)
+                continue;
+
+            slot.task = next++;
+            slot.stage = kOpenSource;
+            slot.sourceFd = -1;
+            slot.targetFd = -1;
+            slot.error = 0;
+            slot.length = 0;
+            slot.written = 0;
+            submitSlot(slot);
+        }
+
+        if (inFlight <= 0)
+            break;
+
+        int ret = io_uring_submit_and_wait(&d->ring, 1);
+        if (ret < 0 && ret != -EINTR) {
+            // ring 出错后无法得知请求的状态，正在拷贝的文件都视为失败，已打开的文件描述符只能泄露
+            qWarning() << "io_uring submit failed:" << strerror(-ret);
+            for (Slot &slot : d->slotList) {
+                if (slot.stage == kIdle)
+                    continue;
+                tasks[slot.task].error = -ret;
+                slot.stage = kIdle;
+            }
+            io_uring_queue_exit(&d->ring);
+            d->valid = false;
+            break;
+        }
+
+        struct io_uring_cqe *cqe = nullptr;
+        while (io_uring_peek_cqe(&d->ring, &cqe) == 0 && cqe) {
+            Slot *slot = static_cast<Slot *>(io_uring_cqe_get_data(cqe));
+            const int result = cqe->res;
+            io_uring_cqe_seen(&d->ring, cqe);
+            --inFlight;
+
+            d->complete(slot, result, canceled, tasks.at(slot->task));
+            if (slot->stage != kIdle)
+                submitSlot(*slot);
+            else
+                finishSlot(*slot);
+        }
+    }
+
+    // 被取消或 ring 出错时未开始的文件
+    for (int i = next; i < tasks.size(); ++i)
+        tasks[i].error = ECANCELED;
+
+    return d->valid;
+#else
+    Q_UNUSED(tasks)
+    Q_UNUSED(isRunning)
+    Q_UNUSED(finished)
+    return false;
+#endif
+}
+
+DFM_END_NAMESPACE
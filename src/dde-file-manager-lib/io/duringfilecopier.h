@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DURINGFILECOPIER_H
+#define DURINGFILECOPIER_H
+
+#include <dfmglobal.h>
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <functional>
+
+DFM_BEGIN_NAMESPACE
+
+class DUringFileCopierPrivate;
+
+/*!
+ * \brief The DUringFileCopier class 基于 io_uring 批量拷贝本地小文件
+ * 每个文件的打开、读、写、同步和关闭都以异步请求提交到同一个 ring 中，同时处理多个文件，
+ * 避免逐个文件的系统调用和线程切换开销。文件内容一次读入预先分配的缓冲区，只适用于不超过
+ * maxFileSize() 的文件。编译时没有 liburing 或运行时内核不支持时 isSupported() 返回 false，
+ * 调用者应退回到原有的拷贝方式。
+ */
+class DUringFileCopier
+{
+public:
+    struct Task {
+        QByteArray source;
+        QByteArray target;
+        qint64 size = 0;   // 拷贝前源文件的大小
+        int error = 0;   // 0 表示拷贝成功，否则为 errno
+        qint64 copiedSize = 0;   // 实际拷贝的大小
+    };
+
+    explicit DUringFileCopier(int maxFilesInFlight = 128);
+    ~DUringFileCopier();
+
+    static bool isSupported();
+    static qint64 maxFileSize();
+
+    bool isValid() const;
+    void setSyncToDisk(bool sync);
+
+    bool copy(QVector<Task> &tasks, const std::function<bool()> &isRunning,
+              const std::function<void(int)> &finished = nullptr);
+
+private:
+    Q_DISABLE_COPY(DUringFileCopier)
+    QScopedPointer<DUringFileCopierPrivate> d_ptr;
+    Q_DECLARE_PRIVATE(DUringFileCopier)
+};
+
+DFM_END_NAMESPACE
+
+#endif // DURINGFILECOPIER_H
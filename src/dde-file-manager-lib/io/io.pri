@@ -4,10 +4,13 @@ HEADERS += \
     $$PWD/dlocalfiledevice.h \
     $$PWD/dfileiodeviceproxy.h \
     $$PWD/dfilecopymovejob.h \
+    $$PWD/dfilecopyjournal.h \
     $$PWD/dfilehandler.h \
     $$PWD/dfiledevice.h \
     $$PWD/dlocalfilehandler.h \
     $$PWD/dfilestatisticsjob.h \
+    $$PWD/dfilestatisticscache.h \
+    $$PWD/duringfilecopier.h \
     $$PWD/dstorageinfo.h \
     $$PWD/dgiofiledevice.h
 
@@ -15,11 +18,20 @@ SOURCES += \
     $$PWD/dlocalfiledevice.cpp \
     $$PWD/dfileiodeviceproxy.cpp \
     $$PWD/dfilecopymovejob.cpp \
+    $$PWD/dfilecopyjournal.cpp \
     $$PWD/dfilehandler.cpp \
     $$PWD/dfiledevice.cpp \
     $$PWD/dlocalfilehandler.cpp \
     $$PWD/dfilestatisticsjob.cpp \
+    $$PWD/dfilestatisticscache.cpp \
+    $$PWD/duringfilecopier.cpp \
     $$PWD/dstorageinfo.cpp \
     $$PWD/dgiofiledevice.cpp
 
+# io_uring 批量拷贝小文件，没有 liburing 时退回到线程池拷贝
+packagesExist(liburing) {
+    PKGCONFIG += liburing
+    DEFINES += DFM_ENABLE_IO_URING
+}
+
 include(private/private.pri)
@@ -19,9 +19,12 @@
 #include <QQueue>
 #include <QFileDevice>
 
+#include <functional>
+
 #include <fcntl.h>
 
 #include "dfiledevice.h"
+#include "dfilecopyjournal.h"
 
 typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
 
@@ -104,6 +107,42 @@ public:
 
     typedef QSharedPointer<FileCopyInfo> FileCopyInfoPointer;
 
+    /*!
+     * \brief The FileCopyRing class 读线程与写线程之间的单生产者单消费者环形队列
+     * 每个位置都有一块预先分配、按页对齐的缓冲区，读线程直接读入其中，写线程写完后归还。
+     * 只在队列满（读线程）或空（写线程）时等待，入队出队本身不加锁。
+     */
+    class FileCopyRing
+    {
+    public:
+        FileCopyRing(int capacity, qint64 bufferSize);
+        ~FileCopyRing();
+
+        qint64 bufferSize() const;
+        bool isEmpty() const;
+        //读线程：取得队尾的空闲位置，队列满时等待，isRunning 返回 false 时返回空
+        FileCopyInfo *reserve(const std::function<bool()> &isRunning);
+        void commit();
+        //写线程：取得队首，队列空时最多等待 timeout 毫秒
+        FileCopyInfo *front(unsigned long timeout);
+        void pop();
+        void clear();
+
+    private:
+        Q_DISABLE_COPY(FileCopyRing)
+
+        QVector<FileCopyInfo> items;
+        char *buffers = nullptr;
+        qint64 m_bufferSize;
+        QAtomicInteger<quint32> head = 0;   // 写线程已经取走的数量
+        QAtomicInteger<quint32> tail = 0;   // 读线程已经放入的数量
+        QAtomicInt producerWaiting = 0;
+        QAtomicInt consumerWaiting = 0;
+        QMutex waitMutex;
+        QWaitCondition notFull;
+        QWaitCondition notEmpty;
+    };
+
     explicit DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq);
     ~DFileCopyMoveJobPrivate();
 
@@ -140,8 +179,21 @@ public:
     bool doCopySmallFilesOnDisk(const DAbstractFileInfoPointer fromInfo, const DAbstractFileInfoPointer toInfo,
                                 const QSharedPointer<DFileDevice> &fromDevice, const QSharedPointer<DFileDevice> &toDevice,
                                 const QSharedPointer<DFileHandler> &handler);
+    //本地文件之间在内核中拷贝
+    bool copyFileByKernel(const DAbstractFileInfoPointer &fromInfo, const QSharedPointer<DFileDevice> &fromDevice,
+                          const QSharedPointer<DFileDevice> &toDevice);
     //线程池中拷贝大量小文件
     bool doThreadPoolCopyFile();
+    void enqueueThreadPoolCopyFile(const QSharedPointer<ThreadCopyInfo> &threadInfo);
+    //用 io_uring 批量拷贝小文件
+    bool canCopyByUring(const DAbstractFileInfoPointer &fromInfo) const;
+    void flushUringBatch();
+    void doUringCopyFiles(const QList<QSharedPointer<ThreadCopyInfo>> &batch);
+    //拷贝完成后设置目标文件的时间和权限
+    void setTargetFileAttributes(const DAbstractFileInfoPointer &fromInfo, const DAbstractFileInfoPointer &toInfo,
+                                 const QSharedPointer<DFileHandler> &handler);
+    //以 O_DIRECT 拷贝大文件到块设备
+    bool doCopyFileDirect(const DAbstractFileInfoPointer fromInfo, const DAbstractFileInfoPointer toInfo, const QSharedPointer<DFileHandler> &handler, int blockSize = 1048576);
     //拷贝文件到块设备（除光驱和系统所在的磁盘）
     bool doCopyFileOnBlock(const DAbstractFileInfoPointer fromInfo, const DAbstractFileInfoPointer toInfo, const QSharedPointer<DFileHandler> &handler, int blockSize = 1048576);
     bool doRemoveFile(const QSharedPointer<DFileHandler> &handler, const DAbstractFileInfoPointer fileInfo,
@@ -166,8 +218,13 @@ public:
     void endJob(const bool isNew = false);
     void enterDirectory(const DUrl from, const DUrl to);
     void leaveDirectory();
-    void joinToCompletedFileList(const DUrl from, const DUrl target, qint64 dataSize);
-    void joinToCompletedDirectoryList(const DUrl from, const DUrl target, qint64 dataSize);
+    void joinToCompletedFileList(const DUrl from, const DUrl target, qint64 dataSize, qint64 lastModified = 0);
+    void joinToCompletedDirectoryList(const DUrl from, const DUrl target, qint64 dataSize, qint64 lastModified = 0);
+    //断点续传
+    void openJournal();
+    void closeJournal();
+    bool skipJournalCompleted(const DUrl &from, const DAbstractFileInfoPointer &sourceInfo, const DAbstractFileInfoPointer &targetInfo);
+    bool isJournalCreatedDirectory(const DUrl &from, const DAbstractFileInfoPointer &toInfo) const;
     void updateProgress();
     void updateCopyProgress();
     void updateMoveProgress();
@@ -185,15 +242,15 @@ public:
     void checkTagetNeedSync();//检测目标目录是网络文件就每次拷贝去同步，否则网络很卡时会因为同步卡死
     void checkTagetIsFromBlockDevice();//检查目标文件是否是块设备
     bool checkWritQueueEmpty();
-    bool checkWritQueueCount();
-    QSharedPointer<FileCopyInfo> writeQueueDequeue();
-    void writeQueueEnqueue(const QSharedPointer<FileCopyInfo> &copyinfo);
+    FileCopyInfo *writeQueueReserve();
+    void writeQueueCommit();
+    void startWriteRefineThread();
     //错误队列处理
     void errorQueueHandling();
     //当前错误队列处理完成
     void errorQueueHandled(const bool &isNotCancel = true);
-    //清理当前拷贝信息
-    void releaseCopyInfo(const FileCopyInfoPointer &info);
+    //关闭写线程打开的文件
+    void releaseCopyInfo();
     /**
      * @brief setCutTrashData    保存剪切回收站文件路径
      * @param fileNameList       文件路径
@@ -267,7 +324,9 @@ public:
     qint64 m_tatol = 0;
     qint64 m_sart = 0;
 
-    QQueue<FileCopyInfoPointer> m_writeFileQueue;
+    //读写线程之间的队列，第一次使用时在任务线程中创建
+    QScopedPointer<FileCopyRing> m_writeRing;
+    QAtomicPointer<QThread> m_writeThread;
     QAtomicInt m_copyRefineFlag = DFileCopyMoveJob::NoProccess;
     QFuture<void> m_writeResult, m_syncResult;
 
@@ -338,8 +397,6 @@ public:
     QQueue<DUrl> m_skipFileQueue;
     //目标文件是否是gvfs目录
     QAtomicInteger<bool> m_isTagGvfsFile = false;
-    //拷贝信息的队列锁
-    QMutex m_copyInfoQueueMutex;
     QMutex m_skipFileQueueMutex;
     //当前拷贝的device
     QMap<DUrl,QSharedPointer<DFileDevice>> m_currentDevice;
@@ -364,6 +421,11 @@ public:
     QMutex m_clearThreadPoolMutex;
     QQueue<QSharedPointer<ThreadCopyInfo>> m_threadInfos;
     QMutex m_threadMutex;
+    //等待 io_uring 批量拷贝的小文件，只在任务线程中访问
+    bool m_isUringSupported = false;
+    QList<QSharedPointer<ThreadCopyInfo>> m_uringBatch;
+    //断点续传的日志，复制和剪切任务中打开，只在任务线程中访问
+    QScopedPointer<DFileCopyJournal> m_journal;
     QList<QPair<DUrl,DUrl>> m_emitUrl;
     QMutex m_emitUrlMutex;
 
@@ -6,6 +6,7 @@
 #define DLOCALFILEDEVICE_P_H
 
 #include "dfileiodeviceproxy_p.h"
+#include "dlocalfiledevice.h"
 
 DFM_BEGIN_NAMESPACE
 
@@ -17,6 +18,7 @@ public:
     ~DLocalFileDevicePrivate() override;
 
     QPointer<QFile> file = nullptr;
+    DLocalFileDevice::CopyMethod copyMethod = DLocalFileDevice::ReflinkCopy;
 
     Q_DECLARE_PUBLIC(DLocalFileDevice)
 };
@@ -4,17 +4,26 @@
 
 #include "maincontroller.h"
 #include "fulltext/fulltextsearcher.h"
+#include "fulltext/fulltextindexmanager.h"
+#include "fsearch/fsdatabasemanager.h"
+#include "dfmapplication.h"
 
 #include <QFileSystemWatcher>
 #include <QApplication>
 #include <QtConcurrent>
+#include <QPointer>
 #include <QUrl>
 #include <QDir>
 #include <QDebug>
 
 MainController::MainController(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      fsDatabaseManager(new FsDatabaseManager(this)),
+      fullTextIndexManager(new FullTextIndexManager(this))
 {
+    // 已经建立的全文索引通过文件变化事件维护，旧版本结构的索引在后台重建
+    if (qAppName() == "dde-file-manager" && DFMApplication::genericAttribute(DFMApplication::GA_IndexFullTextSearch).toBool())
+        createFullTextIndex();
 }
 
 MainController::~MainController()
@@ -43,7 +52,7 @@ bool MainController::doSearchTask(QString taskId, const DUrl &url, const QString
     if (taskManager.contains(taskId))
         stop(taskId);
 
-    auto task = new TaskCommander(taskId, url, keyword);
+    auto task = new TaskCommander(taskId, url, keyword, fsDatabaseManager, fullTextIndexManager);
     qInfo() << "new task: " << task << task->taskID();
     Q_ASSERT(task);
     taskManager.insert(taskId, task);
@@ -71,9 +80,11 @@ QList<DUrl> MainController::getResults(QString taskId)
 void MainController::createFullTextIndex()
 {
     if (!indexFuture.isRunning()) {
-        indexFuture = QtConcurrent::run([]() {
+        QPointer<FullTextIndexManager> manager = fullTextIndexManager;
+        indexFuture = QtConcurrent::run([manager]() {
             FullTextSearcher searcher(DUrl(), "");
-            searcher.createIndex("/");
+            if (searcher.createIndex("/") && manager)
+                QMetaObject::invokeMethod(manager, "start", Qt::QueuedConnection);
         });
     }
 }
@@ -14,6 +14,8 @@ QT_BEGIN_NAMESPACE
 class QFileSystemWatcher;
 QT_END_NAMESPACE
 
+class FsDatabaseManager;
+class FullTextIndexManager;
 class MainController : public QObject
 {
     Q_OBJECT
@@ -38,6 +40,8 @@ signals:
 
 private:
     QHash<QString, TaskCommander *> taskManager;
+    FsDatabaseManager *fsDatabaseManager = nullptr;
+    FullTextIndexManager *fullTextIndexManager = nullptr;
     QFuture<void> indexFuture;
 };
 
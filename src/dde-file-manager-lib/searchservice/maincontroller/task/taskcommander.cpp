@@ -37,8 +37,11 @@ AbstractSearcher *TaskCommanderPrivate::createFileNameSearcher(const DUrl &url,
         return new AnythingSearcher(url, keyword, isPrependData, q);
 #endif
 
-    if (FsSearcher::isSupported(url))
-        return new FsSearcher(url, keyword, q);
+    if (FsSearcher::isSupported(url)) {
+        auto searcher = new FsSearcher(url, keyword, q);
+        searcher->setDatabaseManager(fsDatabaseManager);
+        return searcher;
+    }
 
     return new IteratorSearcher(url, keyword, q);
 }
@@ -74,11 +77,14 @@ void TaskCommanderPrivate::onFinished()
     }
 }
 
-TaskCommander::TaskCommander(QString taskId, const DUrl &url, const QString &keyword, QObject *parent)
+TaskCommander::TaskCommander(QString taskId, const DUrl &url, const QString &keyword,
+                             FsDatabaseManager *dbManager, FullTextIndexManager *indexManager, QObject *parent)
     : QObject(parent),
       d(new TaskCommanderPrivate(this))
 {
     d->taskId = taskId;
+    d->fsDatabaseManager = dbManager;
+    d->fullTextIndexManager = indexManager;
     createSearcher(url, keyword);
 }
 
@@ -146,6 +152,7 @@ void TaskCommander::createSearcher(const DUrl &url, const QString &keyword)
     // 全文搜索
     if (FullTextSearcher::isSupport(url)) {
         FullTextSearcher *searcher = new FullTextSearcher(url, keyword, this);
+        searcher->setIndexManager(d->fullTextIndexManager);
         //直连，在线程处理
         connect(searcher, &AbstractSearcher::unearthed, d, &TaskCommanderPrivate::onUnearthed, Qt::DirectConnection);
         d->allSearchers << searcher;
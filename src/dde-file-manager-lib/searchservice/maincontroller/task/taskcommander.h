@@ -10,13 +10,17 @@
 #include "durl.h"
 
 class TaskCommanderPrivate;
+class FsDatabaseManager;
+class FullTextIndexManager;
 class TaskCommander : public QObject
 {
     Q_OBJECT
     friend class MainController;
 
 private:
-    explicit TaskCommander(QString taskId, const DUrl &url, const QString &keyword, QObject *parent = nullptr);
+    explicit TaskCommander(QString taskId, const DUrl &url, const QString &keyword,
+                           FsDatabaseManager *dbManager = nullptr, FullTextIndexManager *indexManager = nullptr,
+                           QObject *parent = nullptr);
     QString taskID() const;
     QList<DUrl> getResults() const;
     bool start();
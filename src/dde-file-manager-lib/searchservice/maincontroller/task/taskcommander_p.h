@@ -33,6 +33,8 @@ private:
     TaskCommander *q = nullptr;
     volatile bool isWorking = false;
     QString taskId;
+    FsDatabaseManager *fsDatabaseManager = nullptr;
+    FullTextIndexManager *fullTextIndexManager = nullptr;
 
     //当前所有的搜索结果和新数据缓冲区
     QReadWriteLock rwLock;
@@ -0,0 +1,387 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "fsdatabasemanager.h"
+#include "interfaces/dfilesystemwatcher.h"
+#include "fulltext/fulltextindexmanager.h"
+
+#include <QStorageInfo>
+#include <QDir>
+#include <QTimer>
+#include <QQueue>
+#include <QThread>
+#include <QtConcurrent>
+#include <QDebug>
+
+#include <limits.h>
+
+namespace {
+static int kApplyInterval = 1000;   // 增量事件合并间隔（ms）
+static int kSaveInterval = 10 * 60 * 1000;   // 持久化间隔（ms）
+static int kRescanInterval = 60 * 60 * 1000;   // 全量重建间隔（ms），用于修正未被监视目录的变化
+}
+
+FsDatabase::FsDatabase(const QString &rootPath)
+    : root(rootPath)
+{
+    config = static_cast<FsearchConfig *>(calloc(1, sizeof(FsearchConfig)));
+    config_load_default(config);
+    config->locations = nullptr;
+}
+
+FsDatabase::~FsDatabase()
+{
+    if (db) {
+        db_clear(db);
+        db_free(db);
+        db = nullptr;
+    }
+    config_free(config);
+}
+
+FsDatabaseManager::FsDatabaseManager(QObject *parent)
+    : QObject(parent)
+{
+    maxWatchCount = FullTextIndexManager::maxWatchCount();
+
+    // 文件监视必须在主线程创建
+    watcher = new DFileSystemWatcher(this);
+    connect(watcher, &DFileSystemWatcher::fileCreated, this, &FsDatabaseManager::onFileCreated);
+    connect(watcher, &DFileSystemWatcher::fileDeleted, this, &FsDatabaseManager::onFileDeleted);
+    connect(watcher, &DFileSystemWatcher::fileMoved, this, &FsDatabaseManager::onFileMoved);
+
+    applyTimer = new QTimer(this);
+    applyTimer->setSingleShot(true);
+    applyTimer->setInterval(kApplyInterval);
+    connect(applyTimer, &QTimer::timeout, this, &FsDatabaseManager::applyChanges);
+
+    saveTimer = new QTimer(this);
+    saveTimer->setInterval(kSaveInterval);
+    connect(saveTimer, &QTimer::timeout, this, &FsDatabaseManager::saveDatabases);
+    saveTimer->start();
+
+    rescanTimer = new QTimer(this);
+    rescanTimer->setInterval(kRescanInterval);
+    connect(rescanTimer, &QTimer::timeout, this, &FsDatabaseManager::rescanDatabases);
+    rescanTimer->start();
+}
+
+FsDatabaseManager::~FsDatabaseManager()
+{
+    {
+        QMutexLocker lk(&mutex);
+        for (auto &database : databases)
+            g_atomic_int_set(&database->working, 0);
+    }
+    pool.waitForDone();
+
+    for (const auto &database : readyDatabases())
+        saveDatabase(database);
+}
+
+/*!
+ * \brief FsDatabaseManager::database 获取 path 所在的数据库，可在任意线程调用
+ * 数据库尚未建立完成时返回空并在后台开始加载，调用方应退回到临时建库的方式
+ */
+FsDatabasePointer FsDatabaseManager::database(const QString &path)
+{
+    const QString &root = databaseRoot(path);
+    if (root.isEmpty())
+        return {};
+
+    QMutexLocker lk(&mutex);
+    auto database = databases.value(root);
+    if (!database) {
+        database.reset(new FsDatabase(root));
+        databases.insert(root, database);
+    }
+
+    if (database->state.testAndSetOrdered(FsDatabase::kUnloaded, FsDatabase::kLoading)) {
+        QtConcurrent::run(&pool, this, &FsDatabaseManager::loadDatabase, database);
+        return {};
+    }
+
+    return database->state.loadAcquire() == FsDatabase::kReady ? database : FsDatabasePointer();
+}
+
+/*!
+ * \brief FsDatabaseManager::databaseRoot 搜索 path 时使用的数据库根目录
+ * 家目录中的搜索使用家目录的数据库，其他挂载点中的搜索使用挂载点的数据库；
+ * 根文件系统中家目录以外的搜索返回空，不建立常驻数据库，避免索引和监视整个根文件系统
+ */
+QString FsDatabaseManager::databaseRoot(const QString &path)
+{
+    if (path.isEmpty())
+        return {};
+
+    const QString &filePath = QDir::cleanPath(path);
+    const QString &home = QDir::homePath();
+    if (filePath == home || filePath.startsWith(home + '/'))
+        return home;
+
+    QStorageInfo info(filePath);
+    if (!info.isValid() || info.isRoot())
+        return {};
+
+    return info.rootPath();
+}
+
+/*!
+ * \brief FsDatabaseManager::isWatched 目录中的变化是否由文件变化事件维护，可在任意线程调用
+ * 未被监视的目录只在全量重建时更新，其中的搜索结果需要逐个检查文件是否还存在
+ */
+bool FsDatabaseManager::isWatched(const QString &directory) const
+{
+    QReadLocker lk(&watchLock);
+    return watchedDirectories.contains(directory);
+}
+
+void FsDatabaseManager::loadDatabase(FsDatabasePointer database)
+{
+    QByteArray root = database->root.toLocal8Bit();
+    Database *db = db_new();
+
+    // 优先加载持久化的数据库，之后再在后台重建以修正离线期间的变化
+    bool fromCache = db_location_load(db, root.data());
+    if (!fromCache && (!db_location_add(db, root.data(), database->config, &database->working, nullptr)
+                       || !g_atomic_int_get(&database->working))) {
+        // 遍历被中断的数据库不完整，不能使用
+        db_clear(db);
+        db_free(db);
+        database->state.storeRelease(FsDatabase::kUnloaded);
+        return;
+    }
+    db_build_initial_entries_list(db);
+
+    {
+        QWriteLocker lk(&database->lock);
+        database->db = db;
+    }
+    database->state.storeRelease(FsDatabase::kReady);
+    qInfo() << "fsearch database ready:" << database->root << "entries:" << db_get_num_entries(db)
+            << "from cache:" << fromCache;
+
+    if (fromCache) {
+        rebuildDatabase(database);
+    } else {
+        saveDatabase(database);
+        updateWatchDirectories(database);
+    }
+}
+
+void FsDatabaseManager::rebuildDatabase(FsDatabasePointer database)
+{
+    QByteArray root = database->root.toLocal8Bit();
+    Database *db = db_new();
+    if (!db_location_add(db, root.data(), database->config, &database->working, nullptr)
+            || !g_atomic_int_get(&database->working)) {
+        db_clear(db);
+        db_free(db);
+        return;
+    }
+    db_build_initial_entries_list(db);
+
+    Database *old = nullptr;
+    {
+        QWriteLocker lk(&database->lock);
+        old = database->db;
+        database->db = db;
+    }
+
+    if (old) {
+        db_clear(old);
+        db_free(old);
+    }
+    saveDatabase(database);
+
+    // 重建后监视新出现的目录
+    updateWatchDirectories(database);
+}
+
+void FsDatabaseManager::saveDatabase(FsDatabasePointer database)
+{
+    QReadLocker lk(&database->lock);
+    if (!database->db)
+        return;
+
+    db_lock(database->db);
+    db_save_locations(database->db);
+    db_unlock(database->db);
+    database->dirty.storeRelease(0);
+}
+
+QStringList FsDatabaseManager::collectWatchDirectories(FsDatabasePointer database) const
+{
+    QStringList directories;
+    QReadLocker lk(&database->lock);
+    if (!database->db)
+        return directories;
+
+    // 广度优先，层级浅的目录优先被监视
+    db_lock(database->db);
+    QQueue<BTreeNode *> queue;
+    queue.enqueue(db_location_find_node(database->db, database->root.toLocal8Bit().data()));
+    char path[PATH_MAX] = "";
+    while (!queue.isEmpty() && directories.size() < maxWatchCount) {
+        BTreeNode *node = queue.dequeue();
+        if (!node || !node->is_dir)
+            continue;
+
+        if (btree_node_get_path_full(node, path, sizeof(path)))
+            directories << QString::fromLocal8Bit(path);
+
+        for (BTreeNode *child = node->children; child; child = child->next) {
+            if (child->is_dir)
+                queue.enqueue(child);
+        }
+    }
+    db_unlock(database->db);
+
+    return directories;
+}
+
+void FsDatabaseManager::updateWatchDirectories(FsDatabasePointer database)
+{
+    // 文件监视只能在主线程添加
+    QMetaObject::invokeMethod(this, "watchDirectories", Qt::QueuedConnection,
+                              Q_ARG(QStringList, collectWatchDirectories(database)));
+}
+
+QList<FsDatabasePointer> FsDatabaseManager::databasesForPath(const QString &path) const
+{
+    // 挂载点可能嵌套，变化需要同步到所有包含该路径的数据库
+    QList<FsDatabasePointer> matched;
+    QMutexLocker lk(&mutex);
+    for (const auto &database : databases) {
+        const QString &prefix = database->root.endsWith('/') ? database->root : database->root + '/';
+        if (path == database->root || path.startsWith(prefix))
+            matched << database;
+    }
+    return matched;
+}
+
+QList<FsDatabasePointer> FsDatabaseManager::readyDatabases() const
+{
+    QList<FsDatabasePointer> ready;
+    QMutexLocker lk(&mutex);
+    for (const auto &database : databases) {
+        if (database->state.loadAcquire() == FsDatabase::kReady)
+            ready << database;
+    }
+    return ready;
+}
+
+void FsDatabaseManager::watchDirectories(const QStringList &directories)
+{
+    // 超出数量的目录由全量重建和搜索时的检查修正
+    QStringList newDirectories;
+    for (const QString &directory : directories) {
+        if (watchedDirectories.size() + newDirectories.size() >= maxWatchCount)
+            break;
+
+        if (!watchedDirectories.contains(directory))
+            newDirectories << directory;
+    }
+
+    const QStringList &failed = watcher->addPaths(newDirectories);
+    QWriteLocker lk(&watchLock);
+    for (const QString &directory : newDirectories) {
+        if (!failed.contains(directory))
+            watchedDirectories.insert(directory);
+    }
+}
+
+void FsDatabaseManager::onFileCreated(const QString &path, const QString &name)
+{
+    if (name.isEmpty())
+        return;
+
+    const QString &filePath = path.endsWith('/') ? path + name : path + '/' + name;
+    pendingRemoved.remove(filePath);
+    pendingAdded.insert(filePath);
+    applyTimer->start();
+}
+
+void FsDatabaseManager::onFileDeleted(const QString &path, const QString &name)
+{
+    const QString &filePath = name.isEmpty() ? path : (path.endsWith('/') ? path + name : path + '/' + name);
+    pendingAdded.remove(filePath);
+    pendingRemoved.insert(filePath);
+    applyTimer->start();
+
+    if (name.isEmpty()) {
+        watcher->removePath(path);
+        QWriteLocker lk(&watchLock);
+        watchedDirectories.remove(path);
+    }
+}
+
+void FsDatabaseManager::onFileMoved(const QString &fromPath, const QString &fromName,
+                                    const QString &toPath, const QString &toName)
+{
+    if (!fromPath.isEmpty())
+        onFileDeleted(fromPath, fromName);
+
+    if (!toPath.isEmpty())
+        onFileCreated(toPath, toName);
+}
+
+void FsDatabaseManager::applyChanges()
+{
+    QHash<FsDatabase *, QPair<QStringList, QStringList>> changes;
+    QHash<FsDatabase *, FsDatabasePointer> targets;
+    for (const QString &path : pendingRemoved) {
+        for (const auto &database : databasesForPath(path)) {
+            changes[database.data()].first << path;
+            targets.insert(database.data(), database);
+        }
+    }
+    for (const QString &path : pendingAdded) {
+        for (const auto &database : databasesForPath(path)) {
+            changes[database.data()].second << path;
+            targets.insert(database.data(), database);
+        }
+    }
+    pendingRemoved.clear();
+    pendingAdded.clear();
+
+    for (auto it = changes.cbegin(); it != changes.cend(); ++it) {
+        FsDatabasePointer database = targets.value(it.key());
+        const QStringList removed = it.value().first;
+        const QStringList added = it.value().second;
+        QtConcurrent::run(&pool, [database, removed, added]() {
+            auto toStrv = [](const QStringList &paths) {
+                char **strv = g_new0(char *, paths.size() + 1);
+                for (int i = 0; i < paths.size(); ++i)
+                    strv[i] = g_strdup(paths.at(i).toLocal8Bit().constData());
+                return strv;
+            };
+            char **removedPaths = toStrv(removed);
+            char **addedPaths = toStrv(added);
+
+            {
+                QReadLocker lk(&database->lock);
+                if (database->db && db_location_apply_changes(database->db, removedPaths, addedPaths, database->config))
+                    database->dirty.storeRelease(1);
+            }
+
+            g_strfreev(removedPaths);
+            g_strfreev(addedPaths);
+        });
+    }
+}
+
+void FsDatabaseManager::saveDatabases()
+{
+    for (const auto &database : readyDatabases()) {
+        if (database->dirty.loadAcquire())
+            QtConcurrent::run(&pool, this, &FsDatabaseManager::saveDatabase, database);
+    }
+}
+
+void FsDatabaseManager::rescanDatabases()
+{
+    for (const auto &database : readyDatabases())
+        QtConcurrent::run(&pool, this, &FsDatabaseManager::rebuildDatabase, database);
+}
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FSDATABASEMANAGER_H
+#define FSDATABASEMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+extern "C" {
+#include "fsearch/fsearch.h"
+}
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+class DFileSystemWatcher;
+
+/*!
+ * \brief The FsDatabase class 一个搜索根目录对应的常驻 fsearch 数据库
+ * 搜索时持有 lock 的读锁，数据库整体重建后替换 db 时持有写锁
+ */
+class FsDatabase
+{
+public:
+    enum State {
+        kUnloaded,
+        kLoading,
+        kReady
+    };
+
+    explicit FsDatabase(const QString &rootPath);
+    ~FsDatabase();
+
+    QString root;
+    Database *db = nullptr;
+    FsearchConfig *config = nullptr;
+    QReadWriteLock lock;
+    QAtomicInt state = kUnloaded;
+    QAtomicInt dirty = 0;
+    gint working = 1;   // 传给 fsearch 遍历函数，用 g_atomic_int_set 置为 0 时中断遍历
+};
+typedef QSharedPointer<FsDatabase> FsDatabasePointer;
+
+/*!
+ * \brief The FsDatabaseManager class 管理家目录和各个挂载点的 fsearch 数据库
+ * 数据库首次使用时在后台建立并持久化，之后通过文件监视的增量事件保持更新，
+ * 搜索时只需在内存中匹配
+ */
+class FsDatabaseManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FsDatabaseManager(QObject *parent = nullptr);
+    ~FsDatabaseManager() override;
+
+    FsDatabasePointer database(const QString &path);
+    static QString databaseRoot(const QString &path);
+    bool isWatched(const QString &directory) const;
+
+private:
+    void loadDatabase(FsDatabasePointer database);
+    void rebuildDatabase(FsDatabasePointer database);
+    void saveDatabase(FsDatabasePointer database);
+    QStringList collectWatchDirectories(FsDatabasePointer database) const;
+    void updateWatchDirectories(FsDatabasePointer database);
+    QList<FsDatabasePointer> databasesForPath(const QString &path) const;
+    QList<FsDatabasePointer> readyDatabases() const;
+
+private slots:
+    void watchDirectories(const QStringList &directories);
+    void onFileCreated(const QString &path, const QString &name);
+    void onFileDeleted(const QString &path, const QString &name);
+    void onFileMoved(const QString &fromPath, const QString &fromName,
+                     const QString &toPath, const QString &toName);
+    void applyChanges();
+    void saveDatabases();
+    void rescanDatabases();
+
+private:
+    mutable QMutex mutex;
+    QHash<QString, FsDatabasePointer> databases;
+    QThreadPool pool;
+    int maxWatchCount = 0;   // 与全文搜索的索引使用相同的监视数量
+    mutable QReadWriteLock watchLock;   // 主线程修改 watchedDirectories 时加写锁，其他线程读取时加读锁
+    QSet<QString> watchedDirectories;
+
+    // 以下成员只在主线程访问
+    DFileSystemWatcher *watcher = nullptr;
+    QSet<QString> pendingAdded;
+    QSet<QString> pendingRemoved;
+    QTimer *applyTimer = nullptr;
+    QTimer *saveTimer = nullptr;
+    QTimer *rescanTimer = nullptr;
+};
+
+#endif   // FSDATABASEMANAGER_H
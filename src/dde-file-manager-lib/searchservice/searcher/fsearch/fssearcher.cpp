@@ -7,6 +7,7 @@
 #include "interfaces/dfileservices.h"
 #include "controllers/vaultcontroller.h"
 
+#include <QFileInfo>
 #include <QDebug>
 
 namespace {
@@ -41,7 +42,7 @@ FsSearcher::~FsSearcher()
 bool FsSearcher::search()
 {
     Q_ASSERT(app);
-    isWorking = true;
+    g_atomic_int_set(&isWorking, 1);
     //准备状态切运行中，否则直接返回
     if (!status.testAndSetRelease(kReady, kRuning))
         return false;
@@ -59,16 +60,43 @@ bool FsSearcher::search()
 
     searchUrl = DUrl::fromLocalFile(info->absoluteFilePath());
     auto searchPath = info->absoluteFilePath().toLocal8Bit();
-    load_database(app, searchPath.data(), &isWorking);//加载数据库
-    if (!isWorking) return false;
     Q_ASSERT(app && app->search);
 
-    db_search_results_clear(app->search);
-    Database *db = app->db;
-    if (!db_try_lock(db)) {
-        return true;
+    // 优先使用常驻数据库，只在内存中匹配
+    FsDatabasePointer database = dbManager ? dbManager->database(info->absoluteFilePath()) : FsDatabasePointer();
+    if (database) {
+        QReadLocker lk(&database->lock);
+        Database *db = database->db;
+        // 变更批次只短暂持有数据库锁，等待其完成，不能以空结果返回
+        db_lock(db);
+
+        BTreeNode *scope = db_location_find_node(db, searchPath.data());
+        if (scope) {
+            isManaged = true;
+            searchDatabase(db, scope);
+            return true;
+        }
+
+        // 搜索目录尚未收录（如刚创建），临时建库搜索
+        db_unlock(db);
     }
 
+    isManaged = false;
+    load_database(app, searchPath.data(), &isWorking);//加载数据库
+    if (!g_atomic_int_get(&isWorking)) return false;
+
+    Database *db = app->db;
+    db_lock(db);
+
+    searchDatabase(db, nullptr);
+    return true;
+}
+
+bool FsSearcher::searchDatabase(Database *db, BTreeNode *scope)
+{
+    db_search_results_clear(app->search);
+    db_search_set_scope(app->search, scope);
+
     if (app->search) {
         db_search_update(app->search,
                          db_get_entries(db),
@@ -81,6 +109,8 @@ bool FsSearcher::search()
                          app->config->enable_regex,
                          app->config->auto_search_in_path,
                          app->config->search_in_path);
+        // 数据库已加锁，条目表在条目列表重建前一直有效
+        db_search_set_entry_table(app->search, db_get_entry_table(db));
 
         conditionMtx.lock();
         db_perform_search(app->search, cbReceiveResults, app, this);
@@ -101,7 +131,7 @@ bool FsSearcher::search()
 
 void FsSearcher::stop()
 {
-    isWorking = false;
+    g_atomic_int_set(&isWorking, 0);
     status.storeRelease(kTerminated);
 }
 
@@ -131,6 +161,11 @@ void FsSearcher::initApp()
     app->search = db_search_new(fsearch_application_get_thread_pool(app));
 }
 
+void FsSearcher::setDatabaseManager(FsDatabaseManager *manager)
+{
+    dbManager = manager;
+}
+
 void FsSearcher::tryNotify()
 {
     int cur = notifyTimer.elapsed();
@@ -192,15 +227,20 @@ void FsSearcher::cbReceiveResults(void *data, void *sender)
                         return;
                     }
 
-                    if (pNode->name != nullptr) {
-                        fileName.prepend(pNode->name);
-                        if (pNode->parent && strcmp(pNode->name, "") != 0)
-                            fileName.prepend("/");
-                    }
+                    fileName.prepend(pNode->name);
+                    if (pNode->parent && strcmp(pNode->name, "") != 0)
+                        fileName.prepend("/");
                     pNode = pNode->parent;
                 }
             }
 
+            // 常驻数据库中未被监视的目录只在全量重建时更新，其中的文件可能已被删除
+            if (self->isManaged && !self->dbManager->isWatched(QFileInfo(fileName).absolutePath())) {
+                const QFileInfo info(fileName);
+                if (!info.exists() && !info.isSymLink())
+                    continue;
+            }
+
             // 过滤文管设置的隐藏文件
             if (!SearchHelper::isHiddenFile(fileName, self->hiddenFilters, self->searchUrl.toLocalFile())) {
                 DUrl fileUrl;
@@ -6,6 +6,7 @@
 #define FSSEARCHER_H
 
 #include "abstractsearcher.h"
+#include "fsdatabasemanager.h"
 #include "durl.h"
 
 extern "C" {
@@ -32,14 +33,18 @@ private:
     QList<DUrl> takeAll() override;
 
     void initApp();
+    void setDatabaseManager(FsDatabaseManager *manager);
+    bool searchDatabase(Database *db, BTreeNode *scope);
     void tryNotify();
     static bool isSupported(const DUrl &url);
     static void cbReceiveResults(void *data, void *sender);
 
 private:
     FsearchApplication *app = nullptr;
+    FsDatabaseManager *dbManager = nullptr;
     QAtomicInt status = kReady;
-    bool isWorking = false;
+    gint isWorking = 0;   // 传给 fsearch 遍历函数，stop 时在其他线程置为 0
+    bool isManaged = false;   // 是否在常驻数据库中搜索
     //搜索结果
     mutable QMutex mutex;
     QWaitCondition waitCondition;
@@ -0,0 +1,463 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "fulltextindexmanager.h"
+#include "fulltextsearcher.h"
+#include "fulltextsearcher_p.h"
+#include "interfaces/dfilesystemwatcher.h"
+#include "dfmapplication.h"
+
+#include <QTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QtConcurrent>
+#include <QDebug>
+
+#include <algorithm>
+#include <stdio.h>
+
+namespace {
+static int kJournalInterval = 1000;   // 文件变化事件合并后写入日志的间隔（ms）
+static int kFlushInterval = 10 * 1000;   // 日志写入索引的间隔（ms）
+static int kRescanInterval = 6 * 60 * 60 * 1000;   // 全量校正间隔（ms），用于修正未被监视目录的变化
+
+inline QString joinPath(const QString &path, const QString &name)
+{
+    return path.endsWith('/') ? path + name : path + '/' + name;
+}
+}
+
+using namespace Lucene;
+
+FullTextIndexManager::FullTextIndexManager(QObject *parent)
+    : QObject(parent)
+{
+    // 写入索引与全量校正共用一个线程，不会同时打开多个 IndexWriter
+    pool.setMaxThreadCount(1);
+
+    // 文件监视必须在主线程创建
+    watcher = new DFileSystemWatcher(this);
+    connect(watcher, &DFileSystemWatcher::fileCreated, this, &FullTextIndexManager::onFileCreated);
+    connect(watcher, &DFileSystemWatcher::fileModified, this, &FullTextIndexManager::onFileChanged);
+    connect(watcher, &DFileSystemWatcher::fileClosed, this, &FullTextIndexManager::onFileChanged);
+    connect(watcher, &DFileSystemWatcher::fileDeleted, this, &FullTextIndexManager::onFileDeleted);
+    connect(watcher, &DFileSystemWatcher::fileMoved, this, &FullTextIndexManager::onFileMoved);
+
+    journalTimer = new QTimer(this);
+    journalTimer->setSingleShot(true);
+    journalTimer->setInterval(kJournalInterval);
+    connect(journalTimer, &QTimer::timeout, this, &FullTextIndexManager::writeJournal);
+
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(kFlushInterval);
+    connect(flushTimer, &QTimer::timeout, this, [this]() {
+        QtConcurrent::run(&pool, this, &FullTextIndexManager::flush);
+    });
+
+    rescanTimer = new QTimer(this);
+    rescanTimer->setInterval(kRescanInterval);
+    connect(rescanTimer, &QTimer::timeout, this, &FullTextIndexManager::rescanIndex);
+}
+
+FullTextIndexManager::~FullTextIndexManager()
+{
+    pool.waitForDone();
+
+    // 未写入索引的变化保留在日志中，下次启动时写入
+    writeJournal();
+}
+
+bool FullTextIndexManager::isWatching() const
+{
+    return watching.loadAcquire();
+}
+
+/*!
+ * \brief FullTextIndexManager::isWatched 目录中的变化是否由文件变化事件维护，可在任意线程调用
+ */
+bool FullTextIndexManager::isWatched(const QString &directory) const
+{
+    QReadLocker lk(&watchLock);
+    return watchedDirectories.contains(directory);
+}
+
+/*!
+ * \brief FullTextIndexManager::maxWatchCount 最多监视的目录数量
+ * 每个目录占用一个 inotify 监视，数量由配置项 IndexWatchCount 设置，文件名搜索的数据库使用相同的数量。
+ * 层级浅的目录优先监视，超出数量的目录中的变化只能由全量校正写入索引，
+ * 搜索时这些目录中的结果需要逐个检查文件是否存在和是否修改过
+ */
+int FullTextIndexManager::maxWatchCount()
+{
+    bool ok = false;
+    const int count = DFMApplication::genericAttribute(DFMApplication::GA_IndexWatchCount).toInt(&ok);
+    return ok && count >= 0 ? count : 4096;
+}
+
+/*!
+ * \brief FullTextIndexManager::flush 把日志中记录的变化写入索引，可在任意线程调用
+ * \param isBlocking 为 false 时，其他线程正在写入索引（如全量校正）则不等待，直接返回 false
+ * 返回 false 表示索引不由文件变化事件维护、写入失败或没有等待写入，日志中的变化还没有写入索引
+ */
+bool FullTextIndexManager::flush(bool isBlocking)
+{
+    if (!watching.loadAcquire())
+        return false;
+
+    if (isBlocking)
+        flushMutex.lock();
+    else if (!flushMutex.tryLock())
+        return false;
+
+    const bool ret = flushJournal();
+    flushMutex.unlock();
+
+    return ret;
+}
+
+/*!
+ * \brief FullTextIndexManager::flushJournal 需要持有 flushMutex
+ */
+bool FullTextIndexManager::flushJournal()
+{
+    const QString &applyingPath = journalPath() + ".applying";
+    Changes changes;
+    {
+        QMutexLocker lk(&journalMutex);
+        // 上次写入失败的变化还在 applying 日志中，与新记录的变化合并后一起写入
+        readJournal(applyingPath, changes);
+        if (readJournal(journalPath(), changes)) {
+            const QString &tmpPath = applyingPath + ".tmp";
+            QFile::remove(tmpPath);
+            if (!appendJournal(tmpPath, changes)
+                    || ::rename(QFile::encodeName(tmpPath).constData(), QFile::encodeName(applyingPath).constData()) != 0) {
+                qWarning() << "can not write full-text index journal:" << applyingPath;
+                return false;
+            }
+            QFile::remove(journalPath());
+        }
+    }
+
+    if (changes.isEmpty())
+        return true;
+
+    // 写入失败时保留日志，下次重试
+    if (!applyChanges(changes))
+        return false;
+
+    QFile::remove(applyingPath);
+    return true;
+}
+
+QString FullTextIndexManager::journalPath()
+{
+    return FullTextSearcherPrivate::indexStorePath() + "-journal";
+}
+
+bool FullTextIndexManager::appendJournal(const QString &fileName, const Changes &changes)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+
+    QDataStream stream(&file);
+    for (auto it = changes.cbegin(); it != changes.cend(); ++it)
+        stream << static_cast<quint8>(it.value()) << it.key();
+
+    return stream.status() == QDataStream::Ok && file.flush();
+}
+
+bool FullTextIndexManager::readJournal(const QString &fileName, Changes &changes)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // 同一文件以最后一次记录的变化为准
+    QDataStream stream(&file);
+    while (!stream.atEnd()) {
+        quint8 type = kUpdate;
+        QString path;
+        stream >> type >> path;
+        // 写入过程中退出会留下不完整的记录
+        if (stream.status() != QDataStream::Ok || type > kDelete)
+            break;
+
+        changes.insert(path, static_cast<ChangeType>(type));
+    }
+
+    return true;
+}
+
+void FullTextIndexManager::start()
+{
+    if (watching.loadAcquire())
+        return;
+
+    if (!FullTextSearcherPrivate::isIndexCompatible())
+        return;
+
+    watching.storeRelease(1);
+    rescanTimer->start();
+
+    QtConcurrent::run(&pool, [this]() {
+        // 先写入上次退出前记录的变化
+        flush();
+        QMetaObject::invokeMethod(this, "watchDirectories", Qt::QueuedConnection,
+                                  Q_ARG(QStringList, collectWatchDirectories()));
+    });
+}
+
+bool FullTextIndexManager::applyChanges(const Changes &changes)
+{
+    QStringList newDirectories;
+
+    try {
+        IndexWriterPtr writer = FullTextSearcherPrivate::newIndexWriter();
+
+        auto updateFile = [&writer](const QString &file) {
+            TermPtr term = newLucene<Term>(L"path", file.toStdWString());
+            DocumentPtr doc;
+            if (FullTextSearcherPrivate::isIndexableFile(file) && QFileInfo(file).isFile()) {
+                try {
+                    doc = FullTextSearcherPrivate::fileDocument(file);
+                } catch (...) {
+                    qWarning() << "Error: can not parse " << file;
+                }
+            }
+
+            if (doc)
+                writer->updateDocument(term, doc);
+            else
+                writer->deleteDocuments(term);
+        };
+
+        // 先处理删除，更新时会重新检查文件当前的状态，所以两者的先后顺序不影响结果
+        for (auto it = changes.cbegin(); it != changes.cend(); ++it) {
+            if (it.value() != kDelete)
+                continue;
+
+            const String &path = it.key().toStdWString();
+            writer->deleteDocuments(newLucene<Term>(L"path", path));
+            writer->deleteDocuments(newLucene<Term>(L"dir", path));
+        }
+
+        for (auto it = changes.cbegin(); it != changes.cend(); ++it) {
+            if (it.value() != kUpdate)
+                continue;
+
+            const QString &path = it.key();
+            QFileInfo info(path);
+            if (!info.isDir() || info.isSymLink()) {
+                updateFile(path);
+                continue;
+            }
+
+            // 新建或移入的目录
+            QDirIterator iterator(path, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while (iterator.hasNext()) {
+                const QString &file = iterator.next();
+                if (!FullTextSearcherPrivate::isIndexableFile(file))
+                    continue;
+
+                updateFile(file);
+                newDirectories << iterator.fileInfo().absolutePath();
+            }
+            newDirectories << path;
+        }
+
+        writer->commit();
+        writer->close();
+    } catch (const LuceneException &e) {
+        qWarning() << "Error: " << __FUNCTION__ << QString::fromStdWString(e.getError());
+        return false;
+    } catch (const std::exception &e) {
+        qWarning() << "Error: " << __FUNCTION__ << QString(e.what());
+        return false;
+    } catch (...) {
+        qWarning() << "Error: " << __FUNCTION__;
+        return false;
+    }
+
+    qInfo() << "apply" << changes.size() << "changes to full-text index";
+    if (!newDirectories.isEmpty()) {
+        newDirectories.removeDuplicates();
+        QMetaObject::invokeMethod(this, "watchDirectories", Qt::QueuedConnection, Q_ARG(QStringList, newDirectories));
+    }
+
+    return true;
+}
+
+QStringList FullTextIndexManager::collectWatchDirectories(QStringList *missingFiles) const
+{
+    // 监视已建立索引的文件所在的目录，遍历 path 字段的词项，不需要读取文档内容
+    QSet<QString> directories;
+    try {
+        IndexReaderPtr reader = FullTextSearcherPrivate::newIndexReader();
+        TermEnumPtr terms = reader->terms(newLucene<Term>(L"path", L""));
+        do {
+            TermPtr term = terms->term();
+            if (!term || term->field() != L"path")
+                break;
+
+            const QString &file = QString::fromStdWString(term->text());
+            if (missingFiles && !QFileInfo::exists(file)) {
+                *missingFiles << file;
+                continue;
+            }
+
+            directories.insert(QFileInfo(file).absolutePath());
+        } while (terms->next());
+
+        terms->close();
+        reader->close();
+    } catch (const LuceneException &e) {
+        qWarning() << "Error: " << __FUNCTION__ << QString::fromStdWString(e.getError());
+    } catch (const std::exception &e) {
+        qWarning() << "Error: " << __FUNCTION__ << QString(e.what());
+    } catch (...) {
+        qWarning() << "Error: " << __FUNCTION__;
+    }
+
+    // 层级浅的目录优先被监视，超出数量的部分由 watchDirectories 丢弃
+    QStringList result = directories.toList();
+    std::sort(result.begin(), result.end(), [](const QString &d1, const QString &d2) {
+        return d1.count('/') < d2.count('/');
+    });
+
+    return result;
+}
+
+void FullTextIndexManager::recordChange(const QString &filePath, ChangeType type)
+{
+    pendingChanges.insert(filePath, type);
+
+    // 持续有事件时也要按时写入日志，不能一直推迟
+    if (!journalTimer->isActive())
+        journalTimer->start();
+}
+
+void FullTextIndexManager::watchDirectories(const QStringList &directories)
+{
+    const int maxCount = maxWatchCount();
+    QStringList newDirectories;
+    for (const QString &directory : directories) {
+        if (watchedDirectories.size() + newDirectories.size() >= maxCount)
+            break;
+
+        if (!watchedDirectories.contains(directory))
+            newDirectories << directory;
+    }
+
+    const QStringList &failed = watcher->addPaths(newDirectories);
+    QWriteLocker lk(&watchLock);
+    for (const QString &directory : newDirectories) {
+        if (!failed.contains(directory))
+            watchedDirectories.insert(directory);
+    }
+}
+
+void FullTextIndexManager::onFileCreated(const QString &path, const QString &name)
+{
+    if (name.isEmpty())
+        return;
+
+    const QString &filePath = joinPath(path, name);
+    if (FullTextSearcherPrivate::isIndexableFile(filePath) || QFileInfo(filePath).isDir())
+        recordChange(filePath, kUpdate);
+}
+
+void FullTextIndexManager::onFileChanged(const QString &path, const QString &name)
+{
+    if (name.isEmpty())
+        return;
+
+    const QString &filePath = joinPath(path, name);
+    if (FullTextSearcherPrivate::isIndexableFile(filePath))
+        recordChange(filePath, kUpdate);
+}
+
+void FullTextIndexManager::onFileDeleted(const QString &path, const QString &name)
+{
+    // 被监视的目录本身被删除
+    if (name.isEmpty()) {
+        watcher->removePath(path);
+        {
+            QWriteLocker lk(&watchLock);
+            watchedDirectories.remove(path);
+        }
+        recordChange(path, kDelete);
+        return;
+    }
+
+    const QString &filePath = joinPath(path, name);
+    if (FullTextSearcherPrivate::isIndexableFile(filePath) || watchedDirectories.contains(filePath))
+        recordChange(filePath, kDelete);
+}
+
+void FullTextIndexManager::onFileMoved(const QString &fromPath, const QString &fromName,
+                                       const QString &toPath, const QString &toName)
+{
+    if (!fromPath.isEmpty()) {
+        // 移走的是目录时目录下所有文件的索引都要删除
+        if (!toPath.isEmpty() && !fromName.isEmpty() && QFileInfo(joinPath(toPath, toName)).isDir())
+            recordChange(joinPath(fromPath, fromName), kDelete);
+        else
+            onFileDeleted(fromPath, fromName);
+    }
+
+    if (!toPath.isEmpty())
+        onFileCreated(toPath, toName);
+}
+
+void FullTextIndexManager::writeJournal()
+{
+    if (pendingChanges.isEmpty())
+        return;
+
+    {
+        QMutexLocker lk(&journalMutex);
+        if (!appendJournal(journalPath(), pendingChanges))
+            qWarning() << "can not write full-text index journal:" << journalPath();
+    }
+    pendingChanges.clear();
+
+    if (!flushTimer->isActive())
+        flushTimer->start();
+}
+
+void FullTextIndexManager::rescanIndex()
+{
+    if (!DFMApplication::genericAttribute(DFMApplication::GA_IndexFullTextSearch).toBool())
+        return;
+
+    QtConcurrent::run(&pool, [this]() {
+        // 遍历目录补充未被监视的目录中的变化，再删除已经不存在的文件；
+        // 遍历期间搜索不等待写入日志中的变化，按结果逐个检查文件
+        {
+            QMutexLocker lk(&flushMutex);
+            FullTextSearcher searcher(DUrl(), "");
+            searcher.d->status.storeRelease(AbstractSearcher::kRuning);
+            searcher.d->updateIndex("/");
+        }
+
+        QStringList missingFiles;
+        const QStringList &directories = collectWatchDirectories(&missingFiles);
+        if (!missingFiles.isEmpty()) {
+            Changes changes;
+            for (const QString &file : missingFiles)
+                changes.insert(file, kDelete);
+
+            QMutexLocker lk(&flushMutex);
+            applyChanges(changes);
+        }
+
+        QMetaObject::invokeMethod(this, "watchDirectories", Qt::QueuedConnection, Q_ARG(QStringList, directories));
+    });
+}
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FULLTEXTINDEXMANAGER_H
+#define FULLTEXTINDEXMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QThreadPool>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+class DFileSystemWatcher;
+
+/*!
+ * \brief The FullTextIndexManager class 通过文件变化事件维护全文索引
+ * 变化先合并写入持久化的日志，再批量写入索引，程序退出或写入失败时日志中的变化不会丢失。
+ * 更新索引的开销只与变化的文件数量相关，不需要遍历目录
+ */
+class FullTextIndexManager : public QObject
+{
+    Q_OBJECT
+public:
+    enum ChangeType : quint8 {
+        kUpdate,
+        kDelete
+    };
+    typedef QHash<QString, ChangeType> Changes;
+
+    explicit FullTextIndexManager(QObject *parent = nullptr);
+    ~FullTextIndexManager() override;
+
+    bool isWatching() const;
+    bool isWatched(const QString &directory) const;
+    bool flush(bool isBlocking = true);
+
+    static int maxWatchCount();
+    static QString journalPath();
+    static bool appendJournal(const QString &fileName, const Changes &changes);
+    static bool readJournal(const QString &fileName, Changes &changes);
+
+public slots:
+    void start();
+
+private:
+    bool flushJournal();
+    bool applyChanges(const Changes &changes);
+    QStringList collectWatchDirectories(QStringList *missingFiles = nullptr) const;
+    void recordChange(const QString &filePath, ChangeType type);
+
+private slots:
+    void watchDirectories(const QStringList &directories);
+    void onFileCreated(const QString &path, const QString &name);
+    void onFileChanged(const QString &path, const QString &name);
+    void onFileDeleted(const QString &path, const QString &name);
+    void onFileMoved(const QString &fromPath, const QString &fromName,
+                     const QString &toPath, const QString &toName);
+    void writeJournal();
+    void rescanIndex();
+
+private:
+    QMutex journalMutex;   // 保护日志文件
+    QMutex flushMutex;     // 同一时间只有一个 IndexWriter
+    QThreadPool pool;
+    QAtomicInt watching = 0;
+    mutable QReadWriteLock watchLock;   // 主线程修改 watchedDirectories 时加写锁，其他线程读取时加读锁
+    QSet<QString> watchedDirectories;
+
+    // 以下成员只在主线程访问
+    DFileSystemWatcher *watcher = nullptr;
+    Changes pendingChanges;
+    QTimer *journalTimer = nullptr;
+    QTimer *flushTimer = nullptr;
+    QTimer *rescanTimer = nullptr;
+};
+
+#endif   // FULLTEXTINDEXMANAGER_H
@@ -4,6 +4,7 @@
 
 #include "fulltextsearcher.h"
 #include "fulltextsearcher_p.h"
+#include "fulltextindexmanager.h"
 #include "chineseanalyzer.h"
 #include "utils/searchhelper.h"
 #include "durl.h"
@@ -26,6 +27,9 @@
 #include <QDir>
 #include <QTime>
 #include <QUrl>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 #include <dirent.h>
 #include <exception>
@@ -37,6 +41,10 @@ const char *const kSupportFiles = "(rtf)|(odt)|(ods)|(odp)|(odg)|(docx)|(xlsx)|(
                                   "(xls)|(xlsb)|(doc)|(dot)|(wps)|(ppt)|(pps)|(txt)|(pdf)|(dps)";
 static int kMaxResultNum = 100000;   // 最大搜索结果数
 static int kEmitInterval = 50;   // 推送时间间隔
+static int kIndexQueueSize = 64;   // 流水线中每个队列的最大长度
+static int kProgressInterval = 10000;   // 输出索引进度的时间间隔
+// 索引结构的版本，结构变化后需要重建索引
+const wchar_t *const kIndexSchemaVersion = L"2";
 }
 
 using namespace Lucene;
@@ -46,6 +54,7 @@ FullTextSearcherPrivate::FullTextSearcherPrivate(FullTextSearcher *parent)
     : QObject(parent),
       q(parent)
 {
+    indexWorkerCount = qMax(1, QThread::idealThreadCount());
 }
 
 FullTextSearcherPrivate::~FullTextSearcherPrivate()
@@ -65,7 +74,57 @@ IndexReaderPtr FullTextSearcherPrivate::newIndexReader()
     return IndexReader::open(FSDirectory::open(indexStorePath().toStdWString()), true);
 }
 
-void FullTextSearcherPrivate::doIndexTask(const IndexReaderPtr &reader, const IndexWriterPtr &writer, const QString &path, TaskType type)
+void FullTextSearcherPrivate::runIndexPipeline(const IndexReaderPtr &reader, const IndexWriterPtr &writer, const QString &path, TaskType type)
+{
+    // 遍历目录 -> 多个线程解析文档 -> 当前线程写入索引，各阶段之间通过有界队列传递，避免解析结果堆积
+    IndexQueue<IndexJob> jobs(kIndexQueueSize);
+    IndexQueue<IndexJob> docs(kIndexQueueSize);
+    QAtomicInt runningWorkers = indexWorkerCount;
+
+    parsedDocuments.storeRelease(0);
+    parsedBytes.storeRelease(0);
+    QTime timer;
+    timer.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(indexWorkerCount + 1);
+
+    QtConcurrent::run(&pool, [&]() {
+        doIndexTask(reader, jobs, path, type);
+        jobs.close();
+    });
+
+    for (int i = 0; i < indexWorkerCount; ++i) {
+        QtConcurrent::run(&pool, [&]() {
+            parseDocs(jobs, docs);
+            // 最后一个解析线程退出时通知写入端
+            if (!runningWorkers.deref())
+                docs.close();
+        });
+    }
+
+    int lastProgress = 0;
+    IndexJob job;
+    while (docs.pop(job)) {
+        if (job.doc)
+            indexDocs(writer, job.file, job.type, job.doc);
+
+        if (timer.elapsed() - lastProgress > kProgressInterval) {
+            lastProgress = timer.elapsed();
+            qInfo() << "indexing:" << parsedDocuments.loadAcquire() << "documents," << parsedBytes.loadAcquire() << "bytes";
+        }
+    }
+
+    pool.waitForDone();
+
+    indexStatistics.documents = parsedDocuments.loadAcquire();
+    indexStatistics.bytes = parsedBytes.loadAcquire();
+    indexStatistics.elapsed = timer.elapsed();
+    qInfo() << "index" << indexStatistics.documents << "documents with" << indexWorkerCount << "workers,"
+            << indexStatistics.documentsPerSecond() << "docs/s," << indexStatistics.bytesPerSecond() << "bytes/s";
+}
+
+void FullTextSearcherPrivate::doIndexTask(const IndexReaderPtr &reader, IndexQueue<IndexJob> &jobs, const QString &path, TaskType type)
 {
     if (status.loadAcquire() != AbstractSearcher::kRuning)
         return;
@@ -94,6 +153,8 @@ void FullTextSearcherPrivate::doIndexTask(const IndexReaderPtr &reader, const In
     if (strcmp(filePath, "/"))
         fn[len++] = '/';
 
+    static QRegExp suffixRegExp(kSupportFiles);
+
     // traverse
     while ((dent = readdir(dir)) && status.loadAcquire() == AbstractSearcher::kRuning) {
         if (dent->d_name[0] == '.' && strncmp(dent->d_name, ".local", strlen(".local")))
@@ -102,32 +163,33 @@ void FullTextSearcherPrivate::doIndexTask(const IndexReaderPtr &reader, const In
         if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
             continue;
 
-        struct stat st;
         strncpy(fn + len, dent->d_name, FILENAME_MAX - len);
-        if (lstat(fn, &st) == -1)
-            continue;
 
-        const bool is_dir = S_ISDIR(st.st_mode);
+        // d_type 能确定类型时不需要 lstat
+        bool is_dir = dent->d_type == DT_DIR;
+        if (dent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(fn, &st) == -1)
+                continue;
+            is_dir = S_ISDIR(st.st_mode);
+        }
+
         if (is_dir) {
-            doIndexTask(reader, writer, fn, type);
+            doIndexTask(reader, jobs, fn, type);
         } else {
-            QFileInfo info(fn);
-            QString suffix = info.suffix();
-            static QRegExp suffixRegExp(kSupportFiles);
-            if (suffixRegExp.exactMatch(suffix)) {
-                switch (type) {
-                case kCreate:
-                    indexDocs(writer, fn, kAddIndex);
-                    break;
-                case kUpdate:
-                    IndexType type;
-                    if (checkUpdate(reader, fn, type)) {
-                        indexDocs(writer, fn, type);
-                        isUpdated = true;
-                    }
-                    break;
-                }
+            const char *dot = strrchr(dent->d_name, '.');
+            if (!dot || !suffixRegExp.exactMatch(QString::fromLocal8Bit(dot + 1)))
+                continue;
+
+            IndexJob job;
+            job.file = fn;
+            if (type == kUpdate) {
+                if (!checkUpdate(reader, job.file, job.type))
+                    continue;
+                isUpdated = true;
             }
+
+            jobs.push(job);
         }
     }
 
@@ -135,7 +197,33 @@ void FullTextSearcherPrivate::doIndexTask(const IndexReaderPtr &reader, const In
         closedir(dir);
 }
 
-void FullTextSearcherPrivate::indexDocs(const IndexWriterPtr &writer, const QString &file, IndexType type)
+void FullTextSearcherPrivate::parseDocs(IndexQueue<IndexJob> &jobs, IndexQueue<IndexJob> &docs)
+{
+    IndexJob job;
+    while (jobs.pop(job)) {
+        // 中断后只取出剩余任务，不再解析
+        if (status.loadAcquire() != AbstractSearcher::kRuning)
+            continue;
+
+        try {
+            qint64 size = 0;
+            job.doc = fileDocument(job.file, &size);
+            parsedDocuments.ref();
+            parsedBytes.fetchAndAddRelaxed(size);
+        } catch (const LuceneException &e) {
+            qWarning() << "Error: " << __FUNCTION__ << QString::fromStdWString(e.getError()) << " file: " << job.file;
+        } catch (const std::exception &e) {
+            qWarning() << "Error: " << __FUNCTION__ << QString(e.what()) << " file: " << job.file;
+        } catch (...) {
+            qWarning() << "Error: " << __FUNCTION__ << " file: " << job.file;
+        }
+
+        docs.push(job);
+        job.doc.reset();
+    }
+}
+
+void FullTextSearcherPrivate::indexDocs(const IndexWriterPtr &writer, const QString &file, IndexType type, const DocumentPtr &doc)
 {
     Q_ASSERT(writer);
 
@@ -144,7 +232,7 @@ void FullTextSearcherPrivate::indexDocs(const IndexWriterPtr &writer, const QStr
         case kAddIndex: {
             qDebug() << "Adding [" << file << "]";
             // 添加
-            writer->addDocument(fileDocument(file));
+            writer->addDocument(doc ? doc : fileDocument(file));
             break;
         }
         case kUpdateIndex: {
@@ -152,7 +240,7 @@ void FullTextSearcherPrivate::indexDocs(const IndexWriterPtr &writer, const QStr
             // 定义一个更新条件
             TermPtr term = newLucene<Term>(L"path", file.toStdWString());
             // 更新
-            writer->updateDocument(term, fileDocument(file));
+            writer->updateDocument(term, doc ? doc : fileDocument(file));
             break;
         }
         case kDeleteIndex: {
@@ -191,11 +279,7 @@ bool FullTextSearcherPrivate::checkUpdate(const IndexReaderPtr &reader, const QS
             return true;
         } else {
             DocumentPtr doc = searcher->doc(topDocs->scoreDocs[0]->doc);
-            QFileInfo info(file);
-            QString modifyTime = info.lastModified().toString("yyyyMMddHHmmss");
-            String storeTime = doc->get(L"modified");
-
-            if (modifyTime.toStdWString() != storeTime) {
+            if (isDocumentStale(doc, QFileInfo(file))) {
                 type = kUpdateIndex;
                 return true;
             }
@@ -221,24 +305,89 @@ void FullTextSearcherPrivate::tryNotify()
     }
 }
 
-DocumentPtr FullTextSearcherPrivate::fileDocument(const QString &file)
+DocumentPtr FullTextSearcherPrivate::fileDocument(const QString &file, qint64 *size)
 {
     DocumentPtr doc = newLucene<Document>();
     // file path
-    doc->add(newLucene<Field>(L"path", file.toStdWString(), Field::STORE_YES, Field::INDEX_NOT_ANALYZED));
+    doc->add(newLucene<Field>(L"path", file.toStdWString(), Field::STORE_YES, Field::INDEX_NOT_ANALYZED_NO_NORMS));
 
-    // file last modified time
-    QFileInfo info(file);
-    QString modifyTime = info.lastModified().toString("yyyyMMddHHmmss");
-    doc->add(newLucene<Field>(L"modified", modifyTime.toStdWString(), Field::STORE_YES, Field::INDEX_NOT_ANALYZED));
+    // 每个上级目录都作为一个词项，按目录过滤搜索结果时只需要查一个词项
+    for (const QString &dir : ancestorDirectories(file))
+        doc->add(newLucene<Field>(L"dir", dir.toStdWString(), Field::STORE_NO, Field::INDEX_NOT_ANALYZED_NO_NORMS));
 
-    // file contents
+    // 修改时间和大小只用于判断文件是否变化，不需要建立索引
+    QFileInfo info(file);
+    if (size)
+        *size = info.size();
+    NumericFieldPtr modified = newLucene<NumericField>(L"modified", Field::STORE_YES, false);
+    modified->setLongValue(info.lastModified().toMSecsSinceEpoch());
+    doc->add(modified);
+    NumericFieldPtr fileSize = newLucene<NumericField>(L"size", Field::STORE_YES, false);
+    fileSize->setLongValue(info.size());
+    doc->add(fileSize);
+
+    // file contents，只建立索引，不保存原文
     QString contents = DocParser::convertFile(file.toStdString()).c_str();
-    doc->add(newLucene<Field>(L"contents", contents.toStdWString(), Field::STORE_YES, Field::INDEX_ANALYZED));
+    doc->add(newLucene<Field>(L"contents", contents.toStdWString(), Field::STORE_NO, Field::INDEX_ANALYZED));
 
     return doc;
 }
 
+bool FullTextSearcherPrivate::isIndexCompatible()
+{
+    try {
+        DirectoryPtr directory = FSDirectory::open(indexStorePath().toStdWString());
+        if (!IndexReader::indexExists(directory))
+            return false;
+
+        return IndexReader::getCommitUserData(directory).get(L"schema") == kIndexSchemaVersion;
+    } catch (const LuceneException &e) {
+        qWarning() << "Error: " << __FUNCTION__ << QString::fromStdWString(e.getError());
+    } catch (...) {
+        qWarning() << "Error: " << __FUNCTION__;
+    }
+
+    return false;
+}
+
+bool FullTextSearcherPrivate::isDocumentStale(const DocumentPtr &doc, const QFileInfo &info)
+{
+    return QString::fromStdWString(doc->get(L"modified")).toLongLong() != info.lastModified().toMSecsSinceEpoch()
+            || QString::fromStdWString(doc->get(L"size")).toLongLong() != info.size();
+}
+
+QStringList FullTextSearcherPrivate::ancestorDirectories(const QString &file)
+{
+    QStringList dirs;
+    int pos = file.lastIndexOf('/');
+    while (pos > 0) {
+        dirs << file.left(pos);
+        pos = file.lastIndexOf('/', pos - 1);
+    }
+    dirs << "/";
+
+    return dirs;
+}
+
+bool FullTextSearcherPrivate::isIndexableFile(const QString &file)
+{
+    // 与 doIndexTask 遍历时的过滤规则保持一致
+    QRegExp folderRegExp(kFilterFolders);
+    if (folderRegExp.exactMatch(file) && !file.startsWith("/run/user"))
+        return false;
+
+    if (file.size() > FILENAME_MAX - 1 || file.count('/') > 21)
+        return false;
+
+    for (const QStringRef &name : file.splitRef('/', QString::SkipEmptyParts)) {
+        if (name.startsWith('.') && !name.startsWith(".local"))
+            return false;
+    }
+
+    QRegExp suffixRegExp(kSupportFiles);
+    return suffixRegExp.exactMatch(QFileInfo(file).suffix());
+}
+
 bool FullTextSearcherPrivate::createIndex(const QString &path)
 {
     //准备状态切运行中，否则直接返回
@@ -267,8 +416,11 @@ bool FullTextSearcherPrivate::createIndex(const QString &path)
         IndexWriterPtr writer = newIndexWriter(true);
         qDebug() << "Indexing to directory: " << indexStorePath();
         writer->deleteAll();
-        doIndexTask(nullptr, writer, path, kCreate);
+        runIndexPipeline(nullptr, writer, path, kCreate);
         writer->optimize();
+        MapStringString userData = MapStringString::newInstance();
+        userData.put(L"schema", kIndexSchemaVersion);
+        writer->commit(userData);
         writer->close();
 
         qInfo() << "create index spending: " << timer.elapsed();
@@ -296,7 +448,7 @@ bool FullTextSearcherPrivate::updateIndex(const QString &path)
         IndexReaderPtr reader = newIndexReader();
         IndexWriterPtr writer = newIndexWriter();
 
-        doIndexTask(reader, writer, path, kUpdate);
+        runIndexPipeline(reader, writer, path, kUpdate);
 
         writer->close();
         reader->close();
@@ -313,7 +465,12 @@ bool FullTextSearcherPrivate::updateIndex(const QString &path)
     return false;
 }
 
-bool FullTextSearcherPrivate::doSearch(const QString &path, const QString &keyword)
+/*!
+ * \brief FullTextSearcherPrivate::doSearch
+ * \param isManaged 索引由 FullTextIndexManager 写入，这里不能再打开 IndexWriter
+ * \param isFlushed 日志中的变化已写入索引，被监视目录中的结果不需要再检查文件
+ */
+bool FullTextSearcherPrivate::doSearch(const QString &path, const QString &keyword, bool isManaged, bool isFlushed)
 {
     qInfo() << "search path: " << path << " keyword: " << keyword;
     notifyTimer.start();
@@ -326,7 +483,7 @@ bool FullTextSearcherPrivate::doSearch(const QString &path, const QString &keywo
     }
 
     try {
-        IndexWriterPtr writer = newIndexWriter();
+        IndexWriterPtr writer = isManaged ? IndexWriterPtr() : newIndexWriter();
         IndexReaderPtr reader = newIndexReader();
         SearcherPtr searcher = newLucene<IndexSearcher>(reader);
         AnalyzerPtr analyzer = newLucene<ChineseAnalyzer>();
@@ -335,9 +492,11 @@ bool FullTextSearcherPrivate::doSearch(const QString &path, const QString &keywo
         parser->setAllowLeadingWildcard(true);
         QueryPtr query = parser->parse(keyword.toStdWString());
 
-        // create query filter
-        String filterPath = searchPath.endsWith("/") ? (searchPath + "*").toStdWString() : (searchPath + "/*").toStdWString();
-        FilterPtr filter = newLucene<QueryWrapperFilter>(newLucene<WildcardQuery>(newLucene<Term>(L"path", filterPath)));
+        // create query filter，按上级目录的词项过滤，不需要枚举所有路径
+        QString scopePath = searchPath;
+        while (scopePath.size() > 1 && scopePath.endsWith('/'))
+            scopePath.chop(1);
+        FilterPtr filter = newLucene<QueryWrapperFilter>(newLucene<TermQuery>(newLucene<Term>(L"dir", scopePath.toStdWString())));
 
         // search
         TopDocsPtr topDocs = searcher->search(query, filter, kMaxResultNum);
@@ -353,16 +512,21 @@ bool FullTextSearcherPrivate::doSearch(const QString &path, const QString &keywo
             String resultPath = doc->get(L"path");
 
             if (!resultPath.empty()) {
+                bool isStale = false;
                 QFileInfo info(QString::fromStdWString(resultPath));
-                // delete invalid index
-                if (!info.exists()) {
-                    indexDocs(writer, info.absoluteFilePath(), kDeleteIndex);
-                    continue;
+                // 被监视目录中的结果不会过期，其他目录（超出监视数量上限等）仍需检查文件
+                if (!isFlushed || !indexManager->isWatched(info.absolutePath())) {
+                    if (!info.exists()) {
+                        // delete invalid index，索引由文件变化事件维护时留给全量校正删除
+                        if (writer)
+                            indexDocs(writer, info.absoluteFilePath(), kDeleteIndex);
+                        continue;
+                    }
+
+                    isStale = isDocumentStale(doc, info);
                 }
 
-                QString modifyTime = info.lastModified().toString("yyyyMMddHHmmss");
-                String storeTime = doc->get(L"modified");
-                if (modifyTime.toStdWString() != storeTime) {
+                if (isStale) {
                     continue;
                 } else {
                     if (!SearchHelper::isHiddenFile(StringUtils::toUTF8(resultPath).c_str(), hiddenFileHash, searchPath)) {
@@ -391,7 +555,8 @@ bool FullTextSearcherPrivate::doSearch(const QString &path, const QString &keywo
         }
 
         reader->close();
-        writer->close();
+        if (writer)
+            writer->close();
     } catch (const LuceneException &e) {
         qWarning() << "Error: " << __FUNCTION__ << QString::fromStdWString(e.getError());
     } catch (const std::exception &e) {
@@ -449,9 +614,8 @@ FullTextSearcher::FullTextSearcher(const DUrl &url, const QString &key, QObject
 
 bool FullTextSearcher::createIndex(const QString &path)
 {
-    // do not re-create index if index already exists
-    bool indexExists = IndexReader::indexExists(FSDirectory::open(d->indexStorePath().toStdWString()));
-    if (indexExists)
+    // do not re-create index if index already exists，旧版本结构的索引需要重建
+    if (d->isIndexCompatible())
         return true;
 
     d->isIndexCreating = true;
@@ -461,6 +625,11 @@ bool FullTextSearcher::createIndex(const QString &path)
     return res;
 }
 
+void FullTextSearcher::setIndexManager(FullTextIndexManager *manager)
+{
+    d->indexManager = manager;
+}
+
 bool FullTextSearcher::isSupport(const DUrl &url)
 {
     if (!url.isValid())
@@ -495,9 +664,13 @@ bool FullTextSearcher::search()
         return false;
     }
 
-    // 先更新索引再搜索
-    d->updateIndex(path);
-    d->doSearch(path, key);
+    // 索引由文件变化事件维护时只需写入日志中记录的变化，否则遍历目录更新索引后再搜索；
+    // 全量校正正在写入索引时不等待，所有结果都检查文件
+    const bool isManaged = d->indexManager && d->indexManager->isWatching();
+    const bool isFlushed = isManaged && d->indexManager->flush(false);
+    if (!isManaged)
+        d->updateIndex(path);
+    d->doSearch(path, key, isManaged, isFlushed);
     //检查是否还有数据
     if (d->status.testAndSetRelease(kRuning, kCompleted)) {
         //发送数据
@@ -10,16 +10,19 @@
 #include <QObject>
 
 class FullTextSearcherPrivate;
+class FullTextIndexManager;
 class FullTextSearcher : public AbstractSearcher
 {
     Q_OBJECT
     friend class TaskCommander;
     friend class MainController;
     friend class FullTextSearcherPrivate;
+    friend class FullTextIndexManager;
 
 private:
     explicit FullTextSearcher(const DUrl &url, const QString &key, QObject *parent = nullptr);
     bool createIndex(const QString &path);
+    void setIndexManager(FullTextIndexManager *manager);
     bool search() override;
     void stop() override;
     bool hasItem() const override;
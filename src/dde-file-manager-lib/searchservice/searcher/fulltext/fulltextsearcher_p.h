@@ -12,13 +12,91 @@
 #include <QStandardPaths>
 #include <QApplication>
 #include <QMutex>
+#include <QFileInfo>
+#include <QWaitCondition>
+#include <QQueue>
 #include <QTime>
 
+// 有界队列，队列满时生产者阻塞，关闭后消费者取完剩余数据再返回
+template<typename T>
+class IndexQueue
+{
+public:
+    explicit IndexQueue(int maxSize)
+        : maxSize(maxSize)
+    {
+    }
+
+    bool push(const T &value)
+    {
+        QMutexLocker lk(&mutex);
+        while (queue.size() >= maxSize && !closed)
+            notFull.wait(&mutex);
+
+        if (closed)
+            return false;
+
+        queue.enqueue(value);
+        notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        QMutexLocker lk(&mutex);
+        while (queue.isEmpty() && !closed)
+            notEmpty.wait(&mutex);
+
+        if (queue.isEmpty())
+            return false;
+
+        value = queue.dequeue();
+        notFull.wakeOne();
+        return true;
+    }
+
+    void close()
+    {
+        QMutexLocker lk(&mutex);
+        closed = true;
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+
+private:
+    QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QQueue<T> queue;
+    int maxSize = 0;
+    bool closed = false;
+};
+
+// 建立索引的吞吐量统计
+struct IndexStatistics
+{
+    qint64 documents = 0;
+    qint64 bytes = 0;
+    qint64 elapsed = 0;   // 毫秒
+
+    qreal documentsPerSecond() const
+    {
+        return elapsed > 0 ? documents * 1000.0 / elapsed : 0;
+    }
+
+    qreal bytesPerSecond() const
+    {
+        return elapsed > 0 ? bytes * 1000.0 / elapsed : 0;
+    }
+};
+
 class FullTextSearcher;
+class FullTextIndexManager;
 class FullTextSearcherPrivate : public QObject
 {
     Q_OBJECT
     friend class FullTextSearcher;
+    friend class FullTextIndexManager;
 
 public:
     enum WordType {
@@ -40,16 +118,24 @@ public:
     };
     Q_ENUM(IndexType)
 
+    // 流水线中传递的索引任务，解析线程填充 doc
+    struct IndexJob
+    {
+        QString file;
+        IndexType type = kAddIndex;
+        Lucene::DocumentPtr doc;
+    };
+
     explicit FullTextSearcherPrivate(FullTextSearcher *parent);
     ~FullTextSearcherPrivate();
 
 private:
-    Lucene::IndexWriterPtr newIndexWriter(bool create = false);
-    Lucene::IndexReaderPtr newIndexReader();
+    static Lucene::IndexWriterPtr newIndexWriter(bool create = false);
+    static Lucene::IndexReaderPtr newIndexReader();
 
     bool createIndex(const QString &path);
     bool updateIndex(const QString &path);
-    bool doSearch(const QString &path, const QString &keyword);
+    bool doSearch(const QString &path, const QString &keyword, bool isManaged = false, bool isFlushed = false);
     inline static QString indexStorePath()
     {
         static QString path = QStandardPaths::standardLocations(QStandardPaths::ConfigLocation).first()
@@ -57,14 +143,26 @@ private:
         return path;
     }
 
-    Lucene::DocumentPtr fileDocument(const QString &file);
+    static Lucene::DocumentPtr fileDocument(const QString &file, qint64 *size = nullptr);
+    static bool isIndexableFile(const QString &file);
+    static bool isIndexCompatible();
+    static bool isDocumentStale(const Lucene::DocumentPtr &doc, const QFileInfo &info);
+    static QStringList ancestorDirectories(const QString &file);
     QString dealKeyword(const QString &keyword);
-    void doIndexTask(const Lucene::IndexReaderPtr &reader, const Lucene::IndexWriterPtr &writer, const QString &path, TaskType type);
-    void indexDocs(const Lucene::IndexWriterPtr &writer, const QString &file, IndexType type);
+    void runIndexPipeline(const Lucene::IndexReaderPtr &reader, const Lucene::IndexWriterPtr &writer, const QString &path, TaskType type);
+    void doIndexTask(const Lucene::IndexReaderPtr &reader, IndexQueue<IndexJob> &jobs, const QString &path, TaskType type);
+    void parseDocs(IndexQueue<IndexJob> &jobs, IndexQueue<IndexJob> &docs);
+    void indexDocs(const Lucene::IndexWriterPtr &writer, const QString &file, IndexType type,
+                   const Lucene::DocumentPtr &doc = Lucene::DocumentPtr());
     bool checkUpdate(const Lucene::IndexReaderPtr &reader, const QString &file, IndexType &type);
     void tryNotify();
 
     bool isUpdated = false;
+    int indexWorkerCount = 1;   // 解析文档的线程数
+    QAtomicInteger<qint64> parsedDocuments = 0;
+    QAtomicInteger<qint64> parsedBytes = 0;
+    IndexStatistics indexStatistics;
+    FullTextIndexManager *indexManager = nullptr;
     QAtomicInt status = AbstractSearcher::kReady;
     QList<DUrl> allResults;
     mutable QMutex mutex;
@@ -9,11 +9,13 @@ HEADERS += \
     $$PWD/searcher/fulltext/chinesetokenizer.h \
     $$PWD/searcher/fulltext/fulltextsearcher.h \
     $$PWD/searcher/fulltext/fulltextsearcher_p.h \
+    $$PWD/searcher/fulltext/fulltextindexmanager.h \
     $$PWD/searcher/iterator/iteratorsearcher.h \
     $$PWD/searcher/abstractsearcher.h \
     $$PWD/utils/searchhelper.h \
     $$PWD/searchservice.h \
     $$PWD/searcher/fsearch/fssearcher.h \
+    $$PWD/searcher/fsearch/fsdatabasemanager.h \
 #    -----------fsearch source---------------
     $$PWD/../../../3rdparty/fsearch/query.h \
     $$PWD/../../../3rdparty/fsearch/array.h \
@@ -25,6 +27,8 @@ HEADERS += \
     $$PWD/../../../3rdparty/fsearch/fsearch_thread_pool.h \
     $$PWD/../../../3rdparty/fsearch/fsearch.h \
     $$PWD/../../../3rdparty/fsearch/string_utils.h \
+    $$PWD/../../../3rdparty/fsearch/string_match.h \
+    $$PWD/../../../3rdparty/fsearch/entry_table.h \
     $$PWD/../../../3rdparty/fsearch/utf8.h
 #    -----------fsearch source---------------
 
@@ -34,11 +38,13 @@ SOURCES += \
     $$PWD/searcher/fulltext/chineseanalyzer.cpp \
     $$PWD/searcher/fulltext/chinesetokenizer.cpp \
     $$PWD/searcher/fulltext/fulltextsearcher.cpp \
+    $$PWD/searcher/fulltext/fulltextindexmanager.cpp \
     $$PWD/searcher/iterator/iteratorsearcher.cpp \
     $$PWD/searcher/abstractsearcher.cpp \
     $$PWD/utils/searchhelper.cpp \
     $$PWD/searchservice.cpp \
     $$PWD/searcher/fsearch/fssearcher.cpp \
+    $$PWD/searcher/fsearch/fsdatabasemanager.cpp \
 #    -----------fsearch source---------------
     $$PWD/../../../3rdparty/fsearch/array.c \
     $$PWD/../../../3rdparty/fsearch/btree.c \
@@ -48,7 +54,9 @@ SOURCES += \
     $$PWD/../../../3rdparty/fsearch/fsearch_thread_pool.c \
     $$PWD/../../../3rdparty/fsearch/fsearch.c \
     $$PWD/../../../3rdparty/fsearch/query.c \
-    $$PWD/../../../3rdparty/fsearch/string_utils.c
+    $$PWD/../../../3rdparty/fsearch/string_utils.c \
+    $$PWD/../../../3rdparty/fsearch/string_match.c \
+    $$PWD/../../../3rdparty/fsearch/entry_table.c
 #    -----------fsearch source---------------
 
 !CONFIG(DISABLE_ANYTHING) {
@@ -0,0 +1,301 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dfmfilesorter.h"
+#include "dfmapplication.h"
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+static const int kMinItemsPerThread = 4096;   // 每个线程至少处理的条目数，条目较少时不值得并行
+
+enum SortColumn {
+    kCustom,
+    kDisplayName,
+    kSize,
+    kModified,
+    kMime,
+    kCreated,
+    kLastRead
+};
+
+typedef bool (*CompareFunctionPointer)(const DAbstractFileInfoPointer &, const DAbstractFileInfoPointer &, Qt::SortOrder, bool);
+
+SortColumn sortColumnOf(const DAbstractFileInfo::CompareFunction &sortFun)
+{
+    const CompareFunctionPointer *target = sortFun.target<CompareFunctionPointer>();
+    if (!target)
+        return kCustom;
+
+    if (*target == FileSortFunction::compareFileListByDisplayName)
+        return kDisplayName;
+    if (*target == FileSortFunction::compareFileListBySize)
+        return kSize;
+    if (*target == FileSortFunction::compareFileListByModified)
+        return kModified;
+    if (*target == FileSortFunction::compareFileListByMime)
+        return kMime;
+    if (*target == FileSortFunction::compareFileListByCreated)
+        return kCreated;
+    if (*target == FileSortFunction::compareFileListByLastRead)
+        return kLastRead;
+
+    return kCustom;
+}
+
+struct StringKey
+{
+    StringKey(const QString &str, const QCollatorSortKey &empty)
+        : text(str), key(empty) {}
+
+    void update()
+    {
+        key = FileSortFunction::collationSortKey(text);
+        isSymbol = DFMGlobal::startWithSymbol(text);
+        isHanzi = DFMGlobal::startWithHanzi(text);
+    }
+
+    QString text;
+    QCollatorSortKey key;
+    bool isSymbol = false;
+    bool isHanzi = false;
+};
+
+struct SortKey
+{
+    SortKey(const DFileNameSortKey &name, const QString &text, const QCollatorSortKey &empty)
+        : name(name), text(text, empty) {}
+
+    bool isDir = false;
+    bool isFile = false;
+    DFileNameSortKey name;
+    StringKey text;
+    qint64 number = 0;
+    QDateTime time;
+};
+
+// 与 FileSortFunction::compareByString 的规则一致
+bool lessString(const StringKey &key1, const StringKey &key2, Qt::SortOrder order)
+{
+    if (key1.isSymbol) {
+        if (!key2.isSymbol)
+            return order == Qt::DescendingOrder;
+    } else if (key2.isSymbol) {
+        return order != Qt::DescendingOrder;
+    }
+
+    if (key1.isHanzi) {
+        if (!key2.isHanzi)
+            return order == Qt::DescendingOrder;
+    } else if (key2.isHanzi) {
+        return order != Qt::DescendingOrder;
+    }
+
+    return ((order == Qt::DescendingOrder) ^ (key1.key.compare(key2.key) < 0)) == 0x01;
+}
+
+// 与 FileSortFunction::compareByDisplayName 的规则一致
+bool lessName(const DFileNameSortKey &key1, const DFileNameSortKey &key2, Qt::SortOrder order)
+{
+    const int result = key1.compare(key2);
+    if (result == 0)
+        return false;
+
+    return ((order == Qt::DescendingOrder) ^ (result < 0)) == 0x01;
+}
+
+// 与 compareFileListByDisplayName 及 COMPARE_FUN_DEFINE 定义的比较函数规则一致
+class KeyCompare
+{
+public:
+    KeyCompare(const std::vector<SortKey> &keys, SortColumn column, Qt::SortOrder order, bool isMixedSort, const bool *cancel)
+        : keys(keys), column(column), order(order), isMixedSort(isMixedSort), cancel(cancel) {}
+
+    bool operator()(int index1, int index2) const
+    {
+        // 取消后视所有元素相等，让排序尽快结束
+        if (cancel && *cancel)
+            return false;
+
+        const SortKey &key1 = keys[static_cast<size_t>(index1)];
+        const SortKey &key2 = keys[static_cast<size_t>(index2)];
+
+        if (!isMixedSort) {
+            if (key1.isDir) {
+                if (!key2.isDir)
+                    return true;
+            } else {
+                if (key2.isDir)
+                    return false;
+            }
+
+            if (column == kDisplayName)
+                return lessName(key1.name, key2.name, order);
+
+            if ((key1.isDir && key2.isDir && equal(key1, key2)) || (key1.isFile && key2.isFile && equal(key1, key2)))
+                return lessName(key1.name, key2.name, Qt::AscendingOrder);
+        } else if (column == kDisplayName) {
+            return lessName(key1.name, key2.name, order);
+        } else if (equal(key1, key2)) {
+            return lessName(key1.name, key2.name, Qt::AscendingOrder);
+        }
+
+        switch (column) {
+        case kMime:
+            return lessString(key1.text, key2.text, order);
+        case kSize:
+            return ((order == Qt::DescendingOrder) ^ (key1.number < key2.number)) == 0x01;
+        default:
+            return ((order == Qt::DescendingOrder) ^ (key1.time < key2.time)) == 0x01;
+        }
+    }
+
+private:
+    bool equal(const SortKey &key1, const SortKey &key2) const
+    {
+        switch (column) {
+        case kMime:
+            return key1.text.text == key2.text.text;
+        case kSize:
+            return key1.number == key2.number;
+        default:
+            return key1.time == key2.time;
+        }
+    }
+
+    const std::vector<SortKey> &keys;
+    SortColumn column;
+    Qt::SortOrder order;
+    bool isMixedSort;
+    const bool *cancel;
+};
+
+/*!
+ * \brief parallelStableSort 分段并行 std::stable_sort，再逐轮两两并行 std::inplace_merge
+ * 合并只发生在相邻的段之间，结果是稳定的
+ */
+template<typename Compare>
+void parallelStableSort(QVector<int> &indexes, const Compare &compare, const bool *cancel)
+{
+    const int count = indexes.size();
+    const int segments = qBound(1, qMin(QThread::idealThreadCount(), count / kMinItemsPerThread), count);
+    if (segments <= 1) {
+        std::stable_sort(indexes.begin(), indexes.end(), compare);
+        return;
+    }
+
+    QVector<int> bounds;
+    for (int i = 0; i <= segments; ++i)
+        bounds << static_cast<int>(static_cast<qint64>(count) * i / segments);
+
+    QVector<int> segmentIndexes;
+    for (int i = 0; i < segments; ++i)
+        segmentIndexes << i;
+
+    int *data = indexes.data();
+    QtConcurrent::blockingMap(segmentIndexes, [&](int segment) {
+        std::stable_sort(data + bounds[segment], data + bounds[segment + 1], compare);
+    });
+
+    for (int width = 1; width < segments; width *= 2) {
+        if (cancel && *cancel)
+            return;
+
+        QVector<int> mergeStarts;
+        for (int i = 0; i + width < segments; i += 2 * width)
+            mergeStarts << i;
+
+        QtConcurrent::blockingMap(mergeStarts, [&](int start) {
+            std::inplace_merge(data + bounds[start],
+                               data + bounds[start + width],
+                               data + bounds[qMin(start + 2 * width, segments)],
+                               compare);
+        });
+    }
+}
+} // namespace
+
+DFMFileSorter::DFMFileSorter(const DAbstractFileInfo::CompareFunction &sortFun, Qt::SortOrder order, const bool *cancel)
+    : sortFun(sortFun)
+    , order(order)
+    , isMixedSort(DFMApplication::appAttribute(DFMApplication::AA_FileAndDirMixedSort).toBool())
+    , cancel(cancel)
+{
+
+}
+
+/*!
+ * \brief DFMFileSorter::sort 计算 infos 排序后的下标顺序
+ * \param infos 待排序的文件
+ * \param indexes 排序结果，indexes[i] 为排在第 i 位的文件在 infos 中的下标
+ * \return 被取消或没有比较函数时返回 false
+ */
+bool DFMFileSorter::sort(const QList<DAbstractFileInfoPointer> &infos, QVector<int> &indexes) const
+{
+    if (!sortFun)
+        return false;
+
+    const int count = infos.size();
+    indexes.resize(count);
+    for (int i = 0; i < count; ++i)
+        indexes[i] = i;
+
+    const SortColumn column = sortColumnOf(sortFun);
+    if (column == kCustom) {
+        // 自定义的比较函数可能访问文件信息，不能保证线程安全，只在当前线程排序
+        std::stable_sort(indexes.begin(), indexes.end(), [&](int index1, int index2) {
+            if (isCanceled())
+                return false;
+            return sortFun(infos.at(index1), infos.at(index2), order, isMixedSort);
+        });
+        return !isCanceled();
+    }
+
+    // 文件信息只在当前线程读取，与原先在排序线程中逐个比较时一致
+    const QCollatorSortKey &empty = FileSortFunction::collationSortKey(QString());
+    std::vector<SortKey> keys;
+    keys.reserve(static_cast<size_t>(count));
+    for (const DAbstractFileInfoPointer &info : infos) {
+        if (isCanceled())
+            return false;
+
+        // 名称排序键缓存在文件信息中，只在首次排序时计算；汉字转拼音的字典不是线程安全的，不能并行计算
+        keys.emplace_back(info->fileDisplayNameSortKey(), column == kMime ? info->fileTypeDisplayName() : QString(), empty);
+        SortKey &key = keys.back();
+        key.isDir = info->isDir();
+        key.isFile = info->isFile();
+        switch (column) {
+        case kSize:
+            key.number = info->fileSize();
+            break;
+        case kModified:
+            key.time = info->lastModified();
+            break;
+        case kCreated:
+            key.time = info->created();
+            break;
+        case kLastRead:
+            key.time = info->lastRead();
+            break;
+        default:
+            break;
+        }
+    }
+
+    // 类型名称的排序键只依赖字符串本身，可以并行计算
+    if (column == kMime)
+        QtConcurrent::blockingMap(keys, [](SortKey &key) { key.text.update(); });
+
+    parallelStableSort(indexes, KeyCompare(keys, column, order, isMixedSort, cancel), cancel);
+    return !isCanceled();
+}
+
+bool DFMFileSorter::isCanceled() const
+{
+    return cancel && *cancel;
+}
@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DFMFILESORTER_H
+#define DFMFILESORTER_H
+
+#include "dabstractfileinfo.h"
+
+#include <QVector>
+
+/*!
+ * \brief The DFMFileSorter class 对文件列表排序
+ * 对内置的排序列（名称、大小、时间、类型）预先计算每个文件的排序键，再以多线程稳定归并排序，
+ * 其它自定义的比较函数退回到单线程稳定排序。两种方式都与逐个比较 CompareFunction 的结果一致。
+ */
+class DFMFileSorter
+{
+public:
+    explicit DFMFileSorter(const DAbstractFileInfo::CompareFunction &sortFun, Qt::SortOrder order, const bool *cancel = nullptr);
+
+    bool sort(const QList<DAbstractFileInfoPointer> &infos, QVector<int> &indexes) const;
+
+    template<typename T, typename InfoOf>
+    bool sort(QList<T> &list, InfoOf infoOf) const
+    {
+        QList<DAbstractFileInfoPointer> infos;
+        infos.reserve(list.size());
+        for (const T &item : list)
+            infos << infoOf(item);
+
+        QVector<int> indexes;
+        if (!sort(infos, indexes))
+            return false;
+
+        QList<T> sorted;
+        sorted.reserve(list.size());
+        for (int index : indexes)
+            sorted << list.at(index);
+        list = sorted;
+
+        return true;
+    }
+
+private:
+    bool isCanceled() const;
+
+    DAbstractFileInfo::CompareFunction sortFun;
+    Qt::SortOrder order;
+    bool isMixedSort;
+    const bool *cancel;
+};
+
+#endif // DFMFILESORTER_H
@@ -0,0 +1,435 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dfmthumbnailimagereader.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QSet>
+#include <QTransform>
+#include <QtEndian>
+
+namespace {
+static const int kMaxIfdCount = 16;   // 损坏的文件中 IFD 可能成环，限制遍历的数量
+static const int kMaxIfdEntries = 1024;
+static const int kMaxJpegMarkers = 32;   // Exif 段一般紧跟 SOI，不再往后查找
+static const qint64 kPreviewProbeSize = 64 * 1024;   // 读取预览图尺寸时只读开头部分
+static const qint64 kMaxPreviewSize = 32 * 1024 * 1024;
+
+enum TiffTag : quint16 {
+    CompressionTag = 0x0103,
+    StripOffsetsTag = 0x0111,
+    OrientationTag = 0x0112,
+    StripByteCountsTag = 0x0117,
+    SubIfdsTag = 0x014a,
+    JpegOffsetTag = 0x0201,
+    JpegLengthTag = 0x0202
+};
+
+enum TiffType : quint16 {
+    ShortType = 3,
+    LongType = 4,
+    IfdType = 13
+};
+
+// 只读取 EXIF/TIFF 目录中与内嵌 JPEG 预览图有关的字段
+class TiffParser
+{
+public:
+    TiffParser(QFile &file, qint64 base)
+        : file(file), base(base), fileSize(file.size()) {}
+
+    bool parse(QList<DFMThumbnailImageReader::Preview> &previews, int &orientation)
+    {
+        QByteArray header = readAt(0, 8);
+        if (header.size() != 8)
+            return false;
+
+        if (header.startsWith("II"))
+            bigEndian = false;
+        else if (header.startsWith("MM"))
+            bigEndian = true;
+        else
+            return false;
+
+        // ORF 与 RW2 使用非标准的魔数，目录结构相同
+        const quint16 magic = toU16(header.constData() + 2);
+        if (magic != 42 && magic != 0x4f52 && magic != 0x5352 && magic != 0x55)
+            return false;
+
+        quint32 offset = toU32(header.constData() + 4);
+        // IFD0 描述主图，IFD1 一般是 EXIF 缩略图，RAW 文件的大预览图通常在 SubIFD 中
+        for (int i = 0; offset != 0 && i < kMaxIfdCount; ++i)
+            offset = parseIfd(offset, i == 0, previews, orientation);
+
+        return true;
+    }
+
+private:
+    quint16 toU16(const char *data) const
+    {
+        return bigEndian ? qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(data))
+               : qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data));
+    }
+
+    quint32 toU32(const char *data) const
+    {
+        return bigEndian ? qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data))
+               : qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+    }
+
+    QByteArray readAt(qint64 offset, qint64 length)
+    {
+        if (offset < 0 || length <= 0 || base + offset + length > fileSize || !file.seek(base + offset))
+            return QByteArray();
+
+        return file.read(length);
+    }
+
+    quint32 valueOf(const char *entry) const
+    {
+        const quint16 type = toU16(entry + 2);
+        if (type == ShortType)
+            return toU16(entry + 8);
+        if (type == LongType || type == IfdType)
+            return toU32(entry + 8);
+
+        return 0;
+    }
+
+    // 解析一个 IFD，返回下一个 IFD 的位置
+    quint32 parseIfd(quint32 offset, bool isMainIfd, QList<DFMThumbnailImageReader::Preview> &previews, int &orientation)
+    {
+        if (visited.contains(offset) || visited.size() >= kMaxIfdCount)
+            return 0;
+        visited.insert(offset);
+
+        const QByteArray countData = readAt(offset, 2);
+        if (countData.size() != 2)
+            return 0;
+
+        const int count = toU16(countData.constData());
+        if (count <= 0 || count > kMaxIfdEntries)
+            return 0;
+
+        const QByteArray entries = readAt(offset + 2, count * 12 + 4);
+        if (entries.size() != count * 12 + 4)
+            return 0;
+
+        quint32 jpegOffset = 0, jpegLength = 0, stripOffset = 0, stripLength = 0, compression = 0;
+        QList<quint32> subIfds;
+        for (int i = 0; i < count; ++i) {
+            const char *entry = entries.constData() + i * 12;
+            const quint32 valueCount = toU32(entry + 4);
+
+            switch (toU16(entry)) {
+            case JpegOffsetTag:
+                jpegOffset = valueOf(entry);
+                break;
+            case JpegLengthTag:
+                jpegLength = valueOf(entry);
+                break;
+            case CompressionTag:
+                compression = valueOf(entry);
+                break;
+            case StripOffsetsTag:
+                // 只处理单个条带的 JPEG 数据
+                if (valueCount == 1)
+                    stripOffset = valueOf(entry);
+                break;
+            case StripByteCountsTag:
+                if (valueCount == 1)
+                    stripLength = valueOf(entry);
+                break;
+            case OrientationTag:
+                if (isMainIfd)
+                    orientation = static_cast<int>(valueOf(entry));
+                break;
+            case SubIfdsTag:
+                if (valueCount == 1) {
+                    subIfds << valueOf(entry);
+                } else if (valueCount > 1 && valueCount <= kMaxIfdCount) {
+                    const QByteArray array = readAt(toU32(entry + 8), valueCount * 4);
+                    for (int j = 0; j + 4 <= array.size(); j += 4)
+                        subIfds << toU32(array.constData() + j);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (jpegOffset > 0 && jpegLength > 0)
+            appendPreview(jpegOffset, jpegLength, previews);
+
+        // 6 为旧式 JPEG，7 为 JPEG，其中无损 JPEG 的主图在读取尺寸时会被排除
+        if ((compression == 6 || compression == 7) && stripOffset > 0 && stripLength > 0)
+            appendPreview(stripOffset, stripLength, previews);
+
+        for (quint32 subIfd : subIfds)
+            parseIfd(subIfd, false, previews, orientation);
+
+        return toU32(entries.constData() + count * 12);
+    }
+
+    void appendPreview(quint32 offset, quint32 length, QList<DFMThumbnailImageReader::Preview> &previews)
+    {
+        if (length > kMaxPreviewSize || base + offset + length > fileSize)
+            return;
+
+        for (const DFMThumbnailImageReader::Preview &preview : previews) {
+            if (preview.offset == base + offset)
+                return;
+        }
+
+        DFMThumbnailImageReader::Preview preview;
+        preview.offset = base + offset;
+        preview.length = length;
+        previews << preview;
+    }
+
+    QFile &file;
+    qint64 base;
+    qint64 fileSize;
+    bool bigEndian = false;
+    QSet<quint32> visited;
+};
+
+// 在 JPEG 文件中查找 APP1 Exif 段，返回其中 TIFF 头的位置，未找到返回 -1
+qint64 exifTiffOffset(QFile &file)
+{
+    qint64 pos = 2;
+    for (int i = 0; i < kMaxJpegMarkers; ++i) {
+        if (!file.seek(pos))
+            return -1;
+
+        const QByteArray marker = file.read(4);
+        if (marker.size() != 4 || static_cast<uchar>(marker.at(0)) != 0xff)
+            return -1;
+
+        const uchar type = static_cast<uchar>(marker.at(1));
+        // SOS 之后是图像数据，不会再有 Exif 段
+        if (type == 0xda || type == 0xd9)
+            return -1;
+
+        const quint16 length = qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(marker.constData() + 2));
+        if (length < 2)
+            return -1;
+
+        if (type == 0xe1 && length > 8 && file.read(6) == QByteArray("Exif\0\0", 6))
+            return pos + 4 + 6;
+
+        pos += 2 + length;
+    }
+
+    return -1;
+}
+
+QImage applyOrientation(const QImage &image, int orientation)
+{
+    switch (orientation) {
+    case 2:
+        return image.mirrored(true, false);
+    case 3:
+        return image.transformed(QTransform().rotate(180));
+    case 4:
+        return image.mirrored(false, true);
+    case 5:
+        return image.transformed(QTransform().rotate(90)).mirrored(true, false);
+    case 6:
+        return image.transformed(QTransform().rotate(90));
+    case 7:
+        return image.transformed(QTransform().rotate(270)).mirrored(true, false);
+    case 8:
+        return image.transformed(QTransform().rotate(270));
+    default:
+        return image;
+    }
+}
+
+QSize previewSize(QFile &file, const DFMThumbnailImageReader::Preview &preview)
+{
+    if (!file.seek(preview.offset))
+        return QSize();
+
+    QByteArray data = file.read(qMin(preview.length, kPreviewProbeSize));
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer, "jpeg");
+
+    return reader.canRead() ? reader.size() : QSize();
+}
+}
+
+DFMThumbnailImageReader::DFMThumbnailImageReader(const QString &filePath, const QByteArray &format)
+    : filePath(filePath)
+    , format(format)
+{
+
+}
+
+/*!
+ * \brief DFMThumbnailImageReader::read 读取不超过 size x size 的图片，保持宽高比并按 EXIF 方向旋转
+ */
+bool DFMThumbnailImageReader::read(int size, QImage &image)
+{
+    readSource = NoSource;
+    error.clear();
+
+    if (readEmbeddedPreview(size, false, image) || readScaled(size, image))
+        return true;
+
+    // 原图无法解码时（如没有解码插件的 RAW 文件），尺寸不够的预览图也比没有好
+    const QString scaledError = error;
+    if (readEmbeddedPreview(size, true, image))
+        return true;
+
+    error = scaledError;
+    return false;
+}
+
+DFMThumbnailImageReader::Source DFMThumbnailImageReader::source() const
+{
+    return readSource;
+}
+
+QString DFMThumbnailImageReader::errorString() const
+{
+    return error;
+}
+
+/*!
+ * \brief DFMThumbnailImageReader::embeddedPreviews 查找 JPEG 或基于 TIFF 的 RAW 文件中内嵌的 JPEG 预览图
+ * 只读取文件头和 EXIF 目录，不读取图像数据
+ */
+QList<DFMThumbnailImageReader::Preview> DFMThumbnailImageReader::embeddedPreviews(const QString &filePath)
+{
+    QList<Preview> previews;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return previews;
+
+    const QByteArray magic = file.read(2);
+    qint64 base = 0;
+    if (magic == QByteArray("\xff\xd8", 2))
+        base = exifTiffOffset(file);
+    else if (magic != "II" && magic != "MM")
+        return previews;
+
+    if (base < 0)
+        return previews;
+
+    int orientation = 1;
+    TiffParser(file, base).parse(previews, orientation);
+    if (orientation < 1 || orientation > 8)
+        orientation = 1;
+
+    for (Preview &preview : previews)
+        preview.orientation = orientation;
+
+    return previews;
+}
+
+/*!
+ * \brief DFMThumbnailImageReader::readEmbeddedPreview 使用长边不小于 size 的最小预览图
+ * \param allowSmaller 没有足够大的预览图时使用最大的一个
+ */
+bool DFMThumbnailImageReader::readEmbeddedPreview(int size, bool allowSmaller, QImage &image)
+{
+    const QList<Preview> &previews = embeddedPreviews(filePath);
+    if (previews.isEmpty())
+        return false;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // 部分相机生成的 EXIF 缩略图固定为 4:3 并加了黑边，与原图比例不同时不使用
+    QSize mainSize;
+    if (format.isEmpty() || format == "jpeg" || format == "jpg")
+        mainSize = QImageReader(filePath, format).size();
+
+    const Preview *best = nullptr;
+    QSize bestSize;
+    for (const Preview &preview : previews) {
+        const QSize &s = previewSize(file, preview);
+        if (s.isEmpty())
+            continue;
+
+        if (mainSize.isValid() && !mainSize.isEmpty()) {
+            const qreal ratio = qreal(s.width()) / s.height();
+            const qreal mainRatio = qreal(mainSize.width()) / mainSize.height();
+            if (qAbs(ratio - mainRatio) > mainRatio * 0.02)
+                continue;
+        }
+
+        const qint64 pixels = qint64(s.width()) * s.height();
+        const qint64 bestPixels = qint64(bestSize.width()) * bestSize.height();
+        if (!allowSmaller) {
+            if (qMax(s.width(), s.height()) < size)
+                continue;
+            if (best && pixels >= bestPixels)
+                continue;
+        } else if (best && pixels <= bestPixels) {
+            continue;
+        }
+
+        best = &preview;
+        bestSize = s;
+    }
+
+    if (!best || !file.seek(best->offset))
+        return false;
+
+    QByteArray data = file.read(best->length);
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer, "jpeg");
+    if (bestSize.width() > size || bestSize.height() > size)
+        reader.setScaledSize(bestSize.scaled(size, size, Qt::KeepAspectRatio));
+
+    QImage preview;
+    if (!reader.read(&preview))
+        return false;
+
+    image = applyOrientation(preview, best->orientation);
+    readSource = EmbeddedPreview;
+
+    return true;
+}
+
+bool DFMThumbnailImageReader::readScaled(int size, QImage &image)
+{
+    QImageReader reader(filePath, format);
+    if (!reader.canRead()) {
+        error = reader.errorString();
+        return false;
+    }
+
+    const QSize &imageSize = reader.size();
+
+    //fix 读取损坏icns文件（可能任意损坏的image类文件也有此情况）在arm平台上会导致递归循环的问题
+    //这里先对损坏文件（imagesize无效）做处理，不再尝试读取其image数据
+    if (!imageSize.isValid()) {
+        error = "Fail to read image file attribute data:" + filePath;
+        return false;
+    }
+
+    // 在解码前设置缩放尺寸，JPEG 可以直接在 DCT 域缩小，不必解码出完整的原图
+    if (imageSize.width() > size || imageSize.height() > size || format.startsWith("svg"))
+        reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+
+    reader.setAutoTransform(true);
+
+    if (!reader.read(&image)) {
+        error = reader.errorString();
+        return false;
+    }
+
+    if (image.width() > size || image.height() > size)
+        image = image.scaled(size, size, Qt::KeepAspectRatio);
+
+    readSource = ScaledDecode;
+
+    return true;
+}
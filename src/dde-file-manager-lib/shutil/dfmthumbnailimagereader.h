@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DFMTHUMBNAILIMAGEREADER_H
+#define DFMTHUMBNAILIMAGEREADER_H
+
+#include <QImage>
+#include <QString>
+
+/*!
+ * \brief The DFMThumbnailImageReader class 以缩略图尺寸读取图片
+ * 优先使用 JPEG/TIFF/RAW 文件 EXIF 中内嵌的预览图，预览图不存在或尺寸不够时，
+ * 让解码器直接按缩略图尺寸解码（JPEG 在 DCT 域缩小），避免先解码出完整的原图再缩放。
+ */
+class DFMThumbnailImageReader
+{
+public:
+    enum Source {
+        NoSource,
+        EmbeddedPreview,   // EXIF 内嵌的预览图
+        ScaledDecode   // 原图按缩略图尺寸解码
+    };
+
+    struct Preview {
+        qint64 offset = 0;   // 内嵌 JPEG 在文件中的位置
+        qint64 length = 0;
+        int orientation = 1;   // EXIF Orientation，1 表示无需变换
+    };
+
+    explicit DFMThumbnailImageReader(const QString &filePath, const QByteArray &format = QByteArray());
+
+    bool read(int size, QImage &image);
+    Source source() const;
+    QString errorString() const;
+
+    static QList<Preview> embeddedPreviews(const QString &filePath);
+
+private:
+    bool readEmbeddedPreview(int size, bool allowSmaller, QImage &image);
+    bool readScaled(int size, QImage &image);
+
+    QString filePath;
+    QByteArray format;
+    Source readSource = NoSource;
+    QString error;
+};
+
+#endif // DFMTHUMBNAILIMAGEREADER_H
@@ -338,6 +338,44 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
 };
 
 
+///###: the statements of files are run once for every file in a batch,
+///###: so they bind values and are prepared only once for a connection.
+static constexpr const char *const SELECT_TAGS_OF_FILE{
+    "SELECT tag_with_file.tag_name FROM tag_with_file WHERE tag_with_file.file_name = ?"
+};
+static constexpr const char *const INSERT_TAG_OF_FILE{
+    "INSERT INTO tag_with_file (file_name, tag_name) SELECT ?, ? "
+    "WHERE NOT EXISTS (SELECT 1 FROM tag_with_file WHERE tag_with_file.file_name = ? AND tag_with_file.tag_name = ?)"
+};
+static constexpr const char *const DELETE_TAG_OF_FILE{
+    "DELETE FROM tag_with_file WHERE tag_with_file.file_name = ? AND tag_with_file.tag_name = ?"
+};
+static constexpr const char *const COUNT_FILE_PROPERTY{
+    "SELECT COUNT(file_property.file_name) AS counter FROM file_property WHERE file_property.file_name = ?"
+};
+static constexpr const char *const INSERT_FILE_PROPERTY{
+    "INSERT INTO file_property (file_name, tag_1, tag_2, tag_3) VALUES (?, ?, ?, ?)"
+};
+static constexpr const char *const UPDATE_FILE_PROPERTY{
+    "UPDATE file_property SET tag_1 = ?, tag_2 = ?, tag_3 = ? WHERE file_property.file_name = ?"
+};
+static constexpr const char *const DELETE_FILE_PROPERTY{
+    "DELETE FROM file_property WHERE file_property.file_name = ?"
+};
+static constexpr const char *const RENAME_FILE_PROPERTY{
+    "UPDATE file_property SET file_name = ? WHERE file_property.file_name = ?"
+};
+static constexpr const char *const RENAME_TAG_WITH_FILE{
+    "UPDATE tag_with_file SET file_name = ? WHERE tag_with_file.file_name = ?"
+};
+
+///###: tag_with_file has no key, every query of a file or a tag scanned the whole table without them.
+static const QList<QString> IndexesOfTagWithFile{
+    "CREATE INDEX IF NOT EXISTS tag_with_file_file_name_tag_name ON tag_with_file (file_name, tag_name)",
+    "CREATE INDEX IF NOT EXISTS tag_with_file_tag_name ON tag_with_file (tag_name)"
+};
+
+
 DSqliteHandle::DSqliteHandle(QObject *const parent)
     : QObject{ parent },
       m_sqlDatabasePtr{ new QSqlDatabase }
@@ -663,6 +701,13 @@ QVariant DSqliteHandle::disposeClientData(const QMap<QString, QList<QString>> &f
 
             break;
         }
+        case 14: { ///###: tags of each file.
+            std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            QMap<QString, QVariant> files_and_tags{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(filesAndTags) };
+            var.setValue(files_and_tags);
+
+            break;
+        }
         default:
             break;
         }
@@ -696,11 +741,17 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
 {
     DSqliteHandle::ReturnCode code = this->checkDBFileExist(path, db_name);
     std::function<void()> initDatabasePtr{ [&]{
-            if (m_sqlDatabasePtr->isOpen())
+            QString DBName{path + QString{"/"} + db_name};
+
+            ///###: keep using the opened connection and its prepared statements.
+            if (code == DSqliteHandle::ReturnCode::Exist && m_sqlDatabasePtr
+                    && m_sqlDatabasePtr->isOpen() && m_sqlDatabasePtr->databaseName() == DBName)
             {
-                m_sqlDatabasePtr->close();
+                return;
             }
 
+            this->resetSqlDatabase();
+
             if (QSqlDatabase::contains(CONNECTIONNAME))
             {
                 m_sqlDatabasePtr.reset(nullptr);
@@ -708,7 +759,6 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
             }
 
             m_sqlDatabasePtr = std::unique_ptr<QSqlDatabase>{new QSqlDatabase{ QSqlDatabase::addDatabase(R"foo(QSQLITE)foo", CONNECTIONNAME)} };
-            QString DBName{path + QString{"/"} + db_name};
 
             ///###: for debugging.
 //            qDebug() << DBName;
@@ -721,7 +771,7 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
     if (code == DSqliteHandle::ReturnCode::NoExist) {
         initDatabasePtr();
 
-        if (m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
             if (m_sqlDatabasePtr->transaction()) {
                 QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
 
@@ -754,6 +804,12 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
                             qWarning() << sqlQuery.lastError().text();
                         }
 
+                        for (const QString &createIndex : IndexesOfTagWithFile) {
+                            if (!sqlQuery.exec(createIndex)) {
+                                qWarning() << sqlQuery.lastError().text();
+                            }
+                        }
+
                     } else {
                         DSqliteHandle::ReturnCode return_code{ this->checkDBFileExist(path) };
 
@@ -766,6 +822,12 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
                             if (!sqlQuery.exec(createTagWithFile)) {
                                 qWarning() << sqlQuery.lastError().text();
                             }
+
+                            for (const QString &createIndex : IndexesOfTagWithFile) {
+                                if (!sqlQuery.exec(createIndex)) {
+                                    qWarning() << sqlQuery.lastError().text();
+                                }
+                            }
                         }
                     }
 
@@ -853,6 +915,94 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
     this->closeSqlDatabase();
 }
 
+bool DSqliteHandle::openSqlDatabase()
+{
+    if (!m_sqlDatabasePtr) {
+        return false;
+    }
+
+    if (m_sqlDatabasePtr->isOpen()) {
+        return true;
+    }
+
+    m_preparedQueries.clear();
+
+    if (!m_sqlDatabasePtr->open()) {
+        qWarning() << m_sqlDatabasePtr->lastError().text();
+        return false;
+    }
+
+    QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+
+    ///###: with WAL the readers are not blocked by a batch being written,
+    ///###: and NORMAL only syncs at checkpoints instead of every commit.
+    if (!sqlQuery.exec("PRAGMA journal_mode = WAL") || !sqlQuery.exec("PRAGMA synchronous = NORMAL")) {
+        qWarning() << sqlQuery.lastError().text();
+    }
+
+    ///###: the DB created by old versions has no index.
+    if (m_sqlDatabasePtr->tables().contains("tag_with_file")) {
+
+        for (const QString &createIndex : IndexesOfTagWithFile) {
+            if (!sqlQuery.exec(createIndex)) {
+                qWarning() << sqlQuery.lastError().text();
+            }
+        }
+    }
+
+    return true;
+}
+
+void DSqliteHandle::resetSqlDatabase()
+{
+    m_preparedQueries.clear();
+
+    if (m_sqlDatabasePtr && m_sqlDatabasePtr->isOpen()) {
+        m_sqlDatabasePtr->close();
+    }
+}
+
+QSqlQuery &DSqliteHandle::preparedQuery(const QString &sql)
+{
+    std::unique_ptr<QSqlQuery> &query = m_preparedQueries[sql];
+
+    if (!query) {
+        query.reset(new QSqlQuery{ *m_sqlDatabasePtr });
+
+        if (!query->prepare(sql)) {
+            qWarning() << query->lastError().text();
+        }
+    }
+
+    return *query;
+}
+
+QList<QString> DSqliteHandle::tagsOfFile(const QString &file, bool *ok)
+{
+    QList<QString> tagNames{};
+    QSqlQuery &sqlQuery = this->preparedQuery(SELECT_TAGS_OF_FILE);
+    sqlQuery.bindValue(0, file);
+    bool result{ sqlQuery.exec() };
+
+    if (result) {
+
+        while (sqlQuery.next()) {
+            tagNames.push_back(sqlQuery.value(0).toString());
+        }
+
+    } else {
+        qWarning() << sqlQuery.lastError().text();
+    }
+
+    sqlQuery.finish();
+
+    if (ok) {
+        *ok = result;
+    }
+
+    return tagNames;
+}
+
 void DSqliteHandle::connectToShareSqlite(const QString &path, const QString &db_name)
 {
     //检查share目录中是否已有数据库存在
@@ -900,42 +1050,23 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles, QMap<QString,
     if (!forDecreasing.isEmpty() && !mountPoint.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ forDecreasing.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ forDecreasing.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
+        QSqlQuery &sqlQuery = this->preparedQuery(DELETE_TAG_OF_FILE);
 
         for (; cbeg != cend; ++cbeg) {
 
             for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(tagName) };
-                sql = sql.arg(cbeg.key());
 
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    ///###: delete redundant item in tag_with_file.
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+                if (m_flag.load(std::memory_order_acquire)
+                        && this->checkDBFileExist(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                    return false;
+                }
 
-                    } else {
+                ///###: delete redundant item in tag_with_file.
+                sqlQuery.bindValue(0, cbeg.key());
+                sqlQuery.bindValue(1, tagName);
 
-                        return false;
-                    }
+                if (!sqlQuery.exec()) {
+                    qWarning() << sqlQuery.lastError().text();
                 }
             }
         }
@@ -954,41 +1085,25 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString,
     if (!forIncreasing.isEmpty() && !mountPoint.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ forIncreasing.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ forIncreasing.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+        QSqlQuery &sqlQuery = this->preparedQuery(INSERT_TAG_OF_FILE);
 
         for (; cbeg != cend; ++cbeg) {
 
             for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(cbeg.key()) };
-                sql = sql.arg(tagName);
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    ///###: tag files
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
 
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+                if (m_flag.load(std::memory_order_acquire)
+                        && this->checkDBFileExist(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                    return false;
+                }
 
-                    } else {
+                ///###: tag files, a file which was tagged by the tag is skipped.
+                sqlQuery.bindValue(0, cbeg.key());
+                sqlQuery.bindValue(1, tagName);
+                sqlQuery.bindValue(2, cbeg.key());
+                sqlQuery.bindValue(3, tagName);
 
-                        return false;
-                    }
+                if (!sqlQuery.exec()) {
+                    qWarning() << sqlQuery.lastError().text();
                 }
             }
         }
@@ -1001,193 +1116,73 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString,
 
 
 
+///###: refresh file_property through the tags left in tag_with_file, it records the last 3 tags of a file.
 template<>
 bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(const QList<QString> &forUpdating,
                                                                                          const QString &mountPoint)
 {
     if (!forUpdating.isEmpty() && !mountPoint.isEmpty()) {
-        QList<QString>::const_iterator cbeg{ forUpdating.cbegin() };
-        QList<QString>::const_iterator cend{ forUpdating.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr; ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        for (; cbeg != cend; ++cbeg) {
-            QString sqlForGettingTag{ itr->second.arg(*cbeg) };
-            std::vector<QString> leftTags{};
-
-            if (!m_flag.load(std::memory_order_acquire)) {
-
-                if (sqlQuery.exec(sqlForGettingTag)) {
-
-                    while (sqlQuery.next()) {
-                        QString tagName{ sqlQuery.value("tag_name").toString() };
-                        leftTags.push_back(tagName);
-                    }
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
 
-                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                    if (sqlQuery.exec(sqlForGettingTag)) {
-
-                        while (sqlQuery.next()) {
-                            QString tagName{ sqlQuery.value("tag_name").toString() };
-                            leftTags.push_back(tagName);
-                        }
-                    }
+        for (const QString &file : forUpdating) {
 
-                } else {
-                    return false;
-                }
+            if (m_flag.load(std::memory_order_acquire)
+                    && this->checkDBFileExist(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                return false;
             }
 
-            if (leftTags.empty()) {
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForDelRowInFileProperty{itr};
-                --itrForDelRowInFileProperty;
-                QString sqlForDelRowInFileProperty{ itrForDelRowInFileProperty->second.arg(*cbeg) };
+            bool ok{ false };
+            QList<QString> leftTags{ this->tagsOfFile(file, &ok) };
 
+            if (!ok) {
+                continue;
+            }
 
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    if (!sqlQuery.exec(sqlForDelRowInFileProperty)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+            if (leftTags.isEmpty()) {
+                QSqlQuery &sqlForDelRowInFileProperty = this->preparedQuery(DELETE_FILE_PROPERTY);
+                sqlForDelRowInFileProperty.bindValue(0, file);
 
-                        if (!sqlQuery.exec(sqlForDelRowInFileProperty)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
-
-                    } else {
-                        return false;
-                    }
+                if (!sqlForDelRowInFileProperty.exec()) {
+                    qWarning() << sqlForDelRowInFileProperty.lastError().text();
                 }
 
-            } else {
-
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForCounterFileInFP{ itr };
-                ++itrForCounterFileInFP; ++itrForCounterFileInFP;
-                QString sqlOfCountingFileInFP{ itrForCounterFileInFP->second.arg(*cbeg) };
-
-                int cnter{ 0 };
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    if (sqlQuery.exec(sqlOfCountingFileInFP)) {
-
-                        if (sqlQuery.next()) {
-                            cnter =  sqlQuery.value("counter").toInt();
-                        }
-                    }
+                continue;
+            }
 
-                } else {
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
+            while (leftTags.size() < 3) {
+                leftTags.push_back(QString{""});
+            }
 
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+            int sizeOfTags{ leftTags.size() };
+            QSqlQuery &sqlOfCountingFileInFP = this->preparedQuery(COUNT_FILE_PROPERTY);
+            sqlOfCountingFileInFP.bindValue(0, file);
+            int cnter{ 0 };
 
-                        if (sqlQuery.exec(sqlOfCountingFileInFP)) {
-                            cnter = sqlQuery.value("counter").toInt();
-                        }
-
-                    } else {
-                        return false;
-                    }
-                }
+            if (sqlOfCountingFileInFP.exec() && sqlOfCountingFileInFP.next()) {
+                cnter = sqlOfCountingFileInFP.value(0).toInt();
+            }
 
-                std::size_t size{ leftTags.size() };
+            sqlOfCountingFileInFP.finish();
 
-                if (size < 3) {
-                    std::size_t differenceValue{ 3u - size };
+            if (cnter > 0) {
+                QSqlQuery &sqlForUpdatingFileProperty = this->preparedQuery(UPDATE_FILE_PROPERTY);
+                sqlForUpdatingFileProperty.bindValue(0, leftTags[sizeOfTags - 3]);
+                sqlForUpdatingFileProperty.bindValue(1, leftTags[sizeOfTags - 2]);
+                sqlForUpdatingFileProperty.bindValue(2, leftTags[sizeOfTags - 1]);
+                sqlForUpdatingFileProperty.bindValue(3, file);
 
-                    for (std::size_t index = 0; index < differenceValue; ++index) {
-                        leftTags.push_back(QString{});
-                    }
+                if (!sqlForUpdatingFileProperty.exec()) {
+                    qWarning() << sqlForUpdatingFileProperty.lastError().text();
                 }
 
+            } else {
+                QSqlQuery &sqlForInsertRowInFP = this->preparedQuery(INSERT_FILE_PROPERTY);
+                sqlForInsertRowInFP.bindValue(0, file);
+                sqlForInsertRowInFP.bindValue(1, leftTags[sizeOfTags - 3]);
+                sqlForInsertRowInFP.bindValue(2, leftTags[sizeOfTags - 2]);
+                sqlForInsertRowInFP.bindValue(3, leftTags[sizeOfTags - 1]);
 
-                if (cnter > 0) {
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdating{itr};
-                    ++itrForUpdating;
-
-                    std::size_t sizeOfTags{ leftTags.size() };
-
-                    QString sqlForUpdatingFileProperty{itrForUpdating->second.arg(leftTags[sizeOfTags - 3])};
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(leftTags[sizeOfTags - 2]);
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(leftTags[sizeOfTags - 1]);
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(*cbeg);
-
-                    if (!m_flag.load(std::memory_order_acquire)) {
-
-                        if (!sqlQuery.exec(sqlForUpdatingFileProperty)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
-
-                    } else {
-
-                        DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                        if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                            if (!sqlQuery.exec(sqlForUpdatingFileProperty)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                        } else {
-                            return false;
-                        }
-
-                    }
-
-                } else {
-
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForInsertRowInFP{ itr };
-                    ++itrForInsertRowInFP;
-                    ++itrForInsertRowInFP;
-                    ++itrForInsertRowInFP;
-                    std::size_t sizeOfTags{ leftTags.size() };
-                    QString sqlForInsertRowInFP{ itrForInsertRowInFP->second.arg(*cbeg) };
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 3]);
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 2]);
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 1]);
-
-
-                    if (!m_flag.load(std::memory_order_acquire)) {
-
-                        if (!sqlQuery.exec(sqlForInsertRowInFP)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
-
-                    } else {
-
-                        DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                        if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                            if (!sqlQuery.exec(sqlForInsertRowInFP)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                        } else {
-                            return false;
-                        }
-                    }
+                if (!sqlForInsertRowInFP.exec()) {
+                    qWarning() << sqlForInsertRowInFP.lastError().text();
                 }
             }
         }
@@ -1372,357 +1367,105 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor,
                                         sql_for_inserting_new_row = sql_for_inserting_new_row.arg(*tagNameItr);
                                         sql_for_inserting_new_row = sql_for_inserting_new_row.arg(*(++tagNameItr));
                                         sql_for_inserting_new_row = sql_for_inserting_new_row.arg(*(++tagNameItr));
-                                        sql_for_inserting_new_row = sql_for_inserting_new_row.arg(std::get<4>(*cbeg));
-
-                                        if (!sqlQuery.exec(sql_for_inserting_new_row)) {
-                                            qWarning() << sqlQuery.lastError().text();
-                                            result = false;
-                                            break;
-                                        }
-                                        continue;
-
-                                    } else {
-                                        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator sqlItrForUpdating{ range.first };
-                                        ++sqlItrForUpdating;
-                                        QString sqlForUpdating{ sqlItrForUpdating->second };
-                                        sqlForUpdating = sqlForUpdating.arg(*tagNameItr);
-                                        sqlForUpdating = sqlForUpdating.arg(*(++tagNameItr));
-                                        sqlForUpdating = sqlForUpdating.arg(*(++tagNameItr));
-                                        sqlForUpdating = sqlForUpdating.arg(std::get<4>(*cbeg));
-
-                                        if (!sqlQuery.exec(sqlForInsertingNewRow)) {
-                                            qWarning() << sqlQuery.lastError().text();
-                                            result = false;
-                                            break;
-                                        }
-                                        continue;
-                                    }
-                                }
-                            }
-                        }
-                        result = false;
-                        break;
-                    }
-                    continue;
-                }
-                result = false;
-                break;
-            }
-        }
-        return result;
-    }
-    return false;
-}
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(const QString &tag_name, const QString &mountPoint)
-{
-    if (!tag_name.isEmpty() && mountPoint == QString{"/home"}) {
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-                  std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFilesThroughColor3) };
-        QSqlQuery sql_query{ *m_sqlDatabasePtr };
-        QString sql_counting{ range.first->second.arg(tag_name) };
-        QString sql_inserting{ (++range.first)->second.arg(tag_name) };
-
-        if (sql_query.exec(sql_counting)) {
-
-            if (sql_query.next()) {
-                int number{ sql_query.value("counter").toInt() };
-
-                if (number == 0) {
-                    sql_query.clear();
-
-                    if (!sql_query.exec(sql_inserting)) {
-                        qWarning() << sql_query.lastError().text();
-
-                        return false;
-                    }
-
-                    emit addNewTags(QVariant{QList<QString>{tag_name}});
-                }
-
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
-
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
-                                std::list<QString>>(const std::list<QString> &sqlStrs, const QString &mountPoint)
-{
-    if (!m_flag.load(std::memory_order_consume) && !sqlStrs.empty() && !mountPoint.isEmpty()) {
-        std::list<QString>::const_iterator cbeg{ sqlStrs.cbegin() };
-        std::list<QString>::const_iterator cend{ sqlStrs.cend() };
-        QSqlQuery sqlQuery{*m_sqlDatabasePtr};
-
-        for (; cbeg != cend; ++cbeg) {
-
-            if (!m_flag.load(std::memory_order_consume)) {
-
-                if (!sqlQuery.exec(*cbeg)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                    if (!sqlQuery.exec(*cbeg)) {
-                        qWarning() << sqlQuery.lastError().text();
-                    }
-
-                } else {
-                    return false;
-                }
-            }
-        }
-
-        return true;
-    }
-
-    return false;
-}
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>>(const QMap<QString, QList<QString>> &fileNameAndTagNames,
-                                                                                                               const QString &mountPoint)
-{
-    if (!fileNameAndTagNames.isEmpty() && !mountPoint.isEmpty() && static_cast<bool>(m_sqlDatabasePtr)) {
-        QMap<QString, QList<QString>>::const_iterator cbeg{ fileNameAndTagNames.cbegin() };
-        QMap<QString, QList<QString>>::const_iterator cend{ fileNameAndTagNames.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::UntagSamePartionFiles2) };
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        for (; cbeg != cend; ++cbeg) {
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator rangeBeg{ range.first };
-            QString countTagNamesInTagWithFile{ rangeBeg->second.arg(cbeg.key()) };
-
-
-            if (!m_flag.load(std::memory_order_consume)) {
-
-                if (!sqlQuery.exec(countTagNamesInTagWithFile)) {
-                    qWarning() << sqlQuery.lastError().text();
-                    continue;
-                }
-
-                if (sqlQuery.next()) {
-                    int size{ sqlQuery.value(0).toInt() };
-
-                    if (size == 0) {
-                        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator  rangeEnd{ range.second };
-                        QString deleteRowInFileProperty{ (--rangeEnd)->second.arg(cbeg.key()) };
-
-                        if (!m_flag.load(std::memory_order_consume)) {
-
-                            if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                        } else {
-
-                            DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                            if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                                if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                            } else {
-                                return false;
-                            }
-                        }
-
-
-                    } else {
-
-                        QString sqlForGetingLeftTag{ (++rangeBeg)->second.arg(cbeg.key()) };
-
-                        if (!m_flag.load(std::memory_order_consume)) {
-
-                            if (!sqlQuery.exec(sqlForGetingLeftTag)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                            std::deque<QString> leftTags{};
-
-                            while (sqlQuery.next()) {
-                                leftTags.push_back(sqlQuery.value("tag_name").toString());
-                            }
-
-                            std::size_t sizeOfLeftTags{ leftTags.size() };
-                            std::deque<QString>::const_iterator leftTagsCbeg{ leftTags.cbegin() };
-
-                            if (sizeOfLeftTags >= 3u) {
-                                leftTags.erase(leftTagsCbeg, leftTagsCbeg + (sizeOfLeftTags - 3u));
-
-                            } else {
-
-                                for (; size < 3; ++size) {
-                                    leftTags.push_back(QString{});
-                                }
-                            }
-
-                            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdateRow{ (--range.second) };
-                            leftTagsCbeg = leftTags.cbegin();
-                            QString updateRowInFileProperty{ (--itrForUpdateRow)->second.arg(*leftTagsCbeg) };
-                            updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                            updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                            updateRowInFileProperty = updateRowInFileProperty.arg(cbeg.key());
-
-                            if (!m_flag.load(std::memory_order_consume)) {
-
-                                if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                            } else {
-
-                                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                                    if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                        qWarning() << sqlQuery.lastError().text();
-                                        continue;
-                                    }
-
-                                } else {
-                                    return false;
-                                }
-
-                            }
-                        }
-                    }
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                    if (sqlQuery.exec(countTagNamesInTagWithFile)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                    if (sqlQuery.next()) {
-
-                        int size{ sqlQuery.value(0).toInt() };
-
-                        if (size == 0) {
-                            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator  rangeEnd{ range.second };
-                            QString deleteRowInFileProperty{ (--rangeEnd)->second.arg(cbeg.key()) };
-
-                            if (!m_flag.load(std::memory_order_consume)) {
-
-                                if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                            } else {
+                                        sql_for_inserting_new_row = sql_for_inserting_new_row.arg(std::get<4>(*cbeg));
 
-                                DSqliteHandle::ReturnCode return_code{ this->checkDBFileExist(mountPoint) };
+                                        if (!sqlQuery.exec(sql_for_inserting_new_row)) {
+                                            qWarning() << sqlQuery.lastError().text();
+                                            result = false;
+                                            break;
+                                        }
+                                        continue;
 
-                                if (return_code == DSqliteHandle::ReturnCode::Exist) {
+                                    } else {
+                                        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator sqlItrForUpdating{ range.first };
+                                        ++sqlItrForUpdating;
+                                        QString sqlForUpdating{ sqlItrForUpdating->second };
+                                        sqlForUpdating = sqlForUpdating.arg(*tagNameItr);
+                                        sqlForUpdating = sqlForUpdating.arg(*(++tagNameItr));
+                                        sqlForUpdating = sqlForUpdating.arg(*(++tagNameItr));
+                                        sqlForUpdating = sqlForUpdating.arg(std::get<4>(*cbeg));
 
-                                    if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                        qWarning() << sqlQuery.lastError().text();
+                                        if (!sqlQuery.exec(sqlForInsertingNewRow)) {
+                                            qWarning() << sqlQuery.lastError().text();
+                                            result = false;
+                                            break;
+                                        }
                                         continue;
                                     }
-
-                                } else {
-                                    return false;
                                 }
                             }
+                        }
+                        result = false;
+                        break;
+                    }
+                    continue;
+                }
+                result = false;
+                break;
+            }
+        }
+        return result;
+    }
+    return false;
+}
 
 
-                        } else {
-
-                            QString sqlForGetingLeftTag{ (++rangeBeg)->second };
-
-                            if (!m_flag.load(std::memory_order_consume)) {
-
-                                if (!sqlQuery.exec(sqlForGetingLeftTag)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                                std::deque<QString> leftTags{};
-                                int sizeOfTags{ sqlQuery.size() };
-
-                                for (long int index = 0; index < sizeOfTags; ++index) {
-                                    leftTags.push_back(sqlQuery.value(index).toString());
-                                }
-
-                                std::size_t sizeOfLeftTags{ leftTags.size() };
-                                std::deque<QString>::const_iterator leftTagsCbeg{ leftTags.cbegin() };
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(const QString &tag_name, const QString &mountPoint)
+{
+    if (!tag_name.isEmpty() && mountPoint == QString{"/home"}) {
+        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
+                  std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFilesThroughColor3) };
+        QSqlQuery sql_query{ *m_sqlDatabasePtr };
+        QString sql_counting{ range.first->second.arg(tag_name) };
+        QString sql_inserting{ (++range.first)->second.arg(tag_name) };
 
-                                if (sizeOfLeftTags >= 3u) {
-                                    leftTags.erase(leftTagsCbeg, leftTagsCbeg + (sizeOfLeftTags - 3u));
+        if (sql_query.exec(sql_counting)) {
 
-                                } else {
+            if (sql_query.next()) {
+                int number{ sql_query.value("counter").toInt() };
 
-                                    for (; size < 3; ++size) {
-                                        leftTags.push_back(QString{});
-                                    }
-                                }
+                if (number == 0) {
+                    sql_query.clear();
 
-                                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdateRow{ (--range.second) };
-                                leftTagsCbeg = leftTags.cbegin();
-                                QString updateRowInFileProperty{ (--itrForUpdateRow)->second.arg(*leftTagsCbeg) };
-                                updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                                updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                                updateRowInFileProperty = updateRowInFileProperty.arg(cbeg.key());
+                    if (!sql_query.exec(sql_inserting)) {
+                        qWarning() << sql_query.lastError().text();
 
-                                if (!m_flag.load(std::memory_order_consume)) {
+                        return false;
+                    }
 
-                                    if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                        qWarning() << sqlQuery.lastError().text();
-                                        continue;
-                                    }
+                    emit addNewTags(QVariant{QList<QString>{tag_name}});
+                }
 
-                                } else {
+                return true;
+            }
+        }
+    }
 
-                                    DSqliteHandle::ReturnCode return_code{ this->checkDBFileExist(mountPoint) };
+    return false;
+}
 
-                                    if (return_code == DSqliteHandle::ReturnCode::Exist) {
 
-                                        if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                            qWarning() << sqlQuery.lastError().text();
-                                            continue;
-                                        }
 
-                                    } else {
-                                        return false;
-                                    }
+///###: the rows are deleted in the same way as the redundant tags when tagging files.
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
+                                QMap<QString, QList<QString>>>(const QMap<QString, QList<QString>> &fileNameAndTagNames, const QString &mountPoint)
+{
+    if (m_flag.load(std::memory_order_consume)) {
+        return false;
+    }
 
-                                }
+    return this->helpExecSql<DSqliteHandle::SqlType::TagFiles, QMap<QString, QList<QString>>, bool>(fileNameAndTagNames, mountPoint);
+}
 
-                            }
-                        }
-                    }
-                }
-            }
-        }
 
-        return true;
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>>(const QMap<QString, QList<QString>> &fileNameAndTagNames,
+                                                                                                               const QString &mountPoint)
+{
+    if (!fileNameAndTagNames.isEmpty() && static_cast<bool>(m_sqlDatabasePtr)) {
+        return this->helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(fileNameAndTagNames.keys(), mountPoint);
     }
 
     return false;
@@ -2089,41 +1832,31 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QStri
 
 
 template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>>(const std::map<QString, QString> &sqlStrs, const QString &mountPoint)
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>>(const std::map<QString, QString> &oldAndNewNames, const QString &mountPoint)
 {
-    if (!sqlStrs.empty() && !mountPoint.isEmpty()) {
-        std::map<QString, QString>::const_iterator sqlCBeg{ sqlStrs.cbegin() };
-        std::map<QString, QString>::const_iterator sqlCEnd{ sqlStrs.cend() };
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        for (; sqlCBeg != sqlCEnd; ++sqlCBeg) {
-
-            if (!m_flag.load(std::memory_order_consume)) {
-
-                if (!sqlQuery.exec(sqlCBeg->first)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
+    if (!oldAndNewNames.empty() && !mountPoint.isEmpty()) {
+        QSqlQuery &updateFileProperty = this->preparedQuery(RENAME_FILE_PROPERTY);
+        QSqlQuery &updateTagWithFile = this->preparedQuery(RENAME_TAG_WITH_FILE);
 
-                if (!sqlQuery.exec(sqlCBeg->second)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
+        for (const std::pair<const QString, QString> &oldAndNewName : oldAndNewNames) {
 
-            } else {
-                DSqliteHandle::ReturnCode code{this->checkDBFileExist(mountPoint)};
+            if (m_flag.load(std::memory_order_consume)
+                    && this->checkDBFileExist(mountPoint) != DSqliteHandle::ReturnCode::Exist) {
+                return false;
+            }
 
-                if (code == DSqliteHandle::ReturnCode::Exist) {
+            updateFileProperty.bindValue(0, oldAndNewName.second);
+            updateFileProperty.bindValue(1, oldAndNewName.first);
 
-                    if (!sqlQuery.exec(sqlCBeg->first)) {
-                        qWarning() << sqlQuery.lastError().text();
-                    }
+            if (!updateFileProperty.exec()) {
+                qWarning() << updateFileProperty.lastError().text();
+            }
 
-                    if (!sqlQuery.exec(sqlCBeg->second)) {
-                        qWarning() << sqlQuery.lastError().text();
-                    }
+            updateTagWithFile.bindValue(0, oldAndNewName.second);
+            updateTagWithFile.bindValue(1, oldAndNewName.first);
 
-                } else {
-                    return false;
-                }
+            if (!updateTagWithFile.exec()) {
+                qWarning() << updateTagWithFile.lastError().text();
             }
         }
         return true;
@@ -2138,42 +1871,17 @@ QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType:
     QMap<QString, QList<QString>> file_with_tags{};
 
     if (!files.empty()) {
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(SqlType::ChangeFilesName2) };
-        std::map<QString, QString>::const_iterator file_beg{ files.cbegin() };
-        std::map<QString, QString>::const_iterator file_end{ files.cend() };
-        QSqlQuery sql_query{ *m_sqlDatabasePtr };
-
-
-        if (!m_flag.load(std::memory_order_consume)) {
-
-            for (; file_beg != file_end; ++file_beg) {
-
-                if (sql_query.exec(range.first->second.arg(file_beg->first))) {
-
-                    while (sql_query.next()) {
-                        QString tag_name{ sql_query.value("tag_name").toString() };
-                        file_with_tags[file_beg->first].push_back(tag_name);
-                    }
-                }
-            }
-
-        } else {
-
-            DSqliteHandle::ReturnCode code{this->checkDBFileExist(mount_point)};
-
-            if (code == DSqliteHandle::ReturnCode::Exist) {
 
-                for (; file_beg != file_end; ++file_beg) {
+        if (m_flag.load(std::memory_order_consume)
+                && this->checkDBFileExist(mount_point) != DSqliteHandle::ReturnCode::Exist) {
+            return file_with_tags;
+        }
 
-                    if (sql_query.exec(range.first->second.arg(file_beg->first))) {
+        for (const std::pair<const QString, QString> &file : files) {
+            QList<QString> tag_names{ this->tagsOfFile(file.first) };
 
-                        while (sql_query.next()) {
-                            QString tag_name{ sql_query.value("tag_name").toString() };
-                            file_with_tags[file_beg->first].push_back(tag_name);
-                        }
-                    }
-                }
+            if (!tag_names.isEmpty()) {
+                file_with_tags[file.first] = tag_names;
             }
         }
     }
@@ -2277,39 +1985,15 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QS
 
 template<>
 QList<QString> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile, QString,
-                                          QList<QString>>(const QString &sqlStr, const QString &mountPoint)
+                                          QList<QString>>(const QString &file, const QString &mountPoint)
 {
     QList<QString> tagNames{};
 
-    if (!sqlStr.isEmpty() && !mountPoint.isEmpty()) {
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        if (!m_flag.load(std::memory_order_consume)) {
-
-            if (!sqlQuery.exec(sqlStr)) {
-                qWarning() << sqlQuery.lastError().text();
-            }
-
-            while (sqlQuery.next()) {
-                QString tagName{ sqlQuery.value("tag_name").toString() };
-                tagNames.push_back(tagName);
-            }
-
-        } else {
-
-            DSqliteHandle::ReturnCode code{this->checkDBFileExist(mountPoint)};
-
-            if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                if (!sqlQuery.exec(sqlStr)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
+    if (!file.isEmpty() && !mountPoint.isEmpty()) {
 
-                while (sqlQuery.next()) {
-                    QString tagName{ sqlQuery.value("tag_name").toString() };
-                    tagNames.push_back(tagName);
-                }
-            }
+        if (!m_flag.load(std::memory_order_consume)
+                || this->checkDBFileExist(mountPoint) == DSqliteHandle::ReturnCode::Exist) {
+            tagNames = this->tagsOfFile(file);
         }
     }
 
@@ -2382,7 +2066,7 @@ QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType:
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToShareSqlite(partion_itr_beg->second);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                        if (this->openSqlDatabase()) {
                             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
                             for (const QString &tag_name : tag_names) {
@@ -2512,7 +2196,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
                     }
                 }
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                     bool valueOfDelRedundant{ true };
 
                     if (!decreased.isEmpty()) {
@@ -2605,7 +2289,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
             if (code == DSqliteHandle::ReturnCode::Exist || code == DSqliteHandle::ReturnCode::NoExist) {
                 this->connectToShareSqlite(unixDeviceAndMountPoint.second);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool valueOfInsertNew{ true };
                     valueOfInsertNew = this->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>,
@@ -2665,7 +2349,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
         this->connectToShareSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(filesAndTags.cbegin().key(), "/home");
         }
 
@@ -2742,7 +2426,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
                     }
 
                     if (!sqlStrs.empty()) {
-                        if (m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                             bool value = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor,
                                  std::list<std::tuple<QString, QString, QString, QString, QString, QString>>, bool>(sqlStrs, cbeg.key());
 
@@ -2809,54 +2493,27 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::UntagSamePartionFiles, bo
 
             this->connectToShareSqlite(unixDeviceAndMountPoint.second);
 
-            if (static_cast<bool>(m_sqlDatabasePtr)) {
-                std::pair<std::multimap<SqlType, QString>::const_iterator,
-                    std::multimap<SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(SqlType::UntagSamePartionFiles) };
-
-                if (range.first != range.second) {
-
-                    ///###: [sql].
-                    std::list<QString> sqlForDeletingRowOfTagWithFile{};
-                    cbeg = file_with_tags.cbegin(); //###:!!!!!!!!
-                    cend = file_with_tags.cend();//###:!!!!!!!!!
+            if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
+                bool resultOfDeleteRowInTagWithFile{ this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
+                                                     QMap<QString, QList<QString>>, bool>(file_with_tags, unixDeviceAndMountPoint.second) };
+                bool resultOfUpdateFileProperty{ false };
 
-                    for (; cbeg != cend; ++cbeg) {
-                        std::multimap<SqlType, QString>::const_iterator rangeCBeg{ range.first };
-                        QString fileLocalName{ cbeg.key() };
-                        QList<QString>::const_iterator cTagBeg{ cbeg.value().cbegin() };
-                        QList<QString>::const_iterator cTagEnd{ cbeg.value().cend() };
-
-                        for (; cTagBeg != cTagEnd; ++cTagBeg) {
-                            QString deletingRowOfTagWithFile{ rangeCBeg->second.arg(fileLocalName) };
-                            deletingRowOfTagWithFile = deletingRowOfTagWithFile.arg(*cTagBeg);
-                            sqlForDeletingRowOfTagWithFile.push_back(deletingRowOfTagWithFile);
-                        }
-                    }
-
-                    if (!sqlForDeletingRowOfTagWithFile.empty() && m_sqlDatabasePtr->open()
-                            && m_sqlDatabasePtr->transaction()) {
-                        bool resultOfDeleteRowInTagWithFile{ this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
-                                                             std::list<QString>, bool>(sqlForDeletingRowOfTagWithFile, unixDeviceAndMountPoint.second) };
-                        bool resultOfUpdateFileProperty{ false };
-
-                        if (resultOfDeleteRowInTagWithFile) {
-                            resultOfUpdateFileProperty = this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2,
-                            QMap<QString, QList<QString>>, bool>(file_with_tags, unixDeviceAndMountPoint.second);
-                        }
+                if (resultOfDeleteRowInTagWithFile) {
+                    resultOfUpdateFileProperty = this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2,
+                    QMap<QString, QList<QString>>, bool>(file_with_tags, unixDeviceAndMountPoint.second);
+                }
 
-                        if (!(resultOfDeleteRowInTagWithFile && resultOfUpdateFileProperty
-                                && m_sqlDatabasePtr->commit())) {
-                            m_sqlDatabasePtr->rollback();
-                            this->closeSqlDatabase();
+                if (!(resultOfDeleteRowInTagWithFile && resultOfUpdateFileProperty
+                        && m_sqlDatabasePtr->commit())) {
+                    m_sqlDatabasePtr->rollback();
+                    this->closeSqlDatabase();
 
-                            return false;
-                        }
+                    return false;
+                }
 
-                        this->closeSqlDatabase();
+                this->closeSqlDatabase();
 
-                        return true;
-                    }
-                }
+                return true;
             }
 
         } else {
@@ -2972,7 +2629,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToShareSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_and_tags_partion{
                         this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles2,
                         std::list<QString>, QMap<QString, QList<QString>>>(itr_partion_and_files->second, itr_partion_and_files->first)
@@ -3007,7 +2664,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToShareSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool result{ this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
                                  std::list<QString>, bool>(itr_partion_and_files->second, itr_partion_and_files->first) };
@@ -3050,7 +2707,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
         bool the_result{ true };
         QList<QString> the_tags_for_deleting{ filesAndTags.keys() };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QString>, bool>(the_tags_for_deleting, "/home");
         }
 
@@ -3100,7 +2757,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
                             bool flagForDeleteInTagWithFile{ false };
                             bool flagForUpdatingFileProperty{ false };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                            if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                                 flagForDeleteInTagWithFile = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags,
                                 std::list<QString>, bool>(sqlStrs, mountPointItr->second);
 
@@ -3153,8 +2810,6 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::ChangeFilesName) };
 
         std::map<QString, std::map<QString, QString>> partionsAndFileNames{};
 
@@ -3177,7 +2832,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToShareSqlite(partion_and_file_names.first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_with_tags{
                         this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
                         QMap<QString, QList<QString>>>(partion_and_file_names.second, partion_and_file_names.first)
@@ -3197,110 +2852,91 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
         }
 
 
-        std::map<QString, std::map<QString, QString>> sqlForChangingFilesName{};
         std::map<QString, std::map<QString, QString>> partionsAndFileNames_backup{ partionsAndFileNames };
 
         if (!partionsAndFileNames.empty()) {
-            std::map<QString, std::map<QString, QString>>::const_iterator partionBeg{ partionsAndFileNames.cbegin() };
-            std::map<QString, std::map<QString, QString>>::const_iterator partionEnd{ partionsAndFileNames.cend() };
-
-            for (; partionBeg != partionEnd; ++partionBeg) {
-
-                for (const std::pair<QString, QString> &oldAndNewName : partionBeg->second) {
-                    std::map<DSqliteHandle::SqlType, QString>::const_iterator rangeBeg{ range.first };
-                    QString updateFileProperty{ rangeBeg->second.arg(oldAndNewName.second)};
-                    updateFileProperty = updateFileProperty.arg(oldAndNewName.first);
-
-                    QString updateTagWithFile{ (++rangeBeg)->second.arg(oldAndNewName.second) };
-                    updateTagWithFile = updateTagWithFile.arg(oldAndNewName.first);
-                    sqlForChangingFilesName[partionBeg->first].emplace(updateFileProperty, updateTagWithFile);
-                }
-            }
-
-            if (!sqlForChangingFilesName.empty()) {
-                bool result{ true };
+            bool result{ true };
 
-                for (const std::pair<QString, std::map<QString, QString>> &mountPointAndSqls : sqlForChangingFilesName) {
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPointAndSqls.first) };
+            for (const std::pair<const QString, std::map<QString, QString>> &mountPointAndNames : partionsAndFileNames) {
+                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPointAndNames.first) };
 
-                    if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
-                        this->connectToShareSqlite(mountPointAndSqls.first);
+                if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
+                    this->connectToShareSqlite(mountPointAndNames.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
-                            bool resultOfExecSql{ this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
-                                                  std::map<QString, QString>, bool>(mountPointAndSqls.second, mountPointAndSqls.first) };
+                    if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
+                        bool resultOfExecSql{ this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
+                                              std::map<QString, QString>, bool>(mountPointAndNames.second, mountPointAndNames.first) };
 
-                            if (!(resultOfExecSql && m_sqlDatabasePtr->commit())) {
-                                m_sqlDatabasePtr->rollback();
-                                result = false;
+                        if (!(resultOfExecSql && m_sqlDatabasePtr->commit())) {
+                            m_sqlDatabasePtr->rollback();
+                            result = false;
 
-                                partionsAndFileNames_backup.erase(mountPointAndSqls.first);
-                                file_with_tags_in_partion.remove(mountPointAndSqls.first);
-                            }
+                            partionsAndFileNames_backup.erase(mountPointAndNames.first);
+                            file_with_tags_in_partion.remove(mountPointAndNames.first);
                         }
                     }
                 }
+            }
 
-                this->closeSqlDatabase();
+            this->closeSqlDatabase();
 
-                QMap<QString, QList<QString>> file_with_tags_new{};
+            QMap<QString, QList<QString>> file_with_tags_new{};
 
-                for (const std::pair<QString, std::map<QString, QString>> &mount_point_and_file_names : partionsAndFileNames_backup) {
-                    std::map<QString, QString> new_and_old_names{};
+            for (const std::pair<QString, std::map<QString, QString>> &mount_point_and_file_names : partionsAndFileNames_backup) {
+                std::map<QString, QString> new_and_old_names{};
 
-                    for (const std::pair<QString, QString> &old_and_new_name : mount_point_and_file_names.second) {
-                        new_and_old_names[old_and_new_name.second] = old_and_new_name.first;
-                    }
+                for (const std::pair<QString, QString> &old_and_new_name : mount_point_and_file_names.second) {
+                    new_and_old_names[old_and_new_name.second] = old_and_new_name.first;
+                }
 
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mount_point_and_file_names.first) };
+                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mount_point_and_file_names.first) };
 
-                    if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
-                        this->connectToShareSqlite(mount_point_and_file_names.first);
+                if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
+                    this->connectToShareSqlite(mount_point_and_file_names.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
-                            QMap<QString, QList<QString>> file_with_tags{
-                                this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
-                                QMap<QString, QList<QString>>>(new_and_old_names, mount_point_and_file_names.first)
-                            };
+                    if (this->openSqlDatabase()) {
+                        QMap<QString, QList<QString>> file_with_tags{
+                            this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
+                            QMap<QString, QList<QString>>>(new_and_old_names, mount_point_and_file_names.first)
+                        };
 
-                            using namespace impl;
-                            file_with_tags_new += file_with_tags;
-                        }
+                        using namespace impl;
+                        file_with_tags_new += file_with_tags;
                     }
                 }
+            }
 
-                QMap<QString, QList<QString>> file_with_tags_old{};
-                QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_beg{ file_with_tags_in_partion.cbegin() };
-                QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_end{ file_with_tags_in_partion.cend() };
+            QMap<QString, QList<QString>> file_with_tags_old{};
+            QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_beg{ file_with_tags_in_partion.cbegin() };
+            QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_end{ file_with_tags_in_partion.cend() };
 
-                for (; itr_beg != itr_end; ++itr_beg) {
-                    using namespace impl;
-                    file_with_tags_old += itr_beg.value();
-                }
+            for (; itr_beg != itr_end; ++itr_beg) {
+                using namespace impl;
+                file_with_tags_old += itr_beg.value();
+            }
 
-                QMap<QString, QVariant> file_with_tags_var{};
-                QMap<QString, QList<QString>>::iterator file_with_tags_beg{ file_with_tags_old.begin() };
-                QMap<QString, QList<QString>>::iterator file_with_tags_end{ file_with_tags_old.end() };
+            QMap<QString, QVariant> file_with_tags_var{};
+            QMap<QString, QList<QString>>::iterator file_with_tags_beg{ file_with_tags_old.begin() };
+            QMap<QString, QList<QString>>::iterator file_with_tags_end{ file_with_tags_old.end() };
 
-                for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
-                    file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
-                }
+            for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
+                file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
+            }
 
-                emit untagFiles(file_with_tags_var);
+            emit untagFiles(file_with_tags_var);
 
-                file_with_tags_var.clear();
-                file_with_tags_beg = file_with_tags_new.begin();
-                file_with_tags_end = file_with_tags_new.end();
+            file_with_tags_var.clear();
+            file_with_tags_beg = file_with_tags_new.begin();
+            file_with_tags_end = file_with_tags_new.end();
 
-                for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
-                    file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
-                }
+            for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
+                file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
+            }
 
-                emit filesWereTagged(file_with_tags_var);
-                this->closeSqlDatabase();
+            emit filesWereTagged(file_with_tags_var);
+            this->closeSqlDatabase();
 
-                return result;
-            }
+            return result;
         }
     }
 
@@ -3323,7 +2959,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
         this->connectToShareSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QString, QList<QString>>, bool>(filesAndTags, "/home");
         }
 
@@ -3374,7 +3010,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
                             bool resultOfChangeNameOfTag{ true };
                             bool flagOfTransaction{ true };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (this->openSqlDatabase()) {
                                 flagOfTransaction = m_sqlDatabasePtr->transaction();
 
                                 if (flagOfTransaction) {
@@ -3427,8 +3063,6 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
         QPair<QString, QString> partionAndMountPoint{ DSqliteHandle::getMountPointOfFile(DUrl::fromLocalFile(cbeg.key()), m_partionsOfDevices) };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagsThroughFile) };
 
         if (partionAndMountPoint.second.isEmpty() || partionAndMountPoint.second.isNull()) {
             return tags;
@@ -3439,13 +3073,12 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
         if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
             QString file{ cbeg.key() };
             file = this->remove_mount_point(file, partionAndMountPoint.second);
-            QString sqlForGetTagsThroughFile{range.first->second.arg(file)};
             this->connectToShareSqlite(partionAndMountPoint.second);
 
             ///###: no transaction.
-            if (m_sqlDatabasePtr->open()) {
+            if (this->openSqlDatabase()) {
                 tags = this->helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
-                QString, QList<QString>>(sqlForGetTagsThroughFile, partionAndMountPoint.second);
+                QString, QList<QString>>(file, partionAndMountPoint.second);
             }
         }
     }
@@ -3461,6 +3094,58 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
     return tags_backup;
 }
 
+///###: 一次查询多个文件各自的标记，同一分区的文件只打开一次数据库，没有标记的文件返回空列表。
+template<>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags)
+{
+    QMap<QString, QVariant> filesWithTags{};
+    std::map<QString, QList<QString>> filesOfMountPoints{};
+
+    QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
+    QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
+
+    for (; cbeg != cend; ++cbeg) {
+        QPair<QString, QString> partionAndMountPoint{ DSqliteHandle::getMountPointOfFile(DUrl::fromLocalFile(cbeg.key()), m_partionsOfDevices) };
+
+        if (!partionAndMountPoint.second.isEmpty()) {
+            filesOfMountPoints[partionAndMountPoint.second].push_back(cbeg.key());
+        }
+    }
+
+    for (const std::pair<const QString, QList<QString>> &mountPointAndFiles : filesOfMountPoints) {
+        const QString &mountPoint{ mountPointAndFiles.first };
+        DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
+
+        if (code != DSqliteHandle::ReturnCode::NoExist && code != DSqliteHandle::ReturnCode::Exist) {
+            continue;
+        }
+
+        this->connectToShareSqlite(mountPoint);
+
+        ///###: the files are read in one transaction, so the lock of DB is taken only once.
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
+            for (const QString &file : mountPointAndFiles.second) {
+                QList<QString> tags{ this->helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
+                                     QString, QList<QString>>(this->remove_mount_point(file, mountPoint), mountPoint) };
+                QList<QString> tags_backup{};
+
+                std::transform(tags.begin(), tags.end(), std::back_inserter(tags_backup),
+                [](const QString & tag) {
+                    return Tag::restore_escaped_en_skim(tag);
+                });
+
+                filesWithTags[Tag::restore_escaped_en_skim(file)] = QVariant{ tags_backup };
+            }
+
+            m_sqlDatabasePtr->commit();
+        }
+
+        this->closeSqlDatabase();
+    }
+
+    return filesWithTags;
+}
+
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThroughTag, QList<QString>>(const QMap<QString, QList<QString>> &filesAndTags)
 {
@@ -3489,7 +3174,7 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThrough
                         if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                             this->connectToShareSqlite(mountPointItr->second);
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (this->openSqlDatabase()) {
 
                                 QList<QString> filesOfPartion{ this->helpExecSql<DSqliteHandle::SqlType::GetFilesThroughTag,
                                                                QString, QList<QString>>(sqlForGetFilesThroughTag, mountPointItr->second) };
@@ -3524,15 +3209,11 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDi
     std::map<QString, std::size_t> countForTags{};
 
     if (!filesAndTags.isEmpty()) {
-        QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
-        QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
+        ///###: query all the files at once, instead of connecting to DB for every file.
+        QMap<QString, QVariant> filesWithTags{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(filesAndTags) };
 
-        for (; cbeg != cend; ++cbeg) {
-            QMap<QString, QList<QString>> file{};
-            file.insert(cbeg.key(), cbeg.value());
-
-            QList<QString> tagsNames{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsThroughFile, QList<QString>>(file) };
-            for (const QString &tagName : tagsNames) {
+        for (const QVariant &tagsNames : filesWithTags) {
+            for (const QString &tagName : tagsNames.toStringList()) {
                 ++countForTags[tagName];
             }
         }
@@ -3551,13 +3232,8 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDi
 //    qDebug()<< totalTagsNames;
 //#endif //QT_DEBUG
 
-    QList<QString> total_tags_names_backup{};
-    std::transform(totalTagsNames.begin(), totalTagsNames.end(), std::back_inserter(total_tags_names_backup),
-    [](const QString & tag_name) {
-        return Tag::restore_escaped_en_skim(tag_name);
-    });
-
-    return total_tags_names_backup;
+    ///###: the names from GetTagsOfFiles have been restored already.
+    return totalTagsNames;
 }
 
 
@@ -3572,7 +3248,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAll
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetAllTags) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
             if (sql_query.exec(range.first->second)) {
@@ -3604,7 +3280,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTag
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagColor) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ fileAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ fileAndTags.cend() };
             QString sql_str{ range.first->second };
@@ -3637,7 +3313,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagColor, bool>(con
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::ChangeTagColor) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
@@ -3678,7 +3354,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::BeforeTagFiles, bool>(con
                   std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::BeforeTagFiles) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
@@ -79,6 +79,7 @@ public:
 
         GetTagsThroughFile,
         GetSameTagsOfDiffFiles,
+        GetTagsOfFiles,
 
         UntagDiffPartionFiles,
 
@@ -125,13 +126,47 @@ private slots:
 private:
     static QString restoreEscapedChar(const QString &value);
 
+    ///###: the connection is kept open and reused by the next operation,
+    ///###: here only reset the cached statements to release the locks.
+    ///###: ROLLBACK does nothing when no transaction is pending, it drops the one left by a failed branch.
     inline void closeSqlDatabase()noexcept
     {
+        for (const std::pair<const QString, std::unique_ptr<QSqlQuery>> &query : m_preparedQueries) {
+            query.second->finish();
+        }
+
         if (m_sqlDatabasePtr && m_sqlDatabasePtr->isOpen()) {
-            m_sqlDatabasePtr->close();
+            m_sqlDatabasePtr->rollback();
         }
     }
 
+    /**
+     * @brief openSqlDatabase 打开数据库连接
+     * 连接已打开时直接复用，第一次打开时开启 WAL 日志，并为 tag_with_file 建立索引
+     * @return 连接是否可用
+     */
+    bool openSqlDatabase();
+
+    /**
+     * @brief resetSqlDatabase 关闭连接并丢弃缓存的预编译语句
+     */
+    void resetSqlDatabase();
+
+    /**
+     * @brief preparedQuery 获取预编译的语句
+     * 语句按 sql 缓存在当前连接上，重复执行时只需要重新绑定参数
+     * @param sql 使用 ? 占位的语句
+     * @return 预编译失败时返回的语句 isValid() 以及 exec() 均失败
+     */
+    QSqlQuery &preparedQuery(const QString &sql);
+
+    /**
+     * @brief tagsOfFile 查询文件的标记，调用前需要打开数据库
+     * @param file 去掉挂载点的文件路径
+     * @param ok 查询是否成功
+     */
+    QList<QString> tagsOfFile(const QString &file, bool *ok = nullptr);
+
     inline QString remove_mount_point(const QString &file, const QString &mount_point) noexcept
     {
         int index{ file.indexOf(mount_point) };
@@ -191,6 +226,7 @@ private:
 
     std::unique_ptr<std::map<QString, std::multimap<QString, QString>>> m_partionsOfDevices{ nullptr };
     std::unique_ptr<QSqlDatabase> m_sqlDatabasePtr{ nullptr };
+    std::unordered_map<QString, std::unique_ptr<QSqlQuery>> m_preparedQueries{};
     std::atomic<bool> m_flag{ false };
     std::mutex m_mutex{};
 
@@ -216,6 +252,9 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDiffFiles, QList<QString>>(const QMap<QString, QList<QString>> &filesAndTags);
 
+template<>///###: --------------------------------------------------------------><file, <tagName>>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsOfFiles, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags);
+
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThroughTag, QList<QString>>(const QMap<QString, QList<QString>> &filesAndTags);
 
@@ -276,8 +315,8 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, Q
 
 ///###: untag files in same/diff partion.
 template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles, std::list<QString>, bool>(
-    const std::list<QString> &sqlStrs, const QString &mountPoint);
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles, QMap<QString, QList<QString>>, bool>(
+    const QMap<QString, QList<QString>> &fileNameAndTagNames, const QString &mountPoint);
 template<>
 bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>, bool>(const QMap<QString, QList<QString>> &fileNameAndTagNames,
                                                                                                                      const QString &mountPoint);
@@ -312,7 +351,7 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QStri
 ///###: change file(s) name.
 template<>
 bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
-     std::map<QString, QString>, bool>(const std::map<QString, QString> &sqlStrs, const QString &mountPoint);
+     std::map<QString, QString>, bool>(const std::map<QString, QString> &oldAndNewNames, const QString &mountPoint);
 
 template<>
 QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
@@ -331,7 +370,7 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QS
 ///###: get tags through file.
 template<>
 QList<QString> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
-      QString, QList<QString>>(const QString &sqlStr, const QString &mountPoint);
+      QString, QList<QString>>(const QString &file, const QString &mountPoint);
 
 
 ///###: get files which was tagged by appointed tag.
@@ -207,6 +207,8 @@ HEADERS += \
     $$PWD/plugins/dfmadditionalmenu.h \
     $$PWD/dialogs/connecttoserverdialog.h \
     $$PWD/shutil/dfmfilelistfile.h \
+    $$PWD/shutil/dfmfilesorter.h \
+    $$PWD/shutil/dfmthumbnailimagereader.h \
     $$PWD/views/dfmsplitter.h \
     $$PWD/dbus/dbussysteminfo.h \
     $$PWD/models/deviceinfoparser.h \
@@ -446,6 +448,8 @@ SOURCES += \
     $$PWD/plugins/dfmadditionalmenu.cpp \
     $$PWD/dialogs/connecttoserverdialog.cpp \
     $$PWD/shutil/dfmfilelistfile.cpp \
+    $$PWD/shutil/dfmfilesorter.cpp \
+    $$PWD/shutil/dfmthumbnailimagereader.cpp \
     $$PWD/views/dfmsplitter.cpp \
     $$PWD/dbus/dbussysteminfo.cpp \
     $$PWD/models/deviceinfoparser.cpp \
@@ -25,6 +25,91 @@
 #include <QDebug>
 #include <QVariant>
 #include <QStorageInfo>
+#include <QCache>
+#include <QColor>
+#include <QMutex>
+
+namespace {
+static const int kMaxCachedFiles = 100000;
+
+// 文件的标记与标记的颜色缓存，本进程修改标记或收到标记守护进程的变更信号时失效
+class TagCache
+{
+public:
+    bool fileTags(const QString &file, QList<QString> &tags)
+    {
+        QMutexLocker locker(&mutex);
+        const QList<QString> *cached = files.object(file);
+        if (!cached)
+            return false;
+
+        tags = *cached;
+        return true;
+    }
+
+    void setFileTags(const QString &file, const QList<QString> &tags)
+    {
+        QMutexLocker locker(&mutex);
+        files.insert(file, new QList<QString>(tags));
+    }
+
+    void removeFiles(const QList<QString> &fileList)
+    {
+        QMutexLocker locker(&mutex);
+        for (const QString &file : fileList)
+            files.remove(file);
+    }
+
+    bool tagColor(const QString &tag, QColor &color)
+    {
+        QMutexLocker locker(&mutex);
+        auto it = colors.constFind(tag);
+        if (it == colors.cend())
+            return false;
+
+        color = it.value();
+        return true;
+    }
+
+    void setTagColor(const QString &tag, const QColor &color)
+    {
+        QMutexLocker locker(&mutex);
+        colors[tag] = color;
+    }
+
+    void clearColors()
+    {
+        QMutexLocker locker(&mutex);
+        colors.clear();
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&mutex);
+        files.clear();
+        colors.clear();
+    }
+
+private:
+    QMutex mutex;
+    QCache<QString, QList<QString>> files{ kMaxCachedFiles };
+    QHash<QString, QColor> colors;
+};
+
+Q_GLOBAL_STATIC(TagCache, tagCache)
+
+#ifndef DDE_ANYTHINGMONITOR
+// 守护进程的信号中文件路径可能是转义后的
+void removeCachedFiles(const QList<QString> &files)
+{
+    QList<QString> all{ files };
+    for (const QString &file : files)
+        all << Tag::restore_escaped_en_skim(file);
+
+    tagCache->removeFiles(all);
+}
+#endif
+}
 
 TagManager::TagManager()
     : QObject{ nullptr }
@@ -66,18 +151,88 @@ QList<QString> TagManager::getTagsThroughFiles(const QList<DUrl> &files)
     QMap<QString, QVariant> string_var{};
 
     if (!files.isEmpty()) {
+        // 只有一个文件时查询的就是文件自身的标记，可以使用缓存
+        QList<QString> tags{};
+        if (files.size() == 1 && tagCache->fileTags(files.first().toLocalFile(), tags)) {
+            return tags;
+        }
 
         for (const DUrl &url : files) {
             string_var[url.toLocalFile()] = QVariant{ QList<QString>{} };
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetTagsThroughFile) };
-        return var.toStringList();
+        tags = var.toStringList();
+
+        if (files.size() == 1 && var.isValid()) {
+            tagCache->setFileTags(files.first().toLocalFile(), tags);
+        }
+
+        return tags;
     }
 
     return QList<QString> {};
 }
 
+/*!
+ * \brief TagManager::getTagsOfFiles 一次查询多个文件各自的标记，已缓存的文件不再查询
+ * 与 getTagsThroughFiles 不同，后者返回的是所有文件共同的标记
+ */
+QHash<DUrl, QList<QString>> TagManager::getTagsOfFiles(const QList<DUrl> &files)
+{
+    QHash<DUrl, QList<QString>> files_and_tags{};
+    QMap<QString, QVariant> string_var{};
+
+    for (const DUrl &url : files) {
+        QList<QString> tags{};
+
+        if (tagCache->fileTags(url.toLocalFile(), tags)) {
+            files_and_tags[url] = tags;
+        } else {
+            string_var[url.toLocalFile()] = QVariant{ QList<QString>{} };
+        }
+    }
+
+    if (string_var.isEmpty()) {
+        return files_and_tags;
+    }
+
+    QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetTagsOfFiles) };
+
+    // 守护进程不支持批量查询时逐个查询
+    if (!var.isValid()) {
+        for (const DUrl &url : files) {
+            if (!files_and_tags.contains(url)) {
+                files_and_tags[url] = getTagsThroughFiles({ url });
+            }
+        }
+
+        return files_and_tags;
+    }
+
+    const QMap<QString, QVariant> &result{ var.toMap() };
+
+    for (const DUrl &url : files) {
+        if (files_and_tags.contains(url)) {
+            continue;
+        }
+
+        const QString &file{ url.toLocalFile() };
+        auto it = result.constFind(file);
+
+        if (it == result.cend()) {
+            files_and_tags[url] = QList<QString>{};
+            continue;
+        }
+
+        const QList<QString> &tags{ it.value().toStringList() };
+        tagCache->setFileTags(file, tags);
+        files_and_tags[url] = tags;
+    }
+
+    return files_and_tags;
+}
+
 QMap<QString, QColor> TagManager::getTagColor(const QList<QString> &tags) const
 {
     QMap<QString, QColor> tag_and_color{};
@@ -86,7 +241,17 @@ QMap<QString, QColor> TagManager::getTagColor(const QList<QString> &tags) const
         QMap<QString, QVariant> string_var{};
 
         for (const QString &tag_name : tags) {
-            string_var[tag_name] = QVariant{ QList<QString>{ QString{" "} } };
+            QColor color{};
+
+            if (tagCache->tagColor(tag_name, color)) {
+                tag_and_color[tag_name] = color;
+            } else {
+                string_var[tag_name] = QVariant{ QList<QString>{ QString{" "} } };
+            }
+        }
+
+        if (string_var.isEmpty()) {
+            return tag_and_color;
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetTagsColor) };
@@ -96,6 +261,7 @@ QMap<QString, QColor> TagManager::getTagColor(const QList<QString> &tags) const
 
         for (; c_beg != c_end; ++c_beg) {
             tag_and_color[c_beg.key()] = Tag::NamesWithColors[c_beg.value().toString()];
+            tagCache->setTagColor(c_beg.key(), tag_and_color[c_beg.key()]);
         }
     }
 
@@ -223,6 +389,8 @@ bool TagManager::makeFilesTags(const QList<QString> &tags, const QList<DUrl> &fi
         }
 
         QVariant tag_files_var{};
+        tagCache->removeFiles(file_and_tag.keys());
+        tagCache->clearColors();
 
         if (insert_tags_var.toBool()) {
             tag_files_var = TagManagerDaemonController::instance()->disposeClientData(file_and_tag, Tag::ActionType::MakeFilesTags);
@@ -247,6 +415,7 @@ bool TagManager::changeTagColor(const QString &tagName, const QString &new_tag_c
     if (!tagName.isEmpty() && !new_tag_color.isEmpty()) {
         QMap<QString, QVariant> string_var{ { tagName, QVariant{ QList<QString>{ new_tag_color } } } };
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::ChangeTagColor) };
+        tagCache->clearColors();
         result = var.toBool();
     }
 
@@ -265,6 +434,7 @@ bool TagManager::removeTagsOfFiles(const QList<QString> &tags, const QList<DUrl>
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(file_and_tag, Tag::ActionType::RemoveTagsOfFiles) };
+        tagCache->removeFiles(file_and_tag.keys());
         result = var.toBool();
     }
 
@@ -283,6 +453,7 @@ bool TagManager::deleteTags(const QList<QString> &tags)
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(tag_and_placeholder, Tag::ActionType::DeleteTags) };
+        tagCache->clear();
         result = var.toBool();
     }
 
@@ -302,6 +473,7 @@ bool TagManager::deleteFiles(const QList<DUrl> &fileList)
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(local_url_and_placeholder, Tag::ActionType::DeleteFiles) };
+        tagCache->removeFiles(local_url_and_placeholder.keys());
         result = var.toBool();
     }
 
@@ -388,11 +560,13 @@ void TagManager::init_connect()noexcept
     });
 
     connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::deleteTags, this, [ = ](const QVariant & be_deleted_tags) {
+        tagCache->clear();
 
         emit this->deleteTag(be_deleted_tags.toStringList());
     });
 
     connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::changeTagColor, this, [ = ](const QVariantMap & old_and_new_color) {
+        tagCache->clearColors();
 
         QMap<QString, QString> old_and_new{};
         QMap<QString, QVariant>::const_iterator c_beg{ old_and_new_color.cbegin() };
@@ -406,6 +580,7 @@ void TagManager::init_connect()noexcept
     });
 
     connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::changeTagName, this, [ = ](const QVariantMap & old_and_new_name) {
+        tagCache->clear();
         QMap<QString, QString> old_and_new{};
         QMap<QString, QVariant>::const_iterator c_beg{ old_and_new_name.cbegin() };
         QMap<QString, QVariant>::const_iterator c_end{ old_and_new_name.cend() };
@@ -418,6 +593,7 @@ void TagManager::init_connect()noexcept
     });
 
     connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::filesWereTagged, this, [ = ](const QVariantMap & files_were_tagged) {
+        removeCachedFiles(files_were_tagged.keys());
         QMap<QString, QList<QString>> file_and_tags{};
         QMap<QString, QVariant>::const_iterator the_beg{ files_were_tagged.cbegin() };
         QMap<QString, QVariant>::const_iterator the_end{ files_were_tagged.cend() };
@@ -430,6 +606,7 @@ void TagManager::init_connect()noexcept
     });
 
     connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::untagFiles, this, [ = ](const QVariantMap & tag_be_removed_files) {
+        removeCachedFiles(tag_be_removed_files.keys());
         QMap<QString, QList<QString>> file_and_tags{};
         QMap<QString, QVariant>::const_iterator the_beg{ tag_be_removed_files.cbegin() };
         QMap<QString, QVariant>::const_iterator the_end{ tag_be_removed_files.cend() };
@@ -450,6 +627,7 @@ bool TagManager::changeTagName(const QPair<QString, QString> &oldAndNewName)
     if (!oldAndNewName.first.isEmpty() && !oldAndNewName.second.isEmpty()) {
         QMap<QString, QVariant> tag_name{ {oldAndNewName.first, QVariant{oldAndNewName.second}} };
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(tag_name, Tag::ActionType::ChangeTagName) };
+        tagCache->clear();
         result = var.toBool();
     }
 
@@ -468,6 +646,7 @@ bool TagManager::makeFilesTagThroughColor(const QString &color, const QList<DUrl
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(local_url_and_tag, Tag::ActionType::MakeFilesTagThroughColor) };
+        tagCache->removeFiles(local_url_and_tag.keys());
         result = var.toBool();
     }
 
@@ -504,6 +683,13 @@ bool TagManager::changeFilesName(const QList<QPair<QByteArray, QByteArray>> &old
         }
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(old_and_new_name, Tag::ActionType::ChangeFilesName) };
+        QList<QString> changed_files{ old_and_new_name.keys() };
+
+        for (const QVariant &new_name : old_and_new_name) {
+            changed_files << new_name.toString();
+        }
+
+        tagCache->removeFiles(changed_files);
         result = var.toBool();
     }
 
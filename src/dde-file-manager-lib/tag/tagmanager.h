@@ -19,6 +19,7 @@
 #include <interfaces/durl.h>
 
 #include <QMap>
+#include <QHash>
 #include <QList>
 #include <QDebug>
 
@@ -89,6 +90,7 @@ public:
     QMap<QString, QString> getAllTags();
 
     QList<QString> getTagsThroughFiles(const QList<DUrl>& files);
+    QHash<DUrl, QList<QString>> getTagsOfFiles(const QList<DUrl>& files);
 
     QMap<QString, QColor> getTagColor(const QList<QString>& tags) const;
     QString getTagColorName(const QString &tag) const;
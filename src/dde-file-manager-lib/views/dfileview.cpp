@@ -28,6 +28,7 @@
 #include "interfaces/dfmglobal.h"
 #include "interfaces/diconitemdelegate.h"
 #include "interfaces/dlistitemdelegate.h"
+#include "interfaces/dthumbnailprovider.h"
 #include "dfmapplication.h"
 #include "interfaces/dfmcrumbbar.h"
 #include "dialogs/dialogmanager.h"
@@ -1430,11 +1431,15 @@ void DFileView::updateModelActiveIndex()
     }
 
     d->visibleIndexRande = rande;
+    // 可见区域中越靠近中心的文件越先生成缩略图
+    const int center = (rande.first + rande.second) / 2;
+    QHash<QString, int> viewportDistances;
     for (int i = rande.first; i <= rande.second; ++i) {
         const DAbstractFileInfoPointer &fileInfo = model()->fileInfo(model()->index(i, 0));
 
         if (fileInfo) {
             fileInfo->makeToActive();
+            viewportDistances.insert(fileInfo->absoluteFilePath(), qAbs(i - center));
 
             if (!fileInfo->exists()) {
                 m_isRemovingCase = true;
@@ -1444,6 +1449,7 @@ void DFileView::updateModelActiveIndex()
             }
         }
     }
+    DThumbnailProvider::instance()->updateViewport(viewportDistances);
     m_isRemovingCase = false;
 }
 
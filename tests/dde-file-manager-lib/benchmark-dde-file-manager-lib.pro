@@ -0,0 +1,4 @@
+# 性能测试，默认不构建，需要时在 UT 的构建目录 tests/dde-file-manager-lib 中单独执行 qmake 和 make
+CONFIG += benchmark
+
+include(test-dde-file-manager-lib.pro)
@@ -0,0 +1,24 @@
+# 性能测试，不属于单元测试，由 benchmark-dde-file-manager-lib.pro 单独构建
+INCLUDEPATH += $$PWD
+
+TARGET = benchmark-dde-file-manager-lib
+
+# 按发布时的优化级别测量，不统计覆盖率
+QMAKE_CXXFLAGS -= -fprofile-arcs -ftest-coverage -O0
+QMAKE_LFLAGS -= -fprofile-arcs -ftest-coverage -O0
+QMAKE_CXXFLAGS += -O2
+
+HEADERS += \
+    $$PWD/testhelper.h
+
+SOURCES += \
+    $$PWD/shutil/bench_dfmfilesorter.cpp \
+    $$PWD/io/bench_duringfilecopier.cpp \
+    $$PWD/shutil/bench_dfmthumbnailimagereader.cpp \
+    $$PWD/shutil/bench_dsqlitehandle.cpp \
+    $$PWD/controllers/bench_filecontroller.cpp \
+    $$PWD/searchservice/bench_fulltextsearcher.cpp \
+    $$PWD/searchservice/bench_fsearch.cpp
+
+SOURCES += \
+    $$PWD/main.cpp
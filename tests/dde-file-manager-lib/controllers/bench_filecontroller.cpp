@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "controllers/filecontroller.cpp"
+
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <iostream>
+
+// 对比 QDirIterator 与 getdents64 读取目录的耗时，文件数量可以用 DFM_DIR_ITERATOR_BENCHMARK_FILES 调整
+TEST(BenchmarkFileController, tst_benchmark_local_dir_iterator)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("DFM_DIR_ITERATOR_BENCHMARK_FILES", &ok);
+    if (!ok || count <= 0)
+        count = 5000;
+
+    for (int i = 0; i < count; ++i) {
+        QFile file(dir.path() + QString("/file_%1.txt").arg(i));
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    }
+
+    const QDir::Filters filters = QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden;
+    QElapsedTimer timer;
+
+    timer.start();
+    int qdirCount = 0;
+    QDirIterator qdirIterator(dir.path(), filters);
+    while (qdirIterator.hasNext()) {
+        qdirIterator.next();
+        qdirIterator.fileInfo().isDir();
+        ++qdirCount;
+    }
+    const qint64 qdirCost = timer.elapsed();
+
+    timer.restart();
+    int localCount = 0;
+    DFMLocalDirIterator localIterator(dir.path(), QStringList(), filters, false, true);
+    while (localIterator.hasNext()) {
+        localIterator.next();
+        ++localCount;
+    }
+    const qint64 localCost = timer.elapsed();
+
+    EXPECT_EQ(count, qdirCount);
+    EXPECT_EQ(count, localCount);
+
+    std::cout << "list " << count << " files, QDirIterator: " << qdirCost
+              << " ms, getdents64: " << localCost << " ms" << std::endl;
+}
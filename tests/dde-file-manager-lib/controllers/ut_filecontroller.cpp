@@ -13,6 +13,8 @@
 #include "dfmevent.h"
 #include "gvfs/gvfsmountmanager.h"
 
+#include <QTemporaryDir>
+
 namespace  {
 static Stub *stub;
 
@@ -176,6 +178,67 @@ TEST_F(FileControllerTest, tst_create_director)
     DumpDirector(dirIterator);
 }
 
+TEST_F(FileControllerTest, tst_local_dir_iterator)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QDir root(dir.path());
+    ASSERT_TRUE(root.mkdir("sub"));
+    ASSERT_TRUE(root.mkdir(".hidden_dir"));
+    for (const QString &name : QStringList {"a.txt", "b.desktop", ".hidden.txt", "c.log"}) {
+        QFile file(root.absoluteFilePath(name));
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    }
+    ASSERT_TRUE(QFile::link(root.absoluteFilePath("a.txt"), root.absoluteFilePath("link.txt")));
+    ASSERT_TRUE(QFile::link(root.absoluteFilePath("sub"), root.absoluteFilePath("link_dir")));
+    ASSERT_TRUE(QFile::link(root.absoluteFilePath("missing"), root.absoluteFilePath("broken")));
+
+    const QList<QDir::Filters> filterList {
+        QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden,
+        QDir::AllEntries | QDir::NoDotAndDotDot,
+        QDir::Files | QDir::NoDotAndDotDot | QDir::Hidden,
+        QDir::Dirs | QDir::NoSymLinks,
+        QDir::AllEntries | QDir::NoSymLinks | QDir::System,
+    };
+    const QList<QStringList> nameFilterList {QStringList(), QStringList {"*.txt"}};
+
+    for (QDir::Filters filters : filterList) {
+        for (const QStringList &nameFilters : nameFilterList) {
+            QStringList expected = QDir(dir.path()).entryList(nameFilters, filters);
+            expected.sort();
+
+            DFMLocalDirIterator iterator(dir.path(), nameFilters, filters, false, true);
+            QStringList names;
+            quint64 inode = 0;
+            while (iterator.hasNext()) {
+                const DUrl &url = iterator.next();
+                EXPECT_EQ(root.absoluteFilePath(iterator.fileName()), url.toLocalFile());
+
+                // 按 inode 顺序返回
+                struct stat buffer;
+                ASSERT_EQ(0, ::lstat(QFile::encodeName(url.toLocalFile()).constData(), &buffer));
+                EXPECT_LE(inode, static_cast<quint64>(buffer.st_ino));
+                inode = buffer.st_ino;
+
+                names << iterator.fileName();
+            }
+            names.sort();
+
+            EXPECT_EQ(expected, names) << "filters: " << static_cast<int>(filters);
+        }
+    }
+
+    DFMLocalDirIterator iterator(dir.path(), {"b.desktop"}, QDir::Files, false, true);
+    EXPECT_FALSE(iterator.fileInfo());
+    ASSERT_TRUE(iterator.hasNext());
+    iterator.next();
+    const DAbstractFileInfoPointer &info = iterator.fileInfo();
+    ASSERT_TRUE(info);
+    EXPECT_EQ(root.absoluteFilePath("b.desktop"), info->absoluteFilePath());
+    EXPECT_FALSE(iterator.hasNext());
+    iterator.close();
+}
+
 TEST_F(FileControllerTest, tst_open_file)
 {
     stub_ext::StubExt stext;
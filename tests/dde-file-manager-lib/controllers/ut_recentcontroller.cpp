@@ -16,6 +16,8 @@
 
 #include <QTimer>
 #include <QSignalSpy>
+#include <QBuffer>
+#include <QTemporaryDir>
 
 using namespace stub_ext;
 DFM_USE_NAMESPACE
@@ -352,5 +354,104 @@ TEST_F(TestRecentController, tst_decompressFile)
     st.set_lamda(&DFileService::decompressFile, []() { return true; });
     EXPECT_TRUE(m_controller->decompressFile(event));
 }
+
+namespace {
+bool writeXbel(const QString &path, const QList<QPair<QString, QString>> &bookmarks)
+{
+    QByteArray data("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<xbel version=\"1.0\">\n");
+    for (const auto &bookmark : bookmarks) {
+        data += QString("<bookmark href=\"%1\" added=\"%2\" modified=\"%2\" visited=\"%2\"/>\n")
+                .arg(QUrl::fromLocalFile(bookmark.first).toString(), bookmark.second).toUtf8();
+    }
+    data += "</xbel>\n";
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+}
+
+TEST_F(TestRecentController, tst_readXbelBookmarks)
+{
+    QByteArray data("<xbel><bookmark href=\"file:///tmp/a.txt\" modified=\"2022-01-01T00:00:00Z\"/>"
+                    "<bookmark href=\"\" modified=\"2022-01-01T00:00:00Z\"/>"
+                    "<bookmark href=\"file:///tmp/b.txt\"/></xbel>");
+    QBuffer buffer(&data);
+    ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+
+    const QHash<QString, QString> &bookmarks = RecentController::readXbelBookmarks(&buffer);
+    EXPECT_EQ(2, bookmarks.size());
+    EXPECT_EQ(QString("2022-01-01T00:00:00Z"), bookmarks.value("file:///tmp/a.txt"));
+    EXPECT_TRUE(bookmarks.contains("file:///tmp/b.txt"));
+}
+
+TEST_F(TestRecentController, tst_handleFileChanged_diff)
+{
+    // 等待构造时触发的解析结束，避免与真实的 xbel 文件相互影响
+    QThreadPool::globalInstance()->waitForDone();
+
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &fileA = dir.path() + "/a.txt";
+    const QString &fileB = dir.path() + "/b.txt";
+    QFile(fileA).open(QIODevice::WriteOnly);
+    QFile(fileB).open(QIODevice::WriteOnly);
+    const DUrl &urlA = DUrl::fromRecentFile(fileA);
+    const DUrl &urlB = DUrl::fromRecentFile(fileB);
+
+    const QString oldXbelPath = m_controller->m_xbelPath;
+    m_controller->m_xbelPath = dir.path() + "/recently-used.xbel";
+    m_controller->m_xbelEntries.clear();
+    m_controller->m_xbelSize = -1;
+    m_controller->recentNodes.clear();
+
+    int createEntryCount = 0;
+    StubExt st;
+    auto createEntry = static_cast<RecentController::XbelEntry (*)(const QString &, const QString &)>(&RecentController::createXbelEntry);
+    st.set_lamda(createEntry, [&createEntryCount](const QString &href, const QString &modified) {
+        ++createEntryCount;
+        RecentController::XbelEntry entry;
+        entry.modified = modified;
+        entry.fileUrl = DUrl(href);
+        return entry;
+    });
+
+    ASSERT_TRUE(writeXbel(m_controller->m_xbelPath, {{fileA, "2022-01-01T00:00:00Z"}}));
+    m_controller->handleFileChanged();
+    EXPECT_EQ(1, createEntryCount);
+    EXPECT_TRUE(m_controller->recentNodes.contains(urlA));
+
+    // 未变化的条目不需要重新检查
+    createEntryCount = 0;
+    ASSERT_TRUE(writeXbel(m_controller->m_xbelPath, {{fileA, "2022-01-01T00:00:00Z"}, {fileB, "2022-01-02T00:00:00Z"}}));
+    m_controller->handleFileChanged();
+    EXPECT_EQ(1, createEntryCount);
+    EXPECT_TRUE(m_controller->recentNodes.contains(urlA));
+    EXPECT_TRUE(m_controller->recentNodes.contains(urlB));
+
+    createEntryCount = 0;
+    ASSERT_TRUE(writeXbel(m_controller->m_xbelPath, {{fileB, "2022-01-03T00:00:00Z"}}));
+    m_controller->handleFileChanged();
+    EXPECT_EQ(1, createEntryCount);
+    EXPECT_FALSE(m_controller->recentNodes.contains(urlA));
+    EXPECT_TRUE(m_controller->recentNodes.contains(urlB));
+
+    // 沿用的条目也要重新检查文件是否存在
+    QFile::remove(fileB);
+    m_controller->m_xbelSize = -1;
+    m_controller->handleFileChanged();
+    EXPECT_EQ(1, createEntryCount);
+    EXPECT_FALSE(m_controller->recentNodes.contains(urlB));
+
+    QFile(fileB).open(QIODevice::WriteOnly);
+    m_controller->m_xbelSize = -1;
+    m_controller->handleFileChanged();
+    EXPECT_EQ(1, createEntryCount);
+    EXPECT_TRUE(m_controller->recentNodes.contains(urlB));
+
+    m_controller->recentNodes.clear();
+    m_controller->m_xbelEntries.clear();
+    m_controller->m_xbelSize = -1;
+    m_controller->m_xbelPath = oldXbelPath;
+}
 }
 
@@ -13,6 +13,7 @@
 #include <QProcess>
 #include <QIcon>
 #include <QStandardPaths>
+#include <QtConcurrent>
 
 #include <gtest/gtest.h>
 #include "stub.h"
@@ -51,6 +52,30 @@ TEST_F(TestDAbstractFileInfo, getFileInfo)
     EXPECT_TRUE(fileInfo == nullptr);
 }
 
+TEST_F(TestDAbstractFileInfo, fileInfoCache)
+{
+    const DUrl url = DUrl::fromLocalFile("/tmp/dfm_file_info_cache_test");
+    DAbstractFileInfoPointer cached(new DAbstractFileInfo(url));
+    const DAbstractFileInfo::CacheStatistics &statistics = DAbstractFileInfo::fileInfoCacheStatistics();
+
+    auto getInWorker = [url] {
+        return QtConcurrent::run([url] { return DAbstractFileInfo::getFileInfo(url); }).result();
+    };
+
+    EXPECT_EQ(cached, DAbstractFileInfo::getFileInfo(url));
+    // 主线程随时会刷新缓存中的对象，其它线程不能共享
+    EXPECT_FALSE(getInWorker());
+
+    const DAbstractFileInfo::CacheStatistics &current = DAbstractFileInfo::fileInfoCacheStatistics();
+    EXPECT_EQ(statistics.hits + 1, current.hits);
+    EXPECT_EQ(statistics.misses, current.misses);
+
+    // 对象释放后从缓存中移除
+    cached.reset();
+    EXPECT_FALSE(DAbstractFileInfo::getFileInfo(url));
+    EXPECT_EQ(current.misses + 1, DAbstractFileInfo::fileInfoCacheStatistics().misses);
+}
+
 TEST_F(TestDAbstractFileInfo, exists)
 {
     EXPECT_FALSE(info->exists());
@@ -116,6 +141,25 @@ TEST_F(TestDAbstractFileInfo, fileDisplayPinyinName)
     EXPECT_EQ(info->fileDisplayPinyinName(), "1.txt");
 }
 
+TEST_F(TestDAbstractFileInfo, fileDisplayNameSortKey)
+{
+    const DFileNameSortKey &key = info->fileDisplayNameSortKey();
+    EXPECT_EQ(key.compare(info->fileDisplayNameSortKey()), 0);
+    EXPECT_EQ(key.compare(DFileNameSortKey("1.txt")), 0);
+}
+
+TEST_F(TestDAbstractFileInfo, fileNameSortKeyOrder)
+{
+    // 数字按数值比较
+    EXPECT_LT(DFileNameSortKey("file2").compare(DFileNameSortKey("file10")), 0);
+    // 字母数字开头的名称在汉字开头的之前，符号开头的排在最后
+    EXPECT_LT(DFileNameSortKey("zoo").compare(DFileNameSortKey("文件")), 0);
+    EXPECT_LT(DFileNameSortKey("文件").compare(DFileNameSortKey("_tmp")), 0);
+    // 汉字按拼音排序
+    EXPECT_LT(DFileNameSortKey("安装").compare(DFileNameSortKey("文件")), 0);
+    EXPECT_GT(DFileNameSortKey("文件").compare(DFileNameSortKey("安装")), 0);
+}
+
 TEST_F(TestDAbstractFileInfo, canRename)
 {
     EXPECT_FALSE(info->canRename());
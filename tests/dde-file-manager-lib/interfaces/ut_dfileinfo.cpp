@@ -269,3 +269,47 @@ TEST_F(TestDFileInfo, test_static_mimeType)
     EXPECT_TRUE(DFileInfo::mimeType(m_filePathStr, QMimeDatabase::MatchDefault, QString(), true).isValid());
     EXPECT_TRUE(DFileInfo::mimeType(m_filePathStr).isValid());
 }
+
+TEST_F(TestDFileInfo, test_stat_snapshot)
+{
+    ASSERT_NE(m_pFileInfo, nullptr);
+    ASSERT_NE(m_pSymLinkInfo, nullptr);
+
+    const QFileInfo fileInfo(m_filePathStr);
+    EXPECT_TRUE(m_pFileInfo->isFile());
+    EXPECT_FALSE(m_pFileInfo->isSymLink());
+    EXPECT_EQ(DAbstractFileInfo::RegularFile, m_pFileInfo->fileType());
+    EXPECT_EQ(fileInfo.ownerId(), m_pFileInfo->ownerId());
+    EXPECT_EQ(fileInfo.lastModified().toSecsSinceEpoch(), m_pFileInfo->lastModified().toSecsSinceEpoch());
+
+    // 链接文件使用目标文件的属性
+    EXPECT_TRUE(m_pSymLinkInfo->isSymLink());
+    EXPECT_TRUE(m_pSymLinkInfo->isFile());
+    EXPECT_EQ(m_pFileInfo->inode(), m_pSymLinkInfo->inode());
+
+    EXPECT_TRUE(m_pDirInfo->isDir());
+    EXPECT_EQ(DAbstractFileInfo::Directory, m_pDirInfo->fileType());
+
+    // 快照在 refresh 之后才会更新
+    QFile file(m_filePathStr);
+    ASSERT_TRUE(file.open(QIODevice::Append));
+    file.write("snapshot");
+    file.close();
+    EXPECT_EQ(0, m_pFileInfo->size());
+    m_pFileInfo->refresh();
+    EXPECT_EQ(8, m_pFileInfo->size());
+
+    // additionalIcon 不使用快照，文件被删除（重命名）后即使没有 refresh 也不再显示角标
+    QFile::remove(m_filePathStr);
+    EXPECT_TRUE(m_pFileInfo->exists());
+    EXPECT_TRUE(m_pFileInfo->additionalIcon().isEmpty());
+    m_pFileInfo->refresh();
+    EXPECT_FALSE(m_pFileInfo->exists());
+
+    // 目标不存在的链接文件仍然存在，但不是普通文件
+    m_pSymLinkInfo->refresh();
+    EXPECT_TRUE(m_pSymLinkInfo->exists());
+    EXPECT_TRUE(m_pSymLinkInfo->isSymLink());
+    EXPECT_FALSE(m_pSymLinkInfo->isFile());
+    EXPECT_TRUE(m_pSymLinkInfo->lastModified().isValid());
+}
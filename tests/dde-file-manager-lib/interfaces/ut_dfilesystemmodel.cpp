@@ -6,6 +6,7 @@
 #include <gmock/gmock-matchers.h>
 
 #include <QTimer>
+#include <QSignalSpy>
 #include <dfmevent.h>
 #include "stubext.h"
 #define private public
@@ -354,6 +355,54 @@ TEST_F(TestDFileSystemModel, test_setAdvanceSearchFilter)
 
 }
 
+TEST_F(TestDFileSystemModel, test_insertSortedNodes)
+{
+    QReadWriteLock lk;
+    const DAbstractFileInfoPointer &rootInfo = DFileService::instance()->createFileInfo(nullptr, tmpDirUrl);
+    FileSystemNodePointer rootNode = m_model->createNode(nullptr, rootInfo, &lk);
+
+    auto createChild = [&](const QString &name) {
+        const DUrl &url = DUrl::fromLocalFile(TestHelper::createTmpFileName(name, tmpDirUrl.path()));
+        return m_model->createNode(rootNode.data(), DFileService::instance()->createFileInfo(nullptr, url), &lk);
+    };
+
+    for (const QString &name : {"b.txt", "d.txt", "f.txt"}) {
+        const FileSystemNodePointer &node = createChild(name);
+        rootNode->appendChildren(node->fileInfo->fileUrl(), node);
+    }
+
+    QList<FileSystemNodePointer> nodes;
+    for (const QString &name : {"a.txt", "c1.txt", "c2.txt", "g.txt"})
+        nodes << createChild(name);
+
+    DAbstractFileInfo::CompareFunction compareFun = [](const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2,
+                                                       Qt::SortOrder order, bool) {
+        return order == Qt::AscendingOrder ? info1->fileName() < info2->fileName() : info1->fileName() > info2->fileName();
+    };
+
+    FileNodeManagerThread manager(m_model);
+    manager.setRootNode(rootNode);
+
+    QSignalSpy spy(m_model, SIGNAL(rowsInserted(QModelIndex, int, int)));
+    EXPECT_TRUE(manager.insertSortedNodes(nodes, compareFun));
+
+    // 插入到同一位置的节点只通知一次
+    EXPECT_EQ(3, spy.count());
+
+    QStringList names;
+    for (const FileSystemNodePointer &node : rootNode->getChildrenList())
+        names << node->fileInfo->fileName();
+    EXPECT_EQ(QStringList({"a.txt", "b.txt", "c1.txt", "c2.txt", "d.txt", "f.txt", "g.txt"}), names);
+
+    // 已存在的节点不会重复插入
+    spy.clear();
+    EXPECT_TRUE(manager.insertSortedNodes(nodes, compareFun));
+    EXPECT_EQ(0, spy.count());
+    EXPECT_EQ(7, rootNode->childrenCount());
+
+    rootNode->clearChildren();
+}
+
 TEST(FileSystemNodeTest, setNodeVisible)
 {
     QReadWriteLock lk;
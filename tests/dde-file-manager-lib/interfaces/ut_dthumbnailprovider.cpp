@@ -209,6 +209,33 @@ TEST_F(DThumbnailProviderTest, test_thumbnailFilePath_fileReadError)
     ASSERT_TRUE(thumbnailProvide->thumbnailFilePath(info, DThumbnailProvider::Normal).isEmpty());
 }
 
+TEST_F(DThumbnailProviderTest, test_thumbnailPixmap)
+{
+    QFileInfo info(THUMBNAIL_RESOURCE"logo.png");
+    ASSERT_TRUE(info.exists());
+    const qint64 limit = thumbnailProvide->pixmapCacheLimit();
+    thumbnailProvide->setPixmapCacheLimit(16 * 1024 * 1024);
+    thumbnailProvide->clearPixmapCache();
+
+    QString thumbnailPath = thumbnailProvide->createThumbnail(info, DThumbnailProvider::Normal);
+    ASSERT_TRUE(QFile::exists(thumbnailPath));
+    const QPixmap &pixmap = thumbnailProvide->thumbnailPixmap(info, DThumbnailProvider::Normal);
+    ASSERT_FALSE(pixmap.isNull());
+    EXPECT_EQ(1, thumbnailProvide->d_func()->pixmapCache.count());
+
+    // 命中缓存时不再读取缩略图文件
+    ASSERT_TRUE(QFile::remove(thumbnailPath));
+    EXPECT_EQ(pixmap.cacheKey(), thumbnailProvide->thumbnailPixmap(info, DThumbnailProvider::Normal).cacheKey());
+    EXPECT_TRUE(thumbnailProvide->thumbnailPixmap(info, DThumbnailProvider::Large).isNull());
+
+    // 超出字节数上限时淘汰
+    thumbnailProvide->setPixmapCacheLimit(1);
+    EXPECT_EQ(0, thumbnailProvide->d_func()->pixmapCache.count());
+    EXPECT_TRUE(thumbnailProvide->thumbnailPixmap(info, DThumbnailProvider::Normal).isNull());
+
+    thumbnailProvide->setPixmapCacheLimit(limit);
+}
+
 TEST_F(DThumbnailProviderTest, test_appendToProduceQueue)
 {
     QFileInfo pngInfo(THUMBNAIL_RESOURCE"logo.png");
@@ -261,9 +288,10 @@ TEST_F(DThumbnailProviderTest, test_removeInProduceQueue)
     condition.wait(&mutex, 2000); // 需要等appendToProduceQueue执行完成才能进行移除
     thumbnailProvide->removeInProduceQueue(pngInfo, DThumbnailProvider::Normal);
     const QPair<QString, DThumbnailProvider::Size> &tmpKey = qMakePair(pngInfo.absoluteFilePath(), DThumbnailProvider::Normal);
-    auto discardedProduceInfos = thumbnailProvide->d_func()->discardedProduceInfos;
-    ASSERT_TRUE(discardedProduceInfos.contains(tmpKey));
-    discardedProduceInfos.remove(tmpKey);
+    {
+        QMutexLocker produceLocker(&thumbnailProvide->d_func()->produceMutex);
+        ASSERT_FALSE(thumbnailProvide->d_func()->produceInfos.contains(tmpKey));
+    }
     sem.tryAcquire(2, 2000);
     QFile savePngFile(savePngImage);
     if(savePngFile.exists()) {
@@ -271,12 +299,75 @@ TEST_F(DThumbnailProviderTest, test_removeInProduceQueue)
     }
 }
 
+TEST_F(DThumbnailProviderTest, test_produceOrder)
+{
+    DFileThumbnailProviderPrivate provider;
+    DThumbnailProviderPrivate *d = provider.d_func();
+    // 不启动生成线程，只检查队列的顺序
+    d->workerCount = d->workerPool.maxThreadCount();
+
+    const QStringList files {"/tmp/a.txt", "/tmp/b.txt", "/tmp/c.txt", "/tmp/d.mp4", "/tmp/e.mp4"};
+    for (const QString &file : files)
+        provider.appendToProduceQueue(QFileInfo(file), DThumbnailProvider::Large);
+    // 重复的请求只追加回调
+    provider.appendToProduceQueue(QFileInfo(files.first()), DThumbnailProvider::Large);
+    EXPECT_EQ(files.size(), d->produceInfos.size());
+    EXPECT_EQ(2, d->produceInfos.value(qMakePair(files.first(), DThumbnailProvider::Large)).callbacks.size());
+
+    provider.updateViewport({{"/tmp/c.txt", 0}, {"/tmp/e.mp4", 1}, {"/tmp/d.mp4", 2}});
+    provider.removeInProduceQueue(QFileInfo("/tmp/b.txt"), DThumbnailProvider::Large);
+
+    QStringList order;
+    DThumbnailProviderPrivate::ProduceKey key;
+    DThumbnailProviderPrivate::ProduceInfo info;
+    d->decoderLimits[DThumbnailProviderPrivate::VideoDecoder] = 1;
+    while (d->takeProduceInfo(key, info))
+        order << key.first;
+
+    // 视频同时只能生成一个，d.mp4 要等 e.mp4 生成完成
+    EXPECT_EQ(QStringList({"/tmp/c.txt", "/tmp/e.mp4", "/tmp/a.txt"}), order);
+    --d->runningDecoders[DThumbnailProviderPrivate::VideoDecoder];
+    ASSERT_TRUE(d->takeProduceInfo(key, info));
+    EXPECT_EQ(QString("/tmp/d.mp4"), key.first);
+
+    d->workerCount = 0;
+}
+
+TEST_F(DThumbnailProviderTest, test_startWorker)
+{
+    DFileThumbnailProviderPrivate provider;
+    DThumbnailProviderPrivate *d = provider.d_func();
+    const int maxThreadCount = d->workerPool.maxThreadCount();
+    d->workerPool.setMaxThreadCount(2);
+
+    // 已有线程在生成时，新的请求即使队列很短也要启动新的线程
+    {
+        QMutexLocker locker(&d->produceMutex);
+        d->workerCount = 1;
+    }
+    provider.appendToProduceQueue(QFileInfo("/tmp/dfm_thumbnail_worker_test.txt"), DThumbnailProvider::Large);
+    {
+        QMutexLocker locker(&d->produceMutex);
+        EXPECT_EQ(2, d->workerCount);
+    }
+
+    // 达到线程池上限时不再启动
+    provider.appendToProduceQueue(QFileInfo("/tmp/dfm_thumbnail_worker_test2.txt"), DThumbnailProvider::Large);
+    d->workerPool.waitForDone();
+    {
+        QMutexLocker locker(&d->produceMutex);
+        EXPECT_EQ(1, d->workerCount);
+        d->workerCount = 0;
+    }
+    d->workerPool.setMaxThreadCount(maxThreadCount);
+}
+
 TEST_F(DThumbnailProviderTest, test_errorString)
 {
     QString simpleError = "test error";
-    thumbnailProvide->d_func()->errorString = simpleError;
+    thumbnailProvide->d_func()->errorString.setLocalData(simpleError);
     EXPECT_EQ(thumbnailProvide->errorString(), simpleError);
-    thumbnailProvide->d_func()->errorString = "";
+    thumbnailProvide->d_func()->errorString.setLocalData(QString());
 }
 
 TEST_F(DThumbnailProviderTest, test_hasThumbnail_no_file)
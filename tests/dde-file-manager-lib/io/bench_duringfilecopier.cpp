@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <iostream>
+
+#include "duringfilecopier.h"
+
+DFM_USE_NAMESPACE
+
+namespace {
+// 在 dir 下创建 count 个 size 大小的文件，返回拷贝任务
+QVector<DUringFileCopier::Task> createTasks(const QString &dir, int count, int size)
+{
+    QDir(dir).mkpath("from");
+    QDir(dir).mkpath("to");
+
+    QVector<DUringFileCopier::Task> tasks;
+    const QByteArray data(size, 'd');
+    for (int i = 0; i < count; ++i) {
+        const QString &name = QString("/file_%1").arg(i);
+        QFile file(dir + "/from" + name);
+        if (!file.open(QIODevice::WriteOnly))
+            break;
+        file.write(data);
+        file.close();
+
+        DUringFileCopier::Task task;
+        task.source = QFile::encodeName(dir + "/from" + name);
+        task.target = QFile::encodeName(dir + "/to" + name);
+        task.size = size;
+        tasks << task;
+    }
+
+    return tasks;
+}
+
+// 与线程池中拷贝小文件的方式相同，每个文件一个任务
+void copyByThreadPool(const QVector<DUringFileCopier::Task> &tasks)
+{
+    QThreadPool pool;
+    for (const DUringFileCopier::Task &task : tasks) {
+        QtConcurrent::run(&pool, [task] {
+            QFile from(QFile::decodeName(task.source));
+            QFile to(QFile::decodeName(task.target));
+            if (from.open(QIODevice::ReadOnly) && to.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                to.write(from.readAll());
+        });
+    }
+    pool.waitForDone();
+}
+}
+
+// 与线程池逐个拷贝对比吞吐量，文件数量可以用 DFM_COPY_BENCHMARK_FILES 调整，如 100000
+TEST(BenchmarkDUringFileCopier, tst_benchmark_against_thread_pool)
+{
+    if (!DUringFileCopier::isSupported())
+        return;
+
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("DFM_COPY_BENCHMARK_FILES", &ok);
+    if (!ok || count <= 0)
+        count = 5000;
+
+    QVector<DUringFileCopier::Task> tasks = createTasks(dir.path(), count, 4096);
+    ASSERT_EQ(count, tasks.size());
+
+    QElapsedTimer timer;
+    timer.start();
+    copyByThreadPool(tasks);
+    const qint64 poolCost = qMax<qint64>(1, timer.restart());
+
+    DUringFileCopier copier;
+    EXPECT_TRUE(copier.copy(tasks, nullptr));
+    const qint64 uringCost = qMax<qint64>(1, timer.elapsed());
+
+    std::cout << "copy " << count << " x 4KB files, thread pool: " << count * 1000 / poolCost
+              << " files/s, io_uring: " << count * 1000 / uringCost << " files/s" << std::endl;
+    for (const DUringFileCopier::Task &task : tasks)
+        EXPECT_EQ(0, task.error);
+}
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "dfilecopyjournal.h"
+
+DFM_USE_NAMESPACE
+
+namespace {
+const DUrlList sources = {DUrl::fromLocalFile("/tmp/from/a"), DUrl::fromLocalFile("/tmp/from/b")};
+const DUrl target = DUrl::fromLocalFile("/tmp/to");
+}
+
+TEST(DFileCopyJournalTest, journal_path_of_job)
+{
+    const QString &path = DFileCopyJournal::journalPath(0, sources, target);
+    EXPECT_TRUE(path.endsWith(".journal"));
+    EXPECT_EQ(path, DFileCopyJournal::journalPath(0, sources, target));
+    EXPECT_NE(path, DFileCopyJournal::journalPath(2, sources, target));
+    EXPECT_NE(path, DFileCopyJournal::journalPath(0, sources, DUrl::fromLocalFile("/tmp/other")));
+}
+
+TEST(DFileCopyJournalTest, can_resume_entries)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/job.journal";
+
+    {
+        DFileCopyJournal journal(path);
+        ASSERT_TRUE(journal.open(0, sources, target));
+        EXPECT_EQ(0, journal.count());
+        EXPECT_TRUE(journal.append(DFileCopyJournal::FileEntry, sources.at(0), DUrl::fromLocalFile("/tmp/to/a"), 100, 1000));
+        EXPECT_TRUE(journal.append(DFileCopyJournal::DirectoryCreatedEntry, sources.at(1), DUrl::fromLocalFile("/tmp/to/b"), 0, 0));
+        EXPECT_TRUE(journal.append(DFileCopyJournal::DirectoryEntry, sources.at(1), DUrl::fromLocalFile("/tmp/to/b"), 0, 2000));
+    }
+
+    DFileCopyJournal journal(path);
+    ASSERT_TRUE(journal.open(0, sources, target));
+    EXPECT_EQ(2, journal.count());
+
+    DFileCopyJournal::Entry entry;
+    ASSERT_TRUE(journal.find(sources.at(0), entry));
+    EXPECT_EQ(DFileCopyJournal::FileEntry, entry.type);
+    EXPECT_EQ(DUrl::fromLocalFile("/tmp/to/a"), entry.target);
+    EXPECT_EQ(100, entry.size);
+    EXPECT_EQ(1000, entry.lastModified);
+
+    // 后追加的记录覆盖先前的
+    ASSERT_TRUE(journal.find(sources.at(1), entry));
+    EXPECT_EQ(DFileCopyJournal::DirectoryEntry, entry.type);
+    EXPECT_EQ(2000, entry.lastModified);
+
+    EXPECT_FALSE(journal.find(DUrl::fromLocalFile("/tmp/from/c"), entry));
+
+    journal.remove();
+    EXPECT_FALSE(QFile::exists(path));
+}
+
+TEST(DFileCopyJournalTest, drop_truncated_entry)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/job.journal";
+
+    qint64 size = 0;
+    {
+        DFileCopyJournal journal(path);
+        ASSERT_TRUE(journal.open(0, sources, target));
+        EXPECT_TRUE(journal.append(DFileCopyJournal::FileEntry, sources.at(0), DUrl::fromLocalFile("/tmp/to/a"), 100, 1000));
+        size = QFile(path).size();
+        EXPECT_TRUE(journal.append(DFileCopyJournal::FileEntry, sources.at(1), DUrl::fromLocalFile("/tmp/to/b"), 200, 1000));
+    }
+
+    // 模拟崩溃时只写了一半的记录
+    ASSERT_TRUE(QFile::resize(path, QFile(path).size() - 5));
+
+    {
+        DFileCopyJournal journal(path);
+        ASSERT_TRUE(journal.open(0, sources, target));
+        EXPECT_EQ(1, journal.count());
+        EXPECT_EQ(size, QFile(path).size());
+
+        DFileCopyJournal::Entry entry;
+        EXPECT_FALSE(journal.find(sources.at(1), entry));
+        EXPECT_TRUE(journal.append(DFileCopyJournal::FileEntry, sources.at(1), DUrl::fromLocalFile("/tmp/to/b"), 200, 1000));
+    }
+
+    DFileCopyJournal journal(path);
+    ASSERT_TRUE(journal.open(0, sources, target));
+    EXPECT_EQ(2, journal.count());
+}
+
+TEST(DFileCopyJournalTest, reset_journal_of_other_job)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/job.journal";
+
+    {
+        DFileCopyJournal journal(path);
+        ASSERT_TRUE(journal.open(0, sources, target));
+        EXPECT_TRUE(journal.append(DFileCopyJournal::FileEntry, sources.at(0), DUrl::fromLocalFile("/tmp/to/a"), 100, 1000));
+    }
+
+    DFileCopyJournal journal(path);
+    ASSERT_TRUE(journal.open(2, sources, target));
+    EXPECT_EQ(0, journal.count());
+}
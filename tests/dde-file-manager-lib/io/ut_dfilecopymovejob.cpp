@@ -6,6 +6,7 @@
 
 #include "fcntl.h"
 #include "sys/mman.h"
+#include "unistd.h"
 #define private public
 #define protected public
 #include "deviceinfo/udisklistener.h"
@@ -1454,6 +1455,75 @@ DFileDevice *createFileDevicelamda1(void *, const QObject *, const DUrl &url)
     return device;
 };
 
+TEST_F(DFileCopyMoveJobTest, start_doCopyFileDirect)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+    // 末尾不足对齐大小，拷贝后应截断回原大小
+    DUrl from(DUrl::fromLocalFile(TestHelper::createTmpFile())), to;
+    QByteArray data;
+    for (int i = 0; i < 5 * 1024 * 1024 + 100; ++i)
+        data.append(static_cast<char>(i % 251));
+    QFile filefrom(from.toLocalFile());
+    ASSERT_TRUE(filefrom.open(QIODevice::WriteOnly));
+    filefrom.write(data);
+    filefrom.close();
+
+    to.setPath(QDir::currentPath() + "/zut_test_file_direct");
+    to.setScheme(FILE_SCHEME);
+    QSharedPointer<DFileHandler>  handler(DFileService::instance()->createFileHandler(nullptr, from));
+    DAbstractFileInfoPointer frominfo = DFileService::instance()->createFileInfo(nullptr, from);
+    DAbstractFileInfoPointer toinfo = DFileService::instance()->createFileInfo(nullptr, to);
+
+    // 当前目录的文件系统不支持 O_DIRECT（如 tmpfs）时应交给 doCopyFileOnBlock
+    const int probefd = open(to.toLocalFile().toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);
+    const bool isDirectSupported = probefd >= 0;
+    if (isDirectSupported)
+        close(probefd);
+
+    bool isFallback = false;
+    int syncCount = 0;
+    StubExt stl;
+    stl.set_lamda(&DFileCopyMoveJobPrivate::stateCheck, []() {return true;});
+    stl.set_lamda(&DFileCopyMoveJobPrivate::doCopyFileOnBlock, [&isFallback]() {isFallback = true; return true;});
+    stl.set_lamda(fdatasync, [&syncCount]() {++syncCount; return 0;});
+    // 与 doCopyFileOnBlock 相同，要求每次写入后同步时每个块都要同步
+    jobd->m_isEveryReadAndWritesSnc = true;
+    EXPECT_TRUE(jobd->doCopyFileDirect(frominfo, toinfo, handler));
+    jobd->m_isEveryReadAndWritesSnc = false;
+    EXPECT_EQ(!isDirectSupported, isFallback);
+    if (isDirectSupported) {
+        EXPECT_EQ(2, syncCount);
+        QFile fileto(to.toLocalFile());
+        ASSERT_TRUE(fileto.open(QIODevice::ReadOnly));
+        EXPECT_EQ(data, fileto.readAll());
+    }
+
+    TestHelper::deleteTmpFile(from.toLocalFile());
+    TestHelper::deleteTmpFile(to.toLocalFile());
+}
+
+TEST_F(DFileCopyMoveJobTest, start_doCopyFileDirect_fallback)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+    DUrl from(DUrl::fromLocalFile(TestHelper::createTmpFile()));
+    // 目标文件无法打开时不做任何写入，交给 doCopyFileOnBlock 处理错误
+    DUrl to(DUrl::fromLocalFile(QDir::currentPath() + "/zut_test_missing_dir/zut_test_file_direct"));
+    QSharedPointer<DFileHandler>  handler(DFileService::instance()->createFileHandler(nullptr, from));
+    DAbstractFileInfoPointer frominfo = DFileService::instance()->createFileInfo(nullptr, from);
+    DAbstractFileInfoPointer toinfo = DFileService::instance()->createFileInfo(nullptr, to);
+
+    bool isFallback = false;
+    StubExt stl;
+    stl.set_lamda(&DFileCopyMoveJobPrivate::doCopyFileOnBlock, [&isFallback]() {isFallback = true; return false;});
+    EXPECT_FALSE(jobd->doCopyFileDirect(frominfo, toinfo, handler));
+    EXPECT_TRUE(isFallback);
+    EXPECT_FALSE(QFile::exists(to.toLocalFile()));
+
+    TestHelper::deleteTmpFile(from.toLocalFile());
+}
+
 TEST_F(DFileCopyMoveJobTest, start_doCopyFileU)
 {
     DFileCopyMoveJobPrivate *jobd = job->d_func();
@@ -1740,6 +1810,66 @@ qint64 iowritetest(const char *, qint64)
     return -1;
 }
 
+TEST_F(DFileCopyMoveJobTest, start_FileCopyRing)
+{
+    DFileCopyMoveJobPrivate::FileCopyRing ring(2, 4096);
+    EXPECT_TRUE(ring.isEmpty());
+    EXPECT_FALSE(ring.front(0));
+
+    DFileCopyMoveJobPrivate::FileCopyInfo *info = ring.reserve([] { return true; });
+    ASSERT_TRUE(info);
+    EXPECT_TRUE(info->buffer);
+    info->currentpos = 1;
+    ring.commit();
+    info = ring.reserve([] { return true; });
+    ASSERT_TRUE(info);
+    info->currentpos = 2;
+    ring.commit();
+    // 队列已满，任务停止时不再等待
+    EXPECT_FALSE(ring.reserve([] { return false; }));
+
+    ASSERT_TRUE(ring.front(0));
+    EXPECT_EQ(1, ring.front(0)->currentpos);
+    ring.pop();
+    EXPECT_EQ(2, ring.front(0)->currentpos);
+    ring.pop();
+    EXPECT_TRUE(ring.isEmpty());
+
+    // 读写线程并发时保持顺序
+    const int count = 1000;
+    QFuture<void> producer = QtConcurrent::run([&ring, count] {
+        for (int i = 0; i < count; ++i) {
+            DFileCopyMoveJobPrivate::FileCopyInfo *slot = ring.reserve([] { return true; });
+            slot->currentpos = i;
+            ring.commit();
+        }
+    });
+    int received = 0;
+    while (received < count) {
+        DFileCopyMoveJobPrivate::FileCopyInfo *slot = ring.front(10);
+        if (!slot)
+            continue;
+        EXPECT_EQ(received, slot->currentpos);
+        ring.pop();
+        ++received;
+    }
+    producer.waitForFinished();
+    EXPECT_TRUE(ring.isEmpty());
+}
+
+// 把 info 放入写队列，data 拷贝到队列位置的缓冲区中
+static void enqueueCopyInfo(DFileCopyMoveJobPrivate *jobd, const DFileCopyMoveJobPrivate::FileCopyInfo &info, const char *data = nullptr)
+{
+    DFileCopyMoveJobPrivate::FileCopyInfo *slot = jobd->writeQueueReserve();
+    ASSERT_TRUE(slot);
+    char *buffer = slot->buffer;
+    *slot = info;
+    slot->buffer = buffer;
+    if (data && info.size > 0)
+        memcpy(buffer, data, static_cast<size_t>(info.size));
+    jobd->writeQueueCommit();
+}
+
 TEST_F(DFileCopyMoveJobTest, start_writeToFileByQueue)
 {
     DFileCopyMoveJobPrivate *jobd = job->d_func();
@@ -1760,64 +1890,40 @@ TEST_F(DFileCopyMoveJobTest, start_writeToFileByQueue)
     DAbstractFileInfoPointer frominfo = DFileService::instance()->createFileInfo(nullptr, from);
     DAbstractFileInfoPointer toinfo = DFileService::instance()->createFileInfo(nullptr, to);
     DAbstractFileInfoPointer dirinfo = DFileService::instance()->createFileInfo(nullptr, dirurl);
-    DFileCopyMoveJobPrivate::FileCopyInfoPointer copyinfo(new DFileCopyMoveJobPrivate::FileCopyInfo());
-    copyinfo->isdir = true;
-    copyinfo->toinfo = dirinfo;
-    copyinfo->handler = handler;
-    jobd->writeQueueEnqueue(copyinfo);
+    const char data[] = "123\n";
+    DFileCopyMoveJobPrivate::FileCopyInfo copyinfo;
+    copyinfo.isdir = true;
+    copyinfo.toinfo = dirinfo;
+    copyinfo.handler = handler;
+    enqueueCopyInfo(jobd, copyinfo);
     EXPECT_FALSE(jobd->writeToFileByQueue());
 
     stl.set_lamda(&DFileCopyMoveJobPrivate::stateCheck, []() {return true;});
-    copyinfo->buffer = new char[1024];
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo);
     EXPECT_FALSE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
-
-    jobd->writeQueueEnqueue(copyinfo);
-    copyinfo->frominfo = frominfo;
-    copyinfo->isdir = true;
+    EXPECT_TRUE(jobd->checkWritQueueEmpty());
 
+    copyinfo.frominfo = frominfo;
+    copyinfo.isdir = true;
+    enqueueCopyInfo(jobd, copyinfo);
     EXPECT_TRUE(jobd->writeToFileByQueue());
 
     jobd->m_skipFileQueue.push_back(frominfo->fileUrl());
-    copyinfo->isdir = false;
+    copyinfo.isdir = false;
     jobd->m_writeOpenFd.insert(frominfo->fileUrl(), 10);
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo);
     EXPECT_TRUE(jobd->writeToFileByQueue());
 
     jobd->m_skipFileQueue.clear();
-    copyinfo->frominfo = frominfo;
-    copyinfo->toinfo = toinfo;
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
-    copyinfo->size = 3;
-    copyinfo->closeflag = false;
-    jobd->writeQueueEnqueue(copyinfo);
-    DFileCopyMoveJobPrivate::FileCopyInfoPointer copyinfoover(
-        new DFileCopyMoveJobPrivate::FileCopyInfo(*copyinfo.data()));
-    copyinfoover->closeflag = true;
-    copyinfoover->buffer = new char[16];
-    copyinfoover->buffer[0] = '1';
-    copyinfoover->buffer[1] = '2';
-    copyinfoover->buffer[2] = '3';
-    copyinfoover->buffer[4] = '\n';
-    jobd->writeQueueEnqueue(copyinfoover);
+    copyinfo.frominfo = frominfo;
+    copyinfo.toinfo = toinfo;
+    copyinfo.size = 3;
+    copyinfo.closeflag = false;
+    enqueueCopyInfo(jobd, copyinfo, data);
+    DFileCopyMoveJobPrivate::FileCopyInfo copyinfoover(copyinfo);
+    copyinfoover.closeflag = true;
+    enqueueCopyInfo(jobd, copyinfoover, data);
     EXPECT_TRUE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
-
-    if (copyinfoover->buffer) {
-        delete [] copyinfoover->buffer;
-        copyinfoover->buffer = nullptr;
-    }
 
     jobd->m_skipFileQueue.clear();
     stl.set_lamda(&DFileCopyMoveJobPrivate::setAndhandleError, []() {
@@ -1825,51 +1931,24 @@ TEST_F(DFileCopyMoveJobTest, start_writeToFileByQueue)
     });
     stl.set_lamda(write, []() {return -1;});
     stl.set_lamda(lseek, []() {return false;});
-    jobd->writeQueueEnqueue(copyinfo);
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
+    enqueueCopyInfo(jobd, copyinfo, data);
     EXPECT_FALSE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
     stl.reset(&DFileCopyMoveJobPrivate::setAndhandleError);
 
     jobd->m_skipFileQueue.clear();
     stl.set_lamda(&DFileCopyMoveJobPrivate::setAndhandleError, []() {
         return DFileCopyMoveJob::SkipAction;
     });
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo, data);
     EXPECT_TRUE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
     stl.reset(&DFileCopyMoveJobPrivate::setAndhandleError);
 
     jobd->m_skipFileQueue.clear();
     stl.set_lamda(&DFileCopyMoveJobPrivate::setAndhandleError, []() {
         return DFileCopyMoveJob::CancelAction;
     });
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo, data);
     EXPECT_FALSE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
     stl.reset(&DFileCopyMoveJobPrivate::setAndhandleError);
 
     stl.set(write, writetest);
@@ -1878,51 +1957,24 @@ TEST_F(DFileCopyMoveJobTest, start_writeToFileByQueue)
     stl.set_lamda(&DFileCopyMoveJobPrivate::setAndhandleError, []() {
         return DFileCopyMoveJob::RetryAction;
     });
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo, data);
     EXPECT_FALSE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
     stl.reset(&DFileCopyMoveJobPrivate::setAndhandleError);
 
     jobd->m_skipFileQueue.clear();
     stl.set_lamda(&DFileCopyMoveJobPrivate::setAndhandleError, []() {
         return DFileCopyMoveJob::SkipAction;
     });
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo, data);
     EXPECT_TRUE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
     stl.reset(&DFileCopyMoveJobPrivate::setAndhandleError);
 
     jobd->m_skipFileQueue.clear();
     stl.set_lamda(&DFileCopyMoveJobPrivate::setAndhandleError, []() {
         return DFileCopyMoveJob::CancelAction;
     });
-    copyinfo->buffer = new char[16];
-    copyinfo->buffer[0] = '1';
-    copyinfo->buffer[1] = '2';
-    copyinfo->buffer[2] = '3';
-    copyinfo->buffer[4] = '\n';
-    jobd->writeQueueEnqueue(copyinfo);
+    enqueueCopyInfo(jobd, copyinfo, data);
     EXPECT_FALSE(jobd->writeToFileByQueue());
-    if (copyinfo->buffer) {
-        delete [] copyinfo->buffer;
-        copyinfo->buffer = nullptr;
-    }
 
     job->stop();
 
@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "dfilestatisticscache.h"
+
+DFM_USE_NAMESPACE
+
+class DFileStatisticsCacheTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        DFileStatisticsCache::instance()->clear();
+    }
+
+    void TearDown() override
+    {
+        DFileStatisticsCache::instance()->clear();
+    }
+};
+
+TEST_F(DFileStatisticsCacheTest, can_find_inserted)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QByteArray &path = QFile::encodeName(dir.path());
+
+    DFileStatisticsCache *cache = DFileStatisticsCache::instance();
+    const quint64 serial = cache->beginWalk();
+    const int wd = cache->watchDirectory(path);
+    ASSERT_GE(wd, 0);
+
+    DFileStatisticsCache::Statistics statistics;
+    statistics.totalSize = 100;
+    statistics.filesCount = 3;
+    statistics.directoryCount = 1;
+    cache->insert(path, 0, statistics, {wd}, serial);
+
+    DFileStatisticsCache::Statistics found;
+    EXPECT_TRUE(cache->find(path, 0, found));
+    EXPECT_EQ(100, found.totalSize);
+    EXPECT_EQ(3, found.filesCount);
+    EXPECT_EQ(1, found.directoryCount);
+
+    // 统计参数不同时不能命中
+    EXPECT_FALSE(cache->find(path, 1, found));
+}
+
+TEST_F(DFileStatisticsCacheTest, can_detect_nested_change)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    ASSERT_TRUE(QDir(dir.path()).mkpath("sub"));
+    const QByteArray &path = QFile::encodeName(dir.path());
+
+    DFileStatisticsCache *cache = DFileStatisticsCache::instance();
+    const quint64 serial = cache->beginWalk();
+    const QVector<int> watchList {cache->watchDirectory(path), cache->watchDirectory(QFile::encodeName(dir.filePath("sub")))};
+    cache->insert(path, 0, DFileStatisticsCache::Statistics(), watchList, serial);
+
+    DFileStatisticsCache::Statistics found;
+    ASSERT_TRUE(cache->find(path, 0, found));
+
+    // 子目录中文件的大小变化不影响根目录的修改时间，也要使缓存失效
+    QFile file(dir.filePath("sub/file"));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("data");
+    file.close();
+
+    EXPECT_FALSE(cache->find(path, 0, found));
+}
+
+TEST_F(DFileStatisticsCacheTest, can_skip_changed_during_walk)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QByteArray &path = QFile::encodeName(dir.path());
+
+    DFileStatisticsCache *cache = DFileStatisticsCache::instance();
+    const quint64 serial = cache->beginWalk();
+    const int wd = cache->watchDirectory(path);
+    ASSERT_GE(wd, 0);
+
+    // 目录在统计过程中发生变化，统计结果不能缓存
+    QFile file(dir.filePath("new"));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.close();
+    cache->insert(path, 0, DFileStatisticsCache::Statistics(), {wd}, serial);
+
+    DFileStatisticsCache::Statistics found;
+    EXPECT_FALSE(cache->find(path, 0, found));
+}
+
+TEST_F(DFileStatisticsCacheTest, can_skip_unwatched)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QByteArray &path = QFile::encodeName(dir.path());
+
+    DFileStatisticsCache *cache = DFileStatisticsCache::instance();
+    EXPECT_LT(cache->watchDirectory(QFile::encodeName(dir.filePath("missing"))), 0);
+
+    // 没有监视的统计结果不缓存
+    cache->insert(path, 0, DFileStatisticsCache::Statistics(), {}, cache->beginWalk());
+
+    DFileStatisticsCache::Statistics found;
+    EXPECT_FALSE(cache->find(path, 0, found));
+}
@@ -4,6 +4,9 @@
 
 #include <gtest/gtest.h>
 #include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
 
 #include "dfilestatisticsjob.h"
 
@@ -106,3 +109,54 @@ TEST_F(DFileStatisticsJobTest,can_running_ExcludeSourceFile) {
     }
     job->stop();
 }
+
+TEST_F(DFileStatisticsJobTest,can_count_local_tree) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    auto writeFile = [&dir](const QString &name, int size) {
+        QFile file(dir.filePath(name));
+        file.open(QIODevice::WriteOnly);
+        file.write(QByteArray(size, 'a'));
+    };
+    QDir(dir.path()).mkpath("sub1/sub2");
+    QDir(dir.path()).mkpath("sub3");
+    writeFile("a", 10);
+    writeFile("sub1/b", 20);
+    writeFile("sub1/sub2/c", 30);
+    writeFile("sub3/d", 0);
+    QFile::link(dir.filePath("a"), dir.filePath("sub3/link"));
+
+    // 统计在多个线程中进行
+    QAtomicInt foundCount = 0;
+    QObject::connect(job, &DFileStatisticsJob::fileFound, job, [&foundCount] { foundCount.ref(); }, Qt::DirectConnection);
+
+    job->start(DUrlList() << DUrl::fromLocalFile(dir.path()));
+    while (!job->isFinished()) {
+
+    }
+
+    // 链接按指向的文件大小统计
+    EXPECT_EQ(70, job->totalSize());
+    EXPECT_EQ(5, job->filesCount());
+    EXPECT_EQ(4, job->directorysCount());
+    EXPECT_EQ(3, job->directorysCount(false));
+    EXPECT_EQ(5, foundCount.load());
+}
+
+TEST_F(DFileStatisticsJobTest,can_stop_paused) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    for (int i = 0; i < 64; ++i)
+        QDir(dir.path()).mkpath(QString("sub%1/sub").arg(i));
+
+    // 暂停后停止，等待中的线程必须被唤醒并退出
+    for (int i = 0; i < 20; ++i) {
+        job->start(DUrlList() << DUrl::fromLocalFile(dir.path()));
+        job->togglePause();
+        job->togglePause();
+        job->togglePause();
+        job->stop();
+        EXPECT_TRUE(job->wait(5000));
+    }
+}
@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 #include <QDateTime>
+#include <QTemporaryDir>
 
 #include "dlocalfiledevice.h"
 
@@ -172,3 +173,41 @@ TEST_F(DLocalFileDeviceTest,can_setFileName) {
     EXPECT_EQ(true,device->setFileName(url.path()));
     EXPECT_EQ(url,static_cast<DFileDevice *>(device)->fileUrl());
 }
+
+TEST_F(DLocalFileDeviceTest,can_copyFrom) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    QByteArray content;
+    for (int i = 0; i < 100000; ++i)
+        content.append(static_cast<char>(i % 251));
+    QFile source(dir.filePath("source"));
+    ASSERT_TRUE(source.open(QIODevice::WriteOnly));
+    source.write(content);
+    source.close();
+
+    DLocalFileDevice from;
+    from.setFileName(dir.filePath("source"));
+    ASSERT_TRUE(from.open(QIODevice::ReadOnly));
+    device->setFileName(dir.filePath("target"));
+    ASSERT_TRUE(device->open(QIODevice::WriteOnly | QIODevice::Truncate));
+
+    qint64 copied = 0;
+    Q_FOREVER {
+        // 分多次拷贝，reflink 会一次完成
+        qint64 size = device->copyFrom(&from, 4096);
+        if (size <= 0)
+            break;
+        copied += size;
+    }
+    from.close();
+    device->close();
+
+    // 所有内核拷贝方式都不可用时由调用者读写拷贝
+    if (device->copyMethod() != DLocalFileDevice::BufferedCopy) {
+        EXPECT_EQ(content.size(), copied);
+        QFile target(dir.filePath("target"));
+        ASSERT_TRUE(target.open(QIODevice::ReadOnly));
+        EXPECT_TRUE(target.readAll() == content);
+    }
+}
@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "duringfilecopier.h"
+
+DFM_USE_NAMESPACE
+
+namespace {
+// 在 dir 下创建 count 个 size 大小的文件，返回拷贝任务
+QVector<DUringFileCopier::Task> createTasks(const QString &dir, int count, int size)
+{
+    QDir(dir).mkpath("from");
+    QDir(dir).mkpath("to");
+
+    QVector<DUringFileCopier::Task> tasks;
+    const QByteArray data(size, 'd');
+    for (int i = 0; i < count; ++i) {
+        const QString &name = QString("/file_%1").arg(i);
+        QFile file(dir + "/from" + name);
+        if (!file.open(QIODevice::WriteOnly))
+            break;
+        file.write(data);
+        file.close();
+
+        DUringFileCopier::Task task;
+        task.source = QFile::encodeName(dir + "/from" + name);
+        task.target = QFile::encodeName(dir + "/to" + name);
+        task.size = size;
+        tasks << task;
+    }
+
+    return tasks;
+}
+}
+
+TEST(DUringFileCopierTest, can_copy_files)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    QVector<DUringFileCopier::Task> tasks = createTasks(dir.path(), 20, 4096);
+    DUringFileCopier::Task empty;
+    empty.source = QFile::encodeName(dir.path() + "/from/empty");
+    empty.target = QFile::encodeName(dir.path() + "/to/empty");
+    QFile(dir.path() + "/from/empty").open(QIODevice::WriteOnly);
+    tasks << empty;
+    DUringFileCopier::Task missing;
+    missing.source = QFile::encodeName(dir.path() + "/from/missing");
+    missing.target = QFile::encodeName(dir.path() + "/to/missing");
+    tasks << missing;
+
+    DUringFileCopier copier(8);
+    if (!DUringFileCopier::isSupported()) {
+        EXPECT_FALSE(copier.copy(tasks, nullptr));
+        return;
+    }
+    ASSERT_TRUE(copier.isValid());
+
+    int finishedCount = 0;
+    EXPECT_TRUE(copier.copy(tasks, nullptr, [&](int) { ++finishedCount; }));
+    EXPECT_EQ(tasks.size(), finishedCount);
+
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(0, tasks.at(i).error);
+        EXPECT_EQ(4096, tasks.at(i).copiedSize);
+        EXPECT_EQ(4096, QFileInfo(QFile::decodeName(tasks.at(i).target)).size());
+    }
+    EXPECT_EQ(0, tasks.at(20).error);
+    EXPECT_TRUE(QFile::exists(QFile::decodeName(empty.target)));
+    EXPECT_EQ(ENOENT, tasks.at(21).error);
+    EXPECT_FALSE(QFile::exists(QFile::decodeName(missing.target)));
+}
+
+TEST(DUringFileCopierTest, can_cancel)
+{
+    if (!DUringFileCopier::isSupported())
+        return;
+
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    QVector<DUringFileCopier::Task> tasks = createTasks(dir.path(), 10, 1024);
+    DUringFileCopier copier(4);
+    EXPECT_TRUE(copier.copy(tasks, [] { return false; }));
+    for (const DUringFileCopier::Task &task : tasks)
+        EXPECT_EQ(ECANCELED, task.error);
+}
+
+TEST(DUringFileCopierTest, can_reject_large_file)
+{
+    if (!DUringFileCopier::isSupported())
+        return;
+
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    // 拷贝前记录的大小比实际小，读满缓冲区后放弃
+    QVector<DUringFileCopier::Task> tasks = createTasks(dir.path(), 1, static_cast<int>(DUringFileCopier::maxFileSize() * 2));
+    tasks[0].size = 1024;
+    DUringFileCopier copier(1);
+    EXPECT_TRUE(copier.copy(tasks, nullptr));
+    EXPECT_EQ(EFBIG, tasks.at(0).error);
+}
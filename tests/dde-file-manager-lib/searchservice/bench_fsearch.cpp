@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <malloc.h>
+
+#include "searcher/fsearch/fssearcher.h"
+
+namespace {
+// 在根节点下生成 64 个目录和 count 个文件，名称由固定的片段随机组合，
+// 条目列表中目录在前，node->pos 与条目下标一致
+DynamicArray *buildSyntheticEntries(BTreeArena *arena, BTreeNode *root, uint32_t count, uint32_t *numEntries)
+{
+    static const char *parts[] = { "Report", "photo", "TODO", "main", "Makefile", "中文", "data", "v2", ".txt", ".CPP" };
+    const uint32_t dirCount = 64;
+    DynamicArray *entries = darray_new(dirCount + count);
+    QVector<BTreeNode *> dirs;
+    for (uint32_t i = 0; i < dirCount; ++i) {
+        const QByteArray &name = QByteArray(parts[i % 10]) + QByteArray::number(i);
+        BTreeNode *dir = btree_node_new_in(arena, name.constData(), 0, 0, i, true);
+        btree_node_prepend(i < 8 ? root : dirs.at(static_cast<int>(i / 8 - 1)), dir);
+        darray_set_item(entries, dir, i);
+        dirs << dir;
+    }
+
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        QByteArray name;
+        for (int j = 0; j < 3; ++j) {
+            seed = seed * 1103515245 + 12345;
+            name += parts[(seed >> 16) % 10];
+        }
+        name += QByteArray::number(i);
+        BTreeNode *node = btree_node_new_in(arena, name.constData(), 0, 0, dirCount + i, i % 5 == 0);
+        btree_node_prepend(dirs.at(static_cast<int>(i % dirCount)), node);
+        darray_set_item(entries, node, dirCount + i);
+    }
+    *numEntries = dirCount + count;
+    return entries;
+}
+
+// 改动前的节点布局：每个节点单独分配，名称另外复制一份，大小和修改时间保存在节点中
+struct LegacyNode
+{
+    LegacyNode *next;
+    LegacyNode *parent;
+    LegacyNode *children;
+    char *name;
+    time_t mtime;
+    off_t size;
+    uint32_t pos;
+    bool is_dir;
+};
+
+// 按改动前的布局为每个条目分配节点和名称，返回占用的堆内存（含分配器的块头）
+size_t legacyNodesSize(DynamicArray *entries, uint32_t numEntries)
+{
+    size_t total = 0;
+    for (uint32_t i = 0; i < numEntries; ++i) {
+        BTreeNode *node = static_cast<BTreeNode *>(darray_get_item(entries, i));
+        LegacyNode *legacy = static_cast<LegacyNode *>(calloc(1, sizeof(LegacyNode)));
+        legacy->name = strdup(node->name);
+        total += malloc_usable_size(legacy) + malloc_usable_size(legacy->name) + 2 * sizeof(size_t);
+        free(legacy->name);
+        free(legacy);
+    }
+    return total;
+}
+
+QList<BTreeNode *> searchNodes(DatabaseSearch *search, const char *query, bool matchCase, bool searchInPath, BTreeNode *scope = nullptr)
+{
+    db_search_set_scope(search, scope);
+    db_search_update(search, search->entries, search->num_entries, 0, FSEARCH_FILTER_NONE,
+                     query, false, matchCase, false, true, searchInPath);
+    FsearchQuery *q = fsearch_query_new(query, nullptr, nullptr, nullptr, matchCase, false, true, searchInPath);
+    DatabaseSearchResult *result = db_search(search, q);
+    fsearch_query_free(q);
+
+    QList<BTreeNode *> nodes;
+    for (guint i = 0; result->results && i < result->results->len; ++i)
+        nodes << db_search_entry_get_node(static_cast<DatabaseSearchEntry *>(g_ptr_array_index(result->results, i)));
+    if (result->results)
+        g_ptr_array_free(result->results, TRUE);
+    free(result);
+    return nodes;
+}
+} // namespace
+
+// 对比逐个节点匹配与在条目表上批量匹配的搜索速度，并输出改动前后每个条目的内存占用，
+// 条目数量可以用 DFM_FSEARCH_BENCHMARK_ENTRIES 调整
+TEST(BenchmarkFsearch, tst_benchmark_search) {
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("DFM_FSEARCH_BENCHMARK_ENTRIES", &ok);
+    if (!ok || count <= 0)
+        count = 200000;
+
+    FsearchThreadPool *pool = fsearch_thread_pool_init();
+    DatabaseSearch *search = db_search_new(pool);
+    BTreeArena *arena = btree_arena_new();
+    BTreeNode *root = btree_node_new_in(arena, "", 0, 0, 0, true);
+    uint32_t numEntries = 0;
+    search->entries = buildSyntheticEntries(arena, root, static_cast<uint32_t>(count), &numEntries);
+    search->num_entries = numEntries;
+    FsearchEntryTable *table = fs_entry_table_new(search->entries, numEntries, arena);
+    ASSERT_TRUE(table);
+    // 改动前：单独分配的节点和名称加上条目列表
+    const size_t listSize = numEntries * sizeof(void *);
+    const size_t legacySize = legacyNodesSize(search->entries, numEntries);
+    std::cout << numEntries << " entries before: nodes " << legacySize / numEntries
+              << " + list " << listSize / numEntries
+              << " = " << (legacySize + listSize) / numEntries << " bytes/entry" << std::endl;
+    // 改动后：竞技场（节点、唯一一份名称、大小和修改时间列）、条目列表与条目表
+    const size_t arenaSize = btree_arena_get_used(arena);
+    const size_t tableSize = fs_entry_table_get_size(table);
+    std::cout << numEntries << " entries after: arena " << arenaSize / numEntries
+              << " + list " << listSize / numEntries
+              << " + table " << tableSize / numEntries
+              << " = " << (arenaSize + listSize + tableSize) / numEntries << " bytes/entry" << std::endl;
+    EXPECT_LT(arenaSize + tableSize, legacySize);
+
+    const char *queries[] = { "makefile", "TODO", "photo 中文", "v2.cpp1" };
+    const int rounds = 10;
+    int expectedResults = -1;
+    for (bool flat : { false, true }) {
+        db_search_set_entry_table(search, flat ? table : nullptr);
+        int results = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < rounds; ++i) {
+            for (const char *query : queries)
+                results += searchNodes(search, query, false, false).size();
+        }
+        const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+        if (expectedResults < 0)
+            expectedResults = results;
+        EXPECT_EQ(expectedResults, results);
+        std::cout << "search " << numEntries << " entries " << (flat ? fs_memmem_get_impl_name() : "per node") << ": "
+                  << rounds * 4 * 1000 / elapsed << " queries/s" << std::endl;
+    }
+
+    db_search_set_entry_table(search, nullptr);
+    fs_entry_table_free(table);
+    darray_free(search->entries);
+    btree_arena_free(arena);
+    db_search_free(search);
+    fsearch_thread_pool_free(pool);
+}
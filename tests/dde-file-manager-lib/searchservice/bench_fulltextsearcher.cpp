@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QDir>
+#include <QTemporaryDir>
+
+#include <gtest/gtest.h>
+#include <iostream>
+
+#define private public
+#include "searcher/fulltext/fulltextsearcher.h"
+#include "searcher/fulltext/fulltextsearcher_p.h"
+#include "searcher/fulltext/chineseanalyzer.h"
+
+// 对比单线程和多线程解析文档建立索引的吞吐量，文档数量可以用 DFM_FULLTEXT_BENCHMARK_FILES 调整
+TEST(BenchmarkFullTextIndex, tst_benchmark_index_pipeline) {
+    QTemporaryDir corpusDir;
+    QTemporaryDir indexDir;
+    ASSERT_TRUE(corpusDir.isValid());
+    ASSERT_TRUE(indexDir.isValid());
+
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("DFM_FULLTEXT_BENCHMARK_FILES", &ok);
+    if (!ok || count <= 0)
+        count = 200;
+
+    QDir corpus(corpusDir.path());
+    for (int i = 0; i < count; ++i) {
+        const QString &subDir = QString("dir_%1").arg(i % 10);
+        corpus.mkpath(subDir);
+        QFile file(corpus.absoluteFilePath(subDir + QString("/doc_%1.%2").arg(i).arg(i % 2 ? "txt" : "md")));
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+        for (int line = 0; line < 200; ++line)
+            file.write(QString("document %1 line %2 全文搜索 benchmark content\n").arg(i).arg(line).toUtf8());
+    }
+
+    FullTextSearcher searcher(DUrl::fromLocalFile(corpusDir.path()), "benchmark");
+    FullTextSearcherPrivate *d = searcher.d;
+    d->status.storeRelease(AbstractSearcher::kRuning);
+
+    const int workerCount = d->indexWorkerCount;
+    for (int workers : QList<int> {1, workerCount}) {
+        d->indexWorkerCount = workers;
+        Lucene::IndexWriterPtr writer = Lucene::newLucene<Lucene::IndexWriter>(Lucene::FSDirectory::open(indexDir.path().toStdWString()),
+                                                                               Lucene::newLucene<ChineseAnalyzer>(),
+                                                                               true,
+                                                                               Lucene::IndexWriter::MaxFieldLengthLIMITED);
+        d->runIndexPipeline(nullptr, writer, corpusDir.path(), FullTextSearcherPrivate::kCreate);
+        EXPECT_EQ(count, writer->numDocs());
+        writer->close();
+
+        const IndexStatistics &statistics = d->indexStatistics;
+        EXPECT_EQ(count, statistics.documents);
+        std::cout << "index " << count << " documents with " << workers << " workers: "
+                  << statistics.documentsPerSecond() << " docs/s, "
+                  << statistics.bytesPerSecond() / 1024 << " KB/s" << std::endl;
+    }
+
+    d->status.storeRelease(AbstractSearcher::kCompleted);
+}
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QStandardPaths>
+#include <QUuid>
+#include <QDir>
+#include <QFile>
+
+#include <gtest/gtest.h>
+
+#define private public
+#include "searcher/fsearch/fsdatabasemanager.h"
+
+namespace {
+class TestFsDatabaseManager : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        QStringList paths = QStandardPaths::standardLocations(QStandardPaths::TempLocation);
+        if (!paths.isEmpty()) {
+            QString dirName = QUuid::createUuid().toString(QUuid::WithoutBraces);
+            filePath = paths.at(0) + QDir::separator() + dirName;
+            QDir dir;
+            dir.mkpath(filePath + "/sub");
+        }
+        manager = new FsDatabaseManager;
+    }
+
+    void TearDown() override
+    {
+        delete manager;
+        manager = nullptr;
+        QDir(filePath).removeRecursively();
+    }
+
+public:
+    FsDatabaseManager *manager = nullptr;
+    QString filePath;
+};
+} // namespace
+
+TEST_F(TestFsDatabaseManager, tst_databaseRoot)
+{
+    // 家目录中的搜索只使用家目录的数据库，不索引整个根文件系统
+    const QString &home = QDir::homePath();
+    EXPECT_EQ(home, FsDatabaseManager::databaseRoot(home));
+    EXPECT_EQ(home, FsDatabaseManager::databaseRoot(home + "/Desktop/"));
+    EXPECT_TRUE(FsDatabaseManager::databaseRoot("/").isEmpty());
+    EXPECT_TRUE(FsDatabaseManager::databaseRoot("").isEmpty());
+}
+
+TEST_F(TestFsDatabaseManager, tst_database_not_ready)
+{
+    // 首次请求只触发后台加载
+    EXPECT_TRUE(manager->database(QDir::homePath()).isNull());
+    EXPECT_EQ(1, manager->databases.size());
+}
+
+TEST_F(TestFsDatabaseManager, tst_watch_budget)
+{
+    manager->maxWatchCount = 1;
+    manager->watchDirectories({ filePath, filePath + "/sub" });
+    EXPECT_TRUE(manager->isWatched(filePath));
+    EXPECT_FALSE(manager->isWatched(filePath + "/sub"));
+
+    // 被监视的目录删除后不再视为被监视
+    manager->onFileDeleted(filePath, "");
+    EXPECT_FALSE(manager->isWatched(filePath));
+}
+
+TEST_F(TestFsDatabaseManager, tst_apply_changes)
+{
+    FsDatabasePointer database(new FsDatabase(filePath));
+    database->db = db_new();
+    QByteArray root = filePath.toLocal8Bit();
+    ASSERT_TRUE(db_location_add(database->db, root.data(), database->config, &database->working, nullptr));
+    db_build_initial_entries_list(database->db);
+    EXPECT_EQ(1u, db_get_num_entries(database->db));
+
+    QFile file(filePath + "/sub/new.txt");
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    QByteArray added = file.fileName().toLocal8Bit();
+    char *addedPaths[] = { added.data(), nullptr };
+    EXPECT_TRUE(db_location_apply_changes(database->db, nullptr, addedPaths, database->config));
+    EXPECT_EQ(2u, db_get_num_entries(database->db));
+    BTreeNode *node = db_location_find_node(database->db, added.data());
+    ASSERT_NE(nullptr, node);
+    // 增量合并后目录仍排在文件之前，且 pos 与下标一致
+    EXPECT_EQ(1u, node->pos);
+    EXPECT_EQ(node, darray_get_item(db_get_entries(database->db), 1));
+
+    char *removedPaths[] = { added.data(), nullptr };
+    EXPECT_TRUE(db_location_apply_changes(database->db, removedPaths, nullptr, database->config));
+    EXPECT_EQ(1u, db_get_num_entries(database->db));
+    EXPECT_EQ(nullptr, db_location_find_node(database->db, added.data()));
+}
+
+TEST_F(TestFsDatabaseManager, tst_collect_pending_changes)
+{
+    manager->onFileCreated(filePath, "a");
+    manager->onFileMoved(filePath, "a", filePath, "b");
+    EXPECT_TRUE(manager->pendingRemoved.contains(filePath + "/a"));
+    EXPECT_TRUE(manager->pendingAdded.contains(filePath + "/b"));
+    EXPECT_NO_FATAL_FAILURE(manager->applyChanges());
+    EXPECT_TRUE(manager->pendingAdded.isEmpty());
+}
@@ -5,9 +5,12 @@
 #include <QStandardPaths>
 #include <QUuid>
 #include <QDir>
+#include <QVector>
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 
 #define private public
 #include "searcher/fsearch/fssearcher.h"
@@ -82,3 +85,204 @@ TEST_F(TestFsSearcher, tst_isSupported) {
 TEST_F(TestFsSearcher, tst_tryNotify) {
     EXPECT_NO_FATAL_FAILURE(search->tryNotify(););
 }
+
+namespace {
+// 在根节点下生成 64 个目录和 count 个文件，名称由固定的片段随机组合，
+// 条目列表中目录在前，node->pos 与条目下标一致
+DynamicArray *buildSyntheticEntries(BTreeArena *arena, BTreeNode *root, uint32_t count, uint32_t *numEntries)
+{
+    static const char *parts[] = { "Report", "photo", "TODO", "main", "Makefile", "中文", "data", "v2", ".txt", ".CPP" };
+    const uint32_t dirCount = 64;
+    DynamicArray *entries = darray_new(dirCount + count);
+    QVector<BTreeNode *> dirs;
+    for (uint32_t i = 0; i < dirCount; ++i) {
+        const QByteArray &name = QByteArray(parts[i % 10]) + QByteArray::number(i);
+        BTreeNode *dir = btree_node_new_in(arena, name.constData(), 0, 0, i, true);
+        btree_node_prepend(i < 8 ? root : dirs.at(static_cast<int>(i / 8 - 1)), dir);
+        darray_set_item(entries, dir, i);
+        dirs << dir;
+    }
+
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        QByteArray name;
+        for (int j = 0; j < 3; ++j) {
+            seed = seed * 1103515245 + 12345;
+            name += parts[(seed >> 16) % 10];
+        }
+        name += QByteArray::number(i);
+        BTreeNode *node = btree_node_new_in(arena, name.constData(), i, i * 512, dirCount + i, i % 5 == 0);
+        btree_node_prepend(dirs.at(static_cast<int>(i % dirCount)), node);
+        darray_set_item(entries, node, dirCount + i);
+    }
+    *numEntries = dirCount + count;
+    return entries;
+}
+
+QList<BTreeNode *> searchNodes(DatabaseSearch *search, const char *query, bool matchCase, bool searchInPath, BTreeNode *scope = nullptr)
+{
+    db_search_set_scope(search, scope);
+    db_search_update(search, search->entries, search->num_entries, 0, FSEARCH_FILTER_NONE,
+                     query, false, matchCase, false, true, searchInPath);
+    FsearchQuery *q = fsearch_query_new(query, nullptr, nullptr, nullptr, matchCase, false, true, searchInPath);
+    DatabaseSearchResult *result = db_search(search, q);
+    fsearch_query_free(q);
+
+    QList<BTreeNode *> nodes;
+    for (guint i = 0; result->results && i < result->results->len; ++i)
+        nodes << db_search_entry_get_node(static_cast<DatabaseSearchEntry *>(g_ptr_array_index(result->results, i)));
+    if (result->results)
+        g_ptr_array_free(result->results, TRUE);
+    free(result);
+    return nodes;
+}
+} // namespace
+
+TEST(TestFsStringMatch, tst_memmem) {
+    const char *haystacks[] = { "", "a", "abcabcabd", "0123456789abcdefghijklmnopqrstuvwxyz_0123456789abcdefghijklmnopqrstuvwxyz", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab" };
+    const char *needles[] = { "", "a", "ab", "abd", "xyz_0", "z", "aab", "nomatch", "stuvwxyz" };
+    for (const char *haystack : haystacks) {
+        for (const char *needle : needles) {
+            const size_t haystackLen = strlen(haystack);
+            const size_t needleLen = strlen(needle);
+            const void *expected = memmem(haystack, haystackLen, needle, needleLen);
+            EXPECT_EQ(expected, fs_memmem(haystack, haystackLen, needle, needleLen))
+                << fs_memmem_get_impl_name() << " " << haystack << " " << needle;
+        }
+    }
+}
+
+TEST(TestFsStringMatch, tst_fold_ascii) {
+    const QByteArray &source = QString("ABCxyz 中文 Ünïcode [@] 0123456789 THE QUICK BROWN FOX").toUtf8();
+    QByteArray folded(source.size(), '\0');
+    fs_str_fold_ascii(folded.data(), source.constData(), static_cast<size_t>(source.size()));
+    EXPECT_EQ(QString("abcxyz 中文 Ünïcode [@] 0123456789 the quick brown fox").toUtf8(), folded);
+}
+
+TEST(TestFsBTree, tst_arena_columns) {
+    BTreeArena *arena = btree_arena_new();
+    BTreeNode *root = btree_node_new_in(arena, "", 0, 0, 0, true);
+    // 超过一个列块和一个内存块，名称偏移和大小、修改时间都要跨块正确
+    const uint32_t count = 100000;
+    QVector<BTreeNode *> nodes;
+    for (uint32_t i = 0; i < count; ++i) {
+        const QByteArray &name = QByteArray("Name") + QByteArray::number(i);
+        BTreeNode *node = btree_node_new_in(arena, name.constData(), 1000 + i, 3 * i, i, false);
+        btree_node_prepend(root, node);
+        nodes << node;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        BTreeNode *node = nodes.at(static_cast<int>(i));
+        const uint32_t offset = btree_arena_get_name_offset(arena, node);
+        ASSERT_NE(BTREE_ARENA_NO_OFFSET, offset);
+        // 名称只保存一份，偏移指向节点中的名称
+        EXPECT_EQ(node->name, btree_arena_get_name(arena, offset));
+        EXPECT_EQ(static_cast<off_t>(3 * i), btree_node_get_size(arena, node));
+        EXPECT_EQ(static_cast<time_t>(1000 + i), btree_node_get_mtime(arena, node));
+    }
+
+    // 不属于该竞技场的节点没有偏移，也没有大小和修改时间
+    BTreeArena *other = btree_arena_new();
+    BTreeNode *otherNode = btree_node_new_in(other, "other", 1, 1, 0, false);
+    EXPECT_EQ(BTREE_ARENA_NO_OFFSET, btree_arena_get_name_offset(arena, otherNode));
+    BTreeNode *heapNode = btree_node_new("heap", 0, false);
+    EXPECT_EQ(BTREE_ARENA_NO_OFFSET, btree_arena_get_name_offset(arena, heapNode));
+    EXPECT_EQ(0, btree_node_get_size(arena, heapNode));
+    EXPECT_EQ(0, btree_node_get_mtime(arena, heapNode));
+
+    btree_node_free(heapNode);
+    btree_arena_free(other);
+    btree_arena_free(arena);
+}
+
+TEST(TestFsBTree, tst_arena) {
+    BTreeArena *arena = btree_arena_new();
+    BTreeNode *root = btree_node_new_in(arena, "", 0, 0, 0, true);
+    uint32_t count = 0;
+    DynamicArray *entries = buildSyntheticEntries(arena, root, 1000, &count);
+    EXPECT_EQ(count + 1, btree_node_n_nodes(root));
+    EXPECT_GE(btree_arena_get_used(arena), (count + 1) * sizeof(BTreeNode));
+
+    // 释放竞技场中的节点只会摘除，内存随竞技场一起释放
+    BTreeNode *dir = static_cast<BTreeNode *>(darray_get_item(entries, 8));
+    const uint32_t removed = btree_node_n_nodes(dir);
+    btree_node_free(dir);
+    EXPECT_EQ(count + 1 - removed, btree_node_n_nodes(root));
+
+    // 压缩时复制到新的竞技场，树的结构和路径不变
+    BTreeArena *compacted = btree_arena_new();
+    BTreeNode *copy = btree_node_clone(compacted, arena, root);
+    EXPECT_EQ(btree_node_n_nodes(root), btree_node_n_nodes(copy));
+    EXPECT_LT(btree_arena_get_used(compacted), btree_arena_get_used(arena));
+    char path[PATH_MAX] = "";
+    char copyPath[PATH_MAX] = "";
+    for (BTreeNode *node = root->children, *other = copy->children; node || other; node = node->next, other = other->next) {
+        ASSERT_TRUE(node && other);
+        BTreeNode *leaf = node->children ? node->children : node;
+        BTreeNode *otherLeaf = other->children ? other->children : other;
+        btree_node_get_path_full(leaf, path, sizeof(path));
+        btree_node_get_path_full(otherLeaf, copyPath, sizeof(copyPath));
+        EXPECT_STREQ(path, copyPath);
+        EXPECT_EQ(btree_node_get_size(arena, leaf), btree_node_get_size(compacted, otherLeaf));
+        EXPECT_EQ(btree_node_get_mtime(arena, leaf), btree_node_get_mtime(compacted, otherLeaf));
+    }
+
+    darray_free(entries);
+    btree_arena_free(arena);
+    btree_arena_free(compacted);
+}
+
+TEST(TestFsStringMatch, tst_search_entry_table) {
+    FsearchThreadPool *pool = fsearch_thread_pool_init();
+    DatabaseSearch *search = db_search_new(pool);
+    BTreeArena *arena = btree_arena_new();
+    BTreeNode *root = btree_node_new_in(arena, "", 0, 0, 0, true);
+    uint32_t count = 0;
+    DynamicArray *entries = buildSyntheticEntries(arena, root, 20000, &count);
+
+    // 复制后的节点按树的深度优先顺序存放，与条目顺序不一致，扫描名称时不能连成一段
+    BTreeArena *cloned = btree_arena_new();
+    BTreeNode *clonedRoot = btree_node_clone(cloned, arena, root);
+    DynamicArray *clonedEntries = darray_new(count);
+    btree_node_children_foreach(clonedRoot, [](BTreeNode *child, void *data) {
+        btree_node_traverse(child, [](BTreeNode *node, void *list) {
+            darray_set_item(static_cast<DynamicArray *>(list), node, node->pos);
+            return true;
+        }, data);
+    }, clonedEntries);
+
+    // 使用条目表的结果必须与逐个访问节点的结果一致
+    const char *queries[] = { "report", "REPORT", "Report", "todo main", "中文", "*.txt", "ph?to", "report1/", "v2.cpp", "nomatch" };
+    for (bool ordered : { true, false }) {
+        search->entries = ordered ? entries : clonedEntries;
+        search->num_entries = count;
+        BTreeNode *scopeRoot = ordered ? root : clonedRoot;
+        FsearchEntryTable *table = fs_entry_table_new(search->entries, count, ordered ? arena : cloned);
+        ASSERT_TRUE(table);
+        BTreeNode *scopes[] = { nullptr, scopeRoot, static_cast<BTreeNode *>(darray_get_item(search->entries, 3)),
+                                static_cast<BTreeNode *>(darray_get_item(search->entries, 40)) };
+        for (const char *query : queries) {
+            for (BTreeNode *scope : scopes) {
+                for (bool matchCase : { false, true }) {
+                    for (bool searchInPath : { false, true }) {
+                        db_search_set_entry_table(search, nullptr);
+                        const QList<BTreeNode *> &expected = searchNodes(search, query, matchCase, searchInPath, scope);
+                        db_search_set_entry_table(search, table);
+                        EXPECT_EQ(expected, searchNodes(search, query, matchCase, searchInPath, scope))
+                            << query << " " << ordered << " " << matchCase << " " << searchInPath;
+                    }
+                }
+            }
+        }
+        db_search_set_entry_table(search, nullptr);
+        fs_entry_table_free(table);
+    }
+
+    db_search_set_scope(search, nullptr);
+    darray_free(entries);
+    darray_free(clonedEntries);
+    btree_arena_free(arena);
+    btree_arena_free(cloned);
+    db_search_free(search);
+    fsearch_thread_pool_free(pool);
+}
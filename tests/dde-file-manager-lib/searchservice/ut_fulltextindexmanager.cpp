@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+#include <gtest/gtest.h>
+
+#define private public
+#include "searcher/fulltext/fulltextindexmanager.h"
+
+namespace {
+class TestFullTextIndexManager : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        manager = new FullTextIndexManager;
+    }
+
+    void TearDown() override
+    {
+        // 不把测试产生的变化写入真实的日志
+        manager->pendingChanges.clear();
+        delete manager;
+        manager = nullptr;
+    }
+
+public:
+    FullTextIndexManager *manager = nullptr;
+};
+} // namespace
+
+TEST_F(TestFullTextIndexManager, tst_journal)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &journal = dir.path() + "/journal";
+
+    FullTextIndexManager::Changes changes;
+    EXPECT_FALSE(FullTextIndexManager::readJournal(journal, changes));
+
+    FullTextIndexManager::Changes first;
+    first.insert("/home/test/a.txt", FullTextIndexManager::kUpdate);
+    first.insert("/home/test/b.doc", FullTextIndexManager::kUpdate);
+    ASSERT_TRUE(FullTextIndexManager::appendJournal(journal, first));
+
+    FullTextIndexManager::Changes second;
+    second.insert("/home/test/a.txt", FullTextIndexManager::kDelete);
+    second.insert("/home/test/dir", FullTextIndexManager::kDelete);
+    ASSERT_TRUE(FullTextIndexManager::appendJournal(journal, second));
+
+    // 同一文件以后记录的变化为准
+    ASSERT_TRUE(FullTextIndexManager::readJournal(journal, changes));
+    EXPECT_EQ(3, changes.size());
+    EXPECT_EQ(FullTextIndexManager::kDelete, changes.value("/home/test/a.txt"));
+    EXPECT_EQ(FullTextIndexManager::kUpdate, changes.value("/home/test/b.doc"));
+    EXPECT_EQ(FullTextIndexManager::kDelete, changes.value("/home/test/dir"));
+
+    // 写入中断留下的不完整记录被忽略
+    QFile file(journal);
+    ASSERT_TRUE(file.open(QIODevice::Append));
+    file.write("\x00\x00", 2);
+    file.close();
+
+    changes.clear();
+    ASSERT_TRUE(FullTextIndexManager::readJournal(journal, changes));
+    EXPECT_EQ(3, changes.size());
+}
+
+TEST_F(TestFullTextIndexManager, tst_record_changes)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QDir(dir.path()).mkdir("sub");
+
+    manager->onFileCreated(dir.path(), "a.txt");
+    manager->onFileCreated(dir.path(), "sub");
+    manager->onFileCreated(dir.path(), "image.png");
+    manager->onFileChanged(dir.path(), "b.docx");
+    manager->onFileDeleted(dir.path(), "a.txt");
+    manager->onFileMoved(dir.path(), "c.pdf", dir.path(), "d.pdf");
+
+    const FullTextIndexManager::Changes &changes = manager->pendingChanges;
+    EXPECT_EQ(5, changes.size());
+    EXPECT_EQ(FullTextIndexManager::kDelete, changes.value(dir.path() + "/a.txt"));
+    EXPECT_EQ(FullTextIndexManager::kUpdate, changes.value(dir.path() + "/sub"));
+    EXPECT_EQ(FullTextIndexManager::kUpdate, changes.value(dir.path() + "/b.docx"));
+    EXPECT_EQ(FullTextIndexManager::kDelete, changes.value(dir.path() + "/c.pdf"));
+    EXPECT_EQ(FullTextIndexManager::kUpdate, changes.value(dir.path() + "/d.pdf"));
+    EXPECT_FALSE(changes.contains(dir.path() + "/image.png"));
+    EXPECT_TRUE(manager->journalTimer->isActive());
+}
+
+TEST_F(TestFullTextIndexManager, tst_flush_not_watching)
+{
+    // 未开始监视时调用方需要遍历目录更新索引
+    EXPECT_FALSE(manager->isWatching());
+    EXPECT_FALSE(manager->flush());
+}
+
+TEST_F(TestFullTextIndexManager, tst_flush_busy)
+{
+    // 其他线程正在写入索引时，搜索不等待，由调用方逐个检查结果
+    manager->watching.storeRelease(1);
+    manager->flushMutex.lock();
+    EXPECT_FALSE(manager->flush(false));
+    manager->flushMutex.unlock();
+    manager->watching.storeRelease(0);
+}
+
+TEST_F(TestFullTextIndexManager, tst_watch_directories)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    EXPECT_FALSE(manager->isWatched(dir.path()));
+
+    // 只有被监视目录中的搜索结果可以跳过文件检查
+    manager->watchDirectories({dir.path()});
+    EXPECT_TRUE(manager->isWatched(dir.path()));
+    EXPECT_FALSE(manager->isWatched(dir.path() + "/sub"));
+
+    manager->onFileDeleted(dir.path(), "");
+    EXPECT_FALSE(manager->isWatched(dir.path()));
+}
@@ -5,12 +5,18 @@
 #include <QStandardPaths>
 #include <QUuid>
 #include <QDir>
+#include <QTemporaryDir>
+#include <QtConcurrent>
 
 #include <gtest/gtest.h>
 
 
 #define private public
 #include "searcher/fulltext/fulltextsearcher.h"
+#include "searcher/fulltext/fulltextsearcher_p.h"
+#include "searcher/fulltext/chineseanalyzer.h"
+
+#include <QueryWrapperFilter.h>
 
 namespace {
 class TestFullTextSearcher : public testing::Test
@@ -78,3 +84,84 @@ TEST_F(TestFullTextSearcher, tst_isSupport) {
     DUrl url = DUrl("file://" + filePath);
     EXPECT_NO_FATAL_FAILURE(search->isSupport(url));
 }
+
+TEST(TestIndexQueue, tst_push_pop) {
+    IndexQueue<int> queue(2);
+    QFuture<void> producer = QtConcurrent::run([&queue]() {
+        for (int i = 0; i < 100; ++i)
+            queue.push(i);
+        queue.close();
+    });
+
+    int value = -1;
+    int expected = 0;
+    while (queue.pop(value))
+        EXPECT_EQ(expected++, value);
+
+    producer.waitForFinished();
+    EXPECT_EQ(100, expected);
+    EXPECT_FALSE(queue.push(100));
+}
+
+TEST(TestFullTextIndex, tst_ancestor_directories) {
+    EXPECT_EQ(QStringList({"/home/test/doc", "/home/test", "/home", "/"}),
+              FullTextSearcherPrivate::ancestorDirectories("/home/test/doc/a.txt"));
+    EXPECT_EQ(QStringList({"/"}), FullTextSearcherPrivate::ancestorDirectories("/a.txt"));
+}
+
+TEST(TestFullTextIndex, tst_file_document) {
+    QTemporaryDir corpusDir;
+    QTemporaryDir indexDir;
+    ASSERT_TRUE(corpusDir.isValid());
+    ASSERT_TRUE(indexDir.isValid());
+
+    QDir corpus(corpusDir.path());
+    corpus.mkpath("sub");
+    for (const QString &name : QStringList {"a.txt", "sub/b.txt"}) {
+        QFile file(corpus.absoluteFilePath(name));
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+        file.write("compact index keyword");
+    }
+
+    // 只保存路径、修改时间和大小，不保存原文
+    const QString &file = corpus.absoluteFilePath("sub/b.txt");
+    Lucene::DocumentPtr doc = FullTextSearcherPrivate::fileDocument(file);
+    EXPECT_EQ(file.toStdWString(), doc->get(L"path"));
+    EXPECT_TRUE(doc->get(L"contents").empty());
+    EXPECT_FALSE(FullTextSearcherPrivate::isDocumentStale(doc, QFileInfo(file)));
+
+    Lucene::IndexWriterPtr writer = Lucene::newLucene<Lucene::IndexWriter>(Lucene::FSDirectory::open(indexDir.path().toStdWString()),
+                                                                           Lucene::newLucene<ChineseAnalyzer>(),
+                                                                           true,
+                                                                           Lucene::IndexWriter::MaxFieldLengthLIMITED);
+    writer->addDocument(doc);
+    writer->addDocument(FullTextSearcherPrivate::fileDocument(corpus.absoluteFilePath("a.txt")));
+    writer->close();
+
+    // 保存的文档不包含原文，重新读取后仍能判断文件是否变化
+    Lucene::IndexReaderPtr reader = Lucene::IndexReader::open(Lucene::FSDirectory::open(indexDir.path().toStdWString()), true);
+    Lucene::SearcherPtr searcher = Lucene::newLucene<Lucene::IndexSearcher>(reader);
+    Lucene::QueryPtr query = Lucene::newLucene<Lucene::TermQuery>(Lucene::newLucene<Lucene::Term>(L"contents", L"keyword"));
+
+    auto scopeFilter = [](const QString &dir) {
+        return Lucene::newLucene<Lucene::QueryWrapperFilter>(
+                    Lucene::newLucene<Lucene::TermQuery>(Lucene::newLucene<Lucene::Term>(L"dir", dir.toStdWString())));
+    };
+    EXPECT_EQ(2, searcher->search(query, scopeFilter(corpusDir.path()), 10)->totalHits);
+    EXPECT_EQ(2, searcher->search(query, scopeFilter("/"), 10)->totalHits);
+
+    Lucene::TopDocsPtr topDocs = searcher->search(query, scopeFilter(corpus.absoluteFilePath("sub")), 10);
+    ASSERT_EQ(1, topDocs->totalHits);
+    Lucene::DocumentPtr stored = searcher->doc(topDocs->scoreDocs[0]->doc);
+    EXPECT_EQ(file.toStdWString(), stored->get(L"path"));
+    EXPECT_TRUE(stored->get(L"contents").empty());
+    EXPECT_FALSE(FullTextSearcherPrivate::isDocumentStale(stored, QFileInfo(file)));
+
+    QFile changed(file);
+    ASSERT_TRUE(changed.open(QIODevice::Append));
+    changed.write(" changed");
+    changed.close();
+    EXPECT_TRUE(FullTextSearcherPrivate::isDocumentStale(stored, QFileInfo(file)));
+
+    reader->close();
+}
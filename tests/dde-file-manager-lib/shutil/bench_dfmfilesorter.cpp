@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "shutil/dfmfilesorter.h"
+#include "dfmapplication.h"
+
+#include <gtest/gtest.h>
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <iostream>
+
+namespace {
+class SortTestFileInfo : public DAbstractFileInfo
+{
+public:
+    SortTestFileInfo(const QString &name, bool dir, qint64 fileSize, const QDateTime &modified)
+        : DAbstractFileInfo(DUrl::fromLocalFile("/tmp/" + name), false)
+        , name(name), dir(dir), fileSizeValue(fileSize), modified(modified) {}
+
+    QString fileDisplayName() const override { return name; }
+    bool isDir() const override { return dir; }
+    bool isFile() const override { return !dir; }
+    qint64 size() const override { return fileSizeValue; }
+    QDateTime lastModified() const override { return modified; }
+
+private:
+    QString name;
+    bool dir;
+    qint64 fileSizeValue;
+    QDateTime modified;
+};
+
+QList<DAbstractFileInfoPointer> createInfos(int count)
+{
+    QList<DAbstractFileInfoPointer> infos;
+    const QDateTime base = QDateTime::currentDateTime();
+    // 固定种子，保证每次运行的数据相同
+    QRandomGenerator generator(1);
+    for (int i = 0; i < count; ++i) {
+        QString name;
+        switch (i % 4) {
+        case 0: name = QString("file%1.txt").arg(generator.bounded(count)); break;
+        case 1: name = QString("文件%1").arg(generator.bounded(count)); break;
+        case 2: name = QString("_tmp%1").arg(generator.bounded(100)); break;
+        default: name = QString("Dir %1").arg(generator.bounded(count)); break;
+        }
+        infos << DAbstractFileInfoPointer(new SortTestFileInfo(name, i % 7 == 0, generator.bounded(1000), base.addSecs(generator.bounded(500))));
+    }
+    return infos;
+}
+
+// 原有的二分插入排序
+QList<DAbstractFileInfoPointer> insertionSort(const QList<DAbstractFileInfoPointer> &infos,
+                                              const DAbstractFileInfo::CompareFunction &sortFun, Qt::SortOrder order)
+{
+    QList<DAbstractFileInfoPointer> sortList;
+    for (const auto &info : infos) {
+        int begin = 0;
+        int end = sortList.count();
+        int row = (begin + end) / 2;
+        forever {
+            if (begin == end)
+                break;
+            if (!sortFun(info, sortList.at(row), order, DFMApplication::appAttribute(DFMApplication::AA_FileAndDirMixedSort).toBool())) {
+                begin = row;
+                row = (end + begin + 1) / 2;
+                if (row >= end)
+                    break;
+            } else {
+                end = row;
+                row = (end + begin) / 2;
+            }
+        }
+        sortList.insert(row, info);
+    }
+    return sortList;
+}
+
+bool isOrdered(const QList<DAbstractFileInfoPointer> &list, const DAbstractFileInfo::CompareFunction &sortFun, Qt::SortOrder order)
+{
+    const bool isMixedSort = DFMApplication::appAttribute(DFMApplication::AA_FileAndDirMixedSort).toBool();
+    for (int i = 1; i < list.size(); ++i) {
+        if (sortFun(list.at(i), list.at(i - 1), order, isMixedSort))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+// 与原有的二分插入排序对比耗时
+TEST(BenchmarkDFMFileSorter, tst_benchmark_against_insertion_sort)
+{
+    const QList<DAbstractFileInfoPointer> infos = createInfos(50000);
+    const auto fun = FileSortFunction::compareFileListByDisplayName;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<DAbstractFileInfoPointer> &oldList = insertionSort(infos, fun, Qt::AscendingOrder);
+    const qint64 oldCost = timer.restart();
+
+    QList<DAbstractFileInfoPointer> newList = infos;
+    DFMFileSorter(fun, Qt::AscendingOrder).sort(newList, [](const DAbstractFileInfoPointer &info) { return info; });
+    const qint64 newCost = timer.elapsed();
+
+    std::cout << "sort " << infos.size() << " files, insertion sort: " << oldCost
+              << " ms, DFMFileSorter: " << newCost << " ms" << std::endl;
+    EXPECT_TRUE(isOrdered(oldList, fun, Qt::AscendingOrder));
+    EXPECT_TRUE(isOrdered(newList, fun, Qt::AscendingOrder));
+}
@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "shutil/dfmthumbnailimagereader.h"
+
+#include <gtest/gtest.h>
+
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImageReader>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <iostream>
+
+namespace {
+QByteArray toJpeg(const QSize &size, const QColor &color)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(color);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "jpeg");
+
+    return data;
+}
+
+void appendU16(QByteArray &data, quint16 value)
+{
+    uchar buf[2];
+    qToLittleEndian(value, buf);
+    data.append(reinterpret_cast<const char *>(buf), 2);
+}
+
+void appendU32(QByteArray &data, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian(value, buf);
+    data.append(reinterpret_cast<const char *>(buf), 4);
+}
+
+void appendEntry(QByteArray &data, quint16 tag, quint16 type, quint32 value)
+{
+    appendU16(data, tag);
+    appendU16(data, type);
+    appendU32(data, 1);
+    if (type == 3) {
+        appendU16(data, static_cast<quint16>(value));
+        appendU16(data, 0);
+    } else {
+        appendU32(data, value);
+    }
+}
+
+// 生成带 EXIF 缩略图的 JPEG 文件，IFD0 记录方向，IFD1 指向缩略图
+QByteArray createExifJpeg(const QSize &mainSize, const QSize &thumbSize, int orientation)
+{
+    const QByteArray &thumb = toJpeg(thumbSize, Qt::red);
+
+    QByteArray tiff("II", 2);
+    appendU16(tiff, 42);
+    appendU32(tiff, 8);
+    // IFD0
+    appendU16(tiff, 1);
+    appendEntry(tiff, 0x0112, 3, static_cast<quint32>(orientation));
+    appendU32(tiff, 26);
+    // IFD1
+    appendU16(tiff, 2);
+    appendEntry(tiff, 0x0201, 4, 56);
+    appendEntry(tiff, 0x0202, 4, static_cast<quint32>(thumb.size()));
+    appendU32(tiff, 0);
+    tiff.append(thumb);
+
+    QByteArray app1("\xff\xe1", 2);
+    uchar length[2];
+    qToBigEndian(static_cast<quint16>(2 + 6 + tiff.size()), length);
+    app1.append(reinterpret_cast<const char *>(length), 2);
+    app1.append(QByteArray("Exif\0\0", 6));
+    app1.append(tiff);
+
+    const QByteArray &main = toJpeg(mainSize, Qt::blue);
+    return main.left(2) + app1 + main.mid(2);
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+// 重置进程的内存峰值，内核不支持重置时 peakRss 返回的是整个进程的峰值
+void resetPeakRss()
+{
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly))
+        clearRefs.write("5");
+}
+
+// 进程的内存峰值，单位 KB
+qint64 peakRss()
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly))
+        return 0;
+
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+
+    return 0;
+}
+}
+
+// 对比完整解码后缩放与快速路径的耗时和内存峰值，图片数量可以用 DFM_THUMBNAIL_BENCHMARK_FILES 调整，
+// 也可以用 DFM_THUMBNAIL_BENCHMARK_DIR 指定真实的照片目录
+TEST(BenchmarkDFMThumbnailImageReader, tst_benchmark_thumbnail_decode)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    QStringList files;
+    const QString &corpus = QString::fromLocal8Bit(qgetenv("DFM_THUMBNAIL_BENCHMARK_DIR"));
+    if (!corpus.isEmpty()) {
+        for (const QFileInfo &info : QDir(corpus).entryInfoList({"*.jpg", "*.jpeg", "*.JPG", "*.JPEG"}, QDir::Files))
+            files << info.absoluteFilePath();
+    } else {
+        bool ok = false;
+        int count = qEnvironmentVariableIntValue("DFM_THUMBNAIL_BENCHMARK_FILES", &ok);
+        if (!ok || count <= 0)
+            count = 10;
+
+        const QByteArray &data = createExifJpeg(QSize(4000, 3000), QSize(320, 240), 1);
+        for (int i = 0; i < count; ++i) {
+            const QString &path = dir.path() + QString("/photo_%1.jpg").arg(i);
+            ASSERT_TRUE(writeFile(path, data));
+            files << path;
+        }
+    }
+    ASSERT_FALSE(files.isEmpty());
+
+    const int size = 256;
+    QElapsedTimer timer;
+
+    resetPeakRss();
+    timer.start();
+    for (const QString &file : files) {
+        QImage image = QImageReader(file).read();
+        image = image.scaled(size, size, Qt::KeepAspectRatio);
+        EXPECT_FALSE(image.isNull());
+    }
+    const qint64 fullCost = timer.elapsed();
+    const qint64 fullRss = peakRss();
+
+    int previewCount = 0;
+    resetPeakRss();
+    timer.restart();
+    for (const QString &file : files) {
+        DFMThumbnailImageReader reader(file, "jpeg");
+        QImage image;
+        EXPECT_TRUE(reader.read(size, image));
+        if (reader.source() == DFMThumbnailImageReader::EmbeddedPreview)
+            ++previewCount;
+    }
+    const qint64 fastCost = timer.elapsed();
+    const qint64 fastRss = peakRss();
+
+    std::cout << "thumbnail " << files.size() << " images, full decode: " << qreal(fullCost) / files.size()
+              << " ms/thumbnail, peak rss " << fullRss << " KB; fast path: " << qreal(fastCost) / files.size()
+              << " ms/thumbnail, peak rss " << fastRss << " KB, embedded previews " << previewCount << std::endl;
+}
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#define private public
+#include "shutil/dsqlitehandle.h"
+
+#include "stubext.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <iostream>
+
+using namespace stub_ext;
+
+// 打标记、查询、重命名、取消标记的吞吐量，文件数量可以用 DFM_TAG_BENCHMARK_FILES 调整
+TEST(BenchmarkDSqliteHandle, tst_benchmark_tag_database)
+{
+    DSqliteHandle sqliteHandle;
+    const QString tagName("ut_sqlit_alpha");
+
+    QTemporaryDir dbDir;
+    QTemporaryDir mountPoint;
+    ASSERT_TRUE(dbDir.isValid());
+    ASSERT_TRUE(mountPoint.isValid());
+
+    bool ok = false;
+    int count = qEnvironmentVariableIntValue("DFM_TAG_BENCHMARK_FILES", &ok);
+    if (!ok || count <= 0)
+        count = 5000;
+
+    // 数据库放在临时目录中，所有文件都属于同一个分区
+    const QString &dbPath = dbDir.path();
+    const QString &mountPath = mountPoint.path();
+    StubExt st;
+    st.set_lamda(&DSqliteHandle::connectToShareSqlite, [dbPath](DSqliteHandle *handle, const QString &, const QString &dbName) {
+        handle->connectToSqlite(dbPath, dbName);
+    });
+    st.set_lamda(&DSqliteHandle::getMountPointOfFile, [mountPath]() {
+        return qMakePair(QString("/dev/ut_benchmark"), mountPath);
+    });
+
+    QMap<QString, QList<QString>> filesAndTags;
+    QMap<QString, QList<QString>> oldAndNewNames;
+    QMap<QString, QList<QString>> renamedFilesAndTags;
+
+    for (int i = 0; i < count; ++i) {
+        const QString &file = QString("%1/benchmark_%2.txt").arg(mountPath).arg(i);
+        filesAndTags[file] = QList<QString>{ tagName };
+        oldAndNewNames[file] = QList<QString>{ file + ".bak" };
+        renamedFilesAndTags[file + ".bak"] = QList<QString>{ tagName };
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    EXPECT_TRUE(sqliteHandle.disposeClientData(filesAndTags, 1).toBool());
+    const qint64 tagCost = timer.restart();
+
+    const QVariantMap &tags = sqliteHandle.disposeClientData(filesAndTags, 14).toMap();
+    const qint64 lookupCost = timer.restart();
+    ASSERT_EQ(count, tags.size());
+    EXPECT_EQ(QStringList{ tagName }, tags.first().toStringList());
+
+    EXPECT_TRUE(sqliteHandle.disposeClientData(oldAndNewNames, 9).toBool());
+    const qint64 renameCost = timer.restart();
+
+    EXPECT_TRUE(sqliteHandle.disposeClientData(renamedFilesAndTags, 4).toBool());
+    const qint64 untagCost = timer.restart();
+
+    const QVariantMap &leftTags = sqliteHandle.disposeClientData(renamedFilesAndTags, 14).toMap();
+    ASSERT_EQ(count, leftTags.size());
+    EXPECT_TRUE(leftTags.first().toStringList().isEmpty());
+
+    auto filesPerSecond = [count](qint64 cost) {
+        return qint64(count * 1000.0 / qMax<qint64>(cost, 1));
+    };
+    std::cout << "tag database " << count << " files, tag: " << tagCost << " ms (" << filesPerSecond(tagCost)
+              << " files/s), lookup: " << lookupCost << " ms (" << filesPerSecond(lookupCost)
+              << " files/s), rename: " << renameCost << " ms (" << filesPerSecond(renameCost)
+              << " files/s), untag: " << untagCost << " ms (" << filesPerSecond(untagCost) << " files/s)" << std::endl;
+}
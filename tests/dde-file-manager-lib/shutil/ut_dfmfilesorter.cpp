@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "shutil/dfmfilesorter.h"
+#include "dfmapplication.h"
+
+#include <gtest/gtest.h>
+
+#include <QRandomGenerator>
+
+namespace {
+class SortTestFileInfo : public DAbstractFileInfo
+{
+public:
+    SortTestFileInfo(const QString &name, bool dir, qint64 fileSize, const QDateTime &modified)
+        : DAbstractFileInfo(DUrl::fromLocalFile("/tmp/" + name), false)
+        , name(name), dir(dir), fileSizeValue(fileSize), modified(modified) {}
+
+    QString fileDisplayName() const override { return name; }
+    bool isDir() const override { return dir; }
+    bool isFile() const override { return !dir; }
+    qint64 size() const override { return fileSizeValue; }
+    QDateTime lastModified() const override { return modified; }
+
+private:
+    QString name;
+    bool dir;
+    qint64 fileSizeValue;
+    QDateTime modified;
+};
+
+QList<DAbstractFileInfoPointer> createInfos(int count)
+{
+    QList<DAbstractFileInfoPointer> infos;
+    const QDateTime base = QDateTime::currentDateTime();
+    // 固定种子，保证每次运行的数据相同
+    QRandomGenerator generator(1);
+    for (int i = 0; i < count; ++i) {
+        // 包含数字、中文和符号开头的名称，以及大量相同的大小和时间
+        QString name;
+        switch (i % 4) {
+        case 0: name = QString("file%1.txt").arg(generator.bounded(count)); break;
+        case 1: name = QString("文件%1").arg(generator.bounded(count)); break;
+        case 2: name = QString("_tmp%1").arg(generator.bounded(100)); break;
+        default: name = QString("Dir %1").arg(generator.bounded(count)); break;
+        }
+        infos << DAbstractFileInfoPointer(new SortTestFileInfo(name, i % 7 == 0, generator.bounded(1000), base.addSecs(generator.bounded(500))));
+    }
+    return infos;
+}
+
+bool isOrdered(const QList<DAbstractFileInfoPointer> &list, const DAbstractFileInfo::CompareFunction &sortFun, Qt::SortOrder order)
+{
+    const bool isMixedSort = DFMApplication::appAttribute(DFMApplication::AA_FileAndDirMixedSort).toBool();
+    for (int i = 1; i < list.size(); ++i) {
+        if (sortFun(list.at(i), list.at(i - 1), order, isMixedSort))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+TEST(TestDFMFileSorter, tst_sort_builtin_columns)
+{
+    const QList<DAbstractFileInfoPointer> infos = createInfos(20000);
+    const QList<DAbstractFileInfo::CompareFunction> funs {
+        FileSortFunction::compareFileListByDisplayName,
+        FileSortFunction::compareFileListBySize,
+        FileSortFunction::compareFileListByModified
+    };
+
+    for (const auto &fun : funs) {
+        for (Qt::SortOrder order : { Qt::AscendingOrder, Qt::DescendingOrder }) {
+            QList<DAbstractFileInfoPointer> list = infos;
+            EXPECT_TRUE(DFMFileSorter(fun, order).sort(list, [](const DAbstractFileInfoPointer &info) { return info; }));
+            EXPECT_EQ(infos.size(), list.size());
+            EXPECT_TRUE(isOrdered(list, fun, order));
+        }
+    }
+}
+
+TEST(TestDFMFileSorter, tst_sort_custom_function)
+{
+    QList<DAbstractFileInfoPointer> list = createInfos(1000);
+    DAbstractFileInfo::CompareFunction fun = [](const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order, bool isMixedSort) {
+        return FileSortFunction::compareFileListBySize(info1, info2, order, isMixedSort);
+    };
+    EXPECT_TRUE(DFMFileSorter(fun, Qt::AscendingOrder).sort(list, [](const DAbstractFileInfoPointer &info) { return info; }));
+    EXPECT_TRUE(isOrdered(list, fun, Qt::AscendingOrder));
+}
+
+TEST(TestDFMFileSorter, tst_sort_canceled)
+{
+    const QList<DAbstractFileInfoPointer> infos = createInfos(1000);
+    QList<DAbstractFileInfoPointer> list = infos;
+    bool cancel = true;
+    EXPECT_FALSE(DFMFileSorter(FileSortFunction::compareFileListByDisplayName, Qt::AscendingOrder, &cancel)
+                 .sort(list, [](const DAbstractFileInfoPointer &info) { return info; }));
+    EXPECT_EQ(infos, list);
+    EXPECT_FALSE(DFMFileSorter(DAbstractFileInfo::CompareFunction(), Qt::AscendingOrder).sort(list, [](const DAbstractFileInfoPointer &info) { return info; }));
+}
@@ -0,0 +1,168 @@
+// SPDX-FileCopyrightText: 2022 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "shutil/dfmthumbnailimagereader.h"
+
+#include <gtest/gtest.h>
+
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+namespace {
+QByteArray toJpeg(const QSize &size, const QColor &color)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(color);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "jpeg");
+
+    return data;
+}
+
+void appendU16(QByteArray &data, quint16 value)
+{
+    uchar buf[2];
+    qToLittleEndian(value, buf);
+    data.append(reinterpret_cast<const char *>(buf), 2);
+}
+
+void appendU32(QByteArray &data, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian(value, buf);
+    data.append(reinterpret_cast<const char *>(buf), 4);
+}
+
+void appendEntry(QByteArray &data, quint16 tag, quint16 type, quint32 value)
+{
+    appendU16(data, tag);
+    appendU16(data, type);
+    appendU32(data, 1);
+    if (type == 3) {
+        appendU16(data, static_cast<quint16>(value));
+        appendU16(data, 0);
+    } else {
+        appendU32(data, value);
+    }
+}
+
+// 生成带 EXIF 缩略图的 JPEG 文件，IFD0 记录方向，IFD1 指向缩略图
+QByteArray createExifJpeg(const QSize &mainSize, const QSize &thumbSize, int orientation)
+{
+    const QByteArray &thumb = toJpeg(thumbSize, Qt::red);
+
+    QByteArray tiff("II", 2);
+    appendU16(tiff, 42);
+    appendU32(tiff, 8);
+    // IFD0
+    appendU16(tiff, 1);
+    appendEntry(tiff, 0x0112, 3, static_cast<quint32>(orientation));
+    appendU32(tiff, 26);
+    // IFD1
+    appendU16(tiff, 2);
+    appendEntry(tiff, 0x0201, 4, 56);
+    appendEntry(tiff, 0x0202, 4, static_cast<quint32>(thumb.size()));
+    appendU32(tiff, 0);
+    tiff.append(thumb);
+
+    QByteArray app1("\xff\xe1", 2);
+    uchar length[2];
+    qToBigEndian(static_cast<quint16>(2 + 6 + tiff.size()), length);
+    app1.append(reinterpret_cast<const char *>(length), 2);
+    app1.append(QByteArray("Exif\0\0", 6));
+    app1.append(tiff);
+
+    const QByteArray &main = toJpeg(mainSize, Qt::blue);
+    return main.left(2) + app1 + main.mid(2);
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+}
+
+TEST(DFMThumbnailImageReaderTest, find_embedded_previews)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/exif.jpg";
+    ASSERT_TRUE(writeFile(path, createExifJpeg(QSize(600, 400), QSize(300, 200), 6)));
+
+    const QList<DFMThumbnailImageReader::Preview> &previews = DFMThumbnailImageReader::embeddedPreviews(path);
+    ASSERT_EQ(1, previews.size());
+    EXPECT_EQ(6, previews.first().orientation);
+
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    ASSERT_TRUE(file.seek(previews.first().offset));
+    QByteArray data = file.read(previews.first().length);
+    QBuffer buffer(&data);
+    EXPECT_EQ(QSize(300, 200), QImageReader(&buffer, "jpeg").size());
+
+    const QString &plain = dir.path() + "/plain.jpg";
+    ASSERT_TRUE(writeFile(plain, toJpeg(QSize(100, 100), Qt::green)));
+    EXPECT_TRUE(DFMThumbnailImageReader::embeddedPreviews(plain).isEmpty());
+
+    const QString &broken = dir.path() + "/broken.jpg";
+    ASSERT_TRUE(writeFile(broken, createExifJpeg(QSize(600, 400), QSize(300, 200), 1).left(40)));
+    EXPECT_TRUE(DFMThumbnailImageReader::embeddedPreviews(broken).isEmpty());
+}
+
+TEST(DFMThumbnailImageReaderTest, read_embedded_preview)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/exif.jpg";
+    ASSERT_TRUE(writeFile(path, createExifJpeg(QSize(600, 400), QSize(300, 200), 6)));
+
+    DFMThumbnailImageReader reader(path, "jpeg");
+    QImage image;
+    ASSERT_TRUE(reader.read(128, image));
+    EXPECT_EQ(DFMThumbnailImageReader::EmbeddedPreview, reader.source());
+    // 按 EXIF 方向旋转了 90 度
+    EXPECT_EQ(128, image.height());
+    EXPECT_LT(image.width(), image.height());
+    EXPECT_GT(qRed(image.pixel(image.width() / 2, image.height() / 2)), 200);
+
+    // 预览图不够大时解码原图
+    ASSERT_TRUE(reader.read(512, image));
+    EXPECT_EQ(DFMThumbnailImageReader::ScaledDecode, reader.source());
+    EXPECT_EQ(512, qMax(image.width(), image.height()));
+}
+
+TEST(DFMThumbnailImageReaderTest, skip_letterboxed_preview)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/exif.jpg";
+    ASSERT_TRUE(writeFile(path, createExifJpeg(QSize(600, 400), QSize(160, 120), 1)));
+
+    DFMThumbnailImageReader reader(path, "jpeg");
+    QImage image;
+    ASSERT_TRUE(reader.read(128, image));
+    EXPECT_EQ(DFMThumbnailImageReader::ScaledDecode, reader.source());
+    EXPECT_EQ(QSize(128, 85), image.size());
+}
+
+TEST(DFMThumbnailImageReaderTest, read_invalid_file)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &path = dir.path() + "/invalid.png";
+    ASSERT_TRUE(writeFile(path, "not an image"));
+
+    DFMThumbnailImageReader reader(path, "png");
+    QImage image;
+    EXPECT_FALSE(reader.read(128, image));
+    EXPECT_EQ(DFMThumbnailImageReader::NoSource, reader.source());
+    EXPECT_FALSE(reader.errorString().isEmpty());
+}
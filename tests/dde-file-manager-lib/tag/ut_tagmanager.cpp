@@ -123,6 +123,41 @@ TEST_F(TestTagManager, can_getTagsThroughFiles)
     EXPECT_TRUE(!m_pManager->getTagsThroughFiles(files).isEmpty());
 }
 
+TEST_F(TestTagManager, can_getTagsOfFiles)
+{
+    ASSERT_NE(m_pManager, nullptr);
+
+    DUrlList files { DUrl::fromLocalFile(tempDirPath_A), DUrl::fromLocalFile(tempDirPath_B) };
+    int queryCount = 0;
+    StubExt stExt;
+    stExt.set_lamda(&TagManagerDaemonController::disposeClientData, [&](TagManagerDaemonController *, const QVariantMap &, Tag::ActionType type) {
+        if (type != Tag::ActionType::GetTagsOfFiles)
+            return QVariant(true);
+
+        ++queryCount;
+        return QVariant(QMap<QString, QVariant>({{tempDirPath_A, QVariant(QStringList({TAG_NAME_A}))}, {tempDirPath_B, QVariant(QStringList())}}));
+    });
+
+    // 清除之前用例留下的缓存
+    m_pManager->deleteFiles(files);
+
+    QHash<DUrl, QList<QString>> tags = m_pManager->getTagsOfFiles(files);
+    EXPECT_EQ(1, queryCount);
+    EXPECT_EQ(QList<QString>({TAG_NAME_A}), tags.value(files.first()));
+    EXPECT_TRUE(tags.contains(files.last()));
+    EXPECT_TRUE(tags.value(files.last()).isEmpty());
+
+    // 命中缓存，单个文件的查询也使用缓存
+    tags = m_pManager->getTagsOfFiles(files);
+    EXPECT_EQ(1, queryCount);
+    EXPECT_EQ(QList<QString>({TAG_NAME_A}), m_pManager->getTagsThroughFiles({files.first()}));
+
+    // 修改标记后缓存失效
+    m_pManager->removeTagsOfFiles({TAG_NAME_A}, {files.first()});
+    m_pManager->getTagsOfFiles(files);
+    EXPECT_EQ(2, queryCount);
+}
+
 TEST_F(TestTagManager, can_getTagColor)
 {
     ASSERT_NE(m_pManager, nullptr);
@@ -159,7 +159,12 @@ unix {
 HEADERS += \
     dialogs/burnoptdialog_p.h
 
-include(test.pri)
+# 性能测试不在单元测试中运行，见 benchmark-dde-file-manager-lib.pro
+CONFIG(benchmark) {
+    include(benchmark.pri)
+} else {
+    include(test.pri)
+}
 
 unix:!macx: LIBS += -L$$OUT_PWD/../../src/dde-file-manager-extension/ -ldfm-extension
 CONFIG(debug, debug|release) {
@@ -30,6 +30,8 @@ SOURCES += \
     $$PWD/shutil/ut_danythingmonitorfilter.cpp \
     $$PWD/shutil/ut_desktopfile.cpp \
     $$PWD/shutil/ut_dfmfilelistfile.cpp \
+    $$PWD/shutil/ut_dfmfilesorter.cpp \
+    $$PWD/shutil/ut_dfmthumbnailimagereader.cpp \
     $$PWD/shutil/ut_dfmregularexpression.cpp \
     $$PWD/controllers/ut_appcontroller.cpp \
     $$PWD/io/ut_dlocalfilehandler.cpp \
@@ -91,6 +93,9 @@ SOURCES += \
 
 SOURCES += \
     $$PWD/io/ut_dfilestatisticsjob.cpp \
+    $$PWD/io/ut_dfilestatisticscache.cpp \
+    $$PWD/io/ut_duringfilecopier.cpp \
+    $$PWD/io/ut_dfilecopyjournal.cpp \
     $$PWD/io/ut_dstorageinfo.cpp \
     $$PWD/io/ut_dfileiodeviceproxy.cpp
 
@@ -314,7 +319,9 @@ SOURCES += \
 SOURCES += \
     $$PWD/searchservice/ut_searchservice.cpp \
     $$PWD/searchservice/ut_fulltextsearcher.cpp \
+    $$PWD/searchservice/ut_fulltextindexmanager.cpp \
     $$PWD/searchservice/ut_fsearch.cpp \
+    $$PWD/searchservice/ut_fsdatabasemanager.cpp \
     $$PWD/searchservice/ut_iteratorsearch.cpp
 
 isEqual(ARCH, x86_64) {